@@ -0,0 +1,20 @@
+/** \file grand_adcplugin.c
+ *  \brief HDF5 plugin entry points of the GRAND ADC filter, built into libgrand_adc.so
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+#include "H5PLextern.h"
+
+H5PL_type_t H5PLget_plugin_type(void)
+{
+  return(H5PL_TYPE_FILTER);
+}
+
+const void *H5PLget_plugin_info(void)
+{
+  return(H5Z_GRAND_ADC);
+}
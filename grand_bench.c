@@ -0,0 +1,1119 @@
+/** \file grand_bench.c
+ *  \brief benchmarks of the GRAND conversion kernels
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "grand_misc.h"
+#include "grand_hdf5.h"
+
+extern AntInfo *field;
+extern int field_size;
+extern char *profile_name[GRAND_N_PROFILE];
+extern char *trace_filter_name[GRAND_N_TRACE_FILTER];
+extern GeoOrigin field_origin;
+extern char *column_name[GRAND_N_COLUMNS];
+extern char *reader_name[GRAND_N_READER];
+#ifdef GRAND_USE_MPI
+extern double mpi_write_seconds;
+#endif
+
+/**
+ * \brief wall clock time in seconds
+ */
+double grand_bench_now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return(ts.tv_sec+1e-9*ts.tv_nsec);
+}
+
+/**
+ * \brief benchmark the trigger time reconstruction kernel
+ * @param[in] n: number of antennas per call
+ * @param[in] repeat: number of calls
+ */
+void grand_bench_timing(int n,int repeat)
+{
+  unsigned int *seconds,*nano_seconds,*ctd,*ctp;
+  float *quant0,*quant1;
+  double *nanosec,t0,dt,check = 0;
+  long long *time_ns;
+
+  seconds = malloc(n*sizeof(unsigned int));
+  nano_seconds = malloc(n*sizeof(unsigned int));
+  ctd = malloc(n*sizeof(unsigned int));
+  ctp = malloc(n*sizeof(unsigned int));
+  quant0 = malloc(n*sizeof(float));
+  quant1 = malloc(n*sizeof(float));
+  nanosec = malloc(n*sizeof(double));
+  time_ns = malloc(n*sizeof(long long));
+  srand(1);
+  for(int i=0;i<n;i++){
+    seconds[i] = 1600000000+i/1000;
+    nano_seconds[i] = rand()%1000000000;
+    ctp[i] = 500000000+rand()%1000;
+    ctd[i] = rand()%ctp[i];
+    quant0[i] = (rand()%2000-1000)/100.;
+    quant1[i] = (rand()%2000-1000)/100.;
+  }
+  t0 = grand_bench_now();
+  for(int r=0;r<repeat;r++){
+    grand_trigger_times(n,seconds,nano_seconds,ctd,ctp,quant0,quant1,nanosec,time_ns);
+    check += nanosec[r%n];
+  }
+  dt = grand_bench_now()-t0;
+  printf("timing: %d antennas x %d calls in %.3f s: %.2f ns/antenna %.1f Mantenna/s (check %g)\n",
+         n,repeat,dt,1e9*dt/((double)n*repeat),(double)n*repeat/dt/1e6,check);
+  free(seconds);
+  free(nano_seconds);
+  free(ctd);
+  free(ctp);
+  free(quant0);
+  free(quant1);
+  free(nanosec);
+  free(time_ns);
+}
+
+/**
+ * \brief benchmark reading back the events of a run
+ * @param[in] hdfname: the HDF5 file
+ * @param[in] runnr: the run number
+ * @param[in] max_events: number of events per batch
+ */
+void grand_bench_read(char *hdfname,int runnr,int max_events)
+{
+  GrandReader reader;
+  GrandEventBatch batch;
+  double t0,dt;
+  long n_events = 0, n_antennas = 0, n_samples = 0;
+  int n;
+
+  if(grand_HDF5open_run(hdfname,runnr,&reader)<0){
+    printf("Cannot open run %d in %s\n",runnr,hdfname);
+    return;
+  }
+  if(grand_HDF5alloc_batch(&batch,max_events,64*max_events,64*8192L*max_events)<0){
+    printf("Cannot allocate the event batch\n");
+    grand_HDF5close_run(&reader);
+    return;
+  }
+  t0 = grand_bench_now();
+  while((n = grand_HDF5read_events(&reader,&batch))>0){
+    n_events += n;
+    n_antennas += batch.n_antennas;
+    n_samples += batch.n_samples;
+  }
+  dt = grand_bench_now()-t0;
+  if(n<0) printf("Read error %d\n",n);
+  printf("read: %ld events %ld antennas %ld samples in %.3f s: %.1f events/s %.1f MB/s\n",
+         n_events,n_antennas,n_samples,dt,n_events/dt,n_samples*sizeof(short)/dt/1e6);
+  grand_HDF5free_batch(&batch);
+  grand_HDF5close_run(&reader);
+}
+
+/**
+ * \brief write synthetic events with the antennas of the field into a new file
+ * @param[in] hdfname: the HDF5 file
+ * @param[in] n_events: the number of events
+ * @param[in] tracelength: the number of samples per channel
+ * \return the size of the file in bytes, -1 if it cannot be written
+ */
+long grand_bench_write(char *hdfname,int n_events,int tracelength)
+{
+  hid_t file_id,run_id;
+  unsigned short *event;
+  int ls_id[field_size];
+  int size;
+  FILE *fp;
+  long file_size;
+
+  for(int i=0;i<field_size;i++) ls_id[i] = field[i].elec_id;
+  if(grand_HDF5create_file(hdfname,1,&file_id,&run_id)<0) return(-1);
+  for(int iev=1;iev<=n_events;iev++){
+    if((event = grand_synthetic_event(1,iev,field_size,ls_id,tracelength,&size)) == NULL) break;
+    grand_HDF5fill_event(run_id,event);
+  }
+  grand_HDF5create_run_structure(run_id);
+  grand_HDF5fill_runheader(run_id);
+  grand_HDF5close_file(run_id,file_id);
+  if((fp = fopen(hdfname,"r")) == NULL) return(-1);
+  fseek(fp,0,SEEK_END);
+  file_size = ftell(fp);
+  fclose(fp);
+  return(file_size);
+}
+
+/**
+ * \brief benchmark the file access profiles: write and read back synthetic events
+ * @param[in] fieldname: the field configuration
+ * @param[in] n_events: the number of events
+ * @param[in] tracelength: the number of samples per channel
+ */
+void grand_bench_profile(char *fieldname,int n_events,int tracelength)
+{
+  char *hdfname = "grand_bench_profile.hdf5";
+  double t0,dt_write;
+  long file_size;
+
+  if(grand_HDF5initiate_field(fieldname)<0){
+    printf("Cannot read the field %s\n",fieldname);
+    return;
+  }
+  for(int profile=0;profile<GRAND_N_PROFILE;profile++){
+    grand_HDF5set_profile(profile);
+    t0 = grand_bench_now();
+    file_size = grand_bench_write(hdfname,n_events,tracelength);
+    dt_write = grand_bench_now()-t0;
+    printf("profile %-8s write: %d events in %.3f s: %.1f events/s, file %.2f MB\n",profile_name[profile],
+           n_events,dt_write,n_events/dt_write,file_size/1e6);
+    printf("profile %-8s ",profile_name[profile]);
+    fflush(stdout);
+    grand_bench_read(hdfname,1,64);
+  }
+  grand_HDF5set_profile(GRAND_PROFILE_DEFAULT);
+  remove(hdfname);
+}
+
+/**
+ * \brief fill traces shaped like 14-bit ADC data: baseline, gaussian noise and a few pulses
+ * @param[out] trace: n_traces traces of tracelength samples
+ */
+void grand_bench_traces(short *trace,int n_traces,int tracelength)
+{
+  unsigned int seed = 12345;
+  double noise,pulse;
+  int it,i,j,t0;
+
+  for(it=0;it<n_traces;it++){
+    t0 = tracelength/3+it%64;
+    for(i=0;i<tracelength;i++){
+      noise = 0;
+      for(j=0;j<4;j++){
+        seed = seed*1103515245+12345;
+        noise += (double)((seed>>16)&0x7fff)/32768.-0.5;
+      }
+      pulse = 0;
+      if(it%8 == 0 && i>=t0 && i<t0+60) pulse = 900*exp(-(i-t0)/12.)*sin((i-t0)/3.);
+      trace[it*tracelength+i] = (short)(lrint(8*noise+pulse)+(it%3)*40-20);
+    }
+  }
+}
+
+/**
+ * \brief benchmark the trace storage: the ADC codec in memory and every filter through HDF5
+ * @param[in] n_traces: the number of traces
+ * @param[in] tracelength: the number of samples per trace
+ */
+void grand_bench_filter(int n_traces,int tracelength)
+{
+  short *trace,*back;
+  unsigned char *packed;
+  size_t *offset;
+  size_t n = (size_t)n_traces*tracelength,nbytes = 0;
+  double t0,dt_encode,dt_decode,mb = n*sizeof(short)/1e6;
+  hid_t fapl,file_id,space,plist,data_set;
+  hsize_t dim[1];
+  hsize_t storage;
+  int it,bad;
+
+  trace = malloc(n*sizeof(short));
+  back = malloc(n*sizeof(short));
+  packed = malloc(n_traces*GRAND_ADC_MAX_ENCODED((size_t)tracelength));
+  offset = malloc((n_traces+1)*sizeof(size_t));
+  if(trace == NULL || back == NULL || packed == NULL || offset == NULL){
+    printf("Not enough memory\n");
+    return;
+  }
+  grand_bench_traces(trace,n_traces,tracelength);
+  t0 = grand_bench_now();
+  for(it=0;it<n_traces;it++){
+    offset[it] = nbytes;
+    nbytes += grand_adc_encode(&trace[(size_t)it*tracelength],tracelength,&packed[nbytes]);
+  }
+  offset[n_traces] = nbytes;
+  dt_encode = grand_bench_now()-t0;
+  t0 = grand_bench_now();
+  for(it=0;it<n_traces;it++)
+    grand_adc_decode(&packed[offset[it]],offset[it+1]-offset[it],&back[(size_t)it*tracelength],tracelength);
+  dt_decode = grand_bench_now()-t0;
+  bad = memcmp(trace,back,n*sizeof(short)) != 0;
+  printf("adc codec: %d traces of %d samples, encode %.1f MB/s decode %.1f MB/s ratio %.2f%s\n",n_traces,tracelength,
+         mb/dt_encode,mb/dt_decode,(double)n*sizeof(short)/nbytes,bad?" MISMATCH":"");
+  //through HDF5, one trace per chunk, in memory
+  grand_HDF5register_adc_filter();
+  for(int filter=0;filter<GRAND_N_TRACE_FILTER;filter++){
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_core(fapl,64*1024*1024,0);
+    file_id = H5Fcreate("grand_bench_filter.hdf5",H5F_ACC_TRUNC,H5P_DEFAULT,fapl);
+    H5Pclose(fapl);
+    dim[0] = n;
+    space = H5Screate_simple(1,dim,NULL);
+    plist = grand_HDF5trace_creation(filter,tracelength);
+    data_set = H5Dcreate(file_id,"Traces",H5T_NATIVE_SHORT,space,H5P_DEFAULT,plist,H5P_DEFAULT);
+    t0 = grand_bench_now();
+    H5Dwrite(data_set,H5T_NATIVE_SHORT,H5S_ALL,H5S_ALL,H5P_DEFAULT,trace);
+    H5Fflush(file_id,H5F_SCOPE_LOCAL);
+    dt_encode = grand_bench_now()-t0;
+    storage = H5Dget_storage_size(data_set);
+    H5Dclose(data_set);
+    //reopen so that no chunk is cached
+    data_set = H5Dopen(file_id,"Traces",H5P_DEFAULT);
+    memset(back,0,n*sizeof(short));
+    t0 = grand_bench_now();
+    H5Dread(data_set,H5T_NATIVE_SHORT,H5S_ALL,H5S_ALL,H5P_DEFAULT,back);
+    dt_decode = grand_bench_now()-t0;
+    bad = memcmp(trace,back,n*sizeof(short)) != 0;
+    printf("hdf5 %-8s write %.1f MB/s read %.1f MB/s ratio %.2f%s\n",trace_filter_name[filter],
+           mb/dt_encode,mb/dt_decode,(double)n*sizeof(short)/storage,bad?" MISMATCH":"");
+    H5Dclose(data_set);
+    if(plist != H5P_DEFAULT) H5Pclose(plist);
+    H5Sclose(space);
+    H5Fclose(file_id);
+  }
+  free(offset);
+  free(packed);
+  free(back);
+  free(trace);
+}
+
+/**
+ * \brief benchmark the geodetic to local coordinate transform
+ *
+ * The positions are spread over a square of 200 km around a center in the
+ * GRANDProto300 area. The flat-earth projection used before is shown for comparison.
+ * @param[in] n: number of positions per call
+ * @param[in] repeat: number of calls
+ */
+void grand_bench_geo(int n,int repeat)
+{
+  double *lon,*lat,*alt,*east,*north,*up;
+  double t0,dt,dt_field,r_earth,dx,dy,dmax = 0,check = 0;
+  AntInfo *ant;
+  GeoOrigin origin;
+
+  lon = malloc(n*sizeof(double));
+  lat = malloc(n*sizeof(double));
+  alt = malloc(n*sizeof(double));
+  east = malloc(n*sizeof(double));
+  north = malloc(n*sizeof(double));
+  up = malloc(n*sizeof(double));
+  ant = calloc(n,sizeof(AntInfo));
+  if(lon == NULL || lat == NULL || alt == NULL || east == NULL || north == NULL || up == NULL || ant == NULL){
+    printf("Not enough memory\n");
+    return;
+  }
+  srand(1);
+  for(int i=0;i<n;i++){
+    lon[i] = 86.+((rand()%2000000)-1000000)*1.2e-6;
+    lat[i] = 41.+((rand()%2000000)-1000000)*0.9e-6;
+    alt[i] = 1200.+(rand()%100000)*1e-3;
+    ant[i].longitude = lon[i];
+    ant[i].latitude = lat[i];
+    ant[i].altitude = alt[i];
+  }
+  grand_geo_origin(&origin,86.,41.,1200.);
+  t0 = grand_bench_now();
+  for(int r=0;r<repeat;r++){
+    grand_geodetic_to_enu(&origin,n,lon,lat,alt,east,north,up);
+    check += up[r%n];
+  }
+  dt = grand_bench_now()-t0;
+  r_earth = rad_earth(41.);
+  for(int i=0;i<n;i++){
+    dy = cos(41./RADTODEG)*(86.-lon[i])*r_earth/RADTODEG;
+    dx = (lat[i]-41.)*r_earth/RADTODEG;
+    if(fabs(dx-north[i])>dmax) dmax = fabs(dx-north[i]);
+    if(fabs(dy+east[i])>dmax) dmax = fabs(dy+east[i]);
+  }
+  t0 = grand_bench_now();
+  field_origin = origin;
+  grand_HDF5field_positions(n,ant);
+  dt_field = grand_bench_now()-t0;
+  printf("geo: %d positions x %d calls in %.3f s: %.2f ns/position %.1f Mposition/s (check %g)\n",
+         n,repeat,dt,1e9*dt/((double)n*repeat),(double)n*repeat/dt/1e6,check);
+  printf("geo: field of %d antennas in %.2f ms, flat-earth projection differs by up to %.1f m\n",
+         n,1e3*dt_field,dmax);
+  free(lon);
+  free(lat);
+  free(alt);
+  free(east);
+  free(north);
+  free(up);
+  free(ant);
+}
+
+/**
+ * \brief benchmark loading a field configuration: parsing the text and mapping the cache
+ * @param[in] n: number of antennas in the synthetic configuration, at most 65536 for unique ids
+ */
+void grand_bench_field(int n)
+{
+  char *fieldname = "grand_bench_field.txt";
+  char cachename[100];
+  double t0,dt_parse,dt_cache;
+  int return_code;
+  FILE *fp;
+
+  if((fp = fopen(fieldname,"w")) == NULL){
+    printf("Cannot write %s\n",fieldname);
+    return;
+  }
+  fprintf(fp,"# Antenna_id Elec_id Longitude Latitude Altitude Antenna_type Elec_type ch0 ch1 ch2 ch3\n");
+  srand(1);
+  for(int i=0;i<n;i++)
+    fprintf(fp,"%d %d %.7f %.7f %.2f GP300 GP300_V2 X Y Z 0\n",i-32768,32767-i,
+            86.+(rand()%2000000-1000000)*1e-7,41.+(rand()%2000000-1000000)*1e-7,1200.+(rand()%10000)*0.01);
+  fclose(fp);
+  sprintf(cachename,"%s.cache",fieldname);
+  unlink(cachename);
+  t0 = grand_bench_now();
+  return_code = grand_HDF5initiate_field(fieldname);
+  dt_parse = grand_bench_now()-t0;
+  t0 = grand_bench_now();
+  if(return_code>0) return_code = grand_HDF5initiate_field(fieldname);
+  dt_cache = grand_bench_now()-t0;
+  if(return_code<0) printf("Cannot load %s: %d\n",fieldname,return_code);
+  else printf("field: %d antennas parsed in %.2f ms, cache mapped in %.3f ms\n",field_size,1e3*dt_parse,1e3*dt_cache);
+  grand_HDF5release_field();
+  unlink(fieldname);
+  unlink(cachename);
+}
+
+/**
+ * \brief benchmark the output backends on the same synthetic events: decoding only, raw columns and HDF5
+ * @param[in] fieldname: the field configuration
+ * @param[in] n_events: the number of events
+ * @param[in] tracelength: the number of samples per channel
+ */
+void grand_bench_writer(char *fieldname,int n_events,int tracelength)
+{
+  const GrandWriterOps *ops[3] = {&grand_null_writer,&grand_columnar_writer,&grand_hdf5_writer};
+  char filename[VIEW_NAME_LENGTH+30];
+  unsigned short **events,*event;
+  int ls_id[GRAND_N_ELEC_ID];
+  int size,n;
+  long n_samples;
+  GrandJob job;
+  GrandWriter writer;
+  GrandEvent ev;
+  double t0,dt,dt_null = 0;
+
+  if(grand_HDF5initiate_field(fieldname)<0){
+    printf("Cannot read the field %s\n",fieldname);
+    return;
+  }
+  for(int i=0;i<field_size;i++) ls_id[i] = field[i].elec_id;
+  //the synthetic event is a static buffer: keep a copy of every event
+  if((events = calloc(n_events,sizeof(unsigned short *))) == NULL) return;
+  for(n=0;n<n_events;n++){
+    if((event = grand_synthetic_event(1,n+1,field_size,ls_id,tracelength,&size)) == NULL) break;
+    if((events[n] = malloc(size)) == NULL) break;
+    memcpy(events[n],event,size);
+  }
+  memset((void *)&ev,0,sizeof(GrandEvent));
+  grand_job_init(&job,".",1,1);
+  snprintf(job.outname,sizeof(job.outname),"grand_bench_writer.hdf5");
+  for(int iw=0;iw<3;iw++){
+    job.backend = ops[iw]->name;
+    n_samples = 0;
+    t0 = grand_bench_now();
+    if(grand_writer_open(&writer,ops[iw],&job)<0){
+      printf("Cannot open the %s output\n",ops[iw]->name);
+      continue;
+    }
+    for(int iev=0;iev<n;iev++){
+      if(grand_HDF5decode_event(events[iev],&ev)<0) break;
+      grand_writer_event(&writer,&ev);
+      n_samples += ev.n_samples;
+    }
+    grand_writer_close(&writer);
+    dt = grand_bench_now()-t0;
+    if(iw == 0) dt_null = dt;
+    printf("writer %-8s: %d events in %.3f s: %.1f events/s, %.1f MB/s of samples, output %.2f MB",
+           ops[iw]->name,n,dt,n/dt,n_samples*sizeof(short)/dt/1e6,writer.bytes/1e6);
+    if(iw>0) printf(", %.0f%% of the time in the backend",100*(dt-dt_null)/dt);
+    printf("\n");
+  }
+  remove(job.outname);
+  for(int i=0;i<GRAND_N_COLUMNS;i++){
+    snprintf(filename,sizeof(filename),"grand_bench_writer.cols/%s.bin",column_name[i]);
+    remove(filename);
+  }
+  remove("grand_bench_writer.cols/columns.txt");
+  remove("grand_bench_writer.cols");
+  grand_free_event(&ev);
+  for(int iev=0;iev<n;iev++) free(events[iev]);
+  free(events);
+}
+
+/**
+ * \brief benchmark the reader engines on a synthetic binary file, read from disk every time
+ * @param[in] n_events: the number of events
+ * @param[in] n_ls: the number of local stations per event
+ * @param[in] tracelength: the number of samples per channel
+ */
+void grand_bench_reader(int n_events,int n_ls,int tracelength)
+{
+  char *binname = "grand_bench_reader.bin";
+  int engine[7] = {GRAND_READER_STDIO,GRAND_READER_MMAP,GRAND_READER_ASYNC,GRAND_READER_ASYNC,
+    GRAND_READER_ASYNC,GRAND_READER_ASYNC,GRAND_READER_DIRECT};
+  int depth[7] = {0,0,1,8,32,8,8};
+  size_t block[7] = {0,0,0,0,0,65536,0};
+  int file_header[9] = {32,1,0,0,1,0,n_events,0,0};
+  int ls_id[n_ls];
+  unsigned short *event;
+  unsigned long long sum,sum_ref = 0;
+  long long bytes;
+  int size,fd,n;
+  double t0,dt;
+  FILE *fp;
+  BinReader r;
+
+  if((fp = fopen(binname,"w")) == NULL){
+    printf("Cannot write %s\n",binname);
+    return;
+  }
+  for(int i=0;i<n_ls;i++) ls_id[i] = i;
+  fwrite(file_header,sizeof(file_header),1,fp);
+  for(int iev=1;iev<=n_events;iev++){
+    if((event = grand_synthetic_event(1,iev,n_ls,ls_id,tracelength,&size)) == NULL) break;
+    fwrite(event,size,1,fp);
+  }
+  fflush(fp);
+  fsync(fileno(fp));
+  fclose(fp);
+  for(int ir=0;ir<7;ir++){
+    //drop the file from the page cache, so that every engine reads from disk
+    if((fd = open(binname,O_RDONLY))>=0){
+      posix_fadvise(fd,0,0,POSIX_FADV_DONTNEED);
+      close(fd);
+    }
+    grand_reader_set_engine(engine[ir],depth[ir],block[ir]);
+    t0 = grand_bench_now();
+    if(grand_reader_open(&r,binname)<0){
+      printf("Cannot open %s\n",binname);
+      break;
+    }
+    grand_reader_file_header(&r,&size);
+    sum = 0;
+    bytes = 0;
+    n = 0;
+    while(n<n_events && (event = grand_reader_event(&r,&size)) != NULL){
+      for(int i=0;i<size/SHORTSIZE;i++) sum += event[i];
+      bytes += size;
+      n++;
+    }
+    dt = grand_bench_now()-t0;
+    if(ir == 0) sum_ref = sum;
+    printf("reader %-6s depth %2d block %4zu kB%s: %d events in %.3f s: %.1f MB/s%s\n",reader_name[r.engine],
+           r.depth,r.block/1024,r.engine<GRAND_READER_ASYNC?"":(r.use_ring?" io_uring":" pread   "),
+           n,dt,bytes/dt/1e6,sum == sum_ref?"":" CHECKSUM DIFFERS");
+    grand_reader_close(&r);
+  }
+  grand_reader_set_engine(GRAND_READER_STDIO,0,0);
+  remove(binname);
+}
+
+/**
+ * \brief benchmark the power spectra: computed when queued and on 1 to max_threads worker threads
+ * @param[in] nfft: the FFT length
+ * @param[in] n_traces: the number of traces
+ * @param[in] tracelength: the number of samples per trace
+ * @param[in] max_threads: the largest number of threads
+ */
+void grand_bench_spectrum(int nfft,int n_traces,int tracelength,int max_threads)
+{
+  short *trace;
+  float *power,*reference;
+  size_t nbins = nfft/2+1;
+  SpectrumPool pool;
+  double t0,dt,ms = (double)n_traces*tracelength/1e6;
+  int bad;
+
+  trace = malloc((size_t)n_traces*tracelength*sizeof(short));
+  power = malloc(n_traces*nbins*sizeof(float));
+  reference = malloc(n_traces*nbins*sizeof(float));
+  if(trace == NULL || power == NULL || reference == NULL){
+    printf("Not enough memory\n");
+    return;
+  }
+  grand_bench_traces(trace,n_traces,tracelength);
+  for(int n_threads=0;n_threads<=max_threads;n_threads++){
+    if(grand_spectrum_pool_open(&pool,nfft,n_threads)<0){
+      printf("Not a valid FFT length %d or number of threads %d\n",nfft,n_threads);
+      break;
+    }
+    //as in the conversion: the queue is drained every event of 64 antennas
+    t0 = grand_bench_now();
+    for(int it=0;it<n_traces;it+=192){
+      for(int i=it;i<n_traces && i<it+192;i++) grand_spectrum_add(&pool,&trace[(size_t)i*tracelength],tracelength,i);
+      grand_spectrum_wait(&pool);
+      for(int i=0;i<pool.n_jobs;i++) memcpy(&power[pool.job[i].key*nbins],pool.job[i].power,nbins*sizeof(float));
+      grand_spectrum_reset(&pool);
+    }
+    dt = grand_bench_now()-t0;
+    grand_spectrum_pool_close(&pool);
+    if(n_threads == 0) memcpy(reference,power,n_traces*nbins*sizeof(float));
+    bad = memcmp(reference,power,n_traces*nbins*sizeof(float)) != 0;
+    printf("spectrum nfft %d, %d traces of %d samples, %2d threads: %.0f ns/trace %.1f MSamples/s%s\n",nfft,n_traces,
+           tracelength,n_threads,1e9*dt/n_traces,ms/dt,bad?" MISMATCH":"");
+  }
+  free(trace);
+  free(power);
+  free(reference);
+}
+
+/**
+ * \brief benchmark the trace quality flags; traces that do not fit in the cache show the memory bandwidth
+ * @param[in] n_traces: the number of traces
+ * @param[in] tracelength: the number of samples per trace
+ * @param[in] repeat: the number of passes over the traces
+ */
+void grand_bench_quality(int n_traces,int tracelength,int repeat)
+{
+  short *trace;
+  size_t n = (size_t)n_traces*tracelength;
+  double t0,dt,mb = repeat*n*sizeof(short)/1e6;
+  unsigned long long n_flag[GRAND_N_QUALITY];
+  unsigned int flags;
+
+  if((trace = malloc(n*sizeof(short))) == NULL){
+    printf("Not enough memory\n");
+    return;
+  }
+  grand_bench_traces(trace,n_traces,tracelength);
+  //a few stuck and saturated traces
+  for(int it=0;it<n_traces;it+=97) memset(&trace[(size_t)it*tracelength],0,tracelength*sizeof(short));
+  for(int it=50;it<n_traces;it+=101) trace[(size_t)it*tracelength+tracelength/2] = 8191;
+  memset(n_flag,0,sizeof(n_flag));
+  t0 = grand_bench_now();
+  for(int ir=0;ir<repeat;ir++){
+    for(int it=0;it<n_traces;it++){
+      flags = grand_quality_trace(&trace[(size_t)it*tracelength],tracelength,14);
+      for(int i=0;i<GRAND_N_QUALITY;i++) if(ir == 0 && (flags&(1<<i))) n_flag[i]++;
+    }
+  }
+  dt = grand_bench_now()-t0;
+  printf("quality: %d traces of %d samples, %.0f MB/s, saturated %llu flat %llu\n",n_traces,tracelength,
+         mb/dt,n_flag[0],n_flag[1]);
+  free(trace);
+}
+
+/**
+ * \brief benchmark the antenna-major layout: the extra cost of writing it, and reading all traces of an antenna
+ *        from it or from the event groups
+ * @param[in] fieldname: the field file
+ * @param[in] n_events: the number of events
+ * @param[in] tracelength: the number of samples per channel
+ */
+void grand_bench_station(char *fieldname,int n_events,int tracelength)
+{
+  char *hdfname = "grand_bench_station.hdf5";
+  char *trname[3]={"ADC_X","ADC_Y","ADC_Z"};
+  char path[100];
+  unsigned short **events,*event;
+  int ls_id[GRAND_N_ELEC_ID];
+  int size,n,n_index;
+  long n_samples,n_event_samples;
+  short *samples,*event_samples;
+  LiveTrace *index;
+  GrandJob job;
+  GrandWriter writer;
+  GrandEvent ev;
+  GrandReader reader;
+  hid_t data_set,space;
+  hsize_t dim[1];
+  double t0,dt,dt_events = 0;
+
+  if(grand_HDF5initiate_field(fieldname)<0){
+    printf("Cannot read the field %s\n",fieldname);
+    return;
+  }
+  for(int i=0;i<field_size;i++) ls_id[i] = field[i].elec_id;
+  if((events = calloc(n_events,sizeof(unsigned short *))) == NULL) return;
+  for(n=0;n<n_events;n++){
+    if((event = grand_synthetic_event(1,n+1,field_size,ls_id,tracelength,&size)) == NULL) break;
+    if((events[n] = malloc(size)) == NULL) break;
+    memcpy(events[n],event,size);
+  }
+  memset((void *)&ev,0,sizeof(GrandEvent));
+  grand_job_init(&job,".",1,1);
+  snprintf(job.outname,sizeof(job.outname),"%s",hdfname);
+  for(int layout=0;layout<2;layout++){
+    grand_HDF5set_station_layout(layout);
+    t0 = grand_bench_now();
+    if(grand_writer_open(&writer,&grand_hdf5_writer,&job)<0){
+      printf("Cannot open %s\n",hdfname);
+      break;
+    }
+    for(int iev=0;iev<n;iev++){
+      if(grand_HDF5decode_event(events[iev],&ev)<0) break;
+      grand_writer_event(&writer,&ev);
+    }
+    grand_writer_close(&writer);
+    dt = grand_bench_now()-t0;
+    if(layout == 0) dt_events = dt;
+    printf("write %-15s: %d events in %.3f s, output %.2f MB",layout?"+ antenna-major":"event groups",n,dt,writer.bytes/1e6);
+    if(layout == 1) printf(", %.0f%% extra time",100*(dt-dt_events)/dt_events);
+    printf("\n");
+  }
+  grand_HDF5set_station_layout(0);
+  //all traces of the first antenna: an event group at a time, then from its antenna table
+  if(grand_HDF5open_run(hdfname,1,&reader)>0){
+    n_event_samples = 0;
+    event_samples = malloc((size_t)n*3*tracelength*SHORTSIZE+1);
+    t0 = grand_bench_now();
+    for(int iev=0;iev<reader.n_events && event_samples != NULL;iev++){
+      for(int itrace=0;itrace<3;itrace++){
+        sprintf(path,"Event_%u/raw/Traces_1/%s",reader.eventnr[iev],trname[itrace]);
+        if(H5Lexists(reader.run_id,path,H5P_DEFAULT) <= 0 || (data_set = H5Dopen(reader.run_id,path,H5P_DEFAULT))<0)
+          continue;
+        space = H5Dget_space(data_set);
+        H5Sget_simple_extent_dims(space,dim,NULL);
+        H5Sclose(space);
+        if(n_event_samples+dim[0]<=(size_t)n*3*tracelength)
+          H5Dread(data_set,H5T_NATIVE_SHORT,H5S_ALL,H5S_ALL,H5P_DEFAULT,&event_samples[n_event_samples]);
+        n_event_samples += dim[0];
+        H5Dclose(data_set);
+      }
+    }
+    dt_events = grand_bench_now()-t0;
+    t0 = grand_bench_now();
+    n_samples = grand_HDF5read_station(reader.run_id,1,&samples,&index,&n_index);
+    dt = grand_bench_now()-t0;
+    printf("read antenna 1: event groups %.2f ms, antenna-major %.2f ms for %d traces%s\n",1e3*dt_events,1e3*dt,n_index,
+           n_samples != n_event_samples || event_samples == NULL
+           || memcmp(samples,event_samples,n_samples*SHORTSIZE) != 0?" MISMATCH":"");
+    free(samples);
+    free(index);
+    free(event_samples);
+    grand_HDF5close_run(&reader);
+  }
+  remove(hdfname);
+  grand_free_event(&ev);
+  for(int iev=0;iev<n;iev++) free(events[iev]);
+  free(events);
+}
+
+/**
+ * \brief benchmark the preview envelopes: the vectorized reduction against a plain loop, and the size of every level
+ * @param[in] n_traces: the number of traces
+ * @param[in] tracelength: the number of samples per trace
+ */
+void grand_bench_preview(int n_traces,int tracelength)
+{
+  short *trace,*lo[PREVIEW_N_LEVELS],*hi[PREVIEW_N_LEVELS],*ref_lo,*ref_hi;
+  size_t n = (size_t)n_traces*tracelength;
+  int points[PREVIEW_N_LEVELS+1],group,bad = 0;
+  double t0,dt,dt_loop,mb = n*sizeof(short)/1e6;
+
+  trace = malloc(n*sizeof(short));
+  points[0] = tracelength;
+  for(int level=0;level<PREVIEW_N_LEVELS;level++){
+    points[level+1] = grand_preview_points(tracelength,level);
+    lo[level] = malloc((size_t)n_traces*points[level+1]*sizeof(short));
+    hi[level] = malloc((size_t)n_traces*points[level+1]*sizeof(short));
+    if(lo[level] == NULL || hi[level] == NULL) trace = NULL;
+  }
+  ref_lo = malloc((size_t)points[1]*sizeof(short));
+  ref_hi = malloc((size_t)points[1]*sizeof(short));
+  if(trace == NULL || ref_lo == NULL || ref_hi == NULL){
+    printf("Not enough memory\n");
+    return;
+  }
+  grand_bench_traces(trace,n_traces,tracelength);
+  t0 = grand_bench_now();
+  for(int it=0;it<n_traces;it++){
+    grand_preview_reduce(&trace[(size_t)it*tracelength],&trace[(size_t)it*tracelength],tracelength,
+                         &lo[0][(size_t)it*points[1]],&hi[0][(size_t)it*points[1]]);
+    for(int level=1;level<PREVIEW_N_LEVELS;level++)
+      grand_preview_reduce(&lo[level-1][(size_t)it*points[level]],&hi[level-1][(size_t)it*points[level]],points[level],
+                           &lo[level][(size_t)it*points[level+1]],&hi[level][(size_t)it*points[level+1]]);
+  }
+  dt = grand_bench_now()-t0;
+  //the first level with a plain loop over the samples of every group
+  t0 = grand_bench_now();
+  for(int it=0;it<n_traces;it++){
+    for(int k=0;k<points[1];k++){
+      ref_lo[k] = SHRT_MAX;
+      ref_hi[k] = SHRT_MIN;
+      for(int i=k*PREVIEW_FACTOR;i<(k+1)*PREVIEW_FACTOR && i<tracelength;i++){
+        if(trace[(size_t)it*tracelength+i]<ref_lo[k]) ref_lo[k] = trace[(size_t)it*tracelength+i];
+        if(trace[(size_t)it*tracelength+i]>ref_hi[k]) ref_hi[k] = trace[(size_t)it*tracelength+i];
+      }
+    }
+    if(memcmp(ref_lo,&lo[0][(size_t)it*points[1]],points[1]*sizeof(short)) != 0
+       || memcmp(ref_hi,&hi[0][(size_t)it*points[1]],points[1]*sizeof(short)) != 0) bad++;
+  }
+  dt_loop = grand_bench_now()-t0;
+  printf("preview: %d traces of %d samples, all levels %.0f MB/s, first level with a plain loop %.0f MB/s%s\n",
+         n_traces,tracelength,mb/dt,mb/dt_loop,bad?" MISMATCH":"");
+  for(int level=0;level<PREVIEW_N_LEVELS;level++){
+    group = PREVIEW_FACTOR<<(2*level);
+    printf("  level %2d: %d points per trace, %.1f%% of the samples\n",group,points[level+1],
+           100.*2*points[level+1]/tracelength);
+    free(lo[level]);
+    free(hi[level]);
+  }
+  free(trace);
+  free(ref_lo);
+  free(ref_hi);
+}
+
+/**
+ * \brief Write a synthetic AD file with an event per second and all antennas of the field
+ * @param[in] binname: the file
+ * @param[in] runnr: the run number
+ * @param[in] n_events: the number of events
+ * @param[in] tracelength: the number of samples per channel
+ * \return 1: all ok
+ * \return -1: the file cannot be written
+ */
+int grand_bench_adfile(char *binname,int runnr,int n_events,int tracelength)
+{
+  int file_header[9] = {32,runnr,0,0,1,0,n_events,0,0};
+  int ls_id[field_size];
+  unsigned short *event;
+  int size,return_code = 1;
+  FILE *fp;
+
+  if((fp = fopen(binname,"w")) == NULL) return(-1);
+  for(int i=0;i<field_size;i++) ls_id[i] = field[i].elec_id;
+  fwrite(file_header,sizeof(file_header),1,fp);
+  for(int iev=1;iev<=n_events && return_code == 1;iev++){
+    if((event = grand_synthetic_event(runnr,iev,field_size,ls_id,tracelength,&size)) == NULL) return_code = -1;
+    else if(fwrite(event,size,1,fp) != 1) return_code = -1;
+  }
+  if(fclose(fp) != 0) return_code = -1;
+  return(return_code);
+}
+
+/**
+ * \brief Compare the events of a run in two files through the batch reader: headers, antenna rows and samples
+ * @param[in] hdfname: the file to check
+ * @param[in] reference: the reference file
+ * @param[in] runnr: the run number
+ * @param[in] tracelength: the number of samples per channel of the events
+ * \return >=0: the number of events, all equal
+ * \return -1: a file cannot be read or the events differ
+ */
+long grand_bench_compare(char *hdfname,char *reference,int runnr,int tracelength)
+{
+  GrandReader reader[2];
+  GrandEventBatch batch[2];
+  char *name[2] = {hdfname,reference};
+  long n_events = 0;
+  int n[2],opened = 0;
+  int return_code = 1;
+
+  for(;opened<2;opened++){
+    if(grand_HDF5open_run(name[opened],runnr,&reader[opened])<0){
+      printf("Cannot open run %d in %s\n",runnr,name[opened]);
+      return_code = -1;
+      break;
+    }
+    if(grand_HDF5alloc_batch(&batch[opened],16,16*field_size,16L*field_size*4*tracelength)<0){
+      grand_HDF5close_run(&reader[opened]);
+      return_code = -1;
+      break;
+    }
+  }
+  while(return_code == 1){
+    for(int i=0;i<2;i++) n[i] = grand_HDF5read_events(&reader[i],&batch[i]);
+    if(n[0] != n[1] || batch[0].n_antennas != batch[1].n_antennas || batch[0].n_samples != batch[1].n_samples
+       || memcmp(batch[0].header,batch[1].header,n[0]*sizeof(EventHeader)) != 0
+       || memcmp(batch[0].antenna,batch[1].antenna,batch[0].n_antennas*sizeof(AntHdr)) != 0
+       || memcmp(batch[0].samples,batch[1].samples,batch[0].n_samples*sizeof(short)) != 0){
+      printf("%s differs from %s after %ld events\n",hdfname,reference,n_events);
+      return_code = -1;
+    }
+    if(n[0]<=0) break;
+    n_events += n[0];
+  }
+  for(int i=0;i<opened;i++){
+    grand_HDF5free_batch(&batch[i]);
+    grand_HDF5close_run(&reader[i]);
+  }
+  return(return_code<0?-1:n_events);
+}
+
+/**
+ * \brief Send a command to grand_daemon and read its reply up to a line starting with last
+ * \return the length of the reply, -1 if the daemon does not answer
+ */
+int grand_bench_request(int fd,char *command,char *last,char *reply,int size)
+{
+  int used = 0;
+  ssize_t len;
+  char *line;
+
+  if(write(fd,command,strlen(command)) != (ssize_t)strlen(command)) return(-1);
+  reply[0] = 0;
+  while(used<size-1){
+    if((len = read(fd,&reply[used],size-1-used))<=0) return(-1);
+    used += len;
+    reply[used] = 0;
+    //the reply ends with a complete line starting with last
+    for(line=reply;(line = strstr(line,last)) != NULL;line++)
+      if((line == reply || line[-1] == '\n') && strchr(line,'\n') != NULL) return(used);
+  }
+  return(-1);
+}
+
+/**
+ * \brief End-to-end check of grand_daemon: a file sequence closed in the watched directory and one submitted
+ * on the UNIX socket are converted by the workers, and their outputs hold the events of a direct conversion
+ * @param[in] daemon: the grand_daemon executable
+ */
+void grand_bench_daemon(char *daemon,char *fieldname,int n_events,int tracelength)
+{
+  char *basedir = "grand_bench_daemon";
+  char *subdir[5] = {"","/data","/data/AD","/submit","/submit/AD"};
+  char name[VIEW_NAME_LENGTH+40],sockname[100];
+  char command[VIEW_NAME_LENGTH+40],reply[8192];
+  struct sockaddr_un addr;
+  char state[16],*line;
+  int id,runnr,fileseq,n_done,n_failed,fd = -1;
+  long n;
+  double t0,dt = 0;
+  pid_t pid;
+  GrandJob job;
+  GrandJobStats stats;
+
+  if(grand_HDF5initiate_field(fieldname)<0){
+    printf("Cannot read the field %s\n",fieldname);
+    return;
+  }
+  for(int i=0;i<5;i++){
+    snprintf(name,sizeof(name),"%s%s",basedir,subdir[i]);
+    mkdir(name,0755);
+  }
+  for(fileseq=1;fileseq<=2;fileseq++){
+    snprintf(name,sizeof(name),"%s/Run1_f%04d.hdf5",basedir,fileseq);
+    unlink(name);
+    snprintf(name,sizeof(name),"%s/data/AD/ad%06d.f%04d",basedir,1,fileseq);
+    unlink(name);
+  }
+  //the sequence of the socket job is in a directory that is not watched
+  snprintf(name,sizeof(name),"%s/submit/AD/ad%06d.f%04d",basedir,1,2);
+  if(grand_bench_adfile(name,1,n_events,tracelength)<0){
+    printf("Cannot write %s\n",name);
+    return;
+  }
+  snprintf(sockname,sizeof(sockname),"%s/daemon.sock",basedir);
+  unlink(sockname);
+  snprintf(name,sizeof(name),"%s/data",basedir);
+  if((pid = fork()) == 0){
+    execl(daemon,daemon,"-f",fieldname,"-w",name,"-S",sockname,"-d",basedir,"-j","2",(char *)NULL);
+    printf("Cannot start %s\n",daemon);
+    _exit(127);
+  }
+  if(pid<0) return;
+  memset((void *)&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path,sizeof(addr.sun_path),"%s",sockname);
+  for(int i=0;i<500 && fd<0;i++){
+    if((fd = socket(AF_UNIX,SOCK_STREAM,0))<0) break;
+    if(connect(fd,(struct sockaddr *)&addr,sizeof(addr))<0){
+      close(fd);
+      fd = -1;
+      usleep(10000);
+    }
+  }
+  if(fd<0){
+    printf("daemon: cannot connect to %s\n",sockname);
+    kill(pid,SIGTERM);
+    waitpid(pid,NULL,0);
+    return;
+  }
+  t0 = grand_bench_now();
+  snprintf(name,sizeof(name),"%s/data/AD/ad%06d.f%04d",basedir,1,1);
+  snprintf(command,sizeof(command),"convert %s/submit 1 2\n",basedir);
+  if(grand_bench_adfile(name,1,n_events,tracelength)<0) printf("Cannot write %s\n",name);
+  else if(grand_bench_request(fd,command,"queued",reply,sizeof(reply))<0) printf("daemon: no reply to convert\n");
+  else{
+    //both jobs are done or failed within a minute
+    n_done = n_failed = 0;
+    while(n_done+n_failed<2 && grand_bench_now()-t0<60){
+      usleep(20000);
+      if(grand_bench_request(fd,"status\n","end",reply,sizeof(reply))<0) break;
+      n_done = n_failed = 0;
+      for(line=reply;line != NULL && *line != 0;line = strchr(line,'\n')?strchr(line,'\n')+1:NULL){
+        if(sscanf(line,"job %d run %d file %d %15s",&id,&runnr,&fileseq,state) != 4) continue;
+        if(strcmp(state,"done") == 0) n_done++;
+        if(strcmp(state,"failed") == 0) n_failed++;
+      }
+    }
+    dt = grand_bench_now()-t0;
+    printf("daemon: %d jobs done, %d failed in %.3f s after the AD file was closed\n",n_done,n_failed,dt);
+  }
+  grand_bench_request(fd,"quit\n","bye",reply,sizeof(reply));
+  close(fd);
+  waitpid(pid,NULL,0);
+  //the reference is a direct conversion of the watched sequence, the socket job has the same events
+  snprintf(name,sizeof(name),"%s/data",basedir);
+  grand_job_init(&job,name,1,1);
+  snprintf(job.outname,sizeof(job.outname),"%s/reference.hdf5",basedir);
+  if(grand_convert(&job,&stats)<0){
+    printf("Cannot convert the reference %s\n",job.outname);
+    return;
+  }
+  for(fileseq=1;fileseq<=2;fileseq++){
+    snprintf(name,sizeof(name),"%s/Run1_f%04d.hdf5",basedir,fileseq);
+    if((n = grand_bench_compare(name,job.outname,1,tracelength)) == n_events)
+      printf("daemon: %s (%s) holds the %ld events of the direct conversion\n",name,fileseq == 1?"watched":"socket",n);
+    else printf("daemon: %s (%s) FAILED, %ld events\n",name,fileseq == 1?"watched":"socket",n);
+  }
+}
+
+#ifdef GRAND_USE_MPI
+/**
+ * \brief Strong scaling of the conversion into one shared file: the same synthetic file is converted by 1, 2, 4, ...
+ * and all ranks
+ */
+void grand_bench_mpi(char *fieldname,int n_events,int tracelength)
+{
+  char *basedir = "grand_bench_mpi";
+  char binname[100];
+  int rank,n_ranks,ok = 1;
+  long n;
+  double dt_1 = 0;
+  MPI_Comm comm;
+  GrandJob job;
+  GrandJobStats stats;
+
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+  MPI_Comm_size(MPI_COMM_WORLD,&n_ranks);
+  if(grand_HDF5initiate_field(fieldname)<0){
+    if(rank == 0) printf("Cannot read the field %s\n",fieldname);
+    return;
+  }
+  if(rank == 0){
+    mkdir(basedir,0755);
+    snprintf(binname,sizeof(binname),"%s/AD",basedir);
+    mkdir(binname,0755);
+    snprintf(binname,sizeof(binname),"%s/AD/ad%06d.f%04d",basedir,1,1);
+    if(grand_bench_adfile(binname,1,n_events,tracelength)<0) ok = 0;
+  }
+  MPI_Bcast(&ok,1,MPI_INT,0,MPI_COMM_WORLD);
+  if(!ok){
+    if(rank == 0) printf("Cannot write %s\n",binname);
+    return;
+  }
+  grand_job_init(&job,basedir,1,1);
+  snprintf(job.outname,sizeof(job.outname),"grand_bench_mpi.hdf5");
+  for(int n=1;n<=n_ranks;n=(n<n_ranks && 2*n>n_ranks)?n_ranks:2*n){
+    MPI_Comm_split(MPI_COMM_WORLD,rank<n?0:MPI_UNDEFINED,rank,&comm);
+    if(comm != MPI_COMM_NULL){
+      grand_HDF5set_mpi(comm);
+      if(grand_mpi_convert(&job,&stats)>0 && rank == 0){
+        if(n == 1) dt_1 = stats.seconds;
+        printf("mpi %3d ranks: %ld events in %.3f s (writes %.3f s), %.1f MB/s, speed-up %.2f, efficiency %.0f%%\n",
+               n,stats.n_events,stats.seconds,mpi_write_seconds,stats.bytes/1e6/stats.seconds,dt_1/stats.seconds,
+               100*dt_1/stats.seconds/n);
+      }
+      grand_HDF5set_mpi(MPI_COMM_NULL);
+      MPI_Comm_free(&comm);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+  //the file written by all ranks holds the events of a serial conversion
+  if(rank == 0){
+    snprintf(job.outname,sizeof(job.outname),"grand_bench_serial.hdf5");
+    if(grand_convert(&job,&stats)<0) printf("Cannot convert %s serially\n",binname);
+    else if((n = grand_bench_compare("grand_bench_mpi.hdf5","grand_bench_serial.hdf5",1,tracelength)) == n_events)
+      printf("mpi %3d ranks: the file holds the %ld events of the serial conversion\n",n_ranks,n);
+    else printf("mpi %3d ranks: FAILED, %ld events equal to the serial conversion\n",n_ranks,n);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+#endif
+
+int main(int argc, char **argv) {
+  if(argc < 2){
+    printf("Use: grand_bench timing [n_antenna] [repeat]\n");
+    printf("     grand_bench read [hdffile] [runnr] [batch]\n");
+    printf("     grand_bench profile [fieldfile] [n_events] [tracelength]\n");
+    printf("     grand_bench filter [n_traces] [tracelength]\n");
+    printf("     grand_bench geo [n_positions] [repeat]\n");
+    printf("     grand_bench field [n_antennas]\n");
+    printf("     grand_bench writer [fieldfile] [n_events] [tracelength]\n");
+    printf("     grand_bench reader [n_events] [n_ls] [tracelength]\n");
+    printf("     grand_bench spectrum [nfft] [n_traces] [tracelength] [threads]\n");
+    printf("     grand_bench quality [n_traces] [tracelength] [repeat]\n");
+    printf("     grand_bench station [fieldfile] [n_events] [tracelength]\n");
+    printf("     grand_bench preview [n_traces] [tracelength]\n");
+    printf("     grand_bench daemon [fieldfile] [n_events] [tracelength] [grand_daemon]\n");
+    printf("     mpirun -np N grand_bench mpi [fieldfile] [n_events] [tracelength]\n");
+    return(-1);
+  }
+  if(strcmp(argv[1],"timing") == 0){
+    grand_bench_timing(argc>2?atoi(argv[2]):4096,argc>3?atoi(argv[3]):10000);
+  }
+  else if(strcmp(argv[1],"read") == 0 && argc>3){
+    grand_bench_read(argv[2],atoi(argv[3]),argc>4?atoi(argv[4]):64);
+  }
+  else if(strcmp(argv[1],"profile") == 0){
+    grand_bench_profile(argc>2?argv[2]:"field_run22.txt",argc>3?atoi(argv[3]):2000,argc>4?atoi(argv[4]):1024);
+  }
+  else if(strcmp(argv[1],"filter") == 0){
+    grand_bench_filter(argc>2?atoi(argv[2]):20000,argc>3?atoi(argv[3]):1024);
+  }
+  else if(strcmp(argv[1],"geo") == 0){
+    grand_bench_geo(argc>2?atoi(argv[2]):100000,argc>3?atoi(argv[3]):20);
+  }
+  else if(strcmp(argv[1],"field") == 0){
+    grand_bench_field(argc>2?atoi(argv[2]):65536);
+  }
+  else if(strcmp(argv[1],"reader") == 0){
+    grand_bench_reader(argc>2?atoi(argv[2]):500,argc>3?atoi(argv[3]):32,argc>4?atoi(argv[4]):1024);
+  }
+  else if(strcmp(argv[1],"writer") == 0){
+    grand_bench_writer(argc>2?argv[2]:"field_run22.txt",argc>3?atoi(argv[3]):2000,argc>4?atoi(argv[4]):1024);
+  }
+  else if(strcmp(argv[1],"spectrum") == 0){
+    grand_bench_spectrum(argc>2?atoi(argv[2]):SPECTRUM_NFFT,argc>3?atoi(argv[3]):20000,argc>4?atoi(argv[4]):1024,
+                         argc>5?atoi(argv[5]):4);
+  }
+  else if(strcmp(argv[1],"quality") == 0){
+    grand_bench_quality(argc>2?atoi(argv[2]):20000,argc>3?atoi(argv[3]):1024,argc>4?atoi(argv[4]):20);
+  }
+  else if(strcmp(argv[1],"station") == 0){
+    grand_bench_station(argc>2?argv[2]:"field_run22.txt",argc>3?atoi(argv[3]):2000,argc>4?atoi(argv[4]):1024);
+  }
+  else if(strcmp(argv[1],"preview") == 0){
+    grand_bench_preview(argc>2?atoi(argv[2]):20000,argc>3?atoi(argv[3]):1024);
+  }
+  else if(strcmp(argv[1],"daemon") == 0){
+    grand_bench_daemon(argc>5?argv[5]:"./grand_daemon",argc>2?argv[2]:"field_run22.txt",argc>3?atoi(argv[3]):200,
+                       argc>4?atoi(argv[4]):1024);
+  }
+  else if(strcmp(argv[1],"mpi") == 0){
+#ifdef GRAND_USE_MPI
+    MPI_Init(&argc,&argv);
+    grand_bench_mpi(argc>2?argv[2]:"field_run22.txt",argc>3?atoi(argv[3]):5000,argc>4?atoi(argv[4]):1024);
+    MPI_Finalize();
+#else
+    printf("grand_bench was built without MPI, use make MPI=1\n");
+    return(-1);
+#endif
+  }
+  else{
+    printf("Unknown benchmark %s\n",argv[1]);
+    return(-1);
+  }
+  return(0);
+}
@@ -8,6 +8,8 @@
  */
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include<stddef.h>
 #include "grand_binlib.h"
 
 /*! pointer to the binary file header information*/
@@ -91,3 +93,81 @@ unsigned short *grand_read_event(FILE *fp, int *size)
   *size = isize+INTSIZE;
   return(event);
 }
+
+/**
+ * Create a synthetic event with the on-disk framing of grand_read_event,
+ * 10 events per GPS second with noise traces around an ADC baseline of 100
+ * @param[in] runnr: the run number
+ * @param[in] eventnr: the event number
+ * @param[in] n_ls: the number of local stations
+ * @param[in] ls_id: the electronics id of each local station
+ * @param[in] tracelength: the number of samples of each of the 4 channels
+ * @param[out] size: pointer to the size of the event
+ * \return NULL:  could not allocate the event
+ * \return otherwise: valid pointer to the event data, valid until the next call
+ */
+unsigned short *grand_synthetic_event(int runnr,int eventnr,int n_ls,int *ls_id,int tracelength,int *size)
+{
+  static unsigned short *synthetic=NULL;
+  int ls_size = (((int)offsetof(EventBody,info_ADCbuffer)+EVENT_ADC+4*SHORTSIZE*tracelength)+3)&~3;
+  int isize = EVENT_LS*SHORTSIZE+n_ls*ls_size;
+  unsigned int seed = 12345+eventnr;
+  unsigned int ctd,ctp;
+  unsigned short trlen = tracelength;
+  float quant[2];
+  EventHeader *eh;
+  EventBody *eb;
+  char *raw;
+  short *adc;
+
+  *size = -1;
+  if(synthetic != NULL) free((void *)synthetic);
+  if((synthetic = (unsigned short *)calloc(1,isize)) == NULL) return(NULL);
+  eh = (EventHeader *)synthetic;
+  eh->length = isize-INTSIZE;
+  eh->runnr = runnr;
+  eh->eventnr = eventnr;
+  eh->t3_event = eventnr;
+  eh->second = 1600000000+eventnr/10;
+  eh->nanosecond = (eventnr%10)*100000000;
+  eh->version = 1;
+  eh->LSCNT = n_ls;
+  for(int ils=0;ils<n_ls;ils++){
+    eb = (EventBody *)((char *)synthetic+EVENT_LS*SHORTSIZE+ils*ls_size);
+    eb->length = ls_size/SHORTSIZE;
+    eb->event_nr = eventnr;
+    eb->LS_id = ls_id[ils];
+    eb->header_length = offsetof(EventBody,info_ADCbuffer)/SHORTSIZE;
+    eb->GPSseconds = eh->second;
+    eb->GPSnanoseconds = eh->nanosecond+100*ils;
+    eb->trigger_flag = 1<<(eventnr%4);
+    eb->sampling_freq = 500;
+    eb->channel_mask = 0xf;
+    eb->ADC_resolution = 14;
+    eb->tracelength = tracelength;
+#ifdef USE_EVENT_VERSION
+    eb->version = 1;
+#endif
+    raw = (char *)eb->info_ADCbuffer;
+    raw[EVENT_GPS] = (2020&0xff);
+    raw[EVENT_GPS+1] = (2020>>8);
+    raw[EVENT_GPS+2] = 9;
+    raw[EVENT_GPS+3] = 13;
+    ctp = 500000000+ils;
+    ctd = (eh->nanosecond/2)+13*ils;
+    quant[0] = 1.5;
+    quant[1] = -2.25;
+    memcpy(&raw[EVENT_CTD],&ctd,INTSIZE);
+    memcpy(&raw[EVENT_CTP],&ctp,INTSIZE);
+    memcpy(&raw[EVENT_QUANT1],&quant[0],INTSIZE);
+    memcpy(&raw[EVENT_QUANT2],&quant[1],INTSIZE);
+    for(int ich=0;ich<4;ich++) memcpy(&raw[EVENT_LENCH1+2*ich],&trlen,SHORTSIZE);
+    adc = (short *)&raw[EVENT_ADC];
+    for(int i=0;i<4*tracelength;i++){
+      seed = seed*1103515245+12345;
+      adc[i] = 100+(int)((seed>>16)%41)-20;
+    }
+  }
+  *size = isize;
+  return(synthetic);
+}
@@ -201,4 +201,5 @@ typedef struct{
 
 int *grand_read_file_header(FILE *fp, int *size);
 unsigned short *grand_read_event(FILE *fp, int *size);
+unsigned short *grand_synthetic_event(int runnr,int eventnr,int n_ls,int *ls_id,int tracelength,int *size);
 
@@ -0,0 +1,373 @@
+/** \file grand_catalog.c
+ *  \brief time-ordered catalog of the events of many converted runs
+ *
+ *  The catalog is an HDF5 file with four extendable tables:
+ *  Files (the converted HDF5 files), Entries (one row per event),
+ *  Blocks (the key of every CATALOG_BLOCK-th entry) and Segments.
+ *  Every conversion appends one segment of time-sorted entries, so existing
+ *  entries are never rewritten. A query only reads the segment table, sorts it
+ *  on the start time if needed, binary searches the overlapping segments, then
+ *  the sparse block index of those segments, and reads the entry blocks that
+ *  contain the requested time range.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+
+/*! HDF5 types for the catalog */
+hid_t t_catalog_entry = -1;
+/*! HDF5 types for the catalog */
+hid_t t_catalog_segment = -1;
+/*! HDF5 types for the catalog */
+hid_t t_catalog_key = -1;
+/*! HDF5 types for the catalog */
+hid_t t_catalog_name = -1;
+
+/**
+ \brief Creates the HDF5 structures of the catalog
+ * \return 1: all ok
+ * \return 0: nothing needs to be done
+ * \return -1: Structure cannot be created
+ * \return -2: items cannot be added
+* */
+int grand_HDF5create_compound_catalog()
+{
+  int return_code = 1;
+
+  if(t_catalog_entry>0) return(0);
+  if((t_catalog_entry = H5Tcreate( H5T_COMPOUND, sizeof(CatalogEntry)))<0) return(-1);
+  if(H5Tinsert(t_catalog_entry, "second", HOFFSET(CatalogEntry,second), H5T_NATIVE_UINT)<0) return_code = -2;
+  if(H5Tinsert(t_catalog_entry, "nanosec", HOFFSET(CatalogEntry,nanosecond), H5T_NATIVE_UINT)<0) return_code = -2;
+  if(H5Tinsert(t_catalog_entry, "run_nr", HOFFSET(CatalogEntry,runnr), H5T_NATIVE_UINT)<0) return_code = -2;
+  if(H5Tinsert(t_catalog_entry, "event_nr", HOFFSET(CatalogEntry,eventnr), H5T_NATIVE_UINT)<0) return_code = -2;
+  if(H5Tinsert(t_catalog_entry, "file", HOFFSET(CatalogEntry,file), H5T_NATIVE_UINT)<0) return_code = -2;
+  if((t_catalog_segment = H5Tcreate( H5T_COMPOUND, sizeof(CatalogSegment)))<0) return(-1);
+  if(H5Tinsert(t_catalog_segment, "first_entry", HOFFSET(CatalogSegment,first_entry), H5T_NATIVE_ULLONG)<0)
+    return_code = -2;
+  if(H5Tinsert(t_catalog_segment, "n_entries", HOFFSET(CatalogSegment,n_entries), H5T_NATIVE_ULLONG)<0)
+    return_code = -2;
+  if(H5Tinsert(t_catalog_segment, "first_block", HOFFSET(CatalogSegment,first_block), H5T_NATIVE_ULLONG)<0)
+    return_code = -2;
+  if(H5Tinsert(t_catalog_segment, "n_blocks", HOFFSET(CatalogSegment,n_blocks), H5T_NATIVE_ULLONG)<0)
+    return_code = -2;
+  if(H5Tinsert(t_catalog_segment, "first_second", HOFFSET(CatalogSegment,first_second), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_catalog_segment, "first_nanosec", HOFFSET(CatalogSegment,first_nanosecond), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_catalog_segment, "last_second", HOFFSET(CatalogSegment,last_second), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_catalog_segment, "last_nanosec", HOFFSET(CatalogSegment,last_nanosecond), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if((t_catalog_key = H5Tcreate( H5T_COMPOUND, sizeof(CatalogKey)))<0) return(-1);
+  if(H5Tinsert(t_catalog_key, "second", HOFFSET(CatalogKey,second), H5T_NATIVE_UINT)<0) return_code = -2;
+  if(H5Tinsert(t_catalog_key, "nanosec", HOFFSET(CatalogKey,nanosecond), H5T_NATIVE_UINT)<0) return_code = -2;
+  t_catalog_name = H5Tcopy (H5T_C_S1);
+  if(H5Tset_size (t_catalog_name, CATALOG_NAME_LENGTH)<0) return_code = -2;
+  if(return_code < 0){
+    H5Tclose(t_catalog_entry);
+    H5Tclose(t_catalog_segment);
+    H5Tclose(t_catalog_key);
+    H5Tclose(t_catalog_name);
+    t_catalog_entry = -1;
+    return(return_code);
+  }
+  return(1);
+}
+
+/**
+ * \brief compare two catalog times
+ * \return <0, 0, >0 if the first time is earlier, equal or later than the second one
+ */
+int grand_catalog_compare(unsigned int sec1,unsigned int nsec1,unsigned int sec2,unsigned int nsec2)
+{
+  if(sec1 != sec2) return(sec1<sec2?-1:1);
+  if(nsec1 != nsec2) return(nsec1<nsec2?-1:1);
+  return(0);
+}
+
+/**
+ * \brief qsort comparison of catalog entries
+ */
+int grand_catalog_sort(const void *a,const void *b)
+{
+  const CatalogEntry *ea = (const CatalogEntry *)a;
+  const CatalogEntry *eb = (const CatalogEntry *)b;
+
+  return(grand_catalog_compare(ea->second,ea->nanosecond,eb->second,eb->nanosecond));
+}
+
+/**
+ * \brief qsort comparison of catalog segments on their first event
+ */
+int grand_catalog_sort_segment(const void *a,const void *b)
+{
+  const CatalogSegment *sa = (const CatalogSegment *)a;
+  const CatalogSegment *sb = (const CatalogSegment *)b;
+
+  return(grand_catalog_compare(sa->first_second,sa->first_nanosecond,sb->first_second,sb->first_nanosecond));
+}
+
+/**
+ * \brief number of rows in a catalog table
+ * @param[in] file_id: the catalog file
+ * @param[in] name: the name of the table
+ * \return the number of rows, 0 if the table does not exist
+ */
+hsize_t grand_HDF5catalog_size(hid_t file_id,char *name)
+{
+  hid_t data_set,space;
+  hsize_t dim[1]={0};
+
+  if(H5Lexists(file_id,name,H5P_DEFAULT)<=0) return(0);
+  if((data_set = H5Dopen(file_id,name,H5P_DEFAULT))<0) return(0);
+  space = H5Dget_space(data_set);
+  H5Sget_simple_extent_dims(space,dim,NULL);
+  H5Sclose(space);
+  H5Dclose(data_set);
+  return(dim[0]);
+}
+
+/**
+ * \brief read consecutive rows of a catalog table
+ * @param[in] file_id: the catalog file
+ * @param[in] name: the name of the table
+ * @param[in] type: the HDF5 type of the rows
+ * @param[in] start: the first row
+ * @param[in] n: the number of rows
+ * @param[out] buf: the rows
+ * \return 1: all ok
+ * \return -1: the table cannot be read
+ */
+int grand_HDF5catalog_read(hid_t file_id,char *name,hid_t type,hsize_t start,hsize_t n,void *buf)
+{
+  hid_t data_set,mem_space,file_space;
+  int return_code = 1;
+
+  if(n == 0) return(1);
+  if((data_set = H5Dopen(file_id,name,H5P_DEFAULT))<0) return(-1);
+  mem_space = H5Screate_simple(1, &n, NULL);
+  file_space = H5Dget_space(data_set);
+  if(H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &start, NULL, &n, NULL)<0) return_code = -1;
+  if(return_code>0 && H5Dread(data_set, type, mem_space, file_space, H5P_DEFAULT, buf)<0) return_code = -1;
+  H5Sclose(file_space);
+  H5Sclose(mem_space);
+  H5Dclose(data_set);
+  return(return_code);
+}
+
+/**
+ * \brief Add the events of one converted file to the catalog as a new time-sorted segment
+ * @param[in] catalogname: the catalog file, created if it does not exist
+ * @param[in] hdfname: the HDF5 file holding the events
+ * @param[in] entries: the events, sorted in place
+ * @param[in] n: the number of events
+ * \return 1: all ok
+ * \return 0: nothing to add
+ * \return -1: the catalog cannot be opened or created
+ * \return -2: the catalog cannot be updated
+ */
+int grand_HDF5catalog_add(char *catalogname,char *hdfname,CatalogEntry *entries,int n)
+{
+  hid_t file_id;
+  FILE *fp;
+  char name[CATALOG_NAME_LENGTH];
+  char *path;
+  CatalogSegment segment;
+  CatalogKey *blocks;
+  hsize_t ifile;
+  int return_code = 1;
+
+  if(n<=0) return(0);
+  if(grand_HDF5create_compound_catalog()<0) return(-1);
+  if((fp = fopen(catalogname,"r")) != NULL){
+    fclose(fp);
+    file_id = H5Fopen(catalogname, H5F_ACC_RDWR, H5P_DEFAULT);
+  }
+  else{
+    file_id = H5Fcreate(catalogname, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  }
+  if(file_id<0) return(-1);
+  qsort(entries,n,sizeof(CatalogEntry),grand_catalog_sort);
+  ifile = grand_HDF5catalog_size(file_id,"Files");
+  for(int i=0;i<n;i++) entries[i].file = ifile;
+  segment.first_entry = grand_HDF5catalog_size(file_id,"Entries");
+  segment.n_entries = n;
+  segment.first_block = grand_HDF5catalog_size(file_id,"Blocks");
+  segment.n_blocks = (n+CATALOG_BLOCK-1)/CATALOG_BLOCK;
+  segment.first_second = entries[0].second;
+  segment.first_nanosecond = entries[0].nanosecond;
+  segment.last_second = entries[n-1].second;
+  segment.last_nanosecond = entries[n-1].nanosecond;
+  if((blocks = (CatalogKey *)malloc(segment.n_blocks*sizeof(CatalogKey))) == NULL){
+    H5Fclose(file_id);
+    return(-2);
+  }
+  for(int ib=0;ib<segment.n_blocks;ib++){
+    blocks[ib].second = entries[ib*CATALOG_BLOCK].second;
+    blocks[ib].nanosecond = entries[ib*CATALOG_BLOCK].nanosecond;
+  }
+  // the catalog can be queried from any directory: store the absolute path of the file
+  memset(name,0,CATALOG_NAME_LENGTH);
+  if((path = realpath(hdfname,NULL)) != NULL){
+    strncpy(name,path,CATALOG_NAME_LENGTH-1);
+    free(path);
+  }
+  else strncpy(name,hdfname,CATALOG_NAME_LENGTH-1);
+  if(grand_HDF5append_records(file_id,"Files",t_catalog_name,64,1,name)<0) return_code = -2;
+  if(grand_HDF5append_records(file_id,"Entries",t_catalog_entry,CATALOG_BLOCK,n,entries)<0) return_code = -2;
+  if(grand_HDF5append_records(file_id,"Blocks",t_catalog_key,CATALOG_BLOCK,segment.n_blocks,blocks)<0)
+    return_code = -2;
+  // the segment is written last: a failed update leaves no reference to partial data
+  if(return_code>0 && grand_HDF5append_records(file_id,"Segments",t_catalog_segment,64,1,&segment)<0)
+    return_code = -2;
+  free(blocks);
+  H5Fclose(file_id);
+  return(return_code);
+}
+
+/**
+ * \brief Find all events in a GPS time range
+ * @param[in] catalogname: the catalog file
+ * @param[in] from: the start of the time range
+ * @param[in] to: the end of the time range (inclusive)
+ * @param[out] result: the events in the range sorted in time, to be freed by the caller
+ * @param[out] n: the number of events
+ * \return 1: all ok
+ * \return -1: the catalog cannot be opened
+ * \return -2: the catalog cannot be read
+ */
+int grand_HDF5catalog_query(char *catalogname,CatalogKey from,CatalogKey to,CatalogEntry **result,int *n)
+{
+  hid_t file_id;
+  CatalogSegment *segments;
+  CatalogKey *blocks,*reach;
+  CatalogEntry block[CATALOG_BLOCK];
+  hsize_t n_segments,first,last,lo,hi,mid,ientry,nread;
+  int n_alloc = 0;
+  int return_code = 1;
+  int done;
+
+  *result = NULL;
+  *n = 0;
+  if(grand_HDF5create_compound_catalog()<0) return(-1);
+  if((file_id = H5Fopen(catalogname, H5F_ACC_RDONLY, H5P_DEFAULT))<0) return(-1);
+  n_segments = grand_HDF5catalog_size(file_id,"Segments");
+  if((segments = (CatalogSegment *)malloc((n_segments+1)*sizeof(CatalogSegment))) == NULL){
+    H5Fclose(file_id);
+    return(-2);
+  }
+  if((reach = (CatalogKey *)malloc((n_segments+1)*sizeof(CatalogKey))) == NULL){
+    free(segments);
+    H5Fclose(file_id);
+    return(-2);
+  }
+  if(grand_HDF5catalog_read(file_id,"Segments",t_catalog_segment,0,n_segments,segments)<0)
+    return_code = -2;
+  // segments are appended in conversion order, which is normally already time order
+  for(hsize_t is=1;is<n_segments;is++){
+    if(grand_catalog_sort_segment(&segments[is-1],&segments[is])>0){
+      qsort(segments,n_segments,sizeof(CatalogSegment),grand_catalog_sort_segment);
+      break;
+    }
+  }
+  // latest event of all segments up to is: non-decreasing, so both ends are binary searched
+  for(hsize_t is=0;is<n_segments;is++){
+    reach[is].second = segments[is].last_second;
+    reach[is].nanosecond = segments[is].last_nanosecond;
+    if(is>0 && grand_catalog_compare(reach[is-1].second,reach[is-1].nanosecond,
+                                     reach[is].second,reach[is].nanosecond)>0) reach[is] = reach[is-1];
+  }
+  // first segment that reaches the range
+  lo = 0;
+  hi = n_segments;
+  while(lo<hi){
+    mid = (lo+hi)/2;
+    if(grand_catalog_compare(reach[mid].second,reach[mid].nanosecond,from.second,from.nanosecond)<0) lo = mid+1;
+    else hi = mid;
+  }
+  first = lo;
+  // first segment that starts after the range
+  hi = n_segments;
+  while(lo<hi){
+    mid = (lo+hi)/2;
+    if(grand_catalog_compare(segments[mid].first_second,segments[mid].first_nanosecond,to.second,to.nanosecond)<=0)
+      lo = mid+1;
+    else hi = mid;
+  }
+  last = lo;
+  free(reach);
+  for(hsize_t is=first;is<last && return_code>0;is++){
+    if(grand_catalog_compare(segments[is].last_second,segments[is].last_nanosecond,from.second,from.nanosecond)<0)
+      continue;
+    if((blocks = (CatalogKey *)malloc(segments[is].n_blocks*sizeof(CatalogKey))) == NULL){
+      return_code = -2;
+      break;
+    }
+    if(grand_HDF5catalog_read(file_id,"Blocks",t_catalog_key,segments[is].first_block,
+                              segments[is].n_blocks,blocks)<0) return_code = -2;
+    // last block that starts before the range
+    lo = 0;
+    hi = segments[is].n_blocks;
+    while(hi-lo>1){
+      mid = (lo+hi)/2;
+      if(grand_catalog_compare(blocks[mid].second,blocks[mid].nanosecond,from.second,from.nanosecond)<0) lo = mid;
+      else hi = mid;
+    }
+    free(blocks);
+    done = 0;
+    for(ientry=lo*CATALOG_BLOCK;ientry<segments[is].n_entries && !done && return_code>0;ientry+=CATALOG_BLOCK){
+      nread = segments[is].n_entries-ientry;
+      if(nread>CATALOG_BLOCK) nread = CATALOG_BLOCK;
+      if(grand_HDF5catalog_read(file_id,"Entries",t_catalog_entry,segments[is].first_entry+ientry,nread,block)<0){
+        return_code = -2;
+        break;
+      }
+      for(int i=0;i<nread;i++){
+        if(grand_catalog_compare(block[i].second,block[i].nanosecond,from.second,from.nanosecond)<0) continue;
+        if(grand_catalog_compare(block[i].second,block[i].nanosecond,to.second,to.nanosecond)>0){
+          done = 1;
+          break;
+        }
+        if(*n == n_alloc){
+          n_alloc = n_alloc>0?2*n_alloc:CATALOG_BLOCK;
+          if((*result = (CatalogEntry *)realloc(*result,n_alloc*sizeof(CatalogEntry))) == NULL){
+            return_code = -2;
+            *n = 0;
+            break;
+          }
+        }
+        (*result)[(*n)++] = block[i];
+      }
+    }
+  }
+  free(segments);
+  H5Fclose(file_id);
+  if(*n>1) qsort(*result,*n,sizeof(CatalogEntry),grand_catalog_sort);
+  return(return_code);
+}
+
+/**
+ * \brief Read the names of the files in the catalog
+ * @param[in] catalogname: the catalog file
+ * @param[out] files: the file names, indexed by CatalogEntry.file, to be freed by the caller
+ * @param[out] n: the number of files
+ * \return 1: all ok
+ * \return -1: the catalog cannot be opened
+ * \return -2: the catalog cannot be read
+ */
+int grand_HDF5catalog_files(char *catalogname,char (**files)[CATALOG_NAME_LENGTH],int *n)
+{
+  hid_t file_id;
+  int return_code = 1;
+
+  *n = 0;
+  if(grand_HDF5create_compound_catalog()<0) return(-1);
+  if((file_id = H5Fopen(catalogname, H5F_ACC_RDONLY, H5P_DEFAULT))<0) return(-1);
+  *n = grand_HDF5catalog_size(file_id,"Files");
+  if((*files = malloc((*n+1)*CATALOG_NAME_LENGTH)) == NULL) return_code = -2;
+  else if(grand_HDF5catalog_read(file_id,"Files",t_catalog_name,0,*n,*files)<0) return_code = -2;
+  H5Fclose(file_id);
+  return(return_code);
+}
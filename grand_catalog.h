@@ -0,0 +1,43 @@
+/** \file grand_catalog.h
+ *  \brief time-ordered catalog of the events of many converted runs
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_CATALOG_H
+#define GRAND_CATALOG_H
+
+#define CATALOG_BLOCK 256 /**< number of catalog entries per block of the sparse index */
+#define CATALOG_NAME_LENGTH 256 /**< maximal length of a file name in the catalog */
+
+typedef struct{
+  unsigned int second;
+  unsigned int nanosecond;
+  unsigned int runnr;
+  unsigned int eventnr;
+  unsigned int file;
+}CatalogEntry;
+
+typedef struct{
+  unsigned long long first_entry;
+  unsigned long long n_entries;
+  unsigned long long first_block;
+  unsigned long long n_blocks;
+  unsigned int first_second;
+  unsigned int first_nanosecond;
+  unsigned int last_second;
+  unsigned int last_nanosecond;
+}CatalogSegment;
+
+typedef struct{
+  unsigned int second;
+  unsigned int nanosecond;
+}CatalogKey;
+
+int grand_HDF5catalog_add(char *catalogname,char *hdfname,CatalogEntry *entries,int n);
+int grand_HDF5catalog_query(char *catalogname,CatalogKey from,CatalogKey to,CatalogEntry **result,int *n);
+int grand_HDF5catalog_files(char *catalogname,char (**files)[CATALOG_NAME_LENGTH],int *n);
+
+#endif
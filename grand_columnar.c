@@ -0,0 +1,264 @@
+/** \file grand_columnar.c
+ *  \brief raw columnar output: one file of fixed-width records per column
+ *
+ *  The output of a conversion is the directory <base>.cols, with a file
+ *  <column>.bin per column and a description in columns.txt. The records
+ *  are the structures of grand_hdf5.h in native byte order; the rows of
+ *  event i are event_offset[i] up to event_offset[i+1]. The files are grown
+ *  and written through memory maps, without compression, sharding or
+ *  periodic data, which makes this format a fast scratch output for
+ *  quick-look and a reference for the cost of the HDF5 output.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "grand_hdf5.h"
+
+char *column_name[GRAND_N_COLUMNS] = {"event_header","event_offset","antenna_info","trigger_time",
+  "trace_index","traces","monitor","skipped"};
+int column_size[GRAND_N_COLUMNS] = {sizeof(EventHeader),sizeof(unsigned long long),sizeof(AntHdr),
+  sizeof(TriggerTime),sizeof(LiveTrace),sizeof(short),sizeof(MonInfo),sizeof(SkippedRange)};
+
+/**
+ * \brief Append bytes to a column file, the file and its map are grown as needed
+ * @param[in,out] c: the column file
+ * @param[in] buf: the data
+ * @param[in] n: the number of bytes
+ * \return 1: all ok
+ * \return 0: nothing to do
+ * \return -1: the disk space cannot be allocated or the file cannot be mapped
+ */
+int grand_columnar_append(ColumnFile *c,const void *buf,size_t n)
+{
+  size_t mapped;
+  char *map;
+
+  if(n == 0) return(0);
+  if(c->used+n > c->mapped){
+    mapped = 2*c->mapped;
+    if(mapped < c->used+n) mapped = c->used+n;
+    if(mapped < COLUMN_GROW) mapped = COLUMN_GROW;
+    /* allocate the blocks before mapping them, a full disk fails here instead of raising SIGBUS in memcpy */
+    if(posix_fallocate(c->fd,c->mapped,mapped-c->mapped) != 0){
+      printf("Cannot grow a column file to %zu bytes\n",mapped);
+      return(-1);
+    }
+    if(c->map != NULL) munmap(c->map,c->mapped);
+    c->map = NULL;
+    c->mapped = 0;
+    if((map = mmap(NULL,mapped,PROT_READ|PROT_WRITE,MAP_SHARED,c->fd,0)) == MAP_FAILED) return(-1);
+    c->map = map;
+    c->mapped = mapped;
+  }
+  memcpy(&c->map[c->used],buf,n);
+  c->used += n;
+  return(1);
+}
+
+/**
+ * \brief Unmap a column file and truncate it to its contents
+ * @param[in,out] c: the column file
+ */
+void grand_columnar_close_column(ColumnFile *c)
+{
+  if(c->fd<0) return;
+  if(c->map != NULL) munmap(c->map,c->mapped);
+  if(ftruncate(c->fd,c->used)<0) printf("Cannot truncate a column file\n");
+  close(c->fd);
+  c->fd = -1;
+  c->map = NULL;
+  c->mapped = 0;
+}
+
+/**
+ * \brief Create the column directory and files of a conversion job
+ * \return 1: all ok
+ * \return -2: the directory or a column file cannot be created
+ */
+int grand_columnar_open(GrandWriter *w,GrandJob *job)
+{
+  ColumnarOutput *out;
+  char name[VIEW_NAME_LENGTH-8];
+  char filename[VIEW_NAME_LENGTH+30];
+  char *ext;
+
+  if((out = calloc(1,sizeof(ColumnarOutput))) == NULL) return(-2);
+  w->state = out;
+  for(int i=0;i<GRAND_N_COLUMNS;i++) out->column[i].fd = -1;
+  grand_job_outname(job,name,sizeof(name));
+  if((ext = strstr(name,".hdf5")) != NULL) *ext = 0;
+  snprintf(out->dirname,sizeof(out->dirname),"%s.cols",name);
+  out->runnr = job->runnr;
+  if(mkdir(out->dirname,0755)<0 && errno != EEXIST){
+    printf("Cannot create %s\n",out->dirname);
+    return(-2);
+  }
+  for(int i=0;i<GRAND_N_COLUMNS;i++){
+    snprintf(filename,sizeof(filename),"%s/%s.bin",out->dirname,column_name[i]);
+    if((out->column[i].fd = open(filename,O_RDWR|O_CREAT|O_TRUNC,0644))<0){
+      printf("Cannot create %s\n",filename);
+      for(int j=0;j<i;j++) close(out->column[j].fd);
+      return(-2);
+    }
+  }
+  w->n_files = 1;
+  return(1);
+}
+
+/**
+ * \brief Append the header and the first antenna row of an event
+ * \return 1: all ok
+ * \return -2: a column cannot be written
+ */
+int grand_columnar_begin(GrandWriter *w,GrandEvent *ev)
+{
+  ColumnarOutput *out = (ColumnarOutput *)w->state;
+  ColumnFile *c = out->column;
+  int return_code = 1;
+
+  if(grand_columnar_append(&c[COLUMN_EVENT_HEADER],ev->header,sizeof(EventHeader))<0) return_code = -2;
+  if(grand_columnar_append(&c[COLUMN_EVENT_OFFSET],&out->n_rows,sizeof(unsigned long long))<0) return_code = -2;
+  return(return_code);
+}
+
+/**
+ * \brief Append the traces of an antenna and their index
+ * \return 1: all ok
+ * \return -2: a column cannot be written
+ */
+int grand_columnar_antenna(GrandWriter *w,GrandEvent *ev,int ic)
+{
+  ColumnarOutput *out = (ColumnarOutput *)w->state;
+  ColumnFile *c = out->column;
+  LiveTrace index;
+  int return_code = 1;
+
+  memset((void *)&index,0,sizeof(LiveTrace));
+  index.event_nr = ev->header->eventnr;
+  index.antenna_id = ev->iant[ic]+1;
+  index.offset = out->n_samples;
+  for(int itrace=0;itrace<3;itrace++){
+    index.length[itrace] = ev->slice[ic].length[itrace];
+    if(ev->slice[ic].trace[itrace] == NULL) continue;
+    if(grand_columnar_append(&c[COLUMN_TRACES],ev->slice[ic].trace[itrace],
+                             ev->slice[ic].length[itrace]*sizeof(short))<0) return_code = -2;
+    out->n_samples += ev->slice[ic].length[itrace];
+  }
+  if(grand_columnar_append(&c[COLUMN_TRACE_INDEX],&index,sizeof(LiveTrace))<0) return_code = -2;
+  return(return_code);
+}
+
+/**
+ * \brief Append the antenna headers and trigger times of an event
+ * \return 1: all ok
+ * \return -2: a column cannot be written
+ */
+int grand_columnar_end(GrandWriter *w,GrandEvent *ev)
+{
+  ColumnarOutput *out = (ColumnarOutput *)w->state;
+  ColumnFile *c = out->column;
+  int return_code = 1;
+
+  if(grand_columnar_append(&c[COLUMN_ANTENNA_INFO],ev->ah,ev->n*sizeof(AntHdr))<0) return_code = -2;
+  if(grand_columnar_append(&c[COLUMN_TRIGGER_TIME],ev->tt,ev->n*sizeof(TriggerTime))<0) return_code = -2;
+  out->n_rows += ev->n;
+  out->n_events++;
+  return(return_code);
+}
+
+/**
+ * \brief Append a monitor record to the monitor column
+ * \return 1: all ok
+ * \return -2: the column cannot be written
+ */
+int grand_columnar_monitor(GrandWriter *w,int iant,MonInfo *monitor)
+{
+  ColumnarOutput *out = (ColumnarOutput *)w->state;
+
+  if(grand_columnar_append(&out->column[COLUMN_MONITOR],monitor,sizeof(MonInfo))<0) return(-2);
+  return(1);
+}
+
+/**
+ * \brief Append a skipped byte range of the binary files to its column
+ * \return 1: all ok
+ * \return -2: the column cannot be written
+ */
+int grand_columnar_skipped(GrandWriter *w,SkippedRange *range)
+{
+  ColumnarOutput *out = (ColumnarOutput *)w->state;
+
+  if(grand_columnar_append(&out->column[COLUMN_SKIPPED],range,sizeof(SkippedRange))<0) return(-2);
+  return(1);
+}
+
+/**
+ * \brief Close the columns and describe them in columns.txt
+ * \return 1: all ok
+ * \return -1: a column or the description cannot be written
+ */
+int grand_columnar_close(GrandWriter *w)
+{
+  ColumnarOutput *out = (ColumnarOutput *)w->state;
+  char filename[VIEW_NAME_LENGTH+30];
+  FILE *fp;
+  int return_code = 1;
+
+  if(grand_columnar_append(&out->column[COLUMN_EVENT_OFFSET],&out->n_rows,sizeof(unsigned long long))<0)
+    return_code = -1;
+  w->bytes = 0;
+  for(int i=0;i<GRAND_N_COLUMNS;i++){
+    w->bytes += out->column[i].used;
+    grand_columnar_close_column(&out->column[i]);
+  }
+  snprintf(filename,sizeof(filename),"%s/columns.txt",out->dirname);
+  if((fp = fopen(filename,"w")) == NULL){
+    printf("Cannot write %s\n",filename);
+    return(-1);
+  }
+  fprintf(fp,"# GRAND columnar output\n");
+  fprintf(fp,"run %d\nevents %llu\nantennas %llu\nsamples %llu\n",out->runnr,out->n_events,out->n_rows,out->n_samples);
+  fprintf(fp,"# column record_size n_records\n");
+  for(int i=0;i<GRAND_N_COLUMNS;i++)
+    fprintf(fp,"%s %d %zu\n",column_name[i],column_size[i],out->column[i].used/column_size[i]);
+  fclose(fp);
+  return(return_code);
+}
+
+/**
+ * \brief Map a column of a columnar output read-only
+ * @param[in] dirname: the column directory
+ * @param[in] column: the name of the column, e.g. antenna_info
+ * @param[out] size: the size of the column in bytes
+ * \return the column, to be released with munmap(map,size); NULL if it does not exist or is empty
+ */
+void *grand_columnar_map(char *dirname,char *column,size_t *size)
+{
+  char filename[VIEW_NAME_LENGTH+30];
+  struct stat st;
+  void *map;
+  int fd;
+
+  *size = 0;
+  snprintf(filename,sizeof(filename),"%s/%s.bin",dirname,column);
+  if((fd = open(filename,O_RDONLY))<0) return(NULL);
+  if(fstat(fd,&st)<0 || st.st_size == 0){
+    close(fd);
+    return(NULL);
+  }
+  map = mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(map == MAP_FAILED) return(NULL);
+  *size = st.st_size;
+  return(map);
+}
+
+const GrandWriterOps grand_columnar_writer = {"columnar",grand_columnar_open,grand_columnar_begin,grand_columnar_antenna,
+  grand_columnar_end,NULL,
+  grand_columnar_monitor,grand_columnar_skipped,grand_columnar_close};
@@ -0,0 +1,45 @@
+/** \file grand_columnar.h
+ *  \brief raw columnar output: one file of fixed-width records per column
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_COLUMNAR_H
+#define GRAND_COLUMNAR_H
+
+#define COLUMN_EVENT_HEADER 0 /**< EventHeader per event */
+#define COLUMN_EVENT_OFFSET 1 /**< first antenna row per event (unsigned long long), plus the total */
+#define COLUMN_ANTENNA_INFO 2 /**< AntHdr per antenna */
+#define COLUMN_TRIGGER_TIME 3 /**< TriggerTime per antenna */
+#define COLUMN_TRACE_INDEX  4 /**< LiveTrace per antenna: offset and lengths in the traces column */
+#define COLUMN_TRACES       5 /**< ADC samples (short) */
+#define COLUMN_MONITOR      6 /**< MonInfo per monitor record */
+#define COLUMN_SKIPPED      7 /**< SkippedRange per byte range of the binary files that was not converted */
+#define GRAND_N_COLUMNS     8
+
+#define COLUMN_GROW (1<<20) /**< minimal growth of a column file in bytes */
+
+typedef struct{
+  int fd;
+  char *map;
+  size_t used;
+  size_t mapped;
+}ColumnFile;
+
+typedef struct{
+  char dirname[VIEW_NAME_LENGTH];
+  int runnr;
+  unsigned long long n_events;
+  unsigned long long n_rows;
+  unsigned long long n_samples;
+  ColumnFile column[GRAND_N_COLUMNS];
+}ColumnarOutput;
+
+extern const GrandWriterOps grand_columnar_writer;
+
+int grand_columnar_append(ColumnFile *c,const void *buf,size_t n);
+void *grand_columnar_map(char *dirname,char *column,size_t *size);
+
+#endif
@@ -0,0 +1,160 @@
+/** \file grand_convert.c
+ *  \brief conversion of one file sequence of a run, as done by to_hdf5 and grand_daemon
+ *
+ *  The field configuration, the HDF5 profile and the trace storage are set by
+ *  the caller, so that a long-running process sets them up only once.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <time.h>
+#include "grand_hdf5.h"
+
+/**
+ * \brief Initialize a conversion job with the defaults of to_hdf5
+ * @param[out] job: the job
+ * @param[in] basedir: directory with the AD and TD subdirectories
+ * @param[in] runnr: the run number
+ * @param[in] fileseq: the file sequence number
+ */
+void grand_job_init(GrandJob *job,char *basedir,int runnr,int fileseq)
+{
+  memset((void *)job,0,sizeof(GrandJob));
+  snprintf(job->basedir,sizeof(job->basedir),"%s",basedir);
+  job->runnr = runnr;
+  job->fileseq = fileseq;
+}
+
+/**
+ * \brief The name of the output of a job
+ * @param[in] job: the job
+ * @param[out] name: outname, or Run<runnr>.hdf5 without outname
+ * @param[in] size: the size of name
+ */
+void grand_job_outname(GrandJob *job,char *name,int size)
+{
+  if(job->outname[0] != 0) snprintf(name,size,"%s",job->outname);
+  else snprintf(name,size,"Run%d.hdf5",job->runnr);
+}
+
+/**
+ * \brief Pass the byte ranges that a reader skipped since the last call to the output
+ * @param[in] reader: the reader of a binary file
+ * @param[in] source: 0 for the AD file, 1 for the TD file
+ * @param[in,out] n_done: the number of ranges passed already
+ * @param[in] output: the output
+ * @param[in,out] stats: the skipped ranges and bytes are added
+ * \return 1: all ok
+ * \return -4: a range cannot be written
+ */
+int grand_convert_skipped(BinReader *reader,int source,int *n_done,GrandWriter *output,GrandJobStats *stats)
+{
+  SkippedRange *range;
+  int return_code = 1;
+
+  for(;*n_done<reader->n_skipped;(*n_done)++){
+    range = &reader->skipped[*n_done];
+    range->source = source;
+    if(output->ops->skipped != NULL && output->ops->skipped(output,range)<0) return_code = -4;
+    stats->n_skipped++;
+    stats->skipped_bytes += range->end-range->start;
+  }
+  return(return_code);
+}
+
+/**
+ * \brief Convert the AD and TD files of a file sequence
+ * @param[in] job: what to convert, where to write it and with which backend (hdf5 when not set)
+ * @param[out] stats: the events, files and bytes written, the corrupted ranges skipped and the wall time
+ * \return 1: all ok
+ * \return -1: not a valid roll-over limit
+ * \return -2: the output cannot be created
+ * \return -3: unknown backend
+ * \return -4: an event, periodic record or skipped range cannot be written, or no memory; the conversion stopped
+ * \return -5: the output cannot be closed
+ */
+int grand_convert(GrandJob *job,GrandJobStats *stats)
+{
+  char filename[VIEW_NAME_LENGTH+30];
+  int readlength;
+  unsigned short *event;
+  BinReader reader;
+  const GrandWriterOps *ops;
+  GrandWriter output;
+  GrandEvent ev;
+  EventHeader header;
+  EventBody *eb;
+  int return_code,ic,n_done;
+  struct timespec t0,t1;
+
+  clock_gettime(CLOCK_MONOTONIC,&t0);
+  memset((void *)stats,0,sizeof(GrandJobStats));
+  memset((void *)&ev,0,sizeof(GrandEvent));
+  if((ops = grand_writer_backend(job->backend)) == NULL){
+    printf("Unknown output backend %s\n",job->backend);
+    return(-3);
+  }
+  if((return_code = grand_writer_open(&output,ops,job))<0) return(return_code);
+
+  snprintf(filename,sizeof(filename),"%s/AD/ad%06d.f%04d",job->basedir,job->runnr,job->fileseq);
+  if(grand_reader_open(&reader,filename)>0) {
+    grand_reader_file_header(&reader,&readlength);
+    n_done = 0;
+    //the event is streamed to the writer one local station at a time
+    while(return_code>=0 && grand_reader_event_header(&reader,&header)>0){
+      if(grand_convert_skipped(&reader,0,&n_done,&output,stats)<0){
+        return_code = -4;
+        break;
+      }
+      if(header.LSCNT<1)continue;
+      if(grand_HDF5decode_begin(&header,&ev)<0){
+        return_code = -4;
+        break;
+      }
+      if(ops->begin(&output,&ev)<0){
+        return_code = -4;
+        break;
+      }
+      //a failed antenna or end still ends the event, the conversion stops after it
+      while((eb = grand_reader_next_ls(&reader)) != NULL){
+        if((ic = grand_HDF5decode_antenna(eb,&ev)) == -2) grand_reader_skip_ls(&reader,eb);
+        else if(ic>=0 && ops->antenna(&output,&ev,ic)<0) return_code = -4;
+      }
+      grand_HDF5decode_end(&ev);
+      if(ops->end(&output,&ev)<0) return_code = -4;
+      stats->n_events++;
+    }
+    if(grand_convert_skipped(&reader,0,&n_done,&output,stats)<0) return_code = -4;
+    grand_reader_close(&reader);
+  }
+  snprintf(filename,sizeof(filename),"%s/TD/td%06d.f%04d",job->basedir,job->runnr,job->fileseq);
+  if(return_code>=0 && grand_reader_open(&reader,filename)>0) {
+    grand_reader_file_header(&reader,&readlength);
+    n_done = 0;
+    while(return_code>=0 && (event = grand_reader_event(&reader,&readlength))!= NULL){
+      if(grand_convert_skipped(&reader,1,&n_done,&output,stats)<0){
+        return_code = -4;
+        break;
+      }
+      if(((EventHeader *)event)->LSCNT<1)continue;
+      if(ops->periodic != NULL && ops->periodic(&output,event)<0){
+        return_code = -4;
+        break;
+      }
+      stats->n_periodic++;
+    }
+    if(grand_convert_skipped(&reader,1,&n_done,&output,stats)<0) return_code = -4;
+    grand_reader_close(&reader);
+  }
+  /*// Next: monitoring data, one ops->monitor(&output,iant,&monitor) per record
+  snprintf(filename,sizeof(filename),"%s/MON/MO%06d.f%04d",job->basedir,job->runnr,job->fileseq);
+  grand_HDF5fill_monitor(filename,output.run_id);*/
+  if(grand_writer_close(&output)<0 && return_code>=0) return_code = -5;
+  grand_free_event(&ev);
+  stats->n_shards = output.n_files;
+  stats->bytes = output.bytes;
+  clock_gettime(CLOCK_MONOTONIC,&t1);
+  stats->seconds = (t1.tv_sec-t0.tv_sec)+1e-9*(t1.tv_nsec-t0.tv_nsec);
+  return(return_code<0?return_code:1);
+}
@@ -0,0 +1,42 @@
+/** \file grand_convert.h
+ *  \brief conversion of one file sequence of a run, as done by to_hdf5 and grand_daemon
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_CONVERT_H
+#define GRAND_CONVERT_H
+
+#define GRAND_MAX_LIMITS 3 /**< number of roll-over limits of a conversion */
+
+typedef struct{
+  char basedir[VIEW_NAME_LENGTH];
+  int runnr;
+  int fileseq;
+  char outname[VIEW_NAME_LENGTH];
+  char *catalogname;
+  char *viewname;
+  char *lockname;
+  char *limit[GRAND_MAX_LIMITS];
+  int nlimit;
+  int swmr_cadence;
+  char *backend;
+}GrandJob;
+
+typedef struct{
+  long n_events;
+  long n_periodic;
+  int n_shards;
+  unsigned long long bytes;
+  double seconds;
+  int n_skipped;                   /**< corrupted byte ranges of the binary files that were skipped */
+  unsigned long long skipped_bytes;
+}GrandJobStats;
+
+void grand_job_init(GrandJob *job,char *basedir,int runnr,int fileseq);
+void grand_job_outname(GrandJob *job,char *name,int size);
+int grand_convert(GrandJob *job,GrandJobStats *stats);
+
+#endif
@@ -0,0 +1,599 @@
+/** \file grand_daemon.c
+ *  \brief conversion service: watches the data directory and accepts jobs on a UNIX socket
+ *
+ *  The field configuration and the compound types are set up once; every job
+ *  runs in a forked worker that inherits them, with at most n_workers jobs at
+ *  the same time and an optional limit on the address space of a worker. Each
+ *  file sequence is written to <outdir>/Run<runnr>_f<fileseq>.hdf5, and with -V
+ *  added to the view <outdir>/Run<runnr>_view.hdf5 of its run.
+ *  A watched file sequence is queued once its AD file is closed and its TD file,
+ *  if there is one, is closed as well or has not been closed within
+ *  DAEMON_TD_WAIT seconds. A file sequence is queued only once while it waits,
+ *  and never converted by two workers at the same time. Only the last
+ *  DAEMON_KEEP_JOBS finished jobs are kept for the status command.
+ *
+ *  Socket commands, one per line:
+ *    convert basedir runnr fileseq   queue a job, answered with "queued <id>" (the id of the
+ *                                    same file sequence if it is still queued)
+ *    status                          one line per job followed by "end"
+ *    quit                            stop after the running jobs
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/inotify.h>
+#include "grand_hdf5.h"
+
+#define USAGE "Use: grand_daemon [-f fieldfile] [-w datadir] [-S socket] [-j workers] [-m worker_memory_MB] [-d outdir] [-c catalog] [-V] [-p default|latest|paged|core] [-z none|deflate|shuffle|adc] [-s flush_cadence] [-g rate_bin_seconds] [-F none|trace|average] [-n nfft] [-a] [-P] [-r limit[k|M|G|e|s]] [-i stdio|mmap|async|direct]\n"
+
+#define DAEMON_MAX_CLIENTS 16 /**< number of simultaneous socket connections */
+#define DAEMON_LINE 1024 /**< maximal length of a command */
+#define DAEMON_TD_WAIT 10 /**< seconds a closed AD file waits for the TD file of its sequence */
+#define DAEMON_KEEP_JOBS 256 /**< number of finished jobs kept for the status command */
+
+#define JOB_QUEUED  0
+#define JOB_RUNNING 1
+#define JOB_DONE    2
+#define JOB_FAILED  3
+
+typedef struct{
+  int id;
+  int state;
+  GrandJob job;
+  char viewname[VIEW_NAME_LENGTH+20];
+  pid_t pid;
+  int pipe;
+  GrandJobStats stats;
+  struct rusage usage;
+  int exit_code;
+}DaemonJob;
+
+typedef struct{
+  int fd;
+  int used;
+  char line[DAEMON_LINE];
+}DaemonClient;
+
+/*! a watched file sequence of which not both files are closed yet */
+typedef struct{
+  int runnr;
+  int fileseq;
+  time_t ad_closed; /**< 0 while the AD file is not closed */
+  int td_closed;
+}DaemonPending;
+
+void grand_HDF5create_compounds();
+extern int field_size;
+
+char *job_state_name[4] = {"queued","running","done","failed"};
+
+DaemonJob *jobs = NULL;
+int n_jobs = 0,n_jobs_alloc = 0;
+int next_job_id = 1;
+DaemonPending *pending = NULL;
+int n_pending = 0,n_pending_alloc = 0;
+static volatile sig_atomic_t stop = 0;
+
+/**
+ * \brief the template of every job: output directory and conversion options
+ */
+GrandJob job_template;
+char *outdir = ".";
+int run_view = 0;
+
+/**
+ * \brief SIGINT and SIGTERM: stop after the running jobs, the signal is reported at the end
+ */
+void grand_daemon_signal(int sig)
+{
+  stop = sig;
+}
+
+/**
+ * \brief Drop the oldest finished jobs, the queued and running ones are kept in order
+ */
+void grand_daemon_trim()
+{
+  int n_finished = 0,j = 0;
+
+  for(int i=0;i<n_jobs;i++) if(jobs[i].state == JOB_DONE || jobs[i].state == JOB_FAILED) n_finished++;
+  for(int i=0;i<n_jobs;i++){
+    if(n_finished>DAEMON_KEEP_JOBS && (jobs[i].state == JOB_DONE || jobs[i].state == JOB_FAILED)){
+      n_finished--;
+      continue;
+    }
+    if(j != i) jobs[j] = jobs[i];
+    j++;
+  }
+  n_jobs = j;
+}
+
+/**
+ * \brief Add a job to the queue, unless the same file sequence is already waiting in it
+ * \return the id of the job, -1 if there is no memory
+ */
+int grand_daemon_queue(char *basedir,int runnr,int fileseq)
+{
+  DaemonJob *grow;
+  DaemonJob *dj;
+  int n;
+
+  for(int i=0;i<n_jobs;i++){
+    dj = &jobs[i];
+    if(dj->state == JOB_QUEUED && dj->job.runnr == runnr && dj->job.fileseq == fileseq
+       && strcmp(dj->job.basedir,basedir) == 0) return(dj->id);
+  }
+  grand_daemon_trim();
+  if(n_jobs == n_jobs_alloc){
+    n = n_jobs_alloc == 0?64:2*n_jobs_alloc;
+    if((grow = realloc(jobs,n*sizeof(DaemonJob))) == NULL) return(-1);
+    jobs = grow;
+    n_jobs_alloc = n;
+  }
+  dj = &jobs[n_jobs];
+  memset((void *)dj,0,sizeof(DaemonJob));
+  dj->id = next_job_id++;
+  dj->state = JOB_QUEUED;
+  dj->job = job_template;
+  snprintf(dj->job.basedir,sizeof(dj->job.basedir),"%s",basedir);
+  dj->job.runnr = runnr;
+  dj->job.fileseq = fileseq;
+  snprintf(dj->job.outname,sizeof(dj->job.outname),"%s/Run%d_f%04d.hdf5",outdir,runnr,fileseq);
+  snprintf(dj->viewname,sizeof(dj->viewname),"%s/Run%d_view.hdf5",outdir,runnr);
+  dj->pipe = -1;
+  n_jobs++;
+  printf("job %d queued: run %d file %d in %s\n",dj->id,runnr,fileseq,basedir);
+  fflush(stdout);
+  return(dj->id);
+}
+
+/**
+ * \brief Start a job in a forked worker
+ * @param[in,out] dj: the job
+ * @param[in] memory_mb: limit of the address space of the worker, 0 for none
+ * \return 1: the worker is running
+ * \return -1: the worker cannot be started
+ */
+int grand_daemon_start(DaemonJob *dj,long memory_mb)
+{
+  int fd[2];
+  struct rlimit rl;
+  GrandJobStats stats;
+  int return_code;
+
+  if(pipe(fd)<0) return(-1);
+  fflush(stdout);
+  if((dj->pid = fork())<0){
+    close(fd[0]);
+    close(fd[1]);
+    return(-1);
+  }
+  if(dj->pid == 0){
+    close(fd[0]);
+    if(memory_mb>0){
+      rl.rlim_cur = rl.rlim_max = memory_mb*1024*1024;
+      setrlimit(RLIMIT_AS,&rl);
+    }
+    if(run_view) dj->job.viewname = dj->viewname;
+    return_code = grand_convert(&dj->job,&stats);
+    if(write(fd[1],&stats,sizeof(GrandJobStats)) != sizeof(GrandJobStats)) return_code = -3;
+    close(fd[1]);
+    fflush(stdout);
+    exit(return_code<0?-return_code:0);
+  }
+  close(fd[1]);
+  dj->pipe = fd[0];
+  dj->state = JOB_RUNNING;
+  return(1);
+}
+
+/**
+ * \brief Collect the finished workers and their statistics
+ * \return number of workers still running
+ */
+int grand_daemon_reap()
+{
+  DaemonJob *dj;
+  int status,running = 0;
+
+  for(int i=0;i<n_jobs;i++){
+    dj = &jobs[i];
+    if(dj->state != JOB_RUNNING) continue;
+    if(wait4(dj->pid,&status,WNOHANG,&dj->usage) != dj->pid){
+      running++;
+      continue;
+    }
+    if(read(dj->pipe,&dj->stats,sizeof(GrandJobStats)) != sizeof(GrandJobStats))
+      memset((void *)&dj->stats,0,sizeof(GrandJobStats));
+    close(dj->pipe);
+    dj->pipe = -1;
+    if(WIFEXITED(status)) dj->exit_code = WEXITSTATUS(status);
+    else dj->exit_code = 128+WTERMSIG(status);
+    dj->state = dj->exit_code == 0?JOB_DONE:JOB_FAILED;
+    printf("job %d %s: run %d file %d, %ld events %ld periodic %d skipped, %d shards, %llu bytes, %.3f s wall %.3f s cpu %ld kB\n",
+           dj->id,job_state_name[dj->state],dj->job.runnr,dj->job.fileseq,dj->stats.n_events,dj->stats.n_periodic,
+           dj->stats.n_skipped,dj->stats.n_shards,dj->stats.bytes,dj->stats.seconds,
+           dj->usage.ru_utime.tv_sec+dj->usage.ru_stime.tv_sec+1e-6*(dj->usage.ru_utime.tv_usec+dj->usage.ru_stime.tv_usec),
+           dj->usage.ru_maxrss);
+    fflush(stdout);
+  }
+  return(running);
+}
+
+/**
+ * \brief Is another job of the same file sequence running: it writes the same output file
+ */
+int grand_daemon_busy(DaemonJob *dj)
+{
+  for(int i=0;i<n_jobs;i++){
+    if(jobs[i].state == JOB_RUNNING && jobs[i].job.runnr == dj->job.runnr && jobs[i].job.fileseq == dj->job.fileseq)
+      return(1);
+  }
+  return(0);
+}
+
+/**
+ * \brief Find the waiting file sequence, or add it
+ * \return the file sequence, NULL if there is no memory
+ */
+DaemonPending *grand_daemon_pending(int runnr,int fileseq)
+{
+  DaemonPending *grow;
+  int n;
+
+  for(int i=0;i<n_pending;i++)
+    if(pending[i].runnr == runnr && pending[i].fileseq == fileseq) return(&pending[i]);
+  if(n_pending == n_pending_alloc){
+    n = n_pending_alloc == 0?16:2*n_pending_alloc;
+    if((grow = realloc(pending,n*sizeof(DaemonPending))) == NULL) return(NULL);
+    pending = grow;
+    n_pending_alloc = n;
+  }
+  memset((void *)&pending[n_pending],0,sizeof(DaemonPending));
+  pending[n_pending].runnr = runnr;
+  pending[n_pending].fileseq = fileseq;
+  return(&pending[n_pending++]);
+}
+
+/**
+ * \brief Record the closed AD and TD files of the watched directories
+ * @param[in] watch: the inotify descriptor
+ * @param[in] wd_td: the watch of the TD directory, -1 if there is none
+ */
+void grand_daemon_watch(int watch,int wd_td)
+{
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  struct inotify_event *ev;
+  DaemonPending *dp;
+  ssize_t len;
+  int runnr,fileseq;
+
+  while((len = read(watch,buf,sizeof(buf)))>0){
+    for(char *p=buf;p<buf+len;p+=sizeof(struct inotify_event)+ev->len){
+      ev = (struct inotify_event *)p;
+      if(ev->len == 0) continue;
+      if(ev->wd == wd_td){
+        if(sscanf(ev->name,"td%6d.f%4d",&runnr,&fileseq) == 2 && (dp = grand_daemon_pending(runnr,fileseq)) != NULL)
+          dp->td_closed = 1;
+      }
+      else if(sscanf(ev->name,"ad%6d.f%4d",&runnr,&fileseq) == 2 && (dp = grand_daemon_pending(runnr,fileseq)) != NULL)
+        dp->ad_closed = time(NULL);
+    }
+  }
+}
+
+/**
+ * \brief Queue the waiting file sequences of which the AD file and, if present, the TD file are closed
+ * @param[in] datadir: the watched data directory
+ */
+void grand_daemon_ready(char *datadir)
+{
+  char tdname[VIEW_NAME_LENGTH+40];
+  time_t now = time(NULL);
+  DaemonPending *dp;
+  int j = 0;
+
+  for(int i=0;i<n_pending;i++){
+    dp = &pending[i];
+    snprintf(tdname,sizeof(tdname),"%s/TD/td%06d.f%04d",datadir,dp->runnr,dp->fileseq);
+    if(dp->ad_closed>0 && (dp->td_closed || access(tdname,F_OK) != 0 || now-dp->ad_closed>=DAEMON_TD_WAIT)){
+      if(!dp->td_closed && access(tdname,F_OK) == 0)
+        printf("run %d file %d: the TD file is not closed after %d s, converting anyway\n",
+               dp->runnr,dp->fileseq,DAEMON_TD_WAIT);
+      if(grand_daemon_queue(datadir,dp->runnr,dp->fileseq)>=0) continue;
+    }
+    if(j != i) pending[j] = pending[i];
+    j++;
+  }
+  n_pending = j;
+}
+
+/**
+ * \brief Execute a command of a socket client
+ * \return 1: all ok
+ * \return 0: the daemon has to stop
+ */
+int grand_daemon_command(int fd,char *line)
+{
+  char reply[DAEMON_LINE+200],basedir[DAEMON_LINE];
+  int runnr,fileseq,id;
+  DaemonJob *dj;
+
+  if(sscanf(line,"convert %1023s %d %d",basedir,&runnr,&fileseq) == 3){
+    if((id = grand_daemon_queue(basedir,runnr,fileseq))<0) sprintf(reply,"error no memory\n");
+    else sprintf(reply,"queued %d\n",id);
+  }
+  else if(strcmp(line,"status") == 0){
+    for(int i=0;i<n_jobs;i++){
+      dj = &jobs[i];
+      snprintf(reply,sizeof(reply),"job %d run %d file %d %s events %ld periodic %ld skipped %d shards %d bytes %llu"
+               " wall %.3f cpu %.3f maxrss %ld exit %d\n",dj->id,dj->job.runnr,dj->job.fileseq,
+               job_state_name[dj->state],dj->stats.n_events,dj->stats.n_periodic,dj->stats.n_skipped,dj->stats.n_shards,
+               dj->stats.bytes,
+               dj->stats.seconds,dj->usage.ru_utime.tv_sec+dj->usage.ru_stime.tv_sec
+               +1e-6*(dj->usage.ru_utime.tv_usec+dj->usage.ru_stime.tv_usec),dj->usage.ru_maxrss,dj->exit_code);
+      if(write(fd,reply,strlen(reply))<0) return(1);
+    }
+    sprintf(reply,"end\n");
+  }
+  else if(strcmp(line,"quit") == 0){
+    sprintf(reply,"bye\n");
+    stop = 1;
+  }
+  else sprintf(reply,"error unknown command\n");
+  if(write(fd,reply,strlen(reply))<0) return(1);
+  return(!stop);
+}
+
+/**
+ * \brief Read the commands of a socket client
+ * \return 1: the client stays connected
+ * \return 0: the client is gone
+ */
+int grand_daemon_client(DaemonClient *c)
+{
+  char *eol;
+  ssize_t len;
+
+  len = read(c->fd,&c->line[c->used],DAEMON_LINE-1-c->used);
+  if(len<=0) return(0);
+  c->used += len;
+  c->line[c->used] = 0;
+  while((eol = strchr(c->line,'\n')) != NULL){
+    *eol = 0;
+    if(eol>c->line && eol[-1] == '\r') eol[-1] = 0;
+    grand_daemon_command(c->fd,c->line);
+    c->used -= eol+1-c->line;
+    memmove(c->line,eol+1,c->used+1);
+  }
+  //a line that does not fit is dropped
+  if(c->used == DAEMON_LINE-1) c->used = 0;
+  return(1);
+}
+
+int main(int argc, char **argv) {
+  char *fieldname = "field_run22.txt";
+  char *datadir = NULL;
+  char *socketname = NULL;
+  char lockname[VIEW_NAME_LENGTH+30];
+  char watchdir[VIEW_NAME_LENGTH+10];
+  int wd_td = -1;
+  int n_workers = 2;
+  long memory_mb = 0;
+  int opt,running,bin_seconds;
+  int spectra = GRAND_SPECTRUM_NONE,nfft = 0;
+  int watch = -1,listener = -1;
+  struct sockaddr_un addr;
+  DaemonClient client[DAEMON_MAX_CLIENTS];
+  struct pollfd pfd[DAEMON_MAX_CLIENTS+2];
+  int ipoll[DAEMON_MAX_CLIENTS+2];
+  int npoll,fd;
+
+  memset((void *)&job_template,0,sizeof(GrandJob));
+  while((opt = getopt(argc,argv,"f:w:S:j:m:d:c:Vp:z:s:g:F:n:aPr:i:")) != -1){
+    switch(opt){
+    case 'f':
+      fieldname = optarg;
+      break;
+    case 'w':
+      datadir = optarg;
+      break;
+    case 'S':
+      socketname = optarg;
+      break;
+    case 'j':
+      n_workers = atoi(optarg);
+      break;
+    case 'm':
+      memory_mb = atol(optarg);
+      break;
+    case 'd':
+      outdir = optarg;
+      break;
+    case 'c':
+      job_template.catalogname = optarg;
+      break;
+    case 'V':
+      run_view = 1;
+      break;
+    case 'p':
+      if(grand_HDF5set_profile(grand_HDF5profile_id(optarg))<0){
+        printf("Unknown HDF5 profile %s\n",optarg);
+        return(-1);
+      }
+      break;
+    case 'z':
+      if(grand_HDF5set_trace_filter(grand_HDF5trace_filter_id(optarg))<0){
+        printf("Unknown or unavailable trace storage %s\n",optarg);
+        return(-1);
+      }
+      break;
+    case 's':
+      if(sscanf(optarg,"%d",&job_template.swmr_cadence) != 1 || job_template.swmr_cadence<1){
+        printf(USAGE);
+        return(-1);
+      }
+      break;
+    case 'g':
+      if(sscanf(optarg,"%d",&bin_seconds) != 1 || grand_HDF5set_rate_bin(bin_seconds)<0){
+        printf(USAGE);
+        return(-1);
+      }
+      break;
+    case 'F':
+      if((spectra = grand_HDF5spectrum_id(optarg))<0){
+        printf("Unknown spectrum mode %s\n",optarg);
+        return(-1);
+      }
+      break;
+    case 'n':
+      if(sscanf(optarg,"%d",&nfft) != 1){
+        printf(USAGE);
+        return(-1);
+      }
+      break;
+    case 'a':
+      grand_HDF5set_station_layout(1);
+      break;
+    case 'P':
+      grand_HDF5set_preview(1);
+      break;
+    case 'r':
+      if(job_template.nlimit<GRAND_MAX_LIMITS) job_template.limit[job_template.nlimit++] = optarg;
+      break;
+    case 'i':
+      if(grand_reader_set_engine(grand_reader_engine_id(optarg),0,0)<0){
+        printf("Unknown reader engine %s\n",optarg);
+        return(-1);
+      }
+      break;
+    default:
+      printf(USAGE);
+      return(-1);
+    }
+  }
+  if(optind != argc || n_workers<1 || (datadir == NULL && socketname == NULL)){
+    printf(USAGE);
+    return(-1);
+  }
+  if(job_template.swmr_cadence>0) grand_HDF5swmr_profile();
+  //every worker computes the spectra of its job in one thread, the workers already run in parallel
+  if(grand_HDF5set_spectrum(spectra,nfft,1)<0){
+    printf("The FFT length must be a power of 2 from %d to %d\n",SPECTRUM_MIN_NFFT,SPECTRUM_MAX_NFFT);
+    return(-1);
+  }
+  //catalog, view and shard index updates of concurrent workers are serialized
+  snprintf(lockname,sizeof(lockname),"%s/grand_daemon.lock",outdir);
+  job_template.lockname = lockname;
+  if(grand_HDF5initiate_field(fieldname)<0){
+    printf("Cannot load the field configuration %s\n",fieldname);
+    return(-1);
+  }
+  grand_HDF5create_compounds();
+
+  if(datadir != NULL){
+    snprintf(watchdir,sizeof(watchdir),"%s/AD",datadir);
+    if((watch = inotify_init1(IN_NONBLOCK)) < 0 || inotify_add_watch(watch,watchdir,IN_CLOSE_WRITE|IN_MOVED_TO)<0){
+      printf("Cannot watch %s\n",watchdir);
+      return(-1);
+    }
+    //without a TD directory the sequences are converted when their AD file is closed
+    snprintf(watchdir,sizeof(watchdir),"%s/TD",datadir);
+    if(access(watchdir,F_OK) == 0) wd_td = inotify_add_watch(watch,watchdir,IN_CLOSE_WRITE|IN_MOVED_TO);
+  }
+  if(socketname != NULL){
+    memset((void *)&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(socketname) >= sizeof(addr.sun_path)){
+      printf("Socket name %s too long\n",socketname);
+      return(-1);
+    }
+    strcpy(addr.sun_path,socketname);
+    unlink(socketname);
+    if((listener = socket(AF_UNIX,SOCK_STREAM,0))<0 || bind(listener,(struct sockaddr *)&addr,sizeof(addr))<0
+       || listen(listener,DAEMON_MAX_CLIENTS)<0){
+      printf("Cannot listen on %s\n",socketname);
+      return(-1);
+    }
+  }
+  for(int i=0;i<DAEMON_MAX_CLIENTS;i++) client[i].fd = -1;
+  signal(SIGINT,grand_daemon_signal);
+  signal(SIGTERM,grand_daemon_signal);
+  signal(SIGPIPE,SIG_IGN);
+  printf("grand_daemon: %d workers, field %s with %d antennas\n",n_workers,fieldname,field_size);
+  fflush(stdout);
+
+  running = 0;
+  while(!stop || running>0){
+    npoll = 0;
+    if(!stop){
+      if(watch>=0){
+        pfd[npoll].fd = watch;
+        pfd[npoll].events = POLLIN;
+        ipoll[npoll++] = -1;
+      }
+      if(listener>=0){
+        pfd[npoll].fd = listener;
+        pfd[npoll].events = POLLIN;
+        ipoll[npoll++] = -2;
+      }
+      for(int i=0;i<DAEMON_MAX_CLIENTS;i++){
+        if(client[i].fd<0) continue;
+        pfd[npoll].fd = client[i].fd;
+        pfd[npoll].events = POLLIN;
+        ipoll[npoll++] = i;
+      }
+    }
+    //the workers are reaped at least every 100 ms
+    if(poll(pfd,npoll,100)>0){
+      for(int ip=0;ip<npoll;ip++){
+        if(pfd[ip].revents == 0) continue;
+        if(ipoll[ip] == -1) grand_daemon_watch(watch,wd_td);
+        else if(ipoll[ip] == -2){
+          if((fd = accept(listener,NULL,NULL))<0) continue;
+          for(int i=0;i<DAEMON_MAX_CLIENTS && fd>=0;i++){
+            if(client[i].fd>=0) continue;
+            client[i].fd = fd;
+            client[i].used = 0;
+            fd = -1;
+          }
+          if(fd>=0) close(fd);
+        }
+        else if(grand_daemon_client(&client[ipoll[ip]]) == 0){
+          close(client[ipoll[ip]].fd);
+          client[ipoll[ip]].fd = -1;
+        }
+      }
+    }
+    if(datadir != NULL && !stop) grand_daemon_ready(datadir);
+    running = grand_daemon_reap();
+    for(int i=0;i<n_jobs && running<n_workers && !stop;i++){
+      if(jobs[i].state != JOB_QUEUED || grand_daemon_busy(&jobs[i])) continue;
+      if(grand_daemon_start(&jobs[i],memory_mb)<0){
+        printf("Cannot start a worker for job %d\n",jobs[i].id);
+        break;
+      }
+      running++;
+    }
+  }
+  for(int i=0;i<DAEMON_MAX_CLIENTS;i++) if(client[i].fd>=0) close(client[i].fd);
+  if(listener>=0){
+    close(listener);
+    unlink(socketname);
+  }
+  if(watch>=0) close(watch);
+  if(stop>1) printf("grand_daemon: stopped by signal %d\n",(int)stop);
+  printf("grand_daemon: %d jobs\n",next_job_id-1);
+  return(0);
+}
@@ -0,0 +1,357 @@
+/** \file grand_field.c
+ *  \brief loading of the antenna field configuration, with a binary cache
+ *
+ *  The text file is read in one pass with a tokenizer; antenna ids and
+ *  electronics ids must be unique. The parsed field, with the positions in
+ *  the frame of the field, the center and the electronics id lookup table, is
+ *  written next to the text file as <fieldname>.cache, keyed by the FNV-1a
+ *  hash of the text. Later processes map the cache instead of parsing: the
+ *  mapping is private, so the electronics settings that are filled in while
+ *  converting stay local to the process.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "grand_misc.h"
+#include "grand_hdf5.h"
+
+extern AntInfo *field;
+extern int field_size;
+extern Center center;
+extern GeoOrigin field_origin;
+
+/*! index in the field of every electronics id, as unsigned short, -1 if not in the field */
+int *field_lookup = NULL;
+
+/*! the mapped cache holding field and field_lookup, NULL if they are allocated */
+static void *field_map = NULL;
+static size_t field_map_size = 0;
+
+typedef struct{
+  char magic[8];
+  unsigned int version;
+  unsigned int antinfo_size;
+  unsigned long long hash;
+  int field_size;
+  int n_elec_id;
+  Center center;
+  GeoOrigin origin;
+}FieldCache;
+
+#define FIELD_CACHE_MAGIC "GRANDFLD"
+#define FIELD_CACHE_DATA ((sizeof(FieldCache)+63)&~(size_t)63) /**< offset of the antennas in the cache */
+
+/**
+ * \brief 64-bit FNV-1a hash
+ * @param[in] buf: the data
+ * @param[in] len: its length in bytes
+ */
+unsigned long long grand_fnv1a(const void *buf,size_t len)
+{
+  const unsigned char *p = buf;
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+
+  for(size_t i=0;i<len;i++){
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return(hash);
+}
+
+/**
+ * \brief Next token of a line
+ * @param[in,out] p: position in the line, moved behind the token
+ * @param[in] end: end of the line
+ * @param[out] tok: the token, truncated to size-1 characters
+ * @param[in] size: size of tok
+ * \return length of the token, 0 at the end of the line
+ */
+static size_t grand_field_token(const char **p,const char *end,char *tok,size_t size)
+{
+  const char *start;
+  size_t len;
+
+  while(*p<end && (**p == ' ' || **p == '\t' || **p == '\r')) (*p)++;
+  start = *p;
+  while(*p<end && **p != ' ' && **p != '\t' && **p != '\r') (*p)++;
+  len = *p-start;
+  if(size>0){
+    memcpy(tok,start,len<size-1?len:size-1);
+    tok[len<size-1?len:size-1] = 0;
+  }
+  return(len);
+}
+
+/**
+ * \brief Numeric token of a line
+ * \return 1: all ok
+ * \return 0: missing or not a number
+ */
+static int grand_field_number(const char **p,const char *end,double *value)
+{
+  char tok[64],*stop;
+
+  if(grand_field_token(p,end,tok,sizeof(tok)) == 0) return(0);
+  *value = strtod(tok,&stop);
+  return(*stop == 0);
+}
+
+/**
+ * \brief Parse the text of a field configuration
+ *
+ * Every line that is not empty or a comment (#) holds: antenna id, electronics id,
+ * longitude, latitude, altitude, antenna model, electronics model and the four
+ * channel connections (X, Y, Z or 0).
+ * @param[in] text: the text, not necessarily terminated
+ * @param[in] len: length of the text
+ * @param[out] ant: the antennas, allocated
+ * @param[out] n: the number of antennas
+ * \return 1: all ok
+ * \return -2: cannot allocate the memory
+ * \return -3: syntax error or an electronics id out of range
+ * \return -4: duplicate antenna or electronics id
+ */
+int grand_HDF5parse_field(const char *text,size_t len,AntInfo **ant,int *n)
+{
+  const char *p = text,*end = text+len,*eol;
+  AntInfo *a = NULL,*grow;
+  int n_alloc = 0,i_field = 0,line = 0;
+  int return_code = 1;
+  double v[5];
+  char tok[4];
+  unsigned char *id_used;
+  int *elec_used;
+
+  id_used = calloc(GRAND_N_ELEC_ID,1);
+  elec_used = malloc(GRAND_N_ELEC_ID*sizeof(int));
+  if(id_used == NULL || elec_used == NULL) return_code = -2;
+  else memset(elec_used,0xff,GRAND_N_ELEC_ID*sizeof(int));
+  for(;return_code == 1 && p<end;p = eol+1){
+    line++;
+    if((eol = memchr(p,'\n',end-p)) == NULL) eol = end;
+    while(p<eol && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    if(p == eol || *p == '#') continue;
+    if(i_field == n_alloc){
+      n_alloc = n_alloc == 0?256:2*n_alloc;
+      if((grow = realloc(a,n_alloc*sizeof(AntInfo))) == NULL){
+        return_code = -2;
+        break;
+      }
+      a = grow;
+    }
+    memset((void *)&a[i_field],0,sizeof(AntInfo));
+    for(int i=0;i<5 && return_code == 1;i++)
+      if(grand_field_number(&p,eol,&v[i]) == 0) return_code = -3;
+    if(return_code == 1 && (v[0] != (short)v[0] || v[1] != (short)v[1] || fabs(v[3])>90)) return_code = -3;
+    if(return_code == 1 && (grand_field_token(&p,eol,a[i_field].ant_model,sizeof(a[i_field].ant_model)) == 0
+                            || grand_field_token(&p,eol,a[i_field].elec_model,sizeof(a[i_field].elec_model)) == 0))
+      return_code = -3;
+    for(int i=0;i<4 && return_code == 1;i++){
+      if(grand_field_token(&p,eol,tok,sizeof(tok)) != 1 || strchr("XYZxyz0",tok[0]) == NULL) return_code = -3;
+      a[i_field].channel[i] = tok[0];
+    }
+    if(return_code<0){
+      printf("Field configuration line %d: expected id elec_id longitude latitude altitude"
+             " antenna_model electronics_model and 4 channels X, Y, Z or 0\n",line);
+      break;
+    }
+    a[i_field].id = v[0];
+    a[i_field].elec_id = v[1];
+    a[i_field].longitude = v[2];
+    a[i_field].latitude = v[3];
+    a[i_field].altitude = v[4];
+    if(a[i_field].elec_id<0 || a[i_field].elec_id>GRAND_LS_ID_MASK){
+      printf("Field configuration line %d: electronics id %d is not in 0-%d\n",line,a[i_field].elec_id,GRAND_LS_ID_MASK);
+      return_code = -3;
+    }
+    else if(id_used[(unsigned short)a[i_field].id]){
+      printf("Field configuration line %d: duplicate antenna id %d\n",line,a[i_field].id);
+      return_code = -4;
+    }
+    else if(elec_used[(unsigned short)a[i_field].elec_id] >= 0){
+      printf("Field configuration line %d: electronics id %d already used by antenna %d\n",line,
+             a[i_field].elec_id,a[elec_used[(unsigned short)a[i_field].elec_id]].id);
+      return_code = -4;
+    }
+    else{
+      id_used[(unsigned short)a[i_field].id] = 1;
+      elec_used[(unsigned short)a[i_field].elec_id] = i_field;
+    }
+    i_field++;
+  }
+  free(id_used);
+  free(elec_used);
+  if(return_code<0){
+    free(a);
+    return(return_code);
+  }
+  *ant = a;
+  *n = i_field;
+  return(1);
+}
+
+/**
+ * \brief Map the binary cache of a field configuration
+ * @param[in] cachename: the cache file
+ * @param[in] hash: hash of the text of the configuration
+ * \return 1: field, field_size, field_lookup, center and field_origin are set
+ * \return 0: no valid cache
+ */
+static int grand_field_map_cache(char *cachename,unsigned long long hash)
+{
+  FieldCache *fc;
+  struct stat st;
+  void *map;
+  int fd;
+
+  if((fd = open(cachename,O_RDONLY)) < 0) return(0);
+  if(fstat(fd,&st)<0 || st.st_size<FIELD_CACHE_DATA){
+    close(fd);
+    return(0);
+  }
+  map = mmap(NULL,st.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(map == MAP_FAILED) return(0);
+  fc = map;
+  if(memcmp(fc->magic,FIELD_CACHE_MAGIC,8) != 0 || fc->version != GRAND_FIELD_VERSION
+     || fc->antinfo_size != sizeof(AntInfo) || fc->hash != hash || fc->n_elec_id != GRAND_N_ELEC_ID
+     || st.st_size != FIELD_CACHE_DATA+fc->field_size*sizeof(AntInfo)+GRAND_N_ELEC_ID*sizeof(int)){
+    munmap(map,st.st_size);
+    return(0);
+  }
+  field_map = map;
+  field_map_size = st.st_size;
+  field_size = fc->field_size;
+  field = (AntInfo *)((char *)map+FIELD_CACHE_DATA);
+  field_lookup = (int *)&field[field_size];
+  center = fc->center;
+  field_origin = fc->origin;
+  return(1);
+}
+
+/**
+ * \brief Write the binary cache of the field configuration
+ *
+ * The cache is written to a temporary file that is renamed, so concurrent
+ * processes see either no cache or a complete one.
+ * @param[in] cachename: the cache file
+ * @param[in] hash: hash of the text of the configuration
+ * \return 1: all ok
+ * \return -1: the cache cannot be written
+ */
+static int grand_field_write_cache(char *cachename,unsigned long long hash)
+{
+  char tmpname[strlen(cachename)+20];
+  char pad[64];
+  FieldCache fc;
+  FILE *fp;
+  int ok;
+
+  memset((void *)&fc,0,sizeof(FieldCache));
+  memcpy(fc.magic,FIELD_CACHE_MAGIC,8);
+  fc.version = GRAND_FIELD_VERSION;
+  fc.antinfo_size = sizeof(AntInfo);
+  fc.hash = hash;
+  fc.field_size = field_size;
+  fc.n_elec_id = GRAND_N_ELEC_ID;
+  fc.center = center;
+  fc.origin = field_origin;
+  memset(pad,0,sizeof(pad));
+  sprintf(tmpname,"%s.%d",cachename,(int)getpid());
+  if((fp = fopen(tmpname,"w")) == NULL) return(-1);
+  ok = fwrite(&fc,sizeof(FieldCache),1,fp) == 1
+    && fwrite(pad,FIELD_CACHE_DATA-sizeof(FieldCache),1,fp) == 1
+    && fwrite(field,sizeof(AntInfo),field_size,fp) == field_size
+    && fwrite(field_lookup,sizeof(int),GRAND_N_ELEC_ID,fp) == GRAND_N_ELEC_ID;
+  if(fclose(fp) != 0) ok = 0;
+  if(!ok || rename(tmpname,cachename)<0){
+    unlink(tmpname);
+    return(-1);
+  }
+  return(1);
+}
+
+/**
+ * \brief Release the field configuration
+ */
+void grand_HDF5release_field()
+{
+  if(field_map != NULL) munmap(field_map,field_map_size);
+  else{
+    free(field);
+    free(field_lookup);
+  }
+  field_map = NULL;
+  field_map_size = 0;
+  field = NULL;
+  field_lookup = NULL;
+  field_size = 0;
+}
+
+/**
+ * \brief Create the field configuration
+ * @param[in] fieldname: name of the file containing the field configuration
+ *  \return 1: all ok
+ *  \return -1: cannot open the file "fieldname"
+ *  \return -2: cannot create the memory to hold the field configuration
+ *  \return -3: syntax error or an electronics id out of range in the file
+ *  \return -4: duplicate antenna or electronics id
+ */
+int grand_HDF5initiate_field(char *fieldname)
+{
+  char cachename[strlen(fieldname)+10];
+  struct stat st;
+  char *text = NULL;
+  unsigned long long hash;
+  AntInfo *ant;
+  int n,fd,return_code;
+
+  grand_HDF5release_field();
+  if((fd = open(fieldname,O_RDONLY))<0) return(-1);
+  if(fstat(fd,&st)<0){
+    close(fd);
+    return(-1);
+  }
+  if(st.st_size>0 && (text = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0)) == MAP_FAILED){
+    close(fd);
+    return(-1);
+  }
+  close(fd);
+  hash = grand_fnv1a(text,st.st_size);
+  sprintf(cachename,"%s.cache",fieldname);
+  if(grand_field_map_cache(cachename,hash) == 1){
+    if(text != NULL) munmap(text,st.st_size);
+    return(1);
+  }
+  return_code = grand_HDF5parse_field(text,st.st_size,&ant,&n);
+  if(text != NULL) munmap(text,st.st_size);
+  if(return_code<0) return(return_code);
+  if((field_lookup = malloc(GRAND_N_ELEC_ID*sizeof(int))) == NULL){
+    free(ant);
+    return(-2);
+  }
+  field = ant;
+  field_size = n;
+  for(int i=0;i<GRAND_N_ELEC_ID;i++) field_lookup[i] = -1;
+  for(int i=0;i<field_size;i++) field_lookup[(unsigned short)field[i].elec_id] = i;
+
+  memset((void *)&center,0,sizeof(Center));
+  for(int i=0;i<field_size;i++){
+    center.latitude +=field[i].latitude/field_size;
+    center.longitude +=field[i].longitude/field_size;
+    center.altitude +=field[i].altitude/field_size;
+  }
+  center.x = 0;
+  center.y = 0;
+  center.z = 0;
+  grand_geo_origin(&field_origin,center.longitude,center.latitude,center.altitude);
+  grand_HDF5field_positions(field_size,field);
+  //the cache is an optimisation: a read-only directory is not an error
+  grand_field_write_cache(cachename,hash);
+  return(1);
+}
@@ -0,0 +1,21 @@
+/** \file grand_field.h
+ *  \brief loading of the antenna field configuration, with a binary cache
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_FIELD_H
+#define GRAND_FIELD_H
+
+#define GRAND_FIELD_VERSION 1 /**< version of the binary field cache */
+#define GRAND_LS_ID_MASK 0xff /**< bits of the local station id that identify the electronics */
+#define GRAND_N_ELEC_ID 65536 /**< size of the electronics id lookup table */
+
+unsigned long long grand_fnv1a(const void *buf,size_t len);
+int grand_HDF5parse_field(const char *text,size_t len,AntInfo **ant,int *n);
+int grand_HDF5initiate_field(char *fieldname);
+void grand_HDF5release_field();
+
+#endif
@@ -0,0 +1,287 @@
+/** \file grand_filter.c
+ *  \brief lossless compression filter for ADC traces
+ *
+ *  The samples are coded in blocks of GRAND_ADC_BLOCK samples, each packed
+ *  with the bit width of its largest value. A block stores either the
+ *  differences with the previous sample, zigzag mapped to unsigned values,
+ *  which suits pulses and slow baselines, or the offsets from the minimum of
+ *  the block, which suits white noise; the encoder picks the smaller. A
+ *  14-bit ADC with a noise of a few counts needs 5 to 7 bits per sample.
+ *  Wrap-around arithmetic keeps the coding lossless for any 16-bit data.
+ *
+ *  Encoded buffer: number of samples (4 bytes, little endian), followed by
+ *  the blocks: one byte with the bit width, or'ed with GRAND_ADC_OFFSET for
+ *  an offset block followed by its minimum (2 bytes), then the packed values
+ *  LSB first.
+ *
+ *  The filter is registered in the library with grand_HDF5register_adc_filter;
+ *  other HDF5 programs load it from libgrand_adc.so through HDF5_PLUGIN_PATH.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * \brief bits needed for a value
+ */
+static int grand_adc_width(unsigned int v)
+{
+  int w;
+
+  for(w=0;w<16 && (v>>w) != 0;w++);
+  return(w);
+}
+
+/**
+ * \brief Encode ADC samples
+ * @param[in] in: the samples
+ * @param[in] n: the number of samples
+ * @param[out] out: the encoded buffer, at least GRAND_ADC_MAX_ENCODED(n) bytes
+ * \return the size of the encoded buffer
+ */
+size_t grand_adc_encode(const short *in,size_t n,unsigned char *out)
+{
+  unsigned short z[GRAND_ADC_BLOCK],zor;
+  unsigned long long acc;
+  short prev = 0,d,vmin,vmax;
+  size_t p = 4,ib,cnt,i;
+  int w,wr,bits;
+
+  out[0] = n&0xff;
+  out[1] = (n>>8)&0xff;
+  out[2] = (n>>16)&0xff;
+  out[3] = (n>>24)&0xff;
+  for(ib=0;ib<n;ib+=GRAND_ADC_BLOCK){
+    cnt = n-ib<GRAND_ADC_BLOCK?n-ib:GRAND_ADC_BLOCK;
+    zor = 0;
+    vmin = vmax = in[ib];
+    for(i=0;i<cnt;i++){
+      d = (short)(unsigned short)(in[ib+i]-prev);
+      prev = in[ib+i];
+      z[i] = (unsigned short)(((unsigned short)d<<1)^(d>>15));
+      zor |= z[i];
+      if(in[ib+i]<vmin) vmin = in[ib+i];
+      if(in[ib+i]>vmax) vmax = in[ib+i];
+    }
+    w = grand_adc_width(zor);
+    wr = grand_adc_width(vmax-vmin);
+    if(cnt*wr+16 < cnt*w){
+      //white noise: offsets from the minimum of the block need fewer bits than the differences
+      w = wr;
+      out[p++] = GRAND_ADC_OFFSET|w;
+      out[p++] = (unsigned short)vmin&0xff;
+      out[p++] = (unsigned short)vmin>>8;
+      for(i=0;i<cnt;i++) z[i] = (unsigned short)(in[ib+i]-vmin);
+    }
+    else out[p++] = w;
+    if(w == 0) continue;
+    acc = 0;
+    bits = 0;
+    for(i=0;i<cnt;i++){
+      acc |= (unsigned long long)z[i]<<bits;
+      bits += w;
+      if(bits >= 32){
+        out[p++] = acc&0xff;
+        out[p++] = (acc>>8)&0xff;
+        out[p++] = (acc>>16)&0xff;
+        out[p++] = (acc>>24)&0xff;
+        acc >>= 32;
+        bits -= 32;
+      }
+    }
+    for(;bits>0;bits-=8){
+      out[p++] = acc&0xff;
+      acc >>= 8;
+    }
+  }
+  return(p);
+}
+
+/**
+ * \brief Undo the zigzag mapping and the prediction of one block
+ * @param[in] z: the zigzag mapped differences, GRAND_ADC_BLOCK values
+ * @param[in] cnt: the number of samples in the block
+ * @param[in] prev: the last sample of the previous block
+ * @param[out] out: the samples
+ */
+static void grand_adc_delta_block(const unsigned short *z,size_t cnt,short prev,short *out)
+{
+#ifdef __SSE2__
+  short tmp[GRAND_ADC_BLOCK];
+  __m128i one = _mm_set1_epi16(1);
+  __m128i zero = _mm_setzero_si128();
+  __m128i carry = _mm_set1_epi16(prev);
+  __m128i v;
+  size_t i;
+
+  for(i=0;i<cnt;i+=8){
+    v = _mm_loadu_si128((const __m128i *)&z[i]);
+    v = _mm_xor_si128(_mm_srli_epi16(v,1),_mm_sub_epi16(zero,_mm_and_si128(v,one)));
+    //prefix sum of the 8 differences
+    v = _mm_add_epi16(v,_mm_slli_si128(v,2));
+    v = _mm_add_epi16(v,_mm_slli_si128(v,4));
+    v = _mm_add_epi16(v,_mm_slli_si128(v,8));
+    v = _mm_add_epi16(v,carry);
+    _mm_storeu_si128((__m128i *)&tmp[i],v);
+    carry = _mm_shufflehi_epi16(v,0xff);
+    carry = _mm_unpackhi_epi64(carry,carry);
+  }
+  memcpy(out,tmp,cnt*sizeof(short));
+#else
+  size_t i;
+
+  for(i=0;i<cnt;i++){
+    prev = (short)(unsigned short)(prev+(short)((z[i]>>1)^-(z[i]&1)));
+    out[i] = prev;
+  }
+#endif
+}
+
+/**
+ * \brief Add the minimum of a block to its offsets
+ */
+static void grand_adc_offset_block(const unsigned short *z,size_t cnt,short vmin,short *out)
+{
+#ifdef __SSE2__
+  short tmp[GRAND_ADC_BLOCK];
+  __m128i base = _mm_set1_epi16(vmin);
+  size_t i;
+
+  for(i=0;i<cnt;i+=8)
+    _mm_storeu_si128((__m128i *)&tmp[i],_mm_add_epi16(_mm_loadu_si128((const __m128i *)&z[i]),base));
+  memcpy(out,tmp,cnt*sizeof(short));
+#else
+  size_t i;
+
+  for(i=0;i<cnt;i++) out[i] = (short)(unsigned short)(vmin+z[i]);
+#endif
+}
+
+/**
+ * \brief Decode ADC samples
+ * @param[in] in: the encoded buffer
+ * @param[in] nbytes: the size of the encoded buffer
+ * @param[out] out: the samples
+ * @param[in] max: the capacity of out
+ * \return >=0: the number of samples
+ * \return -1: the buffer is corrupt or out is too small
+ */
+long grand_adc_decode(const unsigned char *in,size_t nbytes,short *out,size_t max)
+{
+  unsigned short z[GRAND_ADC_BLOCK];
+  unsigned long long acc;
+  unsigned short mask;
+  size_t n,p = 4,ib,cnt,i,end;
+  short prev = 0,vmin = 0;
+  int w,mode,bits;
+
+  if(nbytes<4) return(-1);
+  n = in[0]|(in[1]<<8)|(in[2]<<16)|((size_t)in[3]<<24);
+  if(n>max) return(-1);
+  for(ib=0;ib<n;ib+=GRAND_ADC_BLOCK){
+    cnt = n-ib<GRAND_ADC_BLOCK?n-ib:GRAND_ADC_BLOCK;
+    if(p >= nbytes) return(-1);
+    mode = in[p]&GRAND_ADC_OFFSET;
+    w = in[p++]&~GRAND_ADC_OFFSET;
+    if(mode){
+      if(p+2>nbytes) return(-1);
+      vmin = (short)(in[p]|(in[p+1]<<8));
+      p += 2;
+    }
+    end = p+(cnt*w+7)/8;
+    if(w>16 || end>nbytes) return(-1);
+    memset(z,0,sizeof(z));
+    if(w>0){
+      mask = (unsigned short)((1u<<w)-1);
+      acc = 0;
+      bits = 0;
+      for(i=0;i<cnt;i++){
+        if(bits<w){
+          if(p+4 <= end){
+            acc |= (unsigned long long)(in[p]|(in[p+1]<<8)|(in[p+2]<<16)|((unsigned int)in[p+3]<<24))<<bits;
+            p += 4;
+            bits += 32;
+          }
+          else{
+            for(;bits<w;bits+=8) acc |= (unsigned long long)in[p++]<<bits;
+          }
+        }
+        z[i] = acc&mask;
+        acc >>= w;
+        bits -= w;
+      }
+    }
+    p = end;
+    if(mode) grand_adc_offset_block(z,cnt,vmin,&out[ib]);
+    else grand_adc_delta_block(z,cnt,prev,&out[ib]);
+    prev = out[ib+cnt-1];
+  }
+  return(n);
+}
+
+/**
+ * \brief the filter only applies to 16-bit integers
+ */
+static htri_t grand_adc_can_apply(hid_t dcpl_id,hid_t type_id,hid_t space_id)
+{
+  if(H5Tget_class(type_id) != H5T_INTEGER || H5Tget_size(type_id) != 2) return(0);
+  return(1);
+}
+
+/**
+ * \brief the HDF5 filter function
+ */
+static size_t grand_adc_filter(unsigned int flags,size_t cd_nelmts,const unsigned int cd_values[],
+                               size_t nbytes,size_t *buf_size,void **buf)
+{
+  void *out;
+  size_t size;
+  long n;
+
+  if(flags & H5Z_FLAG_REVERSE){
+    if(nbytes<4) return(0);
+    n = ((unsigned char *)*buf)[0]|(((unsigned char *)*buf)[1]<<8)|(((unsigned char *)*buf)[2]<<16)
+      |((size_t)((unsigned char *)*buf)[3]<<24);
+    if((out = H5allocate_memory(n*sizeof(short)+1,0)) == NULL) return(0);
+    if((n = grand_adc_decode(*buf,nbytes,out,n))<0){
+      H5free_memory(out);
+      return(0);
+    }
+    size = n*sizeof(short);
+  }
+  else{
+    if((out = H5allocate_memory(GRAND_ADC_MAX_ENCODED(nbytes/2),0)) == NULL) return(0);
+    size = grand_adc_encode(*buf,nbytes/2,out);
+  }
+  H5free_memory(*buf);
+  *buf = out;
+  *buf_size = size;
+  return(size);
+}
+
+const H5Z_class2_t H5Z_GRAND_ADC[1] = {{
+    H5Z_CLASS_T_VERS,
+    (H5Z_filter_t)GRAND_FILTER_ADC,
+    1, 1,
+    "GRAND ADC delta bit-packing",
+    grand_adc_can_apply,
+    NULL,
+    grand_adc_filter
+  }};
+
+/**
+ * \brief Register the ADC filter with the HDF5 library
+ * \return 1: all ok
+ * \return -1: the filter cannot be registered
+ */
+int grand_HDF5register_adc_filter()
+{
+  if(H5Zfilter_avail(GRAND_FILTER_ADC)>0) return(1);
+  if(H5Zregister(H5Z_GRAND_ADC)<0) return(-1);
+  return(1);
+}
@@ -0,0 +1,30 @@
+/** \file grand_filter.h
+ *  \brief lossless compression filter for ADC traces
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_FILTER_H
+#define GRAND_FILTER_H
+
+#define GRAND_FILTER_ADC 307 /**< HDF5 filter id, in the range reserved for testing */
+#define GRAND_ADC_BLOCK 64   /**< samples per bit-packed block */
+#define GRAND_ADC_OFFSET 0x80 /**< block of offsets from the block minimum instead of differences */
+/*! upper limit of the size of an encoded buffer of n samples */
+#define GRAND_ADC_MAX_ENCODED(n) (4+2*(n)+3*(((n)+GRAND_ADC_BLOCK-1)/GRAND_ADC_BLOCK))
+
+#define GRAND_TRACE_NONE 0    /**< traces are stored contiguous and uncompressed */
+#define GRAND_TRACE_DEFLATE 1 /**< deflate level 6 */
+#define GRAND_TRACE_SHUFFLE 2 /**< byte shuffle followed by deflate level 6 */
+#define GRAND_TRACE_ADC 3     /**< the GRAND ADC filter */
+#define GRAND_N_TRACE_FILTER 4
+
+extern const H5Z_class2_t H5Z_GRAND_ADC[1];
+
+size_t grand_adc_encode(const short *in,size_t n,unsigned char *out);
+long grand_adc_decode(const unsigned char *in,size_t nbytes,short *out,size_t max);
+int grand_HDF5register_adc_filter();
+
+#endif
@@ -13,12 +13,30 @@
 #include <math.h>
 #include "hdf5.h"
 #include "grand_binlib.h"
+#include "grand_reader.h"
+#include "grand_timing.h"
+#include "grand_catalog.h"
+#include "grand_filter.h"
+
+#define GRAND_N_TYPES 11 /**< number of compound types committed in every file */
+
+#define GRAND_PROFILE_DEFAULT 0 /**< HDF5 default file properties */
+#define GRAND_PROFILE_LATEST  1 /**< latest file format, large metadata cache, aligned allocation */
+#define GRAND_PROFILE_PAGED   2 /**< latest profile with paged aggregation and a page buffer */
+#define GRAND_PROFILE_CORE    3 /**< latest profile in memory (core driver) with backing store */
+#define GRAND_N_PROFILE       4
+
+#define PERIODIC_TRACE_LENGTH 256 /**< number of samples per channel kept for a periodic trigger */
+#define PERIODIC_BUFFER 1024 /**< number of periodic records buffered before appending to the file */
+#define RATE_BIN     60   /**< default width in GPS seconds of the trigger-rate bins */
+#define RATE_N_FLAGS 16   /**< number of trigger_flag bits counted per bin */
+#define RATE_BUFFER  1024 /**< number of closed trigger-rate bins buffered before appending to the file */
 
 typedef struct{
   double longitude;
   double latitude;
   float altitude;
-  float x,y;
+  float x,y,z;
 }Center;
 
 typedef struct{
@@ -26,7 +44,7 @@ typedef struct{
   double longitude;
   double latitude;
   float altitude;
-  float x,y;
+  float x,y,z;
   char ant_model[20];
   short elec_id;
   char elec_model[20];
@@ -51,8 +69,16 @@ typedef struct{
   unsigned int ctp;
   unsigned short sync;
   float temperature;
+  double gps_longitude;
+  double gps_latitude;
+  double gps_altitude;
+  float gps_x,gps_y,gps_z;
+  unsigned char quality[3]; /**< GRAND_QUALITY_* flags of the X, Y and Z traces */
 }AntHdr;
 
+#include "grand_layout.h"
+#include "grand_field.h"
+
 typedef struct{
   unsigned short elec_id;
   unsigned short elec_serial;
@@ -65,15 +91,82 @@ typedef struct{
   unsigned short status;
 }MonInfo;
 
+typedef struct{
+  unsigned short id;
+  unsigned int seconds;
+  unsigned int nano_seconds;
+  unsigned int trigger_flag;
+  unsigned short length[3];     /**< samples stored in trace, at most PERIODIC_TRACE_LENGTH */
+  unsigned short raw_length[3]; /**< samples of the trace in the binary event, before truncation */
+  short trace[3][PERIODIC_TRACE_LENGTH];
+}PeriodicRecord;
+
+typedef struct{
+  unsigned short id;
+  unsigned int n_traces;
+  unsigned int first_second;
+  unsigned int last_second;
+  double n_samples[3];
+  double mean[3];
+  double rms[3];
+}PeriodicBaseline;
+
+/*! triggers of an antenna in a bin of GPS seconds */
+typedef struct{
+  unsigned short id;
+  unsigned int first_second;         /**< start of the bin */
+  unsigned int bin_seconds;          /**< width of the bin */
+  unsigned int n_events;             /**< events in which the antenna took part */
+  unsigned int live_seconds;         /**< seconds of the bin with at least one event of the antenna */
+  unsigned int n_flag[RATE_N_FLAGS]; /**< events per trigger_flag bit */
+}TriggerRate;
+
+typedef struct{
+  unsigned int event_nr;
+  unsigned short antenna_id;
+  unsigned long long offset;
+  unsigned short length[3];
+}LiveTrace;
+
+#include "grand_hdf5read.h"
+#include "grand_hdf5view.h"
+#include "grand_convert.h"
+#include "grand_writer.h"
+#include "grand_spectrum.h"
+#include "grand_quality.h"
+#include "grand_station.h"
+#include "grand_preview.h"
+#include "grand_mpi.h"
+#include "grand_shard.h"
+#include "grand_columnar.h"
+
+int grand_HDF5set_profile(int profile);
+void grand_HDF5check_profile();
+void grand_HDF5swmr_profile();
+int grand_HDF5profile_id(char *name);
+hid_t grand_HDF5file_access(int profile);
+int grand_HDF5set_trace_filter(int filter);
+int grand_HDF5trace_filter_id(char *name);
+hid_t grand_HDF5trace_creation(int filter,hsize_t chunk);
 int grand_HDF5create_file(char *hdfname,int runnr,hid_t *file_id, hid_t *run_id);
 void grand_HDF5close_file(hid_t run_id,hid_t file_id);
-int grand_HDF5initiate_field(char *fieldname);
+void grand_HDF5field_positions(int n,AntInfo *ant);
+void grand_HDF5fill_gps_positions(int n,AntHdr *ah);
 void grand_HDF5fill_electronicsheader(int iant,char *Elechdr);
 int grand_HDF5fill_event(hid_t run_id,unsigned short *event);
 int grand_HDF5fill_periodic_event(hid_t run_id,unsigned short *event);
+int grand_HDF5flush_periodic(hid_t run_id);
+int grand_HDF5set_rate_bin(int seconds);
+int grand_HDF5flush_rates(hid_t run_id,int close_bins);
+hid_t grand_HDF5open_table(hid_t loc_id,char *name,hid_t type,hsize_t chunk);
+hid_t grand_HDF5open_trace_table(hid_t loc_id,char *name,hsize_t chunk);
+int grand_HDF5append_table(hid_t data_set,hid_t type,int n,const void *buf);
+int grand_HDF5append_records(hid_t loc_id,char *name,hid_t type,hsize_t chunk,int n,const void *buf);
 int grand_HDF5fill_run(char *filename, hid_t run_id);
 int grand_HDF5create_run_structure(hid_t run_id);
+void grand_HDF5create_skipped_range();
 void grand_HDF5fill_runheader(hid_t run_id);
+int grand_HDF5start_swmr(hid_t file_id,hid_t run_id,int cadence);
 int grand_HDF5fill_monitor(char *filename, hid_t run_id);
 
 
@@ -10,6 +10,8 @@
 #include "grand_hdf5.h"
 
 #define FIELDSIZE 4 /**< hardcoded maximal size of the antenna field (to be changed!) */
+#define GEO_BATCH 1024 /**< number of antenna positions converted at once */
+#define TIME_BATCH 256 /**< number of trigger times reconstructed at once */
 
 /*! Storage of the detector setup*/
 AntInfo *field;
@@ -17,6 +19,11 @@ int field_size = 0;
 
 /*! the center point of the detector*/
 Center center;
+/*! the local frame at the center of the detector */
+GeoOrigin field_origin;
+extern int *field_lookup;
+extern int preview_on;
+extern hid_t t_quality_counts;
 
 /*! HDF5 types for GRAND */
 hid_t t_run_header = -1;
@@ -30,8 +37,81 @@ hid_t t_event_header = -1;
 hid_t t_antenna_header = -1;
 /*! HDF5 types for GRAND */
 hid_t t_monitor_info = -1;
+/*! HDF5 types for GRAND */
+hid_t t_trigger_time = -1;
+/*! HDF5 types for GRAND */
+hid_t t_live_trace = -1;
+/*! type of the Skipped table, not committed */
+hid_t t_skipped_range = -1;
+/*! HDF5 types for GRAND */
+hid_t t_periodic_record = -1;
+/*! HDF5 types for GRAND */
+hid_t t_periodic_baseline = -1;
+/*! HDF5 types for GRAND */
+hid_t t_trigger_rate = -1;
+/*! the GRAND types, committed under /types in every file */
+hid_t *grand_type[GRAND_N_TYPES] = {&t_run_header,&t_field_center,&t_elec_setting,&t_event_header,&t_antenna_header,
+                                    &t_monitor_info,&t_trigger_time,&t_live_trace,&t_periodic_record,&t_periodic_baseline,
+                                    &t_trigger_rate};
+/*! names of the committed types */
+char *grand_type_name[GRAND_N_TYPES] = {"RunHeader","FieldCenter","ElectronicsSettings","EventHeader","AntennaInfo",
+                                        "MonitorInfo","TriggerTime","LiveTrace","PeriodicRecord","PeriodicBaseline",
+                                        "TriggerRate"};
+/*! the process-wide transient types, while the committed copies of an open file are in use */
+hid_t grand_type_transient[GRAND_N_TYPES] = {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1};
 /**! Chunked property */
 hid_t p_chunked;
+/**! Group creation property of the event groups */
+hid_t p_group = H5P_DEFAULT;
+/**! Transfer property of the tables, collective when several MPI ranks write the file */
+hid_t p_transfer = H5P_DEFAULT;
+
+/*! file access profile used when creating files */
+int hdf5_profile = GRAND_PROFILE_DEFAULT;
+/*! names of the file access profiles */
+char *profile_name[GRAND_N_PROFILE] = {"default","latest","paged","core"};
+/*! storage of the ADC traces */
+int trace_filter = GRAND_TRACE_NONE;
+/*! names of the trace storage options */
+char *trace_filter_name[GRAND_N_TRACE_FILTER] = {"none","deflate","shuffle","adc"};
+
+/*! single-writer/multiple-reader mode: events are appended to the Live tables */
+int swmr_mode = 0;
+/*! number of events between two flushes of the Live tables */
+int swmr_cadence = 1;
+int swmr_events = 0;
+/*! number of samples in the Live trace table */
+hsize_t live_samples = 0;
+/*! the Live tables, kept open so that their chunks stay cached */
+hid_t live_table[5] = {-1,-1,-1,-1,-1};
+/*! names of the Live tables */
+char *live_name[5] = {"EventHeader","AntennaInfo","TriggerTime","TraceIndex","Traces"};
+/*! trace index of the event being appended to the Live tables */
+LiveTrace *live_index = NULL;
+int live_index_alloc = 0;
+/*! event and raw group of the event being written, and the number of trace groups per antenna */
+hid_t event_group[2] = {-1,-1};
+int *event_traces = NULL;
+
+/*! periodic records waiting to be appended to the file */
+PeriodicRecord *periodic_buffer = NULL;
+int periodic_count = 0;
+/*! running baseline of the periodic traces, one entry per antenna */
+PeriodicBaseline *periodic_baseline = NULL;
+/*! running sum of squared deviations of the periodic traces */
+double (*periodic_m2)[3] = NULL;
+/*! a periodic trace was cut to PERIODIC_TRACE_LENGTH samples, the notice is printed once */
+int periodic_truncated = 0;
+
+/*! width of the trigger-rate bins in GPS seconds */
+int rate_seconds = RATE_BIN;
+/*! the open trigger-rate bin of every antenna */
+TriggerRate *rate_bin = NULL;
+/*! last GPS second with an event, per antenna */
+unsigned int *rate_last_second = NULL;
+/*! closed trigger-rate bins waiting to be appended to the file */
+TriggerRate *rate_buffer = NULL;
+int rate_count = 0;
 
 
 /**
@@ -55,6 +135,7 @@ int grand_HDF5create_compound_run_header()
   if(H5Tinsert(t_run_header, "altitude", HOFFSET(AntInfo,altitude), H5T_NATIVE_FLOAT)<0) return_code = -2;
   if(H5Tinsert(t_run_header, "x", HOFFSET(AntInfo,x), H5T_NATIVE_FLOAT)<0) return_code = -2;
   if(H5Tinsert(t_run_header, "y", HOFFSET(AntInfo,y), H5T_NATIVE_FLOAT)<0) return_code = -2;
+  if(H5Tinsert(t_run_header, "z", HOFFSET(AntInfo,z), H5T_NATIVE_FLOAT)<0) return_code = -2;
   mem_type = H5Tcopy (H5T_C_S1); //create string of length 20
   if(H5Tset_size (mem_type, 20)<0) return_code = -2;
   if(H5Tinsert(t_run_header, "antenna_model", HOFFSET(AntInfo,ant_model), mem_type)<0) return_code = -2;
@@ -95,6 +176,7 @@ int grand_HDF5create_compound_field_center()
     return_code = -2;
   if(H5Tinsert(t_field_center, "x", HOFFSET(Center,x), H5T_NATIVE_FLOAT)<0) return_code = -2;
   if(H5Tinsert(t_field_center, "y", HOFFSET(Center,y), H5T_NATIVE_FLOAT)<0) return_code = -2;
+  if(H5Tinsert(t_field_center, "z", HOFFSET(Center,z), H5T_NATIVE_FLOAT)<0) return_code = -2;
   if(return_code < 0){
     H5Tclose(t_field_center);
     t_field_center = -1;
@@ -118,44 +200,45 @@ int grand_HDF5create_compound_elec_setting()
   static hid_t t_channel_trig=-1;
   int return_code = 1;
   
-  if(t_channel_prop>0) return(0);
-  if((t_channel_prop = H5Tcreate( H5T_COMPOUND, sizeof(ChannelProperties)))<0) return(-1);
-  if(H5Tinsert(t_channel_prop, "gain", HOFFSET(ChannelProperties,gain), H5T_NATIVE_SHORT)<0) return_code = -2;
-  if(H5Tinsert(t_channel_prop, "offset", HOFFSET(ChannelProperties,offset), H5T_NATIVE_CHAR)<0) return_code = -2;
-  if(H5Tinsert(t_channel_prop, "integration", HOFFSET(ChannelProperties,integration), H5T_NATIVE_UCHAR)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_prop, "base_max", HOFFSET(ChannelProperties,base_max), H5T_NATIVE_USHORT)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_prop, "base_min", HOFFSET(ChannelProperties,base_min), H5T_NATIVE_USHORT)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_prop, "pm_volt", HOFFSET(ChannelProperties,pm_volt), H5T_NATIVE_CHAR)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_prop, "filter", HOFFSET(ChannelProperties,filter), H5T_NATIVE_CHAR)<0)
-    return_code = -2;
-  if(t_channel_trig>0) return(0);
-  if((t_channel_trig = H5Tcreate( H5T_COMPOUND, sizeof(ChannelTrigger)))<0) return(-1);
-  if(H5Tinsert(t_channel_trig, "signal_threshold", HOFFSET(ChannelTrigger,sig_thres), H5T_NATIVE_USHORT)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_trig, "noise_threshold", HOFFSET(ChannelTrigger,noise_thres), H5T_NATIVE_USHORT)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_trig, "time_previous", HOFFSET(ChannelTrigger,tprev), H5T_NATIVE_UCHAR)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_trig, "time_period", HOFFSET(ChannelTrigger,tper), H5T_NATIVE_UCHAR)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_trig, "time_max", HOFFSET(ChannelTrigger,tcmax), H5T_NATIVE_UCHAR)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_trig, "n_max", HOFFSET(ChannelTrigger,ncmax), H5T_NATIVE_UCHAR)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_trig, "c_min", HOFFSET(ChannelTrigger,ncmin), H5T_NATIVE_UCHAR)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_trig, "charge_max", HOFFSET(ChannelTrigger,qmax), H5T_NATIVE_UCHAR)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_trig, "charge_min", HOFFSET(ChannelTrigger,qmin), H5T_NATIVE_UCHAR)<0)
-    return_code = -2;
-  if(H5Tinsert(t_channel_trig, "options", HOFFSET(ChannelTrigger,options), H5T_NATIVE_UCHAR)<0)
-    return_code = -2;
-
   if(t_elec_setting >0) return(0);
+  if(t_channel_prop<0){
+    if((t_channel_prop = H5Tcreate( H5T_COMPOUND, sizeof(ChannelProperties)))<0) return(-1);
+    if(H5Tinsert(t_channel_prop, "gain", HOFFSET(ChannelProperties,gain), H5T_NATIVE_SHORT)<0) return_code = -2;
+    if(H5Tinsert(t_channel_prop, "offset", HOFFSET(ChannelProperties,offset), H5T_NATIVE_CHAR)<0) return_code = -2;
+    if(H5Tinsert(t_channel_prop, "integration", HOFFSET(ChannelProperties,integration), H5T_NATIVE_UCHAR)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_prop, "base_max", HOFFSET(ChannelProperties,base_max), H5T_NATIVE_USHORT)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_prop, "base_min", HOFFSET(ChannelProperties,base_min), H5T_NATIVE_USHORT)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_prop, "pm_volt", HOFFSET(ChannelProperties,pm_volt), H5T_NATIVE_CHAR)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_prop, "filter", HOFFSET(ChannelProperties,filter), H5T_NATIVE_CHAR)<0)
+      return_code = -2;
+  }
+  if(t_channel_trig<0){
+    if((t_channel_trig = H5Tcreate( H5T_COMPOUND, sizeof(ChannelTrigger)))<0) return(-1);
+    if(H5Tinsert(t_channel_trig, "signal_threshold", HOFFSET(ChannelTrigger,sig_thres), H5T_NATIVE_USHORT)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_trig, "noise_threshold", HOFFSET(ChannelTrigger,noise_thres), H5T_NATIVE_USHORT)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_trig, "time_previous", HOFFSET(ChannelTrigger,tprev), H5T_NATIVE_UCHAR)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_trig, "time_period", HOFFSET(ChannelTrigger,tper), H5T_NATIVE_UCHAR)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_trig, "time_max", HOFFSET(ChannelTrigger,tcmax), H5T_NATIVE_UCHAR)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_trig, "n_max", HOFFSET(ChannelTrigger,ncmax), H5T_NATIVE_UCHAR)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_trig, "c_min", HOFFSET(ChannelTrigger,ncmin), H5T_NATIVE_UCHAR)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_trig, "charge_max", HOFFSET(ChannelTrigger,qmax), H5T_NATIVE_UCHAR)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_trig, "charge_min", HOFFSET(ChannelTrigger,qmin), H5T_NATIVE_UCHAR)<0)
+      return_code = -2;
+    if(H5Tinsert(t_channel_trig, "options", HOFFSET(ChannelTrigger,options), H5T_NATIVE_UCHAR)<0)
+      return_code = -2;
+  }
   if((t_elec_setting = H5Tcreate( H5T_COMPOUND, sizeof(AntInfo)))<0) return(-1);
   if(H5Tinsert(t_elec_setting, "electronics_id", HOFFSET(AntInfo,elec_id), H5T_NATIVE_USHORT)<0) return_code = -2;
   if(H5Tinsert(t_elec_setting, "trigger_mask", HOFFSET(AntInfo,elec_setting.trigmask), H5T_NATIVE_SHORT)<0) return_code = -2;
@@ -239,22 +322,24 @@ int grand_HDF5create_compound_antenna_header()
   if(H5Tinsert(t_antenna_header, "nanosec", HOFFSET(AntHdr,nano_seconds), H5T_NATIVE_UINT)<0) return_code = -2;
   if(H5Tinsert(t_antenna_header, "trigger_flag", HOFFSET(AntHdr,trigger_flag), H5T_NATIVE_UINT)<0)
     return_code = -2;
-  if(H5Tinsert(t_antenna_header, "year", HOFFSET(AntHdr,year), H5T_NATIVE_SHORT)<0) return_code = -2;
-  if(H5Tinsert(t_antenna_header, "month", HOFFSET(AntHdr,month), H5T_NATIVE_CHAR)<0) return_code = -2;
-  if(H5Tinsert(t_antenna_header, "day", HOFFSET(AntHdr,day), H5T_NATIVE_CHAR)<0) return_code = -2;
-  if(H5Tinsert(t_antenna_header, "hour", HOFFSET(AntHdr,hour), H5T_NATIVE_CHAR)<0) return_code = -2;
-  if(H5Tinsert(t_antenna_header, "minute", HOFFSET(AntHdr,minute), H5T_NATIVE_CHAR)<0) return_code = -2;
-  if(H5Tinsert(t_antenna_header, "second", HOFFSET(AntHdr,sec), H5T_NATIVE_CHAR)<0) return_code = -2;
-  if(H5Tinsert(t_antenna_header, "elec_status", HOFFSET(AntHdr,status), H5T_NATIVE_CHAR)<0) return_code = -2;
-  if(H5Tinsert(t_antenna_header, "ctd", HOFFSET(AntHdr,ctd), H5T_NATIVE_UINT)<0) return_code = -2;
-  dim[0] = 2;
-  if((mem_type = H5Tarray_create(H5T_NATIVE_FLOAT,1,dim))<0) return_code = -2;
-  if(H5Tinsert(t_antenna_header, "gps_quant", HOFFSET(AntHdr,gps_quant), mem_type)<0) return_code = -2;
-  H5Tclose(mem_type);
-  if(H5Tinsert(t_antenna_header, "ctp", HOFFSET(AntHdr,ctp), H5T_NATIVE_UINT)<0) return(-2);
-  if(H5Tinsert(t_antenna_header, "synchronization", HOFFSET(AntHdr,sync), H5T_NATIVE_USHORT)<0) return_code = -2;
-  if(H5Tinsert(t_antenna_header, "temperature", HOFFSET(AntHdr,temperature), H5T_NATIVE_FLOAT)<0)
-    return_code = -2;
+  //the fields decoded from the electronics header, see grand_layout.h
+#define GRAND_INSERT_FIELD(member,type,h5type,name,offset,count)       \
+  dim[0] = count;                                                     \
+  if(count>1) mem_type = H5Tarray_create(h5type,1,dim);               \
+  else mem_type = H5Tcopy(h5type);                                    \
+  if(mem_type<0 || H5Tinsert(t_antenna_header, name, HOFFSET(AntHdr,member), mem_type)<0) return_code = -2; \
+  if(mem_type>=0) H5Tclose(mem_type);
+  GRAND_ANTENNA_FIELDS(GRAND_INSERT_FIELD)
+#undef GRAND_INSERT_FIELD
+  //the reported GPS position in the frame of the field, see grand_HDF5fill_gps_positions
+  if(H5Tinsert(t_antenna_header, "gps_x", HOFFSET(AntHdr,gps_x), H5T_NATIVE_FLOAT)<0) return_code = -2;
+  if(H5Tinsert(t_antenna_header, "gps_y", HOFFSET(AntHdr,gps_y), H5T_NATIVE_FLOAT)<0) return_code = -2;
+  if(H5Tinsert(t_antenna_header, "gps_z", HOFFSET(AntHdr,gps_z), H5T_NATIVE_FLOAT)<0) return_code = -2;
+  //GRAND_QUALITY_* flags of the X, Y and Z traces, see grand_quality.c
+  dim[0] = 3;
+  mem_type = H5Tarray_create(H5T_NATIVE_UCHAR,1,dim);
+  if(mem_type<0 || H5Tinsert(t_antenna_header, "quality", HOFFSET(AntHdr,quality), mem_type)<0) return_code = -2;
+  if(mem_type>=0) H5Tclose(mem_type);
   if(return_code < 0){
     H5Tclose(t_antenna_header);
     t_antenna_header = -1;
@@ -320,6 +405,172 @@ int grand_HDF5create_compound_monitor_info()
   return(1);
 }
 
+/**
+ \brief Creates the HDF5 trigger time structure
+ * \return 1: all ok
+ * \return 0: no action needed
+ * \return -1: Structure cannot be created
+ * \return -2: items cannot be added
+* */
+int grand_HDF5create_compound_trigger_time()
+{
+  int return_code = 1;
+
+  if(t_trigger_time>0) return(0); //it already exists
+  if((t_trigger_time = H5Tcreate( H5T_COMPOUND, sizeof(TriggerTime)))<0) return(-1);
+  if(H5Tinsert(t_trigger_time, "time_ns", HOFFSET(TriggerTime,time_ns), H5T_NATIVE_LLONG)<0) return_code = -2;
+  if(H5Tinsert(t_trigger_time, "nanosec", HOFFSET(TriggerTime,nanosec), H5T_NATIVE_DOUBLE)<0) return_code = -2;
+  if(return_code < 0){
+    H5Tclose(t_trigger_time);
+    t_trigger_time = -1;
+    return(return_code);
+  }
+  return(1);
+}
+
+/**
+ \brief Creates the HDF5 live trace index structure
+ * \return 1: all ok
+ * \return 0: no action needed
+ * \return -1: Structure cannot be created
+ * \return -2: items cannot be added
+* */
+int grand_HDF5create_compound_live_trace()
+{
+  hid_t mem_type;
+  hsize_t dim[1]={3};
+  int return_code = 1;
+
+  if(t_live_trace>0) return(0); //it already exists
+  if((t_live_trace = H5Tcreate( H5T_COMPOUND, sizeof(LiveTrace)))<0) return(-1);
+  if(H5Tinsert(t_live_trace, "event_nr", HOFFSET(LiveTrace,event_nr), H5T_NATIVE_UINT)<0) return_code = -2;
+  if(H5Tinsert(t_live_trace, "antenna_id", HOFFSET(LiveTrace,antenna_id), H5T_NATIVE_USHORT)<0) return_code = -2;
+  if(H5Tinsert(t_live_trace, "offset", HOFFSET(LiveTrace,offset), H5T_NATIVE_ULLONG)<0) return_code = -2;
+  if((mem_type = H5Tarray_create(H5T_NATIVE_USHORT,1,dim))<0) return_code = -2;
+  if(H5Tinsert(t_live_trace, "trace_length", HOFFSET(LiveTrace,length), mem_type)<0) return_code = -2;
+  H5Tclose(mem_type);
+  if(return_code < 0){
+    H5Tclose(t_live_trace);
+    t_live_trace = -1;
+    return(return_code);
+  }
+  return(1);
+}
+
+/**
+ \brief Creates the HDF5 periodic record structure
+ * \return 1: all ok
+ * \return 0: no action needed
+ * \return -1: Structure cannot be created
+ * \return -2: items cannot be added
+* */
+int grand_HDF5create_compound_periodic_record()
+{
+  hid_t mem_type;
+  hsize_t dim[2];
+  int return_code = 1;
+
+  if(t_periodic_record>0) return(0); //it already exists
+  if((t_periodic_record = H5Tcreate( H5T_COMPOUND, sizeof(PeriodicRecord)))<0) return(-1);
+  if(H5Tinsert(t_periodic_record, "antenna_id", HOFFSET(PeriodicRecord,id), H5T_NATIVE_USHORT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_periodic_record, "gps_sec", HOFFSET(PeriodicRecord,seconds), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_periodic_record, "nanosec", HOFFSET(PeriodicRecord,nano_seconds), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_periodic_record, "trigger_flag", HOFFSET(PeriodicRecord,trigger_flag), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  dim[0] = 3;
+  if((mem_type = H5Tarray_create(H5T_NATIVE_USHORT,1,dim))<0) return_code = -2;
+  if(H5Tinsert(t_periodic_record, "trace_length", HOFFSET(PeriodicRecord,length), mem_type)<0)
+    return_code = -2;
+  if(H5Tinsert(t_periodic_record, "raw_trace_length", HOFFSET(PeriodicRecord,raw_length), mem_type)<0)
+    return_code = -2;
+  H5Tclose(mem_type);
+  dim[0] = 3;
+  dim[1] = PERIODIC_TRACE_LENGTH;
+  if((mem_type = H5Tarray_create(H5T_NATIVE_SHORT,2,dim))<0) return_code = -2;
+  if(H5Tinsert(t_periodic_record, "ADC_XYZ", HOFFSET(PeriodicRecord,trace), mem_type)<0) return_code = -2;
+  H5Tclose(mem_type);
+  if(return_code < 0){
+    H5Tclose(t_periodic_record);
+    t_periodic_record = -1;
+    return(return_code);
+  }
+  return(1);
+}
+
+/**
+ \brief Creates the HDF5 periodic baseline structure
+ * \return 1: all ok
+ * \return 0: no action needed
+ * \return -1: Structure cannot be created
+ * \return -2: items cannot be added
+* */
+int grand_HDF5create_compound_periodic_baseline()
+{
+  hid_t mem_type;
+  hsize_t dim[1]={3};
+  int return_code = 1;
+
+  if(t_periodic_baseline>0) return(0); //it already exists
+  if((t_periodic_baseline = H5Tcreate( H5T_COMPOUND, sizeof(PeriodicBaseline)))<0) return(-1);
+  if(H5Tinsert(t_periodic_baseline, "antenna_id", HOFFSET(PeriodicBaseline,id), H5T_NATIVE_USHORT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_periodic_baseline, "n_traces", HOFFSET(PeriodicBaseline,n_traces), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_periodic_baseline, "first_second", HOFFSET(PeriodicBaseline,first_second), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_periodic_baseline, "last_second", HOFFSET(PeriodicBaseline,last_second), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if((mem_type = H5Tarray_create(H5T_NATIVE_DOUBLE,1,dim))<0) return_code = -2;
+  if(H5Tinsert(t_periodic_baseline, "n_samples", HOFFSET(PeriodicBaseline,n_samples), mem_type)<0)
+    return_code = -2;
+  if(H5Tinsert(t_periodic_baseline, "baseline", HOFFSET(PeriodicBaseline,mean), mem_type)<0) return_code = -2;
+  if(H5Tinsert(t_periodic_baseline, "noise_rms", HOFFSET(PeriodicBaseline,rms), mem_type)<0) return_code = -2;
+  H5Tclose(mem_type);
+  if(return_code < 0){
+    H5Tclose(t_periodic_baseline);
+    t_periodic_baseline = -1;
+    return(return_code);
+  }
+  return(1);
+}
+
+/**
+ \brief Creates the HDF5 trigger-rate structure
+ * \return 1: all ok
+ * \return 0: no action needed
+ * \return -1: Structure cannot be created
+ * \return -2: items cannot be added
+* */
+int grand_HDF5create_compound_trigger_rate()
+{
+  hid_t mem_type;
+  hsize_t dim[1]={RATE_N_FLAGS};
+  int return_code = 1;
+
+  if(t_trigger_rate>0) return(0); //it already exists
+  if((t_trigger_rate = H5Tcreate( H5T_COMPOUND, sizeof(TriggerRate)))<0) return(-1);
+  if(H5Tinsert(t_trigger_rate, "antenna_id", HOFFSET(TriggerRate,id), H5T_NATIVE_USHORT)<0) return_code = -2;
+  if(H5Tinsert(t_trigger_rate, "first_second", HOFFSET(TriggerRate,first_second), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_trigger_rate, "bin_seconds", HOFFSET(TriggerRate,bin_seconds), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if(H5Tinsert(t_trigger_rate, "n_events", HOFFSET(TriggerRate,n_events), H5T_NATIVE_UINT)<0) return_code = -2;
+  if(H5Tinsert(t_trigger_rate, "live_seconds", HOFFSET(TriggerRate,live_seconds), H5T_NATIVE_UINT)<0)
+    return_code = -2;
+  if((mem_type = H5Tarray_create(H5T_NATIVE_UINT,1,dim))<0) return_code = -2;
+  if(H5Tinsert(t_trigger_rate, "n_flag", HOFFSET(TriggerRate,n_flag), mem_type)<0) return_code = -2;
+  H5Tclose(mem_type);
+  if(return_code < 0){
+    H5Tclose(t_trigger_rate);
+    t_trigger_rate = -1;
+    return(return_code);
+  }
+  return(1);
+}
+
 /**
  * \brief create all compound structures used by GRAND in HDF5 format
  */
@@ -331,13 +582,63 @@ void grand_HDF5create_compounds()
   grand_HDF5create_compound_event_header();
   grand_HDF5create_compound_antenna_header();
   grand_HDF5create_compound_monitor_info();
+  grand_HDF5create_compound_trigger_time();
+  grand_HDF5create_compound_live_trace();
+  grand_HDF5create_compound_periodic_record();
+  grand_HDF5create_compound_periodic_baseline();
+  grand_HDF5create_compound_trigger_rate();
 }
 
 /**
- * \brief close all compound structures used by GRAND in HDF5 format
+ * \brief Commit the compound types under /types of a new file, datasets then refer to them
+ * instead of each holding a copy; the transient types stay in the process-wide registry
+ * @param[in] file_id: the HDF5 file
+ * \return 1: all ok
+ * \return -1: a type cannot be committed, the transient types are used
+ */
+int grand_HDF5commit_compounds(hid_t file_id)
+{
+  char name[100];
+  hid_t lcpl,committed;
+  int return_code = 1;
+
+  if(grand_type_transient[0]>=0) return(-1);
+  lcpl = H5Pcreate(H5P_LINK_CREATE);
+  H5Pset_create_intermediate_group(lcpl,1);
+  for(int i=0;i<GRAND_N_TYPES;i++){
+    committed = H5Tcopy(*grand_type[i]);
+    sprintf(name,"/types/%s",grand_type_name[i]);
+    if(H5Tcommit(file_id,name,committed,lcpl,H5P_DEFAULT,H5P_DEFAULT)<0){
+      H5Tclose(committed);
+      return_code = -1;
+      continue;
+    }
+    grand_type_transient[i] = *grand_type[i];
+    *grand_type[i] = committed;
+  }
+  H5Pclose(lcpl);
+  return(return_code);
+}
+
+/**
+ * \brief Close the committed types of a file and return to the transient types
+ */
+void grand_HDF5release_compounds()
+{
+  for(int i=0;i<GRAND_N_TYPES;i++){
+    if(grand_type_transient[i]<0) continue;
+    H5Tclose(*grand_type[i]);
+    *grand_type[i] = grand_type_transient[i];
+    grand_type_transient[i] = -1;
+  }
+}
+
+/**
+ * \brief close all compound structures used by GRAND in HDF5 format, at the end of the process
  */
 void grand_HDF5close_compounds()
 {
+  grand_HDF5release_compounds();
   H5Tclose(t_run_header);
   t_run_header = -1;
   H5Tclose(t_field_center);
@@ -350,6 +651,16 @@ void grand_HDF5close_compounds()
   t_antenna_header = -1;
   H5Tclose(t_monitor_info);
   t_monitor_info = -1;
+  H5Tclose(t_trigger_time);
+  t_trigger_time = -1;
+  H5Tclose(t_live_trace);
+  t_live_trace = -1;
+  H5Tclose(t_periodic_record);
+  t_periodic_record = -1;
+  H5Tclose(t_periodic_baseline);
+  t_periodic_baseline = -1;
+  H5Tclose(t_trigger_rate);
+  t_trigger_rate = -1;
 }
 
 /**
@@ -377,275 +688,1156 @@ int grand_HDF5create_chunked_property()
   return(return_code);
 }
 
-
 /**
- * \brief Open file, create the run group and compound types
- * @param[in] hdfname: the pathname of the binary GRAND file
- * @param[in] runnr: the run number
- * @param[out] *file_id: pointer to the HDF5 file identifier
- * @param[out] *run_id: pointer to the run group in the HDF5 file
- * \return 1: all ok
- * \return -2: the HDF5 file cannot be opened/created
+ * \brief Open an extendable table, the table is created if it does not exist yet
+ * @param[in] loc_id: the group holding the table
+ * @param[in] name: the name of the table
+ * @param[in] type: the HDF5 type of the records
+ * @param[in] chunk: number of records per chunk when the table has to be created
+ * \return -1: the table cannot be opened or created
+ * \return otherwise: the dataset of the table
  */
-int grand_HDF5create_file(char *hdfname,int runnr,hid_t *file_id, hid_t *run_id)
+hid_t grand_HDF5open_table(hid_t loc_id,char *name,hid_t type,hsize_t chunk)
 {
-  char buf[100];
-  
-  if((*file_id = H5Fcreate(hdfname, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT))<0){
-    return(-2);
-  }
-  //next: create the run as a group
-  sprintf(buf,"/Run_%d",runnr);
-  if((*run_id = H5Gcreate(*file_id, buf, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT))<0){
-    H5Fclose(*file_id);
-    return(-2);
+  hid_t data_set,plist,file_space;
+  hsize_t dim[1]={0};
+  hsize_t max_dim[1]={H5S_UNLIMITED};
+
+  if(H5Lexists(loc_id,name,H5P_DEFAULT)>0) return(H5Dopen(loc_id,name,H5P_DEFAULT));
+  if((plist = H5Pcreate(H5P_DATASET_CREATE))<0) return(-1);
+  H5Pset_chunk(plist,1,&chunk);
+  H5Pset_deflate(plist,6);
+  if((file_space = H5Screate_simple(1, dim, max_dim))<0){
+    H5Pclose(plist);
+    return(-1);
   }
-  //create compound types
-  grand_HDF5create_compounds();
-  grand_HDF5create_chunked_property();
-  return(1);
+  data_set = H5Dcreate(loc_id, name, type, file_space, H5P_DEFAULT, plist, H5P_DEFAULT);
+  H5Sclose(file_space);
+  H5Pclose(plist);
+  return(data_set);
 }
 
 /**
- * \brief Close file and run group
- * @param[in] file_id: the HDF5 file identifier
- * @param[in] run_id: the run group in the HDF5 file
+ * \brief Open an extendable table of ADC samples, it is created with the selected trace storage
+ * @param[in] loc_id: the group holding the table
+ * @param[in] name: the name of the table
+ * @param[in] chunk: number of samples per chunk when the table has to be created
+ * \return -1: the table cannot be opened or created
+ * \return otherwise: the dataset of the table
  */
-void grand_HDF5close_file(hid_t run_id,hid_t file_id)
+hid_t grand_HDF5open_trace_table(hid_t loc_id,char *name,hsize_t chunk)
 {
-  grand_HDF5close_compounds();
-  H5Gclose (run_id);
-  H5Fclose(file_id);
+  hid_t data_set,plist,file_space;
+  hsize_t dim[1]={0};
+  hsize_t max_dim[1]={H5S_UNLIMITED};
+
+  if(H5Lexists(loc_id,name,H5P_DEFAULT)>0) return(H5Dopen(loc_id,name,H5P_DEFAULT));
+  //an extendable table must be chunked, deflate unless another filter was selected
+  plist = grand_HDF5trace_creation(trace_filter == GRAND_TRACE_NONE?GRAND_TRACE_DEFLATE:trace_filter,chunk);
+  if((file_space = H5Screate_simple(1, dim, max_dim))<0){
+    H5Pclose(plist);
+    return(-1);
+  }
+  data_set = H5Dcreate(loc_id, name, H5T_NATIVE_SHORT, file_space, H5P_DEFAULT, plist, H5P_DEFAULT);
+  H5Sclose(file_space);
+  H5Pclose(plist);
+  return(data_set);
 }
 
 /**
- * \brief Create the field configuration
- * @param[in] fieldname: name of the file containing the field configuration
- *  \return 1: all ok
- *  \return -1: cannot open the file "fieldname"
- *  \return -2: cannot create the memory to hold the field configuration
+ * \brief Open a fixed-size dataset, the dataset is created if it does not exist yet
+ * @param[in] loc_id: the group holding the dataset
+ * @param[in] name: the name of the dataset
+ * @param[in] type: the HDF5 type of the dataset
+ * @param[in] space: the dataspace when the dataset has to be created
+ * \return -1: the dataset cannot be opened or created
+ * \return otherwise: the dataset
  */
-int grand_HDF5initiate_field(char *fieldname)
+hid_t grand_HDF5open_dataset(hid_t loc_id,char *name,hid_t type,hid_t space)
 {
-  FILE *fp;
-  double r_earth;
-  char line[300];
-  int i_field;
-  
-  if((fp = fopen(fieldname,"r"))== NULL)return(-1);
-  field_size = 0;
-  while(fgets(line,299,fp)>0){
-    if(line[0] != '#') field_size++;
-  }
-  fseek(fp,0,SEEK_SET);
-  if((field = (AntInfo *)malloc(field_size*sizeof(AntInfo)))<0) {
-    fclose(fp);
-    return(-2);
-  }
-  i_field = 0;
-  while(fgets(line,299,fp)>0){
-    if(line[0] == '#') continue;
-    sscanf(line,"%hd %hd %lg %lg %g %s %s %c %c %c %c",
-           &field[i_field].id,&field[i_field].elec_id,
-           &field[i_field].longitude,&field[i_field].latitude,&field[i_field].altitude,
-           field[i_field].ant_model,field[i_field].elec_model,
-           &field[i_field].channel[0],&field[i_field].channel[1],
-           &field[i_field].channel[2],&field[i_field].channel[3]);
-    i_field++;
-  }
-  fclose(fp);
-  
-  memset((void *)&center,0,sizeof(Center));
-  for(int i=0;i<field_size;i++){
-    center.latitude +=field[i].latitude/field_size;
-    center.longitude +=field[i].longitude/field_size;
-    center.altitude +=field[i].altitude/field_size;
-  }
-  center.x = 0;
-  center.y = 0;
-  r_earth = rad_earth(center.latitude);
-  for(int i=0;i<field_size;i++){
-    field[i].y = cos(center.latitude/RADTODEG)*(center.longitude-field[i].longitude)*r_earth/RADTODEG;
-    field[i].x =(field[i].latitude-center.latitude)*r_earth/RADTODEG;
-  }
-  return(1);
+  if(H5Lexists(loc_id,name,H5P_DEFAULT)>0) return(H5Dopen(loc_id,name,H5P_DEFAULT));
+  return(H5Dcreate(loc_id, name, type, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));
 }
 
-
 /**
- \brief Fills the run header with the appropriate electronics info
-* @param[in] iant: identifier of the antenna to be filled
-* @param[in] electronics_header: The electronics header information
-* */
-void grand_HDF5fill_electronicsheader(int iant,char *electronics_header)
+ * \brief Append records to an open extendable table
+ * @param[in] data_set: the table
+ * @param[in] type: the HDF5 type of the records
+ * @param[in] n: number of records to append
+ * @param[in] buf: the records
+ * \return 1: all ok
+ * \return 0: nothing needs to be done
+ * \return -1: the table cannot be accessed
+ * \return -2: the records cannot be written
+ */
+int grand_HDF5append_table(hid_t data_set,hid_t type,int n,const void *buf)
 {
-  memcpy(&(field[iant].elec_setting),electronics_header,sizeof(ElectronicsHeader));
-}
+  hid_t mem_space,file_space;
+  hsize_t dim[1]={0};
+  hsize_t start[1],count[1];
+  int return_code = 1;
 
+  if(n<=0) return(0);
+  if((file_space = H5Dget_space(data_set))<0) return(-1);
+  H5Sget_simple_extent_dims(file_space,dim,NULL);
+  H5Sclose(file_space);
+  start[0] = dim[0];
+  count[0] = n;
+  dim[0] += n;
+  if(H5Dset_extent(data_set, dim)<0) return_code = -2;
+  mem_space = H5Screate_simple(1, count, NULL);
+  file_space = H5Dget_space(data_set);
+  if(H5Sselect_hyperslab(file_space, H5S_SELECT_SET, start, NULL, count, NULL)<0) return_code = -2;
+  if(return_code>0 && H5Dwrite(data_set, type, mem_space, file_space, p_transfer, buf)<0) return_code = -2;
+  H5Sclose(file_space);
+  H5Sclose(mem_space);
+  return(return_code);
+}
 
+/**
+ * \brief Append records to an extendable table, the table is created if it does not exist yet
+ * @param[in] loc_id: the group holding the table
+ * @param[in] name: the name of the table
+ * @param[in] type: the HDF5 type of the records
+ * @param[in] chunk: number of records per chunk when the table has to be created
+ * @param[in] n: number of records to append
+ * @param[in] buf: the records
+ * \return 1: all ok
+ * \return 0: nothing needs to be done
+ * \return -1: the table cannot be opened or created
+ * \return -2: the records cannot be written
+ */
+int grand_HDF5append_records(hid_t loc_id,char *name,hid_t type,hsize_t chunk,int n,const void *buf)
+{
+  hid_t data_set;
+  int return_code;
 
+  if(n<=0) return(0);
+  if((data_set = grand_HDF5open_table(loc_id,name,type,chunk))<0) return(-1);
+  return_code = grand_HDF5append_table(data_set,type,n,buf);
+  H5Dclose(data_set);
+  return(return_code);
+}
 
 /**
- * \brief Create and fill the event tables
- * @param[in] run_id: the run group in the HDF5 file
- * @param[in] *event: buffer containing the raw event
+ * \brief Select the file access profile of the files created afterwards
+ * @param[in] profile: one of the GRAND_PROFILE_* values
  * \return 1: all ok
- * \return -1: Cannot create the event or raw group
- * \return -2: Event data problem
-  */
-int grand_HDF5fill_event(hid_t run_id,unsigned short *event)
+ * \return -1: unknown profile
+ */
+int grand_HDF5set_profile(int profile)
 {
-  hid_t event_id,raw_id,antenna_id;
-  hid_t data_set,space,trspace;   /* file identifier */
-  herr_t      status;
-  int rank = 1; //dimensions of the matrix to follow
-  hsize_t dim[1]={1}; //length of each of the dimensions!
-  char grpname[50];
-  EventHeader *eh = (EventHeader *)event;
-  int ils = EVENT_LS;
-  EventBody *eb;
-  int ev_end = ((int)(event[EVENT_HDR_LENGTH+1]<<16)+(int)(event[EVENT_HDR_LENGTH]))/SHORTSIZE;
-  AntHdr *ah;
-  ElectronicsHeader *elh;
-  int iant,ic;
-  char *raw;
-  int trlen,ioff;
-  int iused[field_size];
-  char *trname[3]={"ADC_X","ADC_Y","ADC_Z"};
-  int itrace;
+  if(profile<0 || profile>=GRAND_N_PROFILE) return(-1);
+  hdf5_profile = profile;
+  return(1);
+}
 
-  sprintf(grpname,"Event_%d",eh->eventnr);
-  if((event_id = H5Gcreate(run_id, grpname, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT))<0){
-    return(-1);
-  }
-  if((raw_id = H5Gcreate(event_id, "raw", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT))<0){
-    printf("Cannot create group %s\n",grpname);
-    H5Gclose(event_id);
-    return(-1);
+/**
+ * \brief Compressed traces and previews are single chunks, indexed compactly only in the 1.10 file format:
+ * the default profile is changed to latest when the first file with compressed traces or previews is created
+ */
+void grand_HDF5check_profile()
+{
+  if(hdf5_profile != GRAND_PROFILE_DEFAULT) return;
+  if(trace_filter != GRAND_TRACE_NONE){
+    printf("Compressed traces need the latest HDF5 profile, the files are written with -p latest\n");
+    hdf5_profile = GRAND_PROFILE_LATEST;
   }
-  if((space = H5Screate_simple(rank, dim, NULL))< 0){
-    H5Gclose(raw_id);
-    H5Gclose(event_id);
-    return(-2);
+  else if(preview_on && !swmr_mode){
+    printf("Compressed previews need the latest HDF5 profile, the files are written with -p latest\n");
+    hdf5_profile = GRAND_PROFILE_LATEST;
   }
-  if((data_set = H5Dcreate(raw_id, "EventHeader", t_event_header, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT))<0){
-    H5Sclose(space);
-    H5Gclose(raw_id);
-    H5Gclose(event_id);
-    return(-2);
+}
 
-  }
-  status = H5Dwrite(data_set, t_event_header, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)event);
-  H5Sclose(space);
-  H5Dclose(data_set);
-  if(status<0) return(-2);
-    
-  dim[0] = eh->LSCNT;
-  space = H5Screate_simple(rank, dim, NULL);
+/**
+ * \brief Single-writer/multiple-reader mode needs the latest file format and no page buffer:
+ * the profile becomes latest, a profile selected otherwise is replaced with a notice
+ */
+void grand_HDF5swmr_profile()
+{
+  if(hdf5_profile != GRAND_PROFILE_DEFAULT && hdf5_profile != GRAND_PROFILE_LATEST)
+    printf("Single-writer mode needs the latest HDF5 profile, the files are written with -p latest instead of -p %s\n",
+           profile_name[hdf5_profile]);
+  hdf5_profile = GRAND_PROFILE_LATEST;
+}
 
-  ah= malloc(eh->LSCNT*sizeof(AntHdr));
-  ic = 0;
-  for(iant=0;iant<field_size;iant++)iused[iant] = 0;
-  while(ils<ev_end){
-    eb = (EventBody *)(&event[ils]);
-    raw = (char *)eb->info_ADCbuffer;
-    elh = (ElectronicsHeader *)raw;
-    iant = -1;
-    for(int i=0;i<field_size;i++){
-      if((eb->LS_id&0xff) == field[i].elec_id) {
-        iant = i;
-        iused[iant] += 1;
-      }
+/**
+ * \brief Find a file access profile by name
+ * @param[in] name: the name of the profile (default, latest, paged, core)
+ * \return -1: unknown profile
+ * \return otherwise: the profile
+ */
+int grand_HDF5profile_id(char *name)
+{
+  for(int i=0;i<GRAND_N_PROFILE;i++){
+    if(strcmp(name,profile_name[i]) == 0) return(i);
+  }
+  return(-1);
+}
+
+/**
+ * \brief Select the storage of the ADC traces; compressed traces need at least the latest profile
+ * @param[in] filter: one of the GRAND_TRACE_* values
+ * \return 1: all ok
+ * \return -1: unknown option or the filter is not available
+ */
+int grand_HDF5set_trace_filter(int filter)
+{
+  if(filter<0 || filter>=GRAND_N_TRACE_FILTER) return(-1);
+  if(filter == GRAND_TRACE_ADC && grand_HDF5register_adc_filter()<0) return(-1);
+  trace_filter = filter;
+  return(1);
+}
+
+/**
+ * \brief Find a trace storage option by name
+ * @param[in] name: the name of the option (none, deflate, shuffle, adc)
+ * \return -1: unknown option
+ * \return otherwise: the option
+ */
+int grand_HDF5trace_filter_id(char *name)
+{
+  for(int i=0;i<GRAND_N_TRACE_FILTER;i++){
+    if(strcmp(name,trace_filter_name[i]) == 0) return(i);
+  }
+  return(-1);
+}
+
+/**
+ * \brief Create the dataset creation properties of ADC traces
+ * @param[in] filter: one of the GRAND_TRACE_* values
+ * @param[in] chunk: number of samples per chunk
+ * \return the property list, H5P_DEFAULT for contiguous storage
+ */
+hid_t grand_HDF5trace_creation(int filter,hsize_t chunk)
+{
+  hid_t dcpl;
+
+  if(filter == GRAND_TRACE_NONE) return(H5P_DEFAULT);
+  dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(dcpl,1,&chunk);
+  if(filter == GRAND_TRACE_SHUFFLE) H5Pset_shuffle(dcpl);
+  if(filter == GRAND_TRACE_ADC) H5Pset_filter(dcpl,GRAND_FILTER_ADC,H5Z_FLAG_MANDATORY,0,NULL);
+  else H5Pset_deflate(dcpl,6);
+  return(dcpl);
+}
+
+/**
+ * \brief Create the file access properties of a profile
+ * @param[in] profile: one of the GRAND_PROFILE_* values
+ * \return the property list, H5P_DEFAULT for the default profile
+ */
+hid_t grand_HDF5file_access(int profile)
+{
+  hid_t fapl;
+  H5AC_cache_config_t mdc;
+
+  if(profile == GRAND_PROFILE_DEFAULT) return(H5P_DEFAULT);
+  if((fapl = H5Pcreate(H5P_FILE_ACCESS))<0) return(H5P_DEFAULT);
+  // compact object headers and link storage of the latest file format
+  H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+  // keep the metadata of many small objects in memory
+  mdc.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+  if(H5Pget_mdc_config(fapl,&mdc)>=0){
+    mdc.set_initial_size = 1;
+    mdc.initial_size = 16*1024*1024;
+    mdc.max_size = 64*1024*1024;
+    mdc.min_size = 4*1024*1024;
+    H5Pset_mdc_config(fapl,&mdc);
+  }
+  // aggregate metadata and small raw data, align large objects to stripe boundaries
+  H5Pset_meta_block_size(fapl, 1024*1024);
+  H5Pset_small_data_block_size(fapl, 1024*1024);
+  H5Pset_alignment(fapl, 512*1024, 1024*1024);
+  if(profile == GRAND_PROFILE_PAGED) H5Pset_page_buffer_size(fapl, 16*1024*1024, 0, 0);
+  if(profile == GRAND_PROFILE_CORE) H5Pset_fapl_core(fapl, 64*1024*1024, 1);
+  return(fapl);
+}
+
+/**
+ * \brief Create the file creation properties of a profile
+ * @param[in] profile: one of the GRAND_PROFILE_* values
+ * \return the property list, H5P_DEFAULT if nothing needs to be changed
+ */
+hid_t grand_HDF5file_creation(int profile)
+{
+  hid_t fcpl;
+
+  if(profile != GRAND_PROFILE_PAGED) return(H5P_DEFAULT);
+  if((fcpl = H5Pcreate(H5P_FILE_CREATE))<0) return(H5P_DEFAULT);
+  H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_PAGE, 0, 1);
+  H5Pset_file_space_page_size(fcpl, 64*1024);
+  return(fcpl);
+}
+
+/**
+ * \brief Create the group creation properties of the event groups for a profile
+ * @param[in] profile: one of the GRAND_PROFILE_* values
+ * \return the property list, H5P_DEFAULT if nothing needs to be changed
+ */
+hid_t grand_HDF5group_creation(int profile)
+{
+  hid_t gcpl;
+
+  if(profile == GRAND_PROFILE_DEFAULT) return(H5P_DEFAULT);
+  if((gcpl = H5Pcreate(H5P_GROUP_CREATE))<0) return(H5P_DEFAULT);
+  // the event groups hold a handful of links: keep them compact in the object header
+  H5Pset_link_phase_change(gcpl, 16, 8);
+  H5Pset_est_link_info(gcpl, 8, 12);
+  return(gcpl);
+}
+
+/**
+ * \brief Open file, create the run group and compound types
+ * @param[in] hdfname: the pathname of the binary GRAND file
+ * @param[in] runnr: the run number
+ * @param[out] *file_id: pointer to the HDF5 file identifier
+ * @param[out] *run_id: pointer to the run group in the HDF5 file
+ * \return 1: all ok
+ * \return -2: the HDF5 file cannot be opened/created
+ */
+int grand_HDF5create_file(char *hdfname,int runnr,hid_t *file_id, hid_t *run_id)
+{
+  char buf[100];
+  hid_t fcpl,fapl;
+
+  grand_HDF5check_profile();
+  fcpl = grand_HDF5file_creation(hdf5_profile);
+  fapl = grand_HDF5file_access(hdf5_profile);
+#ifdef GRAND_USE_MPI
+  //all ranks of grand_HDF5set_mpi share the file
+  fapl = grand_HDF5mpi_access(fapl);
+#endif
+  *file_id = H5Fcreate(hdfname, H5F_ACC_TRUNC, fcpl, fapl);
+  if(fcpl != H5P_DEFAULT) H5Pclose(fcpl);
+  if(fapl != H5P_DEFAULT) H5Pclose(fapl);
+  if(*file_id<0){
+    return(-2);
+  }
+  //next: create the run as a group
+  sprintf(buf,"/Run_%d",runnr);
+  if((*run_id = H5Gcreate(*file_id, buf, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT))<0){
+    H5Fclose(*file_id);
+    return(-2);
+  }
+  //create compound types, once per process, and commit them to the file
+  grand_HDF5create_compounds();
+  grand_HDF5commit_compounds(*file_id);
+  grand_HDF5create_chunked_property();
+  if(p_group != H5P_DEFAULT) H5Pclose(p_group);
+  p_group = grand_HDF5group_creation(hdf5_profile);
+  return(1);
+}
+
+/**
+ * \brief Close file and run group
+ * @param[in] file_id: the HDF5 file identifier
+ * @param[in] run_id: the run group in the HDF5 file
+ */
+void grand_HDF5close_file(hid_t run_id,hid_t file_id)
+{
+  grand_HDF5flush_periodic(run_id);
+  free(periodic_buffer);
+  free(periodic_baseline);
+  free(periodic_m2);
+  periodic_buffer = NULL;
+  periodic_baseline = NULL;
+  periodic_m2 = NULL;
+  grand_HDF5flush_rates(run_id,1);
+  free(rate_bin);
+  free(rate_last_second);
+  free(rate_buffer);
+  rate_bin = NULL;
+  rate_last_second = NULL;
+  rate_buffer = NULL;
+  grand_HDF5close_spectra(run_id);
+  grand_HDF5write_quality(run_id);
+  grand_HDF5close_stations(run_id);
+  if(swmr_mode){
+    for(int i=0;i<5;i++) H5Dclose(live_table[i]);
+  }
+  swmr_mode = 0;
+  grand_HDF5release_compounds();
+  H5Gclose (run_id);
+  H5Fclose(file_id);
+}
+
+/**
+ \brief Positions of antennas in the frame of the field
+ *
+ * The frame has its origin at the center of the field, x pointing North, y West and
+ * z up. The positions are converted in batches, so the per-antenna information does
+ * not need to fit next to the coordinate arrays for large layouts.
+* @param[in] n: number of antennas
+* @param[in,out] ant: the antennas; x, y and z are set from longitude, latitude and altitude
+* */
+void grand_HDF5field_positions(int n,AntInfo *ant)
+{
+  double lon[GEO_BATCH],lat[GEO_BATCH],alt[GEO_BATCH];
+  double east[GEO_BATCH],north[GEO_BATCH],up[GEO_BATCH];
+  int nb;
+
+  for(int i0=0;i0<n;i0+=GEO_BATCH){
+    nb = n-i0<GEO_BATCH?n-i0:GEO_BATCH;
+    for(int i=0;i<nb;i++){
+      lon[i] = ant[i0+i].longitude;
+      lat[i] = ant[i0+i].latitude;
+      alt[i] = ant[i0+i].altitude;
     }
-    if(iant == -1) {
-      ils+=(eb->length);
-      continue;
+    grand_geodetic_to_enu(&field_origin,nb,lon,lat,alt,east,north,up);
+    for(int i=0;i<nb;i++){
+      ant[i0+i].x = north[i];
+      ant[i0+i].y = -east[i];
+      ant[i0+i].z = up[i];
     }
-    ah[ic].id = iant+1;
-    ah[ic].seconds = eb->GPSseconds;
-    ah[ic].nano_seconds = eb->GPSnanoseconds;
-    ah[ic].trigger_flag = eb->trigger_flag;
-    ah[ic].year =*(short *)(elh->event_year);
-    ah[ic].month =elh->event_month;
-    ah[ic].day =elh->event_day;
-    ah[ic].hour =elh->event_hour;
-    ah[ic].minute =elh->event_minute;
-    ah[ic].sec =elh->event_second;
-    ah[ic].status =elh->status;
-    ah[ic].ctd =*(unsigned int *)elh->ctd;
-    ah[ic].ctp =*(unsigned int *)elh->ctp;
-    ah[ic].gps_quant[0] =*(float *)&elh->gps_quant[0];
-    ah[ic].gps_quant[1] =*(float *)&elh->gps_quant[4];
-    ah[ic].sync =*(unsigned short *)elh->sync;
-    ah[ic].temperature =*(float *)elh->temperature;
-    //printf("         GPS(%d): %02d-%02d-%d %02d:%02d:%02d Status 0x%02x Long %10.7f Lat %10.7f Alt %g Temp %g\n",
-    //       (eb->LS_id&0xff),raw[PPS_GPS+7],raw[PPS_GPS+6],*((unsigned short *)&raw[PPS_GPS+4]),
-    //       raw[PPS_GPS+8],raw[PPS_GPS+9],raw[PPS_GPS+10],raw[PPS_GPS+11],
-    // RADTODEG*(*(double *)&raw[PPS_GPS+12]),RADTODEG*(*(double *)&raw[PPS_GPS+20]),*(double *)&raw[PPS_GPS+28],*(float *)&raw[PPS_GPS+36]);
-    ioff = EVENT_ADC;
-    if(iused[iant] == 1)  sprintf(grpname,"Traces_%d",iant+1);
-    else  sprintf(grpname,"Traces_Antenna_%d_%d",iant+1,iused[iant]);
-    if((antenna_id = H5Gcreate(raw_id, grpname, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT))<0){
-      printf("Cannot create group %s\n",grpname);
-      break;
+  }
+}
+
+/**
+ \brief Convert the GPS positions reported by the local stations of an event to the frame of the field
+ *
+ * Without a field configuration the positions are left at 0. The stations report
+ * longitude and latitude in radians, the field frame is set up in degrees.
+* @param[in] n: number of antenna headers
+* @param[in,out] ah: the antenna headers; gps_x, gps_y and gps_z are set
+* */
+void grand_HDF5fill_gps_positions(int n,AntHdr *ah)
+{
+  double lon[GEO_BATCH],lat[GEO_BATCH],alt[GEO_BATCH];
+  double east[GEO_BATCH],north[GEO_BATCH],up[GEO_BATCH];
+  int nb;
+
+  if(field_size == 0) return;
+  for(int i0=0;i0<n;i0+=GEO_BATCH){
+    nb = n-i0<GEO_BATCH?n-i0:GEO_BATCH;
+    for(int i=0;i<nb;i++){
+      lon[i] = ah[i0+i].gps_longitude*RADTODEG;
+      lat[i] = ah[i0+i].gps_latitude*RADTODEG;
+      alt[i] = ah[i0+i].gps_altitude;
     }
-    grand_HDF5fill_electronicsheader(iant,raw);
-    /* Write Traces */
-    for(int itr=0;itr<4;itr++){
-      itrace = -1;
-      if(field->channel[itr] == 'X' || field->channel[itr] == 'x') itrace = 0;
-      if(field->channel[itr] == 'Y' || field->channel[itr] == 'y') itrace = 1;
-      if(field->channel[itr] == 'Z' || field->channel[itr] == 'z') itrace = 2;
-      trlen = *(unsigned short *)&raw[EVENT_LENCH1+2*itr];
-      if(itrace <0) {
-        ioff+=trlen;
-        continue;
-      }
-      if(trlen != 0){
-        dim[0] = trlen;
-        trspace = H5Screate_simple(rank, dim, NULL);
-        if((data_set = H5Dcreate(antenna_id,trname[itrace], H5T_NATIVE_SHORT, trspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT))<0){
-          printf("Cannot create data_set %s %s\n",grpname,trname[itr]);
-          break;
-        }
-        status = H5Dwrite(data_set,H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)&raw[ioff]);
-        H5Dclose(data_set);
-        H5Sclose(trspace);
-      }
-      ioff+=trlen;
+    grand_geodetic_to_enu(&field_origin,nb,lon,lat,alt,east,north,up);
+    for(int i=0;i<nb;i++){
+      ah[i0+i].gps_x = north[i];
+      ah[i0+i].gps_y = -east[i];
+      ah[i0+i].gps_z = up[i];
     }
-    H5Gclose(antenna_id);
-    ic++;
-    if(ic>=eh->LSCNT) break;
+  }
+}
+
+/**
+ \brief Fills the run header with the appropriate electronics info
+* @param[in] iant: identifier of the antenna to be filled
+* @param[in] electronics_header: The electronics header information
+* */
+void grand_HDF5fill_electronicsheader(int iant,char *electronics_header)
+{
+  memcpy(&(field[iant].elec_setting),electronics_header,sizeof(ElectronicsHeader));
+}
+
+/**
+ \brief Find the antenna in the field that belongs to a local station
+* @param[in] eb: the local station data
+* \return -1: the station is not part of the field
+* \return otherwise: index of the antenna in the field
+* */
+int grand_HDF5find_antenna(EventBody *eb)
+{
+  if(field_lookup == NULL) return(-1);
+  return(field_lookup[eb->LS_id&GRAND_LS_ID_MASK]);
+}
+
+/**
+ \brief Decode the antenna header of a local station
+* @param[in] iant: index of the antenna in the field
+* @param[in] eb: the local station data
+* @param[in] layout: the layout of its electronics data
+* @param[out] ah: the antenna header
+* */
+void grand_HDF5decode_antenna_header(int iant,EventBody *eb,const EventLayout *layout,AntHdr *ah)
+{
+  ah->id = iant+1;
+  ah->seconds = eb->GPSseconds;
+  ah->nano_seconds = eb->GPSnanoseconds;
+  ah->trigger_flag = eb->trigger_flag;
+  layout->decode((const char *)eb->info_ADCbuffer,ah);
+}
+
+/**
+ \brief Locate the X, Y and Z traces in the raw data of a local station
+* @param[in] iant: index of the antenna in the field
+* @param[in] layout: the layout of the electronics data
+* @param[in] eb: the local station
+* @param[out] trace: start of the X, Y and Z traces (NULL if not connected)
+* @param[out] length: number of samples in the X, Y and Z traces
+* \return 1: all ok
+* \return -1: the channel lengths run past the end of the local station, no trace is returned
+* */
+int grand_HDF5locate_traces(int iant,const EventLayout *layout,EventBody *eb,short *trace[3],int length[3])
+{
+  char *raw = (char *)eb->info_ADCbuffer;
+  long available = (long)eb->length*SHORTSIZE-(long)offsetof(EventBody,info_ADCbuffer);
+  long samples = 0;
+  int ioff = layout->adc_offset;
+  int itrace;
+  unsigned short trlen;
+
+  for(itrace=0;itrace<3;itrace++){
+    trace[itrace] = NULL;
+    length[itrace] = 0;
+  }
+  for(int itr=0;itr<4;itr++){
+    GRAND_LOAD(unsigned short,trlen,&raw[EVENT_LENCH1+2*itr]);
+    samples += trlen;
+  }
+  if(layout->adc_offset+samples*SHORTSIZE > available) return(-1);
+  for(int itr=0;itr<4;itr++){
+    itrace = -1;
+    if(field[iant].channel[itr] == 'X' || field[iant].channel[itr] == 'x') itrace = 0;
+    if(field[iant].channel[itr] == 'Y' || field[iant].channel[itr] == 'y') itrace = 1;
+    if(field[iant].channel[itr] == 'Z' || field[iant].channel[itr] == 'z') itrace = 2;
+    GRAND_LOAD(unsigned short,trlen,&raw[EVENT_LENCH1+2*itr]);
+    if(itrace >= 0 && trlen != 0){
+      trace[itrace] = (short *)&raw[ioff];
+      length[itrace] = trlen;
+    }
+    ioff+=trlen;
+  }
+  return(1);
+}
+
+/**
+ \brief Reconstruct the trigger times of all antennas of an event
+* @param[in] n: number of antenna headers
+* @param[in] ah: the antenna headers
+* @param[out] tt: the trigger times
+* */
+void grand_HDF5fill_trigger_times(int n,AntHdr *ah,TriggerTime *tt)
+{
+  unsigned int seconds[TIME_BATCH],nano_seconds[TIME_BATCH],ctd[TIME_BATCH],ctp[TIME_BATCH];
+  float quant0[TIME_BATCH],quant1[TIME_BATCH];
+  double nanosec[TIME_BATCH];
+  long long time_ns[TIME_BATCH];
+  int nb;
+
+  for(int i0=0;i0<n;i0+=TIME_BATCH){
+    nb = n-i0<TIME_BATCH?n-i0:TIME_BATCH;
+    for(int i=0;i<nb;i++){
+      seconds[i] = ah[i0+i].seconds;
+      nano_seconds[i] = ah[i0+i].nano_seconds;
+      ctd[i] = ah[i0+i].ctd;
+      ctp[i] = ah[i0+i].ctp;
+      quant0[i] = ah[i0+i].gps_quant[0];
+      quant1[i] = ah[i0+i].gps_quant[1];
+    }
+    grand_trigger_times(nb,seconds,nano_seconds,ctd,ctp,quant0,quant1,nanosec,time_ns);
+    for(int i=0;i<nb;i++){
+      tt[i0+i].time_ns = time_ns[i];
+      tt[i0+i].nanosec = nanosec[i];
+    }
+  }
+}
+
+/**
+ * \brief Start decoding an event, the arrays of the decoded event are grown to LSCNT antennas
+ * @param[in] eh: the event header, the decoded event points to it
+ * @param[in,out] ev: the decoded event
+ * \return 1: all ok
+ * \return -2: memory problem
+  */
+int grand_HDF5decode_begin(EventHeader *eh,GrandEvent *ev)
+{
+  int n = eh->LSCNT;
+  void *p;
+
+  ev->header = eh;
+  ev->n = 0;
+  ev->n_samples = 0;
+  if(n>ev->n_alloc){
+    if((p = realloc(ev->iant,n*sizeof(int))) == NULL) return(-2);
+    ev->iant = p;
+    if((p = realloc(ev->ah,n*sizeof(AntHdr))) == NULL) return(-2);
+    ev->ah = p;
+    if((p = realloc(ev->tt,n*sizeof(TriggerTime))) == NULL) return(-2);
+    ev->tt = p;
+    if((p = realloc(ev->slice,n*sizeof(TraceSlice))) == NULL) return(-2);
+    ev->slice = p;
+    ev->n_alloc = n;
+  }
+  return(1);
+}
+
+/**
+ * \brief Decode a local station of an event into the next antenna row; its traces point into eb
+ * @param[in] eb: the local station data
+ * @param[in,out] ev: the decoded event
+ * \return -1: the station is not part of the field, or the event has LSCNT antennas already
+ * \return -2: the traces run past the end of the station, it is not decoded
+ * \return otherwise: the antenna row
+  */
+int grand_HDF5decode_antenna(EventBody *eb,GrandEvent *ev)
+{
+  const EventLayout *layout;
+  char *raw = (char *)eb->info_ADCbuffer;
+  int iant,ic = ev->n;
+
+  if(ic >= (int)ev->header->LSCNT || ic >= ev->n_alloc) return(-1);
+  if((iant = grand_HDF5find_antenna(eb)) == -1) return(-1);
+  layout = grand_event_layout(eb);
+  if(grand_HDF5locate_traces(iant,layout,eb,ev->slice[ic].trace,ev->slice[ic].length)<0) return(-2);
+  ev->iant[ic] = iant;
+  memset((void *)&ev->ah[ic],0,sizeof(AntHdr));
+  grand_HDF5decode_antenna_header(iant,eb,layout,&ev->ah[ic]);
+  grand_HDF5fill_electronicsheader(iant,raw);
+  grand_quality_antenna(iant,eb->ADC_resolution,&ev->slice[ic],ev->ah[ic].quality);
+  for(int itrace=0;itrace<3;itrace++) ev->n_samples += ev->slice[ic].length[itrace];
+  ev->n++;
+  return(ic);
+}
+
+/**
+ * \brief Finish decoding an event: positions and trigger times of all antennas
+ * @param[in,out] ev: the decoded event
+  */
+void grand_HDF5decode_end(GrandEvent *ev)
+{
+  grand_HDF5fill_gps_positions(ev->n,ev->ah);
+  grand_HDF5fill_trigger_times(ev->n,ev->ah,ev->tt);
+}
+
+/**
+ * \brief Decode the local stations of an event that belong to the field
+ * @param[in] *event: buffer containing the raw event, the decoded traces point into it
+ * @param[in,out] ev: the decoded event, its arrays are reused and grown as needed
+ * \return 1: all ok
+ * \return -2: memory problem
+  */
+int grand_HDF5decode_event(unsigned short *event,GrandEvent *ev)
+{
+  EventHeader *eh = (EventHeader *)event;
+  int ils = EVENT_LS;
+  int ev_end = ((int)(event[EVENT_HDR_LENGTH+1]<<16)+(int)(event[EVENT_HDR_LENGTH]))/SHORTSIZE;
+  EventBody *eb;
+
+  if(grand_HDF5decode_begin(eh,ev)<0) return(-2);
+  while(ils<ev_end && ev->n<(int)eh->LSCNT){
+    eb = (EventBody *)(&event[ils]);
     ils+=(eb->length);
+    grand_HDF5decode_antenna(eb,ev);
   }
-  data_set = H5Dcreate(raw_id, "AntennaInfo", t_antenna_header, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-  status = H5Dwrite(data_set, t_antenna_header, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)ah);
-  free(ah);
-  H5Dclose(data_set);
+  grand_HDF5decode_end(ev);
+  return(1);
+}
+
+/**
+ * \brief Free the arrays of a decoded event
+ * @param[in,out] ev: the decoded event
+  */
+void grand_free_event(GrandEvent *ev)
+{
+  free(ev->iant);
+  free(ev->ah);
+  free(ev->tt);
+  free(ev->slice);
+  memset((void *)ev,0,sizeof(GrandEvent));
+}
+
+/**
+ * \brief Close the groups of the event being written and free its trace counts
+  */
+void grand_HDF5close_event()
+{
+  free(event_traces);
+  event_traces = NULL;
+  for(int i=1;i>=0;i--){
+    if(event_group[i]>=0) H5Gclose(event_group[i]);
+    event_group[i] = -1;
+  }
+}
+
+/**
+ * \brief Start writing an event: the event group with its header, or the trace index of the Live tables
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] ev: the decoded event, only its header is needed
+ * \return 1: all ok
+ * \return -1: Cannot create the event or raw group
+ * \return -2: Event data problem, the event groups are closed
+  */
+int grand_HDF5begin_event(hid_t run_id,GrandEvent *ev)
+{
+  hid_t data_set,space;
+  herr_t status;
+  hsize_t dim[1]={1};
+  char grpname[50];
+  int n = ev->header->LSCNT;
+  void *p;
+
+  if(swmr_mode){
+    if(n>live_index_alloc){
+      if((p = realloc(live_index,n*sizeof(LiveTrace))) == NULL) return(-2);
+      live_index = p;
+      live_index_alloc = n;
+    }
+    return(1);
+  }
+  sprintf(grpname,"Event_%d",ev->header->eventnr);
+  if((event_group[0] = H5Gcreate(run_id, grpname, H5P_DEFAULT, p_group, H5P_DEFAULT))<0){
+    return(-1);
+  }
+  if((event_group[1] = H5Gcreate(event_group[0], "raw", H5P_DEFAULT, p_group, H5P_DEFAULT))<0){
+    printf("Cannot create group %s\n",grpname);
+    grand_HDF5close_event();
+    return(-1);
+  }
+  if((event_traces = calloc(field_size,sizeof(int))) == NULL){
+    grand_HDF5close_event();
+    return(-2);
+  }
+  if((space = H5Screate_simple(1, dim, NULL))< 0){
+    grand_HDF5close_event();
+    return(-2);
+  }
+  if((data_set = H5Dcreate(event_group[1], "EventHeader", t_event_header, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT))<0){
+    H5Sclose(space);
+    grand_HDF5close_event();
+    return(-2);
+  }
+  status = H5Dwrite(data_set, t_event_header, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)ev->header);
   H5Sclose(space);
-  
-  status = H5Gclose (raw_id);
-  status = H5Gclose (event_id);
+  H5Dclose(data_set);
+  if(status<0){
+    grand_HDF5close_event();
+    return(-2);
+  }
   return(1);
 }
 
 /**
- * \brief Create and fill the event tables
+ * \brief Write the traces of an antenna of the event being written
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] ev: the decoded event
+ * @param[in] ic: the antenna row, its traces are only needed during this call
+ * \return 1: all ok
+ * \return -1: No event is being written
+ * \return -2: the traces cannot be written
+  */
+int grand_HDF5write_antenna(hid_t run_id,GrandEvent *ev,int ic)
+{
+  hid_t antenna_id,data_set,trspace,plist;
+  hsize_t dim[1];
+  char grpname[50];
+  char *trname[3]={"ADC_X","ADC_Y","ADC_Z"};
+  TraceSlice *slice = &ev->slice[ic];
+  int iant = ev->iant[ic];
+  short *samples;
+  int n_samples = 0;
+  int return_code = 1;
+
+  if(grand_HDF5spectrum_antenna(ev,ic)<0) return_code = -2;
+  if(swmr_mode){
+    live_index[ic].event_nr = ev->header->eventnr;
+    live_index[ic].antenna_id = iant+1;
+    live_index[ic].offset = live_samples;
+    if((samples = malloc((slice->length[0]+slice->length[1]+slice->length[2]+1)*SHORTSIZE)) == NULL) return(-2);
+    for(int itrace=0;itrace<3;itrace++){
+      live_index[ic].length[itrace] = slice->length[itrace];
+      if(slice->trace[itrace] == NULL) continue;
+      memcpy(&samples[n_samples],slice->trace[itrace],slice->length[itrace]*SHORTSIZE);
+      n_samples += slice->length[itrace];
+    }
+    if(grand_HDF5append_table(live_table[4],H5T_NATIVE_SHORT,n_samples,samples)<0) return_code = -2;
+    live_samples += n_samples;
+    free(samples);
+    return(return_code);
+  }
+  if(event_group[1]<0 || event_traces == NULL) return(-1);
+  if(grand_HDF5station_trace(run_id,ev,ic)<0) return_code = -2;
+  if(grand_HDF5preview_antenna(ev,ic)<0) return_code = -2;
+  event_traces[iant] += 1;
+  if(event_traces[iant] == 1)  sprintf(grpname,"Traces_%d",iant+1);
+  else  sprintf(grpname,"Traces_Antenna_%d_%d",iant+1,event_traces[iant]);
+  if((antenna_id = H5Gcreate(event_group[1], grpname, H5P_DEFAULT, p_group, H5P_DEFAULT))<0){
+    printf("Cannot create group %s\n",grpname);
+    return(-2);
+  }
+  for(int itrace=0;itrace<3;itrace++){
+    if(slice->trace[itrace] == NULL) continue;
+    dim[0] = slice->length[itrace];
+    trspace = H5Screate_simple(1, dim, NULL);
+    plist = grand_HDF5trace_creation(trace_filter,dim[0]);
+    data_set = H5Dcreate(antenna_id,trname[itrace], H5T_NATIVE_SHORT, trspace, H5P_DEFAULT, plist, H5P_DEFAULT);
+    if(plist != H5P_DEFAULT) H5Pclose(plist);
+    H5Sclose(trspace);
+    if(data_set<0){
+      printf("Cannot create data_set %s %s\n",grpname,trname[itrace]);
+      return_code = -2;
+      break;
+    }
+    if(H5Dwrite(data_set,H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)slice->trace[itrace])<0)
+      return_code = -2;
+    H5Dclose(data_set);
+  }
+  H5Gclose(antenna_id);
+  return(return_code);
+}
+
+/**
+ * \brief Finish writing an event: the antenna and trigger time tables, the traces are not needed
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] ev: the decoded event
+ * \return 1: all ok
+ * \return -1: No event is being written
+ * \return -2: Event data problem
+  */
+int grand_HDF5end_event(hid_t run_id,GrandEvent *ev)
+{
+  hid_t data_set,space;
+  hsize_t dim[1];
+  int return_code = 1;
+
+  if(swmr_mode){
+    if(grand_HDF5spectrum_end(run_id,-1,ev)<0) return_code = -2;
+    if(grand_HDF5append_table(live_table[3],t_live_trace,ev->n,live_index)<0) return_code = -2;
+    if(grand_HDF5append_table(live_table[1],t_antenna_header,ev->n,ev->ah)<0) return_code = -2;
+    if(grand_HDF5append_table(live_table[2],t_trigger_time,ev->n,ev->tt)<0) return_code = -2;
+    // the event header goes last: a reader that sees the event also sees its antennas
+    if(grand_HDF5append_table(live_table[0],t_event_header,1,ev->header)<0) return_code = -2;
+    if(grand_HDF5update_rates(run_id,ev)<0) return_code = -2;
+    grand_HDF5quality_count(ev);
+    if(++swmr_events%swmr_cadence == 0){
+      if(grand_HDF5flush_rates(run_id,0)<0) return_code = -2;
+      H5Fflush(run_id,H5F_SCOPE_LOCAL);
+    }
+    return(return_code);
+  }
+  if(grand_HDF5update_rates(run_id,ev)<0) return_code = -2;
+  grand_HDF5quality_count(ev);
+  if(grand_HDF5spectrum_end(run_id,event_group[1],ev)<0) return_code = -2;
+  if(grand_HDF5preview_end(event_group[1],ev)<0) return_code = -2;
+  if(event_group[1]<0){
+    grand_HDF5close_event();
+    return(-1);
+  }
+  dim[0] = ev->n;
+  space = H5Screate_simple(1, dim, NULL);
+  data_set = H5Dcreate(event_group[1], "AntennaInfo", t_antenna_header, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if(H5Dwrite(data_set, t_antenna_header, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)ev->ah)<0) return_code = -2;
+  H5Dclose(data_set);
+  data_set = H5Dcreate(event_group[1], "TriggerTime", t_trigger_time, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if(H5Dwrite(data_set, t_trigger_time, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)ev->tt)<0) return_code = -2;
+  H5Dclose(data_set);
+  H5Sclose(space);
+  grand_HDF5close_event();
+  return(return_code);
+}
+
+/**
+ * \brief Write a decoded event: an event group with its tables and a group of traces per antenna,
+ * or a row per antenna in the Live tables in single-writer/multiple-reader mode
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] ev: the decoded event
+ * \return 1: all ok
+ * \return -1: Cannot create the event or raw group
+ * \return -2: Event data problem
+  */
+int grand_HDF5write_event(hid_t run_id,GrandEvent *ev)
+{
+  int return_code;
+
+  if((return_code = grand_HDF5begin_event(run_id,ev))<0) return(return_code);
+  for(int ic=0;ic<ev->n;ic++){
+    if(grand_HDF5write_antenna(run_id,ev,ic)<0) return_code = -2;
+  }
+  if(grand_HDF5end_event(run_id,ev)<0) return_code = -2;
+  return(return_code);
+}
+
+/**
+ * \brief Decode an event and write it to the event tables
  * @param[in] run_id: the run group in the HDF5 file
  * @param[in] *event: buffer containing the raw event
  * \return 1: all ok
  * \return -1: Cannot create the event or raw group
  * \return -2: Event data problem
   */
+int grand_HDF5fill_event(hid_t run_id,unsigned short *event)
+{
+  static GrandEvent ev;
+
+  if(grand_HDF5decode_event(event,&ev)<0) return(-2);
+  return(grand_HDF5write_event(run_id,&ev));
+}
+
+/**
+ * \brief Append a monitor record of an antenna to its table in the Monitor group
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] iant: index of the antenna in the field
+ * @param[in] monitor: the monitor record
+ * \return 1: all ok
+ * \return -1: the table cannot be opened
+ * \return -2: the record cannot be written
+  */
+int grand_HDF5write_monitor(hid_t run_id,int iant,MonInfo *monitor)
+{
+  char mon_name[100];
+
+  if(iant<0 || iant>=field_size) return(-1);
+  sprintf(mon_name,"Monitor/MonDetector_%d",field[iant].id);
+  return(grand_HDF5append_records(run_id,mon_name,t_monitor_info,64,1,monitor));
+}
+
+/**
+ * \brief Create the compound of the Skipped table
+ */
+void grand_HDF5create_skipped_range()
+{
+  if(t_skipped_range>0) return;
+  t_skipped_range = H5Tcreate(H5T_COMPOUND,sizeof(SkippedRange));
+  H5Tinsert(t_skipped_range,"Start",HOFFSET(SkippedRange,start),H5T_NATIVE_ULLONG);
+  H5Tinsert(t_skipped_range,"End",HOFFSET(SkippedRange,end),H5T_NATIVE_ULLONG);
+  H5Tinsert(t_skipped_range,"LastEvent",HOFFSET(SkippedRange,last_eventnr),H5T_NATIVE_UINT);
+  H5Tinsert(t_skipped_range,"Reason",HOFFSET(SkippedRange,reason),H5T_NATIVE_UINT);
+  H5Tinsert(t_skipped_range,"Source",HOFFSET(SkippedRange,source),H5T_NATIVE_UINT);
+}
+
+/**
+ * \brief Append a byte range of the binary files that was not converted to the Skipped table of the run
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] range: the skipped range
+ * \return 1: all ok
+ * \return -1: the table cannot be opened
+ * \return -2: the record cannot be written
+  */
+int grand_HDF5write_skipped(hid_t run_id,SkippedRange *range)
+{
+  grand_HDF5create_skipped_range();
+  return(grand_HDF5append_records(run_id,"Skipped",t_skipped_range,64,1,range));
+}
+
+/**
+ * \brief Select the width of the trigger-rate bins of the files written afterwards
+ * @param[in] seconds: the width in GPS seconds
+ * \return 1: all ok
+ * \return -1: not a valid width
+ */
+int grand_HDF5set_rate_bin(int seconds)
+{
+  if(seconds<1) return(-1);
+  rate_seconds = seconds;
+  return(1);
+}
+
+/**
+ \brief Add the antennas of an event to their trigger-rate bins. The bin of an antenna is closed
+ * when the antenna takes part in an event of a later bin; events that are late for the open bin
+ * are counted in it.
+* @param[in] run_id: the run group in the HDF5 file
+* @param[in] ev: the decoded event
+* \return 1: all ok
+* \return -1: Cannot create the trigger-rate buffers
+* \return -2: Cannot write the trigger-rate table
+* */
+int grand_HDF5update_rates(hid_t run_id,GrandEvent *ev)
+{
+  TriggerRate *tr;
+  unsigned int bin,flag;
+  int iant;
+  int return_code = 1;
+
+  if(rate_bin == NULL){
+    rate_bin = (TriggerRate *)calloc(field_size,sizeof(TriggerRate));
+    rate_last_second = (unsigned int *)calloc(field_size,sizeof(unsigned int));
+    rate_buffer = (TriggerRate *)malloc(RATE_BUFFER*sizeof(TriggerRate));
+    if(rate_bin == NULL || rate_last_second == NULL || rate_buffer == NULL) return(-1);
+    rate_count = 0;
+  }
+  for(int ic=0;ic<ev->n;ic++){
+    iant = ev->iant[ic];
+    tr = &rate_bin[iant];
+    bin = ev->ah[ic].seconds-ev->ah[ic].seconds%rate_seconds;
+    if(tr->n_events>0 && bin>tr->first_second){
+      rate_buffer[rate_count] = *tr;
+      memset((void *)tr,0,sizeof(TriggerRate));
+      if(++rate_count == RATE_BUFFER && grand_HDF5flush_rates(run_id,0)<0) return_code = -2;
+    }
+    if(tr->n_events == 0){
+      tr->id = field[iant].id;
+      tr->first_second = bin;
+      tr->bin_seconds = rate_seconds;
+    }
+    tr->n_events++;
+    if(tr->n_events == 1 || ev->ah[ic].seconds != rate_last_second[iant]) tr->live_seconds++;
+    rate_last_second[iant] = ev->ah[ic].seconds;
+    for(flag=ev->ah[ic].trigger_flag;flag != 0;flag &= flag-1){
+      if(__builtin_ctz(flag)<RATE_N_FLAGS) tr->n_flag[__builtin_ctz(flag)]++;
+    }
+  }
+  return(return_code);
+}
+
+/**
+ * \brief Append the closed trigger-rate bins to the Monitor/TriggerRate table
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] close_bins: also close and append the open bins, at the end of a file
+ * \return 1: all ok
+ * \return 0: no trigger-rate data
+ * \return -2: Cannot write the trigger-rate table
+  */
+int grand_HDF5flush_rates(hid_t run_id,int close_bins)
+{
+  int return_code = 1;
+
+  if(rate_bin == NULL) return(0);
+  for(int iant=0;iant<field_size;iant++){
+    if(close_bins && rate_bin[iant].n_events>0){
+      if(rate_count == RATE_BUFFER && grand_HDF5flush_rates(run_id,0)<0) return_code = -2;
+      rate_buffer[rate_count++] = rate_bin[iant];
+      memset((void *)&rate_bin[iant],0,sizeof(TriggerRate));
+    }
+  }
+  if(grand_HDF5append_records(run_id,"Monitor/TriggerRate",t_trigger_rate,256,rate_count,rate_buffer)<0)
+    return_code = -2;
+  rate_count = 0;
+  return(return_code);
+}
+
+/**
+ \brief Add the baseline and noise of a periodic trace to the running statistics of its antenna
+* @param[in] iant: index of the antenna in the field
+* @param[in] itrace: 0,1,2 for the X, Y and Z trace
+* @param[in] trace: the ADC samples
+* @param[in] length: the number of samples
+* */
+void grand_HDF5update_baseline(int iant,int itrace,short *trace,int length)
+{
+  PeriodicBaseline *pb = &periodic_baseline[iant];
+  long long sum = 0, sum2 = 0;
+  double n_a,n,mean,m2,delta;
+
+  if(length<=0) return;
+  for(int i=0;i<length;i++){
+    sum += trace[i];
+    sum2 += trace[i]*trace[i];
+  }
+  mean = (double)sum/length;
+  m2 = (double)sum2-(double)sum*mean;
+  // combine the trace with the running statistics (parallel variance algorithm)
+  n_a = pb->n_samples[itrace];
+  n = n_a+length;
+  delta = mean-pb->mean[itrace];
+  pb->mean[itrace] += delta*length/n;
+  periodic_m2[iant][itrace] += m2+delta*delta*n_a*length/n;
+  pb->n_samples[itrace] = n;
+}
+
+/**
+ * \brief Add a periodic event to the fixed-size periodic records
+ * Only the first PERIODIC_TRACE_LENGTH samples of a channel are stored; raw_length keeps the
+ * length of the trace in the binary event, and the baseline is computed from all its samples.
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] *event: buffer containing the raw event
+ * \return 1: all ok
+ * \return -1: Cannot create the periodic buffers
+ * \return -2: Cannot write the periodic records
+  */
 int grand_HDF5fill_periodic_event(hid_t run_id,unsigned short *event)
 {
-  int ret_code;
-  hid_t per_id = H5Gopen(run_id,"Periodic",H5P_DEFAULT);
-  if(per_id<0) return(-1);
-  ret_code = grand_HDF5fill_event(per_id,event);
+  EventHeader *eh = (EventHeader *)event;
+  int ils = EVENT_LS;
+  int ev_end = ((int)(event[EVENT_HDR_LENGTH+1]<<16)+(int)(event[EVENT_HDR_LENGTH]))/SHORTSIZE;
+  EventBody *eb;
+  PeriodicRecord *pr;
+  PeriodicBaseline *pb;
+  short *trace[3];
+  int length[3];
+  int iant,ic,ncopy;
+  int return_code = 1;
+
+  if(periodic_buffer == NULL){
+    periodic_buffer = (PeriodicRecord *)malloc(PERIODIC_BUFFER*sizeof(PeriodicRecord));
+    periodic_baseline = (PeriodicBaseline *)calloc(field_size,sizeof(PeriodicBaseline));
+    periodic_m2 = calloc(field_size,sizeof(*periodic_m2));
+    if(periodic_buffer == NULL || periodic_baseline == NULL || periodic_m2 == NULL) return(-1);
+    for(iant=0;iant<field_size;iant++) periodic_baseline[iant].id = field[iant].id;
+    periodic_count = 0;
+  }
+  ic = 0;
+  while(ils<ev_end && ic<eh->LSCNT){
+    eb = (EventBody *)(&event[ils]);
+    ils+=(eb->length);
+    if((iant = grand_HDF5find_antenna(eb)) == -1) continue;
+    ic++;
+    if(grand_HDF5locate_traces(iant,grand_event_layout(eb),eb,trace,length)<0) continue;
+    pr = &periodic_buffer[periodic_count];
+    memset((void *)pr,0,sizeof(PeriodicRecord));
+    pr->id = iant+1;
+    pr->seconds = eb->GPSseconds;
+    pr->nano_seconds = eb->GPSnanoseconds;
+    pr->trigger_flag = eb->trigger_flag;
+    for(int itrace=0;itrace<3;itrace++){
+      if(trace[itrace] == NULL) continue;
+      ncopy = length[itrace]<PERIODIC_TRACE_LENGTH?length[itrace]:PERIODIC_TRACE_LENGTH;
+      if(ncopy<length[itrace] && !periodic_truncated){
+        printf("Periodic traces are stored with their first %d samples, raw_trace_length keeps their length\n",
+               PERIODIC_TRACE_LENGTH);
+        periodic_truncated = 1;
+      }
+      pr->length[itrace] = ncopy;
+      pr->raw_length[itrace] = length[itrace];
+      memcpy(pr->trace[itrace],trace[itrace],ncopy*SHORTSIZE);
+      grand_HDF5update_baseline(iant,itrace,trace[itrace],length[itrace]);
+    }
+    pb = &periodic_baseline[iant];
+    if(pb->n_traces == 0) pb->first_second = eb->GPSseconds;
+    pb->last_second = eb->GPSseconds;
+    pb->n_traces++;
+    if(++periodic_count == PERIODIC_BUFFER){
+      if(grand_HDF5flush_periodic(run_id)<0) return_code = -2;
+    }
+  }
+  return(return_code);
+}
+
+/**
+ * \brief Append the buffered periodic records and write the per-antenna baseline table
+ * @param[in] run_id: the run group in the HDF5 file
+ * \return 1: all ok
+ * \return 0: no periodic data
+ * \return -1: Cannot open the Periodic group
+ * \return -2: Cannot write the periodic tables
+  */
+int grand_HDF5flush_periodic(hid_t run_id)
+{
+  hid_t per_id,space,data_set;
+  hsize_t dim[1];
+  PeriodicBaseline *baseline;
+  int return_code = 1;
+
+  if(periodic_baseline == NULL) return(0);
+  if((per_id = H5Gopen(run_id,"Periodic",H5P_DEFAULT))<0) return(-1);
+  if((baseline = (PeriodicBaseline *)malloc(field_size*sizeof(PeriodicBaseline))) == NULL){
+    H5Gclose(per_id);
+    return(-2);
+  }
+  if(grand_HDF5append_records(per_id,"PeriodicTraces",t_periodic_record,64,
+                              periodic_count,periodic_buffer)<0) return_code = -2;
+  periodic_count = 0;
+  for(int iant=0;iant<field_size;iant++){
+    baseline[iant] = periodic_baseline[iant];
+    for(int itrace=0;itrace<3;itrace++){
+      if(baseline[iant].n_samples[itrace]>0)
+        baseline[iant].rms[itrace] = sqrt(periodic_m2[iant][itrace]/baseline[iant].n_samples[itrace]);
+    }
+  }
+  dim[0] = field_size;
+  space = H5Screate_simple(1, dim, NULL);
+  data_set = grand_HDF5open_dataset(per_id, "Baseline", t_periodic_baseline, space);
+  H5Sclose(space);
+  if(data_set<0 || H5Dwrite(data_set, t_periodic_baseline, H5S_ALL, H5S_ALL, p_transfer, baseline)<0)
+    return_code = -2;
+  if(data_set>=0) H5Dclose(data_set);
+  free(baseline);
   H5Gclose(per_id);
-  return(ret_code);
+  return(return_code);
 }
 
 /**
@@ -694,34 +1886,98 @@ int grand_HDF5create_run_structure(hid_t run_id)
   return(1);
 }
 
+/**
+ \brief switch the file to single-writer/multiple-reader mode; the run structure must exist.
+ * Events are appended to the run-level tables in the Live group, which are flushed every
+ * cadence events, as new groups and datasets cannot be created in this mode.
+* @param[in] file_id: the HDF5 file identifier
+* @param[in] run_id: identifier of the run-group inside the hdf5 file
+* @param[in] cadence: number of events between two flushes
+* \return 1: all ok
+* \return -2: if the Live tables cannot be created
+* \return -3: if the file cannot be switched to SWMR mode
+* */
+int grand_HDF5start_swmr(hid_t file_id,hid_t run_id,int cadence)
+{
+  hid_t live_id,per_id,space,data_set[5];
+  hsize_t dim[1];
+  hsize_t chunk[5] = {64,256,256,256,65536};
+  hid_t type[4];
+  int return_code = 1;
+
+  //an open dataset of a committed type keeps the type open, which is not allowed in this mode:
+  //the Live tables use the transient types
+  grand_HDF5release_compounds();
+  if((live_id = H5Gcreate(run_id, "Live", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT))<0) return(-2);
+  if((per_id = H5Gopen(run_id,"Periodic",H5P_DEFAULT))<0){
+    H5Gclose(live_id);
+    return(-2);
+  }
+  type[0] = t_event_header;
+  type[1] = t_antenna_header;
+  type[2] = t_trigger_time;
+  type[3] = t_live_trace;
+  dim[0] = field_size;
+  space = H5Screate_simple(1, dim, NULL);
+  for(int i=0;i<4;i++){
+    if((live_table[i] = grand_HDF5open_table(live_id,live_name[i],type[i],chunk[i]))<0) return_code = -2;
+  }
+  if((live_table[4] = grand_HDF5open_trace_table(live_id,live_name[4],chunk[4]))<0) return_code = -2;
+  data_set[0] = grand_HDF5open_table(per_id,"PeriodicTraces",t_periodic_record,64);
+  data_set[1] = grand_HDF5open_dataset(per_id,"Baseline",t_periodic_baseline,space);
+  grand_HDF5create_skipped_range();
+  data_set[2] = grand_HDF5open_table(run_id,"Skipped",t_skipped_range,64);
+  data_set[3] = grand_HDF5open_table(run_id,"Monitor/TriggerRate",t_trigger_rate,256);
+  grand_HDF5create_quality_counts();
+  data_set[4] = grand_HDF5open_table(run_id,"Monitor/Quality",t_quality_counts,64);
+  if(grand_HDF5spectrum_swmr(run_id,live_id)<0) return_code = -2;
+  for(int i=0;i<5;i++){
+    if(data_set[i]<0) return_code = -2;
+    else H5Dclose(data_set[i]);
+  }
+  H5Sclose(space);
+  H5Gclose(per_id);
+  H5Gclose(live_id);
+  if(return_code == 1 && H5Fstart_swmr_write(file_id)<0) return_code = -3;
+  if(return_code<0){
+    for(int i=0;i<5;i++) if(live_table[i]>=0) H5Dclose(live_table[i]);
+    grand_HDF5close_spectra(run_id);
+    return(return_code);
+  }
+  swmr_mode = 1;
+  swmr_cadence = cadence>0?cadence:1;
+  swmr_events = 0;
+  live_samples = 0;
+  return(1);
+}
+
 /**
  \brief create and fill the run header tables, field and center must have been filled already!
 * @param[in] run_id: identifier of the run-group inside the hdf5 file
 * */
 void grand_HDF5fill_runheader(hid_t run_id)
 {
-  int status;
   hid_t space,data_set;
   int rank = 1; //dimensions of the matrix to follow
   hsize_t dim[2]={1,1}; //length of each of the dimensions!
   
   rank = 1;
-  dim[0] = 4;
+  dim[0] = field_size;
   space = H5Screate_simple(rank, dim, NULL);
-  data_set = H5Dcreate(run_id, "DetectorInfo", t_run_header, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-  status = H5Dwrite(data_set, t_run_header, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)field);
+  data_set = grand_HDF5open_dataset(run_id, "DetectorInfo", t_run_header, space);
+  H5Dwrite(data_set, t_run_header, H5S_ALL, H5S_ALL, p_transfer, (const void *)field);
   H5Dclose(data_set);
 
-  data_set = H5Dcreate(run_id, "ElectronicsSettings", t_elec_setting, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-  status = H5Dwrite(data_set, t_elec_setting, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)field);
+  data_set = grand_HDF5open_dataset(run_id, "ElectronicsSettings", t_elec_setting, space);
+  H5Dwrite(data_set, t_elec_setting, H5S_ALL, H5S_ALL, p_transfer, (const void *)field);
   H5Dclose(data_set);
 
   H5Sclose(space);
   rank = 1;
   dim[0] = 1;
   space = H5Screate_simple(rank, dim, NULL);
-  data_set = H5Dcreate(run_id, "CenterField", t_field_center, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-  status = H5Dwrite(data_set, t_field_center, H5S_ALL, H5S_ALL, H5P_DEFAULT, (const void *)&center);
+  data_set = grand_HDF5open_dataset(run_id, "CenterField", t_field_center, space);
+  H5Dwrite(data_set, t_field_center, H5S_ALL, H5S_ALL, p_transfer, (const void *)&center);
   H5Dclose(data_set);
   H5Sclose(space);
 
@@ -0,0 +1,482 @@
+/** \file grand_hdf5read.c
+ *  \brief library routines to read back the GRAND HDF5 file format
+ *
+ *  Events are returned in batches into buffers owned by the caller. A batch
+ *  holds the event headers, all antenna headers and trigger times of these
+ *  events as contiguous arrays, and one sample buffer into which every trace
+ *  is read directly, so the samples are not copied. The reader only allocates
+ *  small bookkeeping arrays: the antenna counts of an event and the trace
+ *  index of the Live tables.
+ *  Files written in single-writer mode keep all events in the Live tables: a
+ *  batch is then read with one hyperslab per table. Files with one group per
+ *  event store every trace channel as its own dataset, which is read as such.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+
+extern hid_t t_event_header;
+extern hid_t t_antenna_header;
+extern hid_t t_trigger_time;
+extern hid_t t_live_trace;
+extern int hdf5_profile;
+void grand_HDF5create_compounds();
+
+/**
+ * \brief collect the event numbers of the event groups of a run
+ */
+herr_t grand_HDF5collect_event(hid_t group,const char *name,const H5L_info_t *info,void *data)
+{
+  GrandReader *reader = (GrandReader *)data;
+  unsigned int eventnr;
+
+  if(sscanf(name,"Event_%u",&eventnr) == 1) reader->eventnr[reader->n_events++] = eventnr;
+  return(0);
+}
+
+/**
+ * \brief qsort comparison of event numbers
+ */
+int grand_HDF5sort_event(const void *a,const void *b)
+{
+  unsigned int ea = *(const unsigned int *)a;
+  unsigned int eb = *(const unsigned int *)b;
+
+  return(ea<eb?-1:(ea>eb?1:0));
+}
+
+/**
+ * \brief number of rows of a table of the run
+ * @param[in] loc_id: the run group
+ * @param[in] name: the table
+ * \return the number of rows, 0 if the table cannot be opened
+ */
+hsize_t grand_HDF5live_rows(hid_t loc_id,char *name)
+{
+  hid_t data_set,space;
+  hsize_t dim[1]={0};
+
+  if((data_set = H5Dopen(loc_id,name,H5P_DEFAULT))<0) return(0);
+  space = H5Dget_space(data_set);
+  H5Sget_simple_extent_dims(space,dim,NULL);
+  H5Sclose(space);
+  H5Dclose(data_set);
+  return(dim[0]);
+}
+
+/**
+ * \brief read consecutive rows of a table of the run
+ * @param[in] loc_id: the run group
+ * @param[in] name: the table
+ * @param[in] type: the memory type
+ * @param[in] start: the first row
+ * @param[in] n: the number of rows
+ * @param[out] buf: the rows
+ * \return 1: all ok
+ * \return -1: the rows cannot be read
+ */
+int grand_HDF5read_rows(hid_t loc_id,char *name,hid_t type,hsize_t start,hsize_t n,void *buf)
+{
+  hid_t data_set,mem_space,file_space;
+  int return_code = 1;
+
+  if(n == 0) return(1);
+  if((data_set = H5Dopen(loc_id,name,H5P_DEFAULT))<0) return(-1);
+  mem_space = H5Screate_simple(1, &n, NULL);
+  file_space = H5Dget_space(data_set);
+  if(H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &start, NULL, &n, NULL)<0) return_code = -1;
+  memset(buf,0,n*H5Tget_size(type));
+  if(return_code>0 && H5Dread(data_set, type, mem_space, file_space, H5P_DEFAULT, buf)<0) return_code = -1;
+  H5Sclose(file_space);
+  H5Sclose(mem_space);
+  H5Dclose(data_set);
+  return(return_code);
+}
+
+/**
+ * \brief Open a GRAND HDF5 file for reading and list the events of a run
+ * @param[in] hdfname: the HDF5 file
+ * @param[in] runnr: the run number
+ * @param[out] reader: the reader of the run
+ * \return 1: all ok
+ * \return -1: the file or run cannot be opened
+ * \return -2: the events cannot be listed
+ */
+int grand_HDF5open_run(char *hdfname,int runnr,GrandReader *reader)
+{
+  H5G_info_t info;
+  char buf[100];
+  hid_t fapl;
+
+  memset((void *)reader,0,sizeof(GrandReader));
+  grand_HDF5create_compounds();
+  grand_HDF5register_adc_filter();
+  //the core driver would load the whole file, read through the other profile settings
+  fapl = grand_HDF5file_access(hdf5_profile == GRAND_PROFILE_CORE?GRAND_PROFILE_LATEST:hdf5_profile);
+  H5E_BEGIN_TRY {
+    reader->file_id = H5Fopen(hdfname, H5F_ACC_RDONLY, fapl);
+  } H5E_END_TRY;
+  if(fapl != H5P_DEFAULT) H5Pclose(fapl);
+  if(reader->file_id<0) reader->file_id = H5Fopen(hdfname, H5F_ACC_RDONLY, H5P_DEFAULT);
+  if(reader->file_id<0) return(-1);
+  sprintf(buf,"/Run_%d",runnr);
+  if((reader->run_id = H5Gopen(reader->file_id, buf, H5P_DEFAULT))<0){
+    H5Fclose(reader->file_id);
+    return(-1);
+  }
+  if(H5Gget_info(reader->run_id,&info)<0
+     || (reader->eventnr = (unsigned int *)malloc((info.nlinks+1)*sizeof(unsigned int))) == NULL){
+    grand_HDF5close_run(reader);
+    return(-2);
+  }
+  if(H5Literate(reader->run_id,H5_INDEX_NAME,H5_ITER_NATIVE,NULL,grand_HDF5collect_event,reader)<0){
+    grand_HDF5close_run(reader);
+    return(-2);
+  }
+  qsort(reader->eventnr,reader->n_events,sizeof(unsigned int),grand_HDF5sort_event);
+  if(H5Lexists(reader->run_id,"Live",H5P_DEFAULT)>0 && H5Lexists(reader->run_id,"Live/EventHeader",H5P_DEFAULT)>0)
+    reader->n_live = grand_HDF5live_rows(reader->run_id,"Live/EventHeader");
+  return(1);
+}
+
+/**
+ * \brief Close a run opened by grand_HDF5open_run
+ * @param[in] reader: the reader of the run
+ */
+void grand_HDF5close_run(GrandReader *reader)
+{
+  if(reader->eventnr != NULL) free(reader->eventnr);
+  reader->eventnr = NULL;
+  free(reader->index);
+  reader->index = NULL;
+  reader->index_alloc = 0;
+  H5Gclose(reader->run_id);
+  H5Fclose(reader->file_id);
+}
+
+/**
+ * \brief Allocate the buffers of an event batch; callers may also fill in their own buffers
+ * @param[out] batch: the batch
+ * @param[in] max_events: maximal number of events in a batch
+ * @param[in] max_antennas: maximal number of antenna headers in a batch
+ * @param[in] max_samples: maximal number of ADC samples in a batch
+ * \return 1: all ok
+ * \return -1: not enough memory
+ */
+int grand_HDF5alloc_batch(GrandEventBatch *batch,int max_events,int max_antennas,long max_samples)
+{
+  memset((void *)batch,0,sizeof(GrandEventBatch));
+  batch->max_events = max_events;
+  batch->max_antennas = max_antennas;
+  batch->max_samples = max_samples;
+  batch->header = (EventHeader *)malloc(max_events*sizeof(EventHeader));
+  batch->first_antenna = (int *)malloc((max_events+1)*sizeof(int));
+  batch->antenna = (AntHdr *)malloc(max_antennas*sizeof(AntHdr));
+  batch->time = (TriggerTime *)malloc(max_antennas*sizeof(TriggerTime));
+  batch->trace = malloc(max_antennas*sizeof(*batch->trace));
+  batch->length = malloc(max_antennas*sizeof(*batch->length));
+  batch->samples = (short *)malloc(max_samples*sizeof(short));
+  if(batch->header == NULL || batch->first_antenna == NULL || batch->antenna == NULL || batch->time == NULL
+     || batch->trace == NULL || batch->length == NULL || batch->samples == NULL){
+    grand_HDF5free_batch(batch);
+    return(-1);
+  }
+  return(1);
+}
+
+/**
+ * \brief Free the buffers allocated by grand_HDF5alloc_batch
+ * @param[in] batch: the batch
+ */
+void grand_HDF5free_batch(GrandEventBatch *batch)
+{
+  free(batch->header);
+  free(batch->first_antenna);
+  free(batch->antenna);
+  free(batch->time);
+  free(batch->trace);
+  free(batch->length);
+  free(batch->samples);
+  memset((void *)batch,0,sizeof(GrandEventBatch));
+}
+
+/**
+ * \brief read a complete one-dimensional dataset into a buffer
+ * @param[in] loc_id: the group holding the dataset
+ * @param[in] name: the name of the dataset
+ * @param[in] type: the memory type
+ * @param[in] max: the capacity of the buffer
+ * @param[out] buf: the buffer
+ * \return >=0: the number of elements read
+ * \return -1: the dataset cannot be read
+ * \return -3: the buffer is too small
+ */
+long grand_HDF5read_dataset(hid_t loc_id,char *name,hid_t type,long max,void *buf)
+{
+  hid_t data_set,space;
+  hsize_t dim[1]={0};
+  long return_code;
+
+  if((data_set = H5Dopen(loc_id,name,H5P_DEFAULT))<0) return(-1);
+  space = H5Dget_space(data_set);
+  H5Sget_simple_extent_dims(space,dim,NULL);
+  H5Sclose(space);
+  return_code = dim[0];
+  if(dim[0]>max) return_code = -3;
+  else if(dim[0]>0){
+    //members missing in older files are not written by the read
+    memset(buf,0,dim[0]*H5Tget_size(type));
+    if(H5Dread(data_set, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf)<0) return_code = -1;
+  }
+  H5Dclose(data_set);
+  return(return_code);
+}
+
+/**
+ * \brief read one event into the next free slots of a batch
+ * \return 1: all ok
+ * \return -1: the event cannot be read
+ * \return -3: the event does not fit in the batch anymore
+ */
+int grand_HDF5read_one_event(GrandReader *reader,GrandEventBatch *batch,unsigned int eventnr)
+{
+  hid_t raw_id,trace_id;
+  char grpname[100];
+  char *trname[3]={"ADC_X","ADC_Y","ADC_Z"};
+  int iev = batch->n_events;
+  int first = batch->n_antennas;
+  long first_sample = batch->n_samples;
+  long n;
+  int n_ant,max_id,return_code = 1;
+  int *used;
+  AntHdr *ah;
+
+  sprintf(grpname,"Event_%u/raw",eventnr);
+  if((raw_id = H5Gopen(reader->run_id,grpname,H5P_DEFAULT))<0) return(-1);
+  if(grand_HDF5read_dataset(raw_id,"EventHeader",t_event_header,1,&batch->header[iev])<0){
+    H5Gclose(raw_id);
+    return(-1);
+  }
+  n_ant = grand_HDF5read_dataset(raw_id,"AntennaInfo",t_antenna_header,batch->max_antennas-first,
+                                 &batch->antenna[first]);
+  if(n_ant<0){
+    H5Gclose(raw_id);
+    return(n_ant);
+  }
+  memset((void *)&batch->time[first],0,n_ant*sizeof(TriggerTime));
+  if(H5Lexists(raw_id,"TriggerTime",H5P_DEFAULT)>0)
+    grand_HDF5read_dataset(raw_id,"TriggerTime",t_trigger_time,n_ant,&batch->time[first]);
+  max_id = 0;
+  for(int i=first;i<first+n_ant;i++) if(batch->antenna[i].id>max_id) max_id = batch->antenna[i].id;
+  if((used = (int *)calloc(max_id+1,sizeof(int))) == NULL){
+    H5Gclose(raw_id);
+    return(-1);
+  }
+  for(int i=first;i<first+n_ant && return_code>0;i++){
+    ah = &batch->antenna[i];
+    for(int itrace=0;itrace<3;itrace++){
+      batch->trace[i][itrace] = NULL;
+      batch->length[i][itrace] = 0;
+    }
+    if(ah->id == 0) continue;
+    // the same naming as grand_HDF5write_antenna: repeated antennas get Traces_Antenna_<id>_<count>
+    if(++used[ah->id] == 1) sprintf(grpname,"Traces_%d",ah->id);
+    else sprintf(grpname,"Traces_Antenna_%d_%d",ah->id,used[ah->id]);
+    if(H5Lexists(raw_id,grpname,H5P_DEFAULT)<=0) continue;
+    if((trace_id = H5Gopen(raw_id,grpname,H5P_DEFAULT))<0){
+      return_code = -1;
+      break;
+    }
+    for(int itrace=0;itrace<3;itrace++){
+      //channels that were not read out have no dataset
+      H5E_BEGIN_TRY {
+        n = grand_HDF5read_dataset(trace_id,trname[itrace],H5T_NATIVE_SHORT,batch->max_samples-batch->n_samples,
+                                   &batch->samples[batch->n_samples]);
+      } H5E_END_TRY;
+      if(n == -1) continue;
+      if(n<0){
+        return_code = n;
+        break;
+      }
+      batch->trace[i][itrace] = &batch->samples[batch->n_samples];
+      batch->length[i][itrace] = n;
+      batch->n_samples += n;
+    }
+    H5Gclose(trace_id);
+  }
+  free(used);
+  H5Gclose(raw_id);
+  if(return_code<0){
+    batch->n_samples = first_sample;
+    return(return_code);
+  }
+  batch->first_antenna[iev] = first;
+  batch->first_antenna[iev+1] = first+n_ant;
+  batch->n_antennas = first+n_ant;
+  batch->n_events++;
+  return(1);
+}
+
+/**
+ * \brief read the next events of the Live tables into a batch, one hyperslab per table
+ * \return >0: number of events in the batch
+ * \return 0: no more events
+ * \return -1: the Live tables cannot be read
+ * \return -3: a single event does not fit into the batch buffers
+ */
+int grand_HDF5read_live_events(GrandReader *reader,GrandEventBatch *batch)
+{
+  hsize_t n_rows,n_index,first_sample,end_sample,offset;
+  int n_events,iev,irow,row_end;
+  LiveTrace *li;
+  void *p;
+
+  n_events = reader->n_live-reader->next_live;
+  if(n_events>batch->max_events) n_events = batch->max_events;
+  if(n_events<=0) return(0);
+  n_index = grand_HDF5live_rows(reader->run_id,"Live/TraceIndex");
+  n_rows = n_index-reader->next_antenna;
+  // one row more than fits tells whether the last event that fits is complete
+  if(n_rows>batch->max_antennas+1) n_rows = batch->max_antennas+1;
+  if(n_rows>reader->index_alloc){
+    if((p = realloc(reader->index,n_rows*sizeof(LiveTrace))) == NULL) return(-1);
+    reader->index = p;
+    reader->index_alloc = n_rows;
+  }
+  if(grand_HDF5read_rows(reader->run_id,"Live/EventHeader",t_event_header,reader->next_live,n_events,batch->header)<0
+     || grand_HDF5read_rows(reader->run_id,"Live/TraceIndex",t_live_trace,reader->next_antenna,n_rows,reader->index)<0)
+    return(-1);
+  // the antennas of an event are consecutive index rows with its event number
+  first_sample = n_rows>0?reader->index[0].offset:0;
+  end_sample = first_sample;
+  irow = 0;
+  for(iev=0;iev<n_events;iev++){
+    row_end = irow;
+    while(row_end<n_rows && reader->index[row_end].event_nr == batch->header[iev].eventnr) row_end++;
+    // an event that does not fit or is cut by the end of the rows read goes into the next batch
+    if(row_end>batch->max_antennas || (row_end == n_rows && reader->next_antenna+n_rows<n_index)) break;
+    if(row_end>irow){
+      li = &reader->index[row_end-1];
+      if(li->offset+li->length[0]+li->length[1]+li->length[2]-first_sample>batch->max_samples) break;
+      end_sample = li->offset+li->length[0]+li->length[1]+li->length[2];
+    }
+    batch->first_antenna[iev] = irow;
+    irow = row_end;
+  }
+  if(iev == 0) return(-3);
+  n_events = iev;
+  batch->first_antenna[n_events] = irow;
+  if(grand_HDF5read_rows(reader->run_id,"Live/AntennaInfo",t_antenna_header,reader->next_antenna,irow,batch->antenna)<0
+     || grand_HDF5read_rows(reader->run_id,"Live/TriggerTime",t_trigger_time,reader->next_antenna,irow,batch->time)<0
+     || grand_HDF5read_rows(reader->run_id,"Live/Traces",H5T_NATIVE_SHORT,first_sample,end_sample-first_sample,
+                            batch->samples)<0)
+    return(-1);
+  for(int i=0;i<irow;i++){
+    li = &reader->index[i];
+    offset = li->offset-first_sample;
+    for(int itrace=0;itrace<3;itrace++){
+      batch->trace[i][itrace] = li->length[itrace]>0?&batch->samples[offset]:NULL;
+      batch->length[i][itrace] = li->length[itrace];
+      offset += li->length[itrace];
+    }
+  }
+  batch->n_events = n_events;
+  batch->n_antennas = irow;
+  batch->n_samples = end_sample-first_sample;
+  reader->next_live += n_events;
+  reader->next_antenna += irow;
+  return(n_events);
+}
+
+/**
+ * \brief Read the next events of a run into a batch
+ * The antennas of event i are batch->antenna[first_antenna[i]..first_antenna[i+1]-1],
+ * their traces point into batch->samples and stay valid until the next call.
+ * @param[in] reader: the reader of the run
+ * @param[in,out] batch: the batch, filled as far as the buffers allow
+ * \return >0: number of events in the batch
+ * \return 0: no more events
+ * \return -1: an event cannot be read
+ * \return -3: a single event does not fit into the batch buffers
+ */
+int grand_HDF5read_events(GrandReader *reader,GrandEventBatch *batch)
+{
+  int return_code;
+
+  batch->n_events = 0;
+  batch->n_antennas = 0;
+  batch->n_samples = 0;
+  batch->first_antenna[0] = 0;
+  if(reader->n_events == 0 && reader->n_live>0) return(grand_HDF5read_live_events(reader,batch));
+  while(reader->next<reader->n_events && batch->n_events<batch->max_events){
+    return_code = grand_HDF5read_one_event(reader,batch,reader->eventnr[reader->next]);
+    if(return_code == -3 && batch->n_events>0) break; //the event goes into the next batch
+    if(return_code<0) return(return_code);
+    reader->next++;
+  }
+  return(batch->n_events);
+}
+
+/**
+ * \brief Open a file that is being written in single-writer/multiple-reader mode
+ * @param[in] hdfname: the HDF5 file
+ * @param[in] runnr: the run number
+ * @param[out] reader: the reader of the run, close it with grand_HDF5close_run
+ * \return 1: all ok
+ * \return -1: the file or run cannot be opened
+ */
+int grand_HDF5open_live(char *hdfname,int runnr,GrandReader *reader)
+{
+  char buf[100];
+
+  memset((void *)reader,0,sizeof(GrandReader));
+  grand_HDF5create_compounds();
+  grand_HDF5register_adc_filter();
+  if((reader->file_id = H5Fopen(hdfname, H5F_ACC_RDONLY|H5F_ACC_SWMR_READ, H5P_DEFAULT))<0) return(-1);
+  sprintf(buf,"/Run_%d",runnr);
+  if((reader->run_id = H5Gopen(reader->file_id, buf, H5P_DEFAULT))<0){
+    H5Fclose(reader->file_id);
+    return(-1);
+  }
+  return(1);
+}
+
+/**
+ * \brief Read the event headers that were appended since the previous poll
+ * @param[in] reader: the reader of a file opened by grand_HDF5open_live
+ * @param[out] header: the new event headers
+ * @param[in] max: the capacity of header
+ * \return >=0: the number of new events
+ * \return -1: the Live tables cannot be read
+ */
+int grand_HDF5poll_live(GrandReader *reader,EventHeader *header,int max)
+{
+  hid_t data_set,mem_space,file_space;
+  hsize_t dim[1]={0};
+  hsize_t start[1],count[1];
+  int return_code;
+
+  if((data_set = H5Dopen(reader->run_id,"Live/EventHeader",H5P_DEFAULT))<0) return(-1);
+  H5Drefresh(data_set);
+  file_space = H5Dget_space(data_set);
+  H5Sget_simple_extent_dims(file_space,dim,NULL);
+  return_code = 0;
+  if(dim[0]>reader->next){
+    start[0] = reader->next;
+    count[0] = dim[0]-reader->next;
+    if(count[0]>max) count[0] = max;
+    mem_space = H5Screate_simple(1, count, NULL);
+    H5Sselect_hyperslab(file_space, H5S_SELECT_SET, start, NULL, count, NULL);
+    if(H5Dread(data_set, t_event_header, mem_space, file_space, H5P_DEFAULT, header)<0) return_code = -1;
+    else{
+      return_code = count[0];
+      reader->next += count[0];
+    }
+    H5Sclose(mem_space);
+  }
+  H5Sclose(file_space);
+  H5Dclose(data_set);
+  return(return_code);
+}
@@ -0,0 +1,49 @@
+/** \file grand_hdf5read.h
+ *  \brief structures and routines to read back the GRAND HDF5 file format
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_HDF5READ_H
+#define GRAND_HDF5READ_H
+
+typedef struct{
+  hid_t file_id;
+  hid_t run_id;
+  int n_events;
+  int next;
+  unsigned int *eventnr;
+  hsize_t n_live;        /**< events in the Live tables of a single-writer file */
+  hsize_t next_live;     /**< next row of Live/EventHeader */
+  hsize_t next_antenna;  /**< next row of Live/AntennaInfo, TriggerTime and TraceIndex */
+  LiveTrace *index;      /**< trace index rows of the batch being read */
+  int index_alloc;
+}GrandReader;
+
+typedef struct{
+  int max_events;
+  int max_antennas;
+  long max_samples;
+  int n_events;
+  int n_antennas;
+  long n_samples;
+  EventHeader *header;
+  int *first_antenna;
+  AntHdr *antenna;
+  TriggerTime *time;
+  short *(*trace)[3];
+  int (*length)[3];
+  short *samples;
+}GrandEventBatch;
+
+int grand_HDF5open_run(char *hdfname,int runnr,GrandReader *reader);
+void grand_HDF5close_run(GrandReader *reader);
+int grand_HDF5alloc_batch(GrandEventBatch *batch,int max_events,int max_antennas,long max_samples);
+void grand_HDF5free_batch(GrandEventBatch *batch);
+int grand_HDF5read_events(GrandReader *reader,GrandEventBatch *batch);
+int grand_HDF5open_live(char *hdfname,int runnr,GrandReader *reader);
+int grand_HDF5poll_live(GrandReader *reader,EventHeader *header,int max);
+
+#endif
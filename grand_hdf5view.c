@@ -0,0 +1,633 @@
+/** \file grand_hdf5view.c
+ *  \brief library routines to build a run-wide view of the HDF5 files of a run
+ *
+ *  Every file sequence of a run is converted into its own HDF5 file. The view
+ *  is a small master file in which the tables of all these files appear as
+ *  single virtual datasets (EventHeader, AntennaInfo, TriggerTime, Skipped,
+ *  the Live, Periodic and Monitor tables), concatenated in file order and, within a
+ *  file, in event number order. No data is copied: the event groups are
+ *  external links into the source files and the run header is linked from the
+ *  first file. The Files table gives the position of every source file in the
+ *  virtual tables. The event tables of a file with event groups are first
+ *  gathered in the virtual tables Sources/File_<i>, so that every run-wide
+ *  table has one mapping per file. Source file names are stored as given, so relative names
+ *  must be valid from the directory of the view.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+
+extern int hdf5_profile;
+void grand_HDF5create_compounds();
+
+hid_t t_view_file = -1;
+
+/**
+ * \brief Create the compound of the Files table of a view
+ */
+void grand_HDF5create_view_file()
+{
+  hid_t t_name;
+
+  if(t_view_file>0) return;
+  t_name = H5Tcopy(H5T_C_S1);
+  H5Tset_size(t_name,VIEW_NAME_LENGTH);
+  t_view_file = H5Tcreate(H5T_COMPOUND,sizeof(ViewFile));
+  H5Tinsert(t_view_file,"Name",HOFFSET(ViewFile,name),t_name);
+  H5Tinsert(t_view_file,"FirstEvent",HOFFSET(ViewFile,first_event),H5T_NATIVE_ULLONG);
+  H5Tinsert(t_view_file,"Events",HOFFSET(ViewFile,n_events),H5T_NATIVE_ULLONG);
+  H5Tinsert(t_view_file,"FirstAntenna",HOFFSET(ViewFile,first_antenna),H5T_NATIVE_ULLONG);
+  H5Tinsert(t_view_file,"Antennas",HOFFSET(ViewFile,n_antennas),H5T_NATIVE_ULLONG);
+  H5Tinsert(t_view_file,"FirstSample",HOFFSET(ViewFile,first_sample),H5T_NATIVE_ULLONG);
+  H5Tclose(t_name);
+}
+
+/**
+ * \brief Find a virtual table of a view by name, or add it
+ * @param[in,out] table: the virtual tables of the view
+ * @param[in,out] n_table: the number of virtual tables
+ * @param[in] name: the name of the table in the run group of the view
+ * \return the table, NULL if there is no memory
+ */
+ViewTable *grand_HDF5view_table(ViewTable **table,int *n_table,char *name)
+{
+  ViewTable *vt;
+  int it;
+
+  for(it=0;it<*n_table;it++)
+    if(strcmp((*table)[it].name,name) == 0) return(&(*table)[it]);
+  if((vt = (ViewTable *)realloc(*table,(*n_table+1)*sizeof(ViewTable))) == NULL) return(NULL);
+  *table = vt;
+  vt = &(*table)[(*n_table)++];
+  memset((void *)vt,0,sizeof(ViewTable));
+  strncpy(vt->name,name,VIEW_NAME_LENGTH-1);
+  vt->type = -1;
+  return(vt);
+}
+
+/**
+ * \brief Keep the type of a table with the most members: files written before and after a member was
+ * added to a record give a table with all members, the rows of each source are converted by member
+ * name, a member missing in a source is not written by H5Dread
+ * @param[in] type: the type of the table, -1 if not known yet
+ * @param[in] other: the type of a source
+ * \return the type that is kept, the other one is closed
+ */
+hid_t grand_HDF5view_type(hid_t type,hid_t other)
+{
+  if(type<0) return(other);
+  if(other<0) return(type);
+  if(H5Tget_class(type) == H5T_COMPOUND && H5Tget_class(other) == H5T_COMPOUND
+     && H5Tget_nmembers(other) > H5Tget_nmembers(type)){
+    H5Tclose(type);
+    return(other);
+  }
+  H5Tclose(other);
+  return(type);
+}
+
+/**
+ * \brief Add a source dataset to a virtual table
+ * @param[in] vt: the virtual table
+ * @param[in] loc_id: the run group of the source file
+ * @param[in] file: the name of the source file
+ * @param[in] runnr: the run number
+ * @param[in] path: the dataset relative to the run group
+ * \return >=0: the number of rows added
+ * \return -1: the dataset cannot be opened
+ * \return -2: not enough memory
+ */
+long grand_HDF5view_source(ViewTable *vt,hid_t loc_id,char *file,int runnr,char *path)
+{
+  hid_t data_set,space;
+  hsize_t dim[1]={0};
+  int n;
+
+  if(vt == NULL) return(-2);
+  if((data_set = H5Dopen(loc_id,path,H5P_DEFAULT))<0) return(-1);
+  space = H5Dget_space(data_set);
+  H5Sget_simple_extent_dims(space,dim,NULL);
+  H5Sclose(space);
+  if(dim[0] == 0){
+    H5Dclose(data_set);
+    return(0);
+  }
+  vt->type = grand_HDF5view_type(vt->type,H5Dget_type(data_set));
+  H5Dclose(data_set);
+  if(vt->n_source == vt->n_alloc){
+    n = vt->n_alloc == 0?64:2*vt->n_alloc;
+    if((vt->file = realloc(vt->file,n*VIEW_NAME_LENGTH)) == NULL) return(-2);
+    if((vt->path = realloc(vt->path,n*VIEW_NAME_LENGTH)) == NULL) return(-2);
+    if((vt->count = (hsize_t *)realloc(vt->count,n*sizeof(hsize_t))) == NULL) return(-2);
+    vt->n_alloc = n;
+  }
+  strncpy(vt->file[vt->n_source],file,VIEW_NAME_LENGTH-1);
+  vt->file[vt->n_source][VIEW_NAME_LENGTH-1] = 0;
+  snprintf(vt->path[vt->n_source],VIEW_NAME_LENGTH,"/Run_%d/%s",runnr,path);
+  vt->count[vt->n_source++] = dim[0];
+  vt->total += dim[0];
+  return(dim[0]);
+}
+
+/**
+ * \brief Write a virtual table into the run group of the view
+ * @param[in] loc_id: the run group of the view
+ * @param[in] vt: the virtual table
+ * \return 1: all ok
+ * \return 0: the table has no rows
+ * \return -1: the virtual dataset cannot be created
+ */
+int grand_HDF5view_create(hid_t loc_id,ViewTable *vt)
+{
+  hid_t dcpl,lcpl,vspace,src_space,data_set;
+  hsize_t start[1]={0};
+  int isrc;
+  int return_code = 1;
+
+  if(vt->total == 0) return(0);
+  dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  lcpl = H5Pcreate(H5P_LINK_CREATE);
+  H5Pset_create_intermediate_group(lcpl,1);
+  vspace = H5Screate_simple(1,&vt->total,NULL);
+  for(isrc=0;isrc<vt->n_source;isrc++){
+    src_space = H5Screate_simple(1,&vt->count[isrc],NULL);
+    H5Sselect_hyperslab(vspace,H5S_SELECT_SET,start,NULL,&vt->count[isrc],NULL);
+    if(H5Pset_virtual(dcpl,vspace,vt->file[isrc],vt->path[isrc],src_space)<0) return_code = -1;
+    H5Sclose(src_space);
+    start[0] += vt->count[isrc];
+  }
+  H5Sselect_all(vspace);
+  if(return_code == 1){
+    if((data_set = H5Dcreate(loc_id,vt->name,vt->type,vspace,lcpl,dcpl,H5P_DEFAULT))<0){
+      printf("Cannot create the virtual table %s\n",vt->name);
+      return_code = -1;
+    }
+    else H5Dclose(data_set);
+  }
+  H5Sclose(vspace);
+  H5Pclose(lcpl);
+  H5Pclose(dcpl);
+  return(return_code);
+}
+
+/**
+ * \brief Replace the mappings that a source file added to a virtual table by a single mapping. The
+ * rows of the file are gathered in the virtual table Sources/File_<ifile>/<name> of the view, so that
+ * a run-wide table has a mapping per file and not per event group: adding a file to a view copies
+ * the mappings of the table, which would otherwise grow with the square of the number of events.
+ * @param[in] view_id: the run group of the view
+ * @param[in,out] vt: the virtual table
+ * @param[in] first: the first mapping of the file in the table
+ * @param[in] ifile: the row of the file in the Files table
+ * @param[in] runnr: the run number
+ * \return 1: all ok
+ * \return 0: the file has at most one mapping in the table
+ * \return -1: the virtual table of the file cannot be created
+ */
+int grand_HDF5view_gather(hid_t view_id,ViewTable *vt,int first,int ifile,int runnr)
+{
+  ViewTable sub;
+  char path[VIEW_NAME_LENGTH];
+
+  if(vt->n_source-first<2) return(0);
+  memset((void *)&sub,0,sizeof(ViewTable));
+  if(snprintf(sub.name,VIEW_NAME_LENGTH,"Sources/File_%d/%s",ifile,vt->name) >= VIEW_NAME_LENGTH
+     || snprintf(path,VIEW_NAME_LENGTH,"/Run_%d/%s",runnr,sub.name) >= VIEW_NAME_LENGTH) return(-1);
+  sub.type = vt->type;
+  sub.n_source = vt->n_source-first;
+  sub.file = &vt->file[first];
+  sub.path = &vt->path[first];
+  sub.count = &vt->count[first];
+  for(int isrc=0;isrc<sub.n_source;isrc++) sub.total += sub.count[isrc];
+  //left by an add of the file that failed
+  H5E_BEGIN_TRY {
+    H5Ldelete(view_id,sub.name,H5P_DEFAULT);
+  } H5E_END_TRY;
+  if(grand_HDF5view_create(view_id,&sub)<0) return(-1);
+  //the source "." is the file of the view itself
+  strcpy(vt->file[first],".");
+  strcpy(vt->path[first],path);
+  vt->count[first] = sub.total;
+  vt->n_source = first+1;
+  return(1);
+}
+
+/**
+ * \brief Free the virtual tables of a view
+ */
+void grand_HDF5view_free(ViewTable *table,int n_table)
+{
+  int it;
+
+  for(it=0;it<n_table;it++){
+    if(table[it].type>=0) H5Tclose(table[it].type);
+    if(table[it].file != NULL) free(table[it].file);
+    if(table[it].path != NULL) free(table[it].path);
+    if(table[it].count != NULL) free(table[it].count);
+  }
+  if(table != NULL) free(table);
+}
+
+/**
+ * \brief collect the names of the datasets in a group
+ */
+herr_t grand_HDF5collect_datasets(hid_t group,const char *name,const H5L_info_t *info,void *data)
+{
+  char (**names)[VIEW_NAME_LENGTH] = data;
+  H5O_info_t oinfo;
+  int n;
+
+  if(H5Oget_info_by_name(group,name,&oinfo,H5P_DEFAULT)<0 || oinfo.type != H5O_TYPE_DATASET) return(0);
+  for(n=0;(*names)[n][0] != 0;n++);
+  if((*names = realloc(*names,(n+2)*VIEW_NAME_LENGTH)) == NULL) return(-1);
+  strncpy((*names)[n],name,VIEW_NAME_LENGTH-1);
+  (*names)[n][VIEW_NAME_LENGTH-1] = 0;
+  (*names)[n+1][0] = 0;
+  return(0);
+}
+
+/**
+ * \brief Add the datasets of a group of a source file to the virtual tables of the same name
+ * @param[in,out] table: the virtual tables of the view
+ * @param[in,out] n_table: the number of virtual tables
+ * @param[in] run_id: the run group of the source file
+ * @param[in] file: the name of the source file
+ * @param[in] runnr: the run number
+ * @param[in] group: the group relative to the run group
+ * \return 1: all ok
+ * \return 0: the source file does not have this group
+ * \return -2: not enough memory
+ */
+int grand_HDF5view_group(ViewTable **table,int *n_table,hid_t run_id,char *file,int runnr,char *group)
+{
+  char (*names)[VIEW_NAME_LENGTH];
+  char path[2*VIEW_NAME_LENGTH];
+  hid_t grp_id;
+  int n;
+  int return_code = 1;
+
+  if(H5Lexists(run_id,group,H5P_DEFAULT) <= 0) return(0);
+  if((grp_id = H5Gopen(run_id,group,H5P_DEFAULT))<0) return(0);
+  if((names = malloc(VIEW_NAME_LENGTH)) == NULL){
+    H5Gclose(grp_id);
+    return(-2);
+  }
+  names[0][0] = 0;
+  if(H5Literate(grp_id,H5_INDEX_NAME,H5_ITER_INC,NULL,grand_HDF5collect_datasets,&names)<0) return_code = -2;
+  H5Gclose(grp_id);
+  for(n=0;return_code == 1 && names[n][0] != 0;n++){
+    //the baseline is a summary of one file, it is not concatenated
+    if(strcmp(names[n],"Baseline") == 0) continue;
+    snprintf(path,sizeof(path),"%s/%s",group,names[n]);
+    if(grand_HDF5view_source(grand_HDF5view_table(table,n_table,path),run_id,file,runnr,path) == -2) return_code = -2;
+  }
+  free(names);
+  return(return_code);
+}
+
+/**
+ * \brief Collect the tables of one source file into the virtual tables of a view
+ * @param[in,out] table: the virtual tables of the view
+ * @param[in,out] n_table: the number of virtual tables
+ * @param[out] vf: the Files row of the source file, its offsets relative to the collected tables
+ * @param[in] view_id: the run group of the view, for the external links and the tables of the event groups
+ * @param[in] file: the source file
+ * @param[in] ifile: the row of the source file in the Files table
+ * @param[in] runnr: the run number
+ * @param[in] header: link the run header of this file into the view
+ * \return 1: all ok
+ * \return -2: the source file cannot be read
+ * \return -3: not enough memory
+ * \return -4: a virtual table of the event groups cannot be created
+ */
+int grand_HDF5view_file(ViewTable **table,int *n_table,ViewFile *vf,hid_t view_id,char *file,int ifile,int runnr,int header)
+{
+  GrandReader reader;
+  char path[VIEW_NAME_LENGTH],target[VIEW_NAME_LENGTH];
+  char (*names)[VIEW_NAME_LENGTH];
+  ViewTable *vt;
+  long nrow;
+  int ievt,it,n;
+  int first[3];
+  int return_code = 1;
+  static char *event_table[3] = {"EventHeader","AntennaInfo","TriggerTime"};
+  static char *live_view[5][2] = {{"Live/EventHeader","EventHeader"},{"Live/AntennaInfo","AntennaInfo"},
+                                  {"Live/TriggerTime","TriggerTime"},{"Live/TraceIndex","Live/TraceIndex"},
+                                  {"Live/Traces","Live/Traces"}};
+
+  if(grand_HDF5open_run(file,runnr,&reader)<0){
+    printf("Cannot read run %d from %s\n",runnr,file);
+    return(-2);
+  }
+  // the table array is reallocated when a table is added: all tables are added first
+  for(it=0;it<3;it++)
+    if(grand_HDF5view_table(table,n_table,event_table[it]) == NULL
+       || grand_HDF5view_table(table,n_table,"Live/Traces") == NULL){
+      grand_HDF5close_run(&reader);
+      return(-3);
+    }
+  strncpy(vf->name,file,VIEW_NAME_LENGTH-1);
+  vf->first_event = grand_HDF5view_table(table,n_table,"EventHeader")->total;
+  vf->first_antenna = grand_HDF5view_table(table,n_table,"AntennaInfo")->total;
+  vf->first_sample = grand_HDF5view_table(table,n_table,"Live/Traces")->total;
+  for(it=0;it<3;it++) first[it] = grand_HDF5view_table(table,n_table,event_table[it])->n_source;
+  for(ievt=0;ievt<reader.n_events && return_code == 1;ievt++){
+    for(it=0;it<3 && return_code == 1;it++){
+      sprintf(path,"Event_%u/raw/%s",reader.eventnr[ievt],event_table[it]);
+      vt = grand_HDF5view_table(table,n_table,event_table[it]);
+      //files converted before the trigger times were reconstructed have no TriggerTime
+      H5E_BEGIN_TRY {
+        nrow = grand_HDF5view_source(vt,reader.run_id,file,runnr,path);
+      } H5E_END_TRY;
+      if(nrow == -2) return_code = -3;
+      else if(nrow == -1 && it<2){
+        printf("Cannot read %s from %s\n",path,file);
+        return_code = -2;
+      }
+    }
+    sprintf(path,"Event_%u",reader.eventnr[ievt]);
+    sprintf(target,"/Run_%d/Event_%u",runnr,reader.eventnr[ievt]);
+    if(return_code == 1 && H5Lexists(view_id,path,H5P_DEFAULT) <= 0)
+      H5Lcreate_external(file,target,view_id,path,H5P_DEFAULT,H5P_DEFAULT);
+  }
+  for(it=0;it<3 && return_code == 1;it++)
+    if(grand_HDF5view_gather(view_id,grand_HDF5view_table(table,n_table,event_table[it]),first[it],ifile,runnr)<0)
+      return_code = -4;
+  for(it=0;it<5 && return_code == 1;it++){
+    if(H5Lexists(reader.run_id,"Live",H5P_DEFAULT) <= 0) break;
+    nrow = grand_HDF5view_source(grand_HDF5view_table(table,n_table,live_view[it][1]),reader.run_id,file,runnr,live_view[it][0]);
+    if(nrow == -2) return_code = -3;
+    else if(nrow == -1){
+      printf("Cannot read %s from %s\n",live_view[it][0],file);
+      return_code = -2;
+    }
+  }
+  if(return_code == 1 && H5Lexists(reader.run_id,"Skipped",H5P_DEFAULT)>0
+     && grand_HDF5view_source(grand_HDF5view_table(table,n_table,"Skipped"),reader.run_id,file,runnr,"Skipped")<0)
+    return_code = -2;
+  if(return_code == 1 && (grand_HDF5view_group(table,n_table,reader.run_id,file,runnr,"Periodic") == -2
+                          || grand_HDF5view_group(table,n_table,reader.run_id,file,runnr,"Monitor") == -2))
+    return_code = -3;
+  vf->n_events = grand_HDF5view_table(table,n_table,"EventHeader")->total-vf->first_event;
+  vf->n_antennas = grand_HDF5view_table(table,n_table,"AntennaInfo")->total-vf->first_antenna;
+  //the run header is the same in all files, link it from the first
+  if(return_code == 1 && header && (names = malloc(VIEW_NAME_LENGTH)) != NULL){
+    names[0][0] = 0;
+    H5Literate(reader.run_id,H5_INDEX_NAME,H5_ITER_INC,NULL,grand_HDF5collect_datasets,&names);
+    for(n=0;names != NULL && names[n][0] != 0;n++){
+      //the skipped ranges are per file, they are concatenated above
+      if(strcmp(names[n],"Skipped") == 0) continue;
+      sprintf(target,"/Run_%d/%s",runnr,names[n]);
+      H5Lcreate_external(file,target,view_id,names[n],H5P_DEFAULT,H5P_DEFAULT);
+    }
+    if(names != NULL) free(names);
+  }
+  grand_HDF5close_run(&reader);
+  return(return_code);
+}
+
+/**
+ * \brief Write the Files table of a view, it grows when files are added to the view
+ * @param[in] run_id: the run group of the view
+ * @param[in] vf: the rows
+ * @param[in] n: the number of rows
+ * \return 1: all ok
+ * \return -1: the table cannot be written
+ */
+int grand_HDF5view_files(hid_t run_id,ViewFile *vf,hsize_t n)
+{
+  hid_t space,plist,data_set;
+  hsize_t dim[1],max_dim[1]={H5S_UNLIMITED};
+  int return_code = 1;
+
+  dim[0] = n;
+  space = H5Screate_simple(1,dim,max_dim);
+  plist = H5Pcreate(H5P_DATASET_CREATE);
+  dim[0] = 64;
+  H5Pset_chunk(plist,1,dim);
+  if((data_set = H5Dcreate(run_id,"Files",t_view_file,space,H5P_DEFAULT,plist,H5P_DEFAULT))<0
+     || H5Dwrite(data_set,t_view_file,H5S_ALL,H5S_ALL,H5P_DEFAULT,vf)<0) return_code = -1;
+  if(data_set>=0) H5Dclose(data_set);
+  H5Pclose(plist);
+  H5Sclose(space);
+  return(return_code);
+}
+
+/**
+ * \brief Build the run-wide view of the HDF5 files of a run
+ * @param[in] viewname: the HDF5 file of the view, it is overwritten
+ * @param[in] runnr: the run number
+ * @param[in] n_files: the number of source files
+ * @param[in] files: the source files, in the order of their file sequence
+ * \return 1: all ok
+ * \return -1: the view cannot be created
+ * \return -2: a source file cannot be read
+ * \return -3: not enough memory
+ * \return -4: a virtual table cannot be created
+ */
+int grand_HDF5create_run_view(char *viewname,int runnr,int n_files,char **files)
+{
+  ViewTable *table = NULL;
+  ViewFile *vf;
+  int n_table = 0;
+  char path[VIEW_NAME_LENGTH];
+  hid_t fapl,file_id,run_id;
+  int ifile,it;
+  int return_code = 1;
+
+  if(n_files<1) return(-1);
+  if((vf = (ViewFile *)calloc(n_files,sizeof(ViewFile))) == NULL) return(-3);
+  grand_HDF5create_compounds();
+  grand_HDF5create_view_file();
+  //virtual datasets need the 1.10 file format
+  fapl = grand_HDF5file_access(GRAND_PROFILE_LATEST);
+  file_id = H5Fcreate(viewname,H5F_ACC_TRUNC,H5P_DEFAULT,fapl);
+  H5Pclose(fapl);
+  if(file_id<0){
+    printf("Cannot create the view %s\n",viewname);
+    free(vf);
+    return(-1);
+  }
+  sprintf(path,"/Run_%d",runnr);
+  if((run_id = H5Gcreate(file_id,path,H5P_DEFAULT,H5P_DEFAULT,H5P_DEFAULT))<0){
+    H5Fclose(file_id);
+    free(vf);
+    return(-1);
+  }
+  // the event tables of the per-file event groups, then the tables of the Live, Periodic and Monitor groups
+  for(ifile=0;ifile<n_files && return_code == 1;ifile++)
+    return_code = grand_HDF5view_file(&table,&n_table,&vf[ifile],run_id,files[ifile],ifile,runnr,ifile == 0);
+  for(it=0;it<n_table && return_code == 1;it++)
+    if(grand_HDF5view_create(run_id,&table[it])<0) return_code = -4;
+  grand_HDF5view_free(table,n_table);
+  if(return_code == 1 && grand_HDF5view_files(run_id,vf,n_files)<0) return_code = -1;
+  free(vf);
+  H5Gclose(run_id);
+  H5Fclose(file_id);
+  return(return_code);
+}
+
+/**
+ * \brief Append the mappings of a virtual table to the virtual dataset of the same name in a view
+ * The mappings of a virtual dataset are fixed when it is created: the existing
+ * mappings are copied from its creation properties, without opening their
+ * sources, and the dataset is recreated with the new mappings behind them.
+ * @param[in] loc_id: the run group of the view
+ * @param[in] vt: the virtual table with the mappings of the added file
+ * \return >=0: the number of rows in the virtual dataset before the append
+ * \return -1: the virtual dataset cannot be recreated
+ */
+long grand_HDF5view_extend(hid_t loc_id,ViewTable *vt)
+{
+  hid_t old_set,old_dcpl,dcpl,lcpl,vspace,old_vspace,src_space,data_set;
+  hsize_t dim[1]={0},start[1],count[1],lo[1],hi[1];
+  size_t n_map;
+  char file[VIEW_NAME_LENGTH],path[VIEW_NAME_LENGTH];
+  char tmpname[VIEW_NAME_LENGTH+8];
+  htri_t exists;
+  long return_code;
+
+  //a table in a group that the view does not have yet
+  H5E_BEGIN_TRY {
+    exists = H5Lexists(loc_id,vt->name,H5P_DEFAULT);
+  } H5E_END_TRY;
+  if(exists <= 0){
+    if(grand_HDF5view_create(loc_id,vt)<0) return(-1);
+    return(0);
+  }
+  if((old_set = H5Dopen(loc_id,vt->name,H5P_DEFAULT))<0) return(-1);
+  vspace = H5Dget_space(old_set);
+  H5Sget_simple_extent_dims(vspace,dim,NULL);
+  H5Sclose(vspace);
+  return_code = dim[0];
+  if(vt->total == 0){
+    H5Dclose(old_set);
+    return(return_code);
+  }
+  old_dcpl = H5Dget_create_plist(old_set);
+  //the table keeps all members of the existing and the new sources
+  vt->type = grand_HDF5view_type(H5Dget_type(old_set),vt->type);
+  H5Dclose(old_set);
+  dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  dim[0] = return_code+vt->total;
+  vspace = H5Screate_simple(1,dim,NULL);
+  if(H5Pget_virtual_count(old_dcpl,&n_map)<0) return_code = -1;
+  for(size_t imap=0;imap<n_map && return_code>=0;imap++){
+    old_vspace = H5Pget_virtual_vspace(old_dcpl,imap);
+    H5Pget_virtual_filename(old_dcpl,imap,file,VIEW_NAME_LENGTH);
+    H5Pget_virtual_dsetname(old_dcpl,imap,path,VIEW_NAME_LENGTH);
+    H5Sget_select_bounds(old_vspace,lo,hi);
+    start[0] = lo[0];
+    count[0] = hi[0]-lo[0]+1;
+    //every source is mapped as a whole; its extent is not kept in the file, only the selection
+    src_space = H5Screate_simple(1,count,NULL);
+    H5Sselect_hyperslab(vspace,H5S_SELECT_SET,start,NULL,count,NULL);
+    if(H5Pset_virtual(dcpl,vspace,file,path,src_space)<0) return_code = -1;
+    H5Sclose(src_space);
+    H5Sclose(old_vspace);
+  }
+  H5Pclose(old_dcpl);
+  start[0] = dim[0]-vt->total;
+  for(int isrc=0;isrc<vt->n_source && return_code>=0;isrc++){
+    src_space = H5Screate_simple(1,&vt->count[isrc],NULL);
+    H5Sselect_hyperslab(vspace,H5S_SELECT_SET,start,NULL,&vt->count[isrc],NULL);
+    if(H5Pset_virtual(dcpl,vspace,vt->file[isrc],vt->path[isrc],src_space)<0) return_code = -1;
+    H5Sclose(src_space);
+    start[0] += vt->count[isrc];
+  }
+  H5Sselect_all(vspace);
+  if(return_code>=0){
+    lcpl = H5Pcreate(H5P_LINK_CREATE);
+    H5Pset_create_intermediate_group(lcpl,1);
+    snprintf(tmpname,sizeof(tmpname),"%s_new",vt->name);
+    if((data_set = H5Dcreate(loc_id,tmpname,vt->type,vspace,lcpl,dcpl,H5P_DEFAULT))<0
+       || H5Ldelete(loc_id,vt->name,H5P_DEFAULT)<0 || H5Lmove(loc_id,tmpname,loc_id,vt->name,H5P_DEFAULT,H5P_DEFAULT)<0){
+      printf("Cannot extend the virtual table %s\n",vt->name);
+      return_code = -1;
+    }
+    if(data_set>=0) H5Dclose(data_set);
+    H5Pclose(lcpl);
+  }
+  H5Sclose(vspace);
+  H5Pclose(dcpl);
+  return(return_code);
+}
+
+/**
+ * \brief Add a converted file to the run-wide view: only the mappings of the new file are added
+ * @param[in] viewname: the HDF5 file of the view, it is created if it does not exist
+ * @param[in] runnr: the run number
+ * @param[in] hdfname: the converted file
+ * \return 1: all ok
+ * \return 0: the file is already in the view
+ * \return see grand_HDF5create_run_view for the errors
+ */
+int grand_HDF5add_to_run_view(char *viewname,int runnr,char *hdfname)
+{
+  ViewTable *table = NULL;
+  ViewFile *vf = NULL;
+  ViewFile added;
+  int n_table = 0;
+  char buf[100];
+  hid_t fapl,file_id,run_id,data_set,space,mem_space;
+  hsize_t dim[1]={0},start[1],count[1]={1};
+  long offset;
+  int it;
+  int return_code = 1;
+
+  grand_HDF5create_compounds();
+  grand_HDF5create_view_file();
+  fapl = grand_HDF5file_access(GRAND_PROFILE_LATEST);
+  H5E_BEGIN_TRY {
+    file_id = H5Fopen(viewname,H5F_ACC_RDWR,fapl);
+  } H5E_END_TRY;
+  H5Pclose(fapl);
+  if(file_id<0) return(grand_HDF5create_run_view(viewname,runnr,1,&hdfname));
+  sprintf(buf,"/Run_%d",runnr);
+  H5E_BEGIN_TRY {
+    run_id = H5Gopen(file_id,buf,H5P_DEFAULT);
+    data_set = run_id<0?-1:H5Dopen(run_id,"Files",H5P_DEFAULT);
+  } H5E_END_TRY;
+  if(data_set<0){
+    if(run_id>=0) H5Gclose(run_id);
+    H5Fclose(file_id);
+    return(grand_HDF5create_run_view(viewname,runnr,1,&hdfname));
+  }
+  space = H5Dget_space(data_set);
+  H5Sget_simple_extent_dims(space,dim,NULL);
+  H5Sclose(space);
+  if((vf = (ViewFile *)calloc(dim[0]+1,sizeof(ViewFile))) == NULL
+     || H5Dread(data_set,t_view_file,H5S_ALL,H5S_ALL,H5P_DEFAULT,vf)<0) return_code = -1;
+  for(hsize_t ifile=0;ifile<dim[0] && return_code == 1;ifile++)
+    if(strcmp(vf[ifile].name,hdfname) == 0) return_code = 0;
+  memset((void *)&added,0,sizeof(ViewFile));
+  if(return_code == 1) return_code = grand_HDF5view_file(&table,&n_table,&added,run_id,hdfname,dim[0],runnr,0);
+  for(it=0;it<n_table && return_code == 1;it++){
+    if((offset = grand_HDF5view_extend(run_id,&table[it]))<0) return_code = -4;
+    // the offsets of the new file are relative to the rows of the view before the append
+    else if(strcmp(table[it].name,"EventHeader") == 0) added.first_event += offset;
+    else if(strcmp(table[it].name,"AntennaInfo") == 0) added.first_antenna += offset;
+    else if(strcmp(table[it].name,"Live/Traces") == 0) added.first_sample += offset;
+  }
+  grand_HDF5view_free(table,n_table);
+  if(return_code == 1){
+    start[0] = dim[0];
+    dim[0]++;
+    if(H5Dset_extent(data_set,dim)<0) return_code = -1;
+    else{
+      space = H5Dget_space(data_set);
+      mem_space = H5Screate_simple(1,count,NULL);
+      H5Sselect_hyperslab(space,H5S_SELECT_SET,start,NULL,count,NULL);
+      if(H5Dwrite(data_set,t_view_file,mem_space,space,H5P_DEFAULT,&added)<0) return_code = -1;
+      H5Sclose(mem_space);
+      H5Sclose(space);
+    }
+  }
+  free(vf);
+  if(data_set>=0) H5Dclose(data_set);
+  H5Gclose(run_id);
+  H5Fclose(file_id);
+  return(return_code);
+}
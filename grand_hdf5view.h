@@ -0,0 +1,37 @@
+/** \file grand_hdf5view.h
+ *  \brief run-wide virtual view of the HDF5 files of the file sequences of a run
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_HDF5VIEW_H
+#define GRAND_HDF5VIEW_H
+
+#define VIEW_NAME_LENGTH 256 /**< maximal length of file and dataset names in a view */
+
+typedef struct{
+  char name[VIEW_NAME_LENGTH];
+  unsigned long long first_event;
+  unsigned long long n_events;
+  unsigned long long first_antenna;
+  unsigned long long n_antennas;
+  unsigned long long first_sample;
+}ViewFile;
+
+typedef struct{
+  char name[VIEW_NAME_LENGTH];
+  hid_t type;
+  int n_source;
+  int n_alloc;
+  char (*file)[VIEW_NAME_LENGTH];
+  char (*path)[VIEW_NAME_LENGTH];
+  hsize_t *count;
+  hsize_t total;
+}ViewTable;
+
+int grand_HDF5create_run_view(char *viewname,int runnr,int n_files,char **files);
+int grand_HDF5add_to_run_view(char *viewname,int runnr,char *hdfname);
+
+#endif
@@ -0,0 +1,52 @@
+/** \file grand_layout.c
+ *  \brief decode routines of the electronics data, one per event format version
+ *
+ *  The routines are generated from the tables in grand_layout.h. All loads
+ *  go through memcpy, so unaligned fields are read without undefined
+ *  behaviour, and with constant offsets the compiler turns them into plain
+ *  moves. The layout is looked up once per local station block.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+
+#define GRAND_DECODE_FIELD(member,type,h5type,name,offset,count) \
+  for(int i=0;i<count;i++) GRAND_LOAD(type,((type *)&ah->member)[i],&raw[(offset)+i*sizeof(type)]);
+
+#define GRAND_DECODER(version,pps,adc)                                   \
+  static void grand_decode_v##version(const char *raw,AntHdr *ah)       \
+  {                                                                     \
+    const int pps_offset = (pps);                                       \
+    (void)pps_offset;                                                   \
+    GRAND_ANTENNA_FIELDS(GRAND_DECODE_FIELD)                            \
+  }
+GRAND_EVENT_LAYOUTS(GRAND_DECODER)
+
+#define GRAND_LAYOUT_ENTRY(version,pps,adc) {version,pps,adc,grand_decode_v##version},
+static const EventLayout grand_layouts[] = {GRAND_EVENT_LAYOUTS(GRAND_LAYOUT_ENTRY)};
+#define GRAND_N_LAYOUTS (sizeof(grand_layouts)/sizeof(EventLayout))
+
+/**
+ * \brief Find the layout of the electronics data of a local station
+ * @param[in] eb: the local station data
+ * \return the layout of its version; unknown versions, or data without version,
+ *  use the layout with the ADC data at EVENT_ADC
+ */
+const EventLayout *grand_event_layout(EventBody *eb)
+{
+  static const EventLayout *build_default = NULL;
+  int il;
+
+#ifdef USE_EVENT_VERSION
+  for(il=0;il<GRAND_N_LAYOUTS;il++)
+    if(grand_layouts[il].version == eb->version) return(&grand_layouts[il]);
+#endif
+  if(build_default == NULL){
+    build_default = &grand_layouts[0];
+    for(il=0;il<GRAND_N_LAYOUTS;il++)
+      if(grand_layouts[il].adc_offset == EVENT_ADC) build_default = &grand_layouts[il];
+  }
+  return(build_default);
+}
@@ -0,0 +1,53 @@
+/** \file grand_layout.h
+ *  \brief layout of the electronics data of a local station per event format version
+ *
+ *  The tables below are X-macros: GRAND_EVENT_LAYOUTS lists the event format
+ *  versions, GRAND_ANTENNA_FIELDS the antenna header fields decoded from the
+ *  electronics header. grand_layout.c expands them into one decode routine
+ *  per version, with the offsets as compile-time constants, and the antenna
+ *  header compound type is built from the same field table.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_LAYOUT_H
+#define GRAND_LAYOUT_H
+
+/*! event format versions: version, offset of the PPS block, offset of the ADC data, in bytes */
+#define GRAND_EVENT_LAYOUTS(L) \
+  L(1, PPS_GPS, 344)           \
+  L(2, PPS_GPS, 472)
+
+/*! antenna header fields: member of AntHdr, C type, HDF5 type, name in the file, offset, count.
+    pps_offset is the offset of the PPS block of the version being decoded */
+#define GRAND_ANTENNA_FIELDS(F)                                                                \
+  F(year,          short,          H5T_NATIVE_SHORT,  "year",            EVENT_GPS,      1)    \
+  F(month,         char,           H5T_NATIVE_CHAR,   "month",           EVENT_GPS+2,    1)    \
+  F(day,           char,           H5T_NATIVE_CHAR,   "day",             EVENT_GPS+3,    1)    \
+  F(hour,          char,           H5T_NATIVE_CHAR,   "hour",            EVENT_GPS+4,    1)    \
+  F(minute,        char,           H5T_NATIVE_CHAR,   "minute",          EVENT_GPS+5,    1)    \
+  F(sec,           char,           H5T_NATIVE_CHAR,   "second",          EVENT_GPS+6,    1)    \
+  F(status,        char,           H5T_NATIVE_CHAR,   "elec_status",     EVENT_STATUS,   1)    \
+  F(ctd,           unsigned int,   H5T_NATIVE_UINT,   "ctd",             EVENT_CTD,      1)    \
+  F(gps_quant,     float,          H5T_NATIVE_FLOAT,  "gps_quant",       EVENT_QUANT1,   2)    \
+  F(ctp,           unsigned int,   H5T_NATIVE_UINT,   "ctp",             EVENT_CTP,      1)    \
+  F(sync,          unsigned short, H5T_NATIVE_USHORT, "synchronization", EVENT_SYNC,     1)    \
+  F(temperature,   float,          H5T_NATIVE_FLOAT,  "temperature",     pps_offset+36,  1)    \
+  F(gps_longitude, double,         H5T_NATIVE_DOUBLE, "gps_longitude",   pps_offset+12,  1)    \
+  F(gps_latitude,  double,         H5T_NATIVE_DOUBLE, "gps_latitude",    pps_offset+20,  1)    \
+  F(gps_altitude,  double,         H5T_NATIVE_DOUBLE, "gps_altitude",    pps_offset+28,  1)
+
+/*! load a value from an unaligned position in the raw data */
+#define GRAND_LOAD(type,dst,src) memcpy(&(dst),(src),sizeof(type))
+
+typedef struct{
+  unsigned short version;
+  int pps_offset;
+  int adc_offset;
+  void (*decode)(const char *raw,AntHdr *ah);
+}EventLayout;
+
+const EventLayout *grand_event_layout(EventBody *eb);
+
+#endif
@@ -23,3 +23,81 @@ double rad_earth(float latitude)
     radius = sqrt(radius);
     return(radius);
 }
+
+/**
+ * \brief Convert geodetic positions on the WGS84 ellipsoid to Earth-centered Earth-fixed coordinates
+ *
+ * The arrays are processed in one pass without branches, so the compiler can
+ * vectorize the loop, apart from the sines and cosines.
+ * @param[in] n: number of positions
+ * @param[in] longitude,latitude: in degrees
+ * @param[in] altitude: above the ellipsoid, in m
+ * @param[out] x,y,z: ECEF coordinates in m
+ */
+void grand_geodetic_to_ecef(long n,const double *restrict longitude,const double *restrict latitude,
+                            const double *restrict altitude,double *restrict x,double *restrict y,double *restrict z)
+{
+  double sinlat,coslat,sinlon,coslon,rn;
+
+  for(long i=0;i<n;i++){
+    sinlat = sin(latitude[i]/RADTODEG);
+    coslat = cos(latitude[i]/RADTODEG);
+    sinlon = sin(longitude[i]/RADTODEG);
+    coslon = cos(longitude[i]/RADTODEG);
+    rn = WGS84_A/sqrt(1.-WGS84_E2*sinlat*sinlat);
+    x[i] = (rn+altitude[i])*coslat*coslon;
+    y[i] = (rn+altitude[i])*coslat*sinlon;
+    z[i] = (rn*(1.-WGS84_E2)+altitude[i])*sinlat;
+  }
+}
+
+/**
+ * \brief Set the origin of a local East-North-Up frame
+ * @param[out] origin: the origin with its ECEF position and rotation
+ * @param[in] longitude,latitude: in degrees
+ * @param[in] altitude: above the ellipsoid, in m
+ */
+void grand_geo_origin(GeoOrigin *origin,double longitude,double latitude,double altitude)
+{
+  origin->longitude = longitude;
+  origin->latitude = latitude;
+  origin->altitude = altitude;
+  grand_geodetic_to_ecef(1,&longitude,&latitude,&altitude,&origin->x,&origin->y,&origin->z);
+  origin->sinlon = sin(longitude/RADTODEG);
+  origin->coslon = cos(longitude/RADTODEG);
+  origin->sinlat = sin(latitude/RADTODEG);
+  origin->coslat = cos(latitude/RADTODEG);
+}
+
+/**
+ * \brief Convert geodetic positions to a local East-North-Up frame
+ *
+ * The positions are first converted to ECEF, in the output arrays, after which
+ * the translation and rotation to the local frame are done in place in a second
+ * loop of multiplications and additions only. The result is exact on the
+ * ellipsoid, also for fields of hundreds of km.
+ * @param[in] origin: the origin of the frame, from grand_geo_origin
+ * @param[in] n: number of positions
+ * @param[in] longitude,latitude: in degrees
+ * @param[in] altitude: above the ellipsoid, in m
+ * @param[out] east,north,up: local coordinates in m
+ */
+void grand_geodetic_to_enu(const GeoOrigin *origin,long n,
+                           const double *longitude,const double *latitude,const double *altitude,
+                           double *restrict east,double *restrict north,double *restrict up)
+{
+  const double sinlon = origin->sinlon,coslon = origin->coslon;
+  const double sinlat = origin->sinlat,coslat = origin->coslat;
+  const double x0 = origin->x,y0 = origin->y,z0 = origin->z;
+  double dx,dy,dz;
+
+  grand_geodetic_to_ecef(n,longitude,latitude,altitude,east,north,up);
+  for(long i=0;i<n;i++){
+    dx = east[i]-x0;
+    dy = north[i]-y0;
+    dz = up[i]-z0;
+    east[i] = -sinlon*dx+coslon*dy;
+    north[i] = -sinlat*coslon*dx-sinlat*sinlon*dy+coslat*dz;
+    up[i] = coslat*coslon*dx+coslat*sinlon*dy+sinlat*dz;
+  }
+}
@@ -10,4 +10,21 @@
 
 #define RADTODEG 57.295779513082325 /**<Conversion radians to degrees */
 
+#define WGS84_A 6378137.0                          /**< semi-major axis of the WGS84 ellipsoid */
+#define WGS84_F (1./298.257223563)                 /**< flattening of the WGS84 ellipsoid */
+#define WGS84_E2 (WGS84_F*(2.-WGS84_F))            /**< first eccentricity squared */
+
+/*! origin of a local East-North-Up frame, with its rotation precomputed */
+typedef struct{
+  double longitude,latitude,altitude;
+  double x,y,z;
+  double sinlon,coslon,sinlat,coslat;
+}GeoOrigin;
+
 double rad_earth(float latitude);
+void grand_geo_origin(GeoOrigin *origin,double longitude,double latitude,double altitude);
+void grand_geodetic_to_ecef(long n,const double *longitude,const double *latitude,const double *altitude,
+                            double *x,double *y,double *z);
+void grand_geodetic_to_enu(const GeoOrigin *origin,long n,
+                           const double *longitude,const double *latitude,const double *altitude,
+                           double *east,double *north,double *up);
@@ -0,0 +1,420 @@
+/** \file grand_mpi.c
+ *  \brief conversion of a file sequence by several MPI ranks into one shared file (make MPI=1)
+ *
+ *  All ranks open the same output with the MPI-IO driver. Every rank scans
+ *  the event headers of the AD file, which is cheap, and decodes only its
+ *  own events: the file is cut in ranges of MPI_BLOCK_EVENTS events that
+ *  are dealt to the ranks in turn. Creating, extending and closing objects
+ *  is collective in parallel HDF5, so the events are not written to event
+ *  groups but to the run-level tables of the single-writer/multiple-reader
+ *  layout (Live/EventHeader, AntennaInfo, TriggerTime, TraceIndex and
+ *  Traces), which grand_HDF5open_live and grand_HDF5poll_live read.
+ *  After a round every rank knows the rows of all ranks from an exclusive
+ *  scan; the tables are extended once and every rank writes its hyperslab
+ *  in one collective write, so the rows stay in event order. The periodic
+ *  triggers of the TD file and the quality counts are the same on all
+ *  ranks; the skipped ranges of the AD file are gathered from all ranks,
+ *  as only the rank that decodes an event sees its corrupted local
+ *  stations. They are written collectively; trigger rates,
+ *  spectra, previews and the antenna-major layout are not written.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <time.h>
+#include "grand_hdf5.h"
+
+#ifdef GRAND_USE_MPI
+extern hid_t t_event_header;
+extern hid_t t_antenna_header;
+extern hid_t t_trigger_time;
+extern hid_t t_live_trace;
+extern hid_t p_transfer;
+extern char *live_name[5];
+extern QualityCounts quality_counts;
+
+/*! the ranks that write the files created afterwards, MPI_COMM_NULL for a serial file */
+MPI_Comm grand_comm = MPI_COMM_NULL;
+int mpi_rank = 0;
+int mpi_size = 1;
+/*! seconds spent in the collective writes of the last conversion */
+double mpi_write_seconds = 0;
+
+/**
+ * \brief Select the ranks that write the files created afterwards
+ * @param[in] comm: the communicator of the ranks, MPI_COMM_NULL for a serial file
+ * \return 1: all ok
+ * \return -1: the transfer properties cannot be created
+ */
+int grand_HDF5set_mpi(MPI_Comm comm)
+{
+  if(p_transfer != H5P_DEFAULT) H5Pclose(p_transfer);
+  p_transfer = H5P_DEFAULT;
+  grand_comm = comm;
+  mpi_rank = 0;
+  mpi_size = 1;
+  if(comm == MPI_COMM_NULL) return(1);
+  MPI_Comm_rank(comm,&mpi_rank);
+  MPI_Comm_size(comm,&mpi_size);
+  //filtered tables can only be written collectively
+  if((p_transfer = H5Pcreate(H5P_DATASET_XFER))<0 || H5Pset_dxpl_mpio(p_transfer,H5FD_MPIO_COLLECTIVE)<0){
+    p_transfer = H5P_DEFAULT;
+    return(-1);
+  }
+  return(1);
+}
+
+/**
+ * \brief Add the MPI-IO driver to the file access properties of a profile
+ * @param[in] fapl: the properties of the profile, H5P_DEFAULT for the default profile
+ * \return the properties for the selected ranks, fapl itself for a serial file
+ */
+hid_t grand_HDF5mpi_access(hid_t fapl)
+{
+  if(grand_comm == MPI_COMM_NULL) return(fapl);
+  if(fapl == H5P_DEFAULT && (fapl = H5Pcreate(H5P_FILE_ACCESS))<0) return(H5P_DEFAULT);
+  //replaces the core driver; the page buffer is not available in parallel
+  H5Pset_fapl_mpio(fapl,grand_comm,MPI_INFO_NULL);
+  H5Pset_page_buffer_size(fapl,0,0,0);
+  H5Pset_all_coll_metadata_ops(fapl,1);
+  H5Pset_coll_metadata_write(fapl,1);
+  return(fapl);
+}
+
+/**
+ * \brief Copy the traces of an antenna row to the buffer of the round
+ * @param[in,out] b: the buffer
+ * @param[in] ev: the decoded event
+ * @param[in] ic: the antenna row, its traces are only needed during this call
+ * \return 1: all ok
+ * \return -1: not enough memory
+ */
+int grand_mpi_antenna(MpiBuffer *b,GrandEvent *ev,int ic)
+{
+  TraceSlice *slice = &ev->slice[ic];
+  LiveTrace *lt;
+  void *p;
+  long n = 0,size;
+
+  if(b->n_rows+ic >= b->rows_alloc){
+    size = 2*(b->n_rows+ev->header->LSCNT);
+    if((p = realloc(b->index,size*sizeof(LiveTrace))) == NULL) return(-1);
+    b->index = p;
+    if((p = realloc(b->ah,size*sizeof(AntHdr))) == NULL) return(-1);
+    b->ah = p;
+    if((p = realloc(b->tt,size*sizeof(TriggerTime))) == NULL) return(-1);
+    b->tt = p;
+    b->rows_alloc = size;
+  }
+  for(int itrace=0;itrace<3;itrace++) if(slice->trace[itrace] != NULL) n += slice->length[itrace];
+  if(b->n_samples+n>b->samples_alloc){
+    size = 2*(b->n_samples+n);
+    if((p = realloc(b->samples,size*SHORTSIZE)) == NULL) return(-1);
+    b->samples = p;
+    b->samples_alloc = size;
+  }
+  lt = &b->index[b->n_rows+ic];
+  memset((void *)lt,0,sizeof(LiveTrace));
+  lt->event_nr = ev->header->eventnr;
+  lt->antenna_id = ev->iant[ic]+1;
+  //offset in the samples of the round, moved to the table in grand_HDF5mpi_flush
+  lt->offset = b->n_samples;
+  for(int itrace=0;itrace<3;itrace++){
+    if(slice->trace[itrace] == NULL) continue;
+    lt->length[itrace] = slice->length[itrace];
+    memcpy(&b->samples[b->n_samples],slice->trace[itrace],slice->length[itrace]*SHORTSIZE);
+    b->n_samples += slice->length[itrace];
+  }
+  return(1);
+}
+
+/**
+ * \brief Add the headers of a decoded event to the buffer of the round, after its antenna rows
+ * @param[in,out] b: the buffer
+ * @param[in] ev: the decoded event
+ * \return 1: all ok
+ * \return -1: not enough memory
+ */
+int grand_mpi_event(MpiBuffer *b,GrandEvent *ev)
+{
+  void *p;
+
+  if(b->n_events == b->events_alloc){
+    if((p = realloc(b->header,(b->events_alloc+MPI_BLOCK_EVENTS)*sizeof(EventHeader))) == NULL) return(-1);
+    b->header = p;
+    b->events_alloc += MPI_BLOCK_EVENTS;
+  }
+  b->header[b->n_events++] = *ev->header;
+  if(ev->n>0){
+    memcpy(&b->ah[b->n_rows],ev->ah,ev->n*sizeof(AntHdr));
+    memcpy(&b->tt[b->n_rows],ev->tt,ev->n*sizeof(TriggerTime));
+    b->n_rows += ev->n;
+  }
+  return(1);
+}
+
+/**
+ * \brief Append the rows of all ranks to a shared table, collectively
+ * @param[in] data_set: the table
+ * @param[in] type: the HDF5 type of the rows
+ * @param[in,out] size: the rows of the table, the total of all ranks is added
+ * @param[in] offset: the rows of the lower ranks
+ * @param[in] n: the rows of this rank
+ * @param[in] total: the rows of all ranks
+ * @param[in] buf: the rows of this rank
+ * \return 1: all ok
+ * \return 0: no rank has rows
+ * \return -2: the rows cannot be written
+ */
+int grand_HDF5mpi_append(hid_t data_set,hid_t type,hsize_t *size,long offset,long n,long total,const void *buf)
+{
+  hid_t mem_space,file_space;
+  hsize_t dim[1],start[1],count[1];
+  int return_code = 1;
+
+  if(total <= 0) return(0);
+  dim[0] = *size+total;
+  if(H5Dset_extent(data_set,dim)<0) return(-2);
+  start[0] = *size+offset;
+  count[0] = n>0?n:1;
+  mem_space = H5Screate_simple(1,count,NULL);
+  file_space = H5Dget_space(data_set);
+  //a rank without rows still takes part in the collective write
+  if(n>0) H5Sselect_hyperslab(file_space,H5S_SELECT_SET,start,NULL,count,NULL);
+  else{
+    H5Sselect_none(file_space);
+    H5Sselect_none(mem_space);
+  }
+  //nothing is read from the buffer of an empty selection, but it must not be NULL
+  if(H5Dwrite(data_set,type,mem_space,file_space,p_transfer,n>0?buf:(const void *)dim)<0) return_code = -2;
+  H5Sclose(file_space);
+  H5Sclose(mem_space);
+  *size = dim[0];
+  return(return_code);
+}
+
+/**
+ * \brief Write the rows that all ranks decoded in a round and empty the buffer, collectively
+ * @param[in] table: the EventHeader, AntennaInfo, TriggerTime, TraceIndex and Traces tables
+ * @param[in,out] b: the buffer of this rank
+ * \return 1: all ok
+ * \return -2: a table cannot be written
+ */
+int grand_HDF5mpi_flush(hid_t *table,MpiBuffer *b)
+{
+  long n[MPI_N_TABLES] = {b->n_events,b->n_rows,b->n_rows,b->n_rows,b->n_samples};
+  long offset[MPI_N_TABLES] = {0,0,0,0,0};
+  long total[MPI_N_TABLES];
+  hid_t type[MPI_N_TABLES] = {t_event_header,t_antenna_header,t_trigger_time,t_live_trace,H5T_NATIVE_SHORT};
+  void *buf[MPI_N_TABLES] = {b->header,b->ah,b->tt,b->index,b->samples};
+  int return_code = 1;
+
+  MPI_Exscan(n,offset,MPI_N_TABLES,MPI_LONG,MPI_SUM,grand_comm);
+  if(mpi_rank == 0) memset((void *)offset,0,sizeof(offset));
+  MPI_Allreduce(n,total,MPI_N_TABLES,MPI_LONG,MPI_SUM,grand_comm);
+  for(int i=0;i<b->n_rows;i++) b->index[i].offset += b->size[4]+offset[4];
+  for(int i=0;i<MPI_N_TABLES;i++){
+    if(grand_HDF5mpi_append(table[i],type[i],&b->size[i],offset[i],n[i],total[i],buf[i])<0) return_code = -2;
+  }
+  b->n_events = 0;
+  b->n_rows = 0;
+  b->n_samples = 0;
+  return(return_code);
+}
+
+/**
+ * \brief qsort comparison of skipped ranges on their position in the file
+ */
+int grand_mpi_sort_skipped(const void *a,const void *b)
+{
+  const SkippedRange *ra = (const SkippedRange *)a;
+  const SkippedRange *rb = (const SkippedRange *)b;
+
+  if(ra->start != rb->start) return(ra->start<rb->start?-1:1);
+  if(ra->end != rb->end) return(ra->end<rb->end?-1:1);
+  return(0);
+}
+
+/**
+ * \brief Collect the skipped ranges of all ranks. The ranges of corrupted headers are found by every
+ * rank, those inside the local stations of an event only by the rank that decodes it.
+ * @param[in] r: the reader of the rank
+ * @param[out] n: the number of ranges, -1 when there is not enough memory on a rank
+ * \return the ranges of all ranks in file order without duplicates, the same on all ranks, to be freed
+ */
+SkippedRange *grand_mpi_skipped(BinReader *r,int *n)
+{
+  int size = r->n_skipped*sizeof(SkippedRange);
+  int *count,*offset;
+  int total = 0,ok,m = 0;
+  SkippedRange *all = NULL;
+
+  *n = -1;
+  //a rank that fails an allocation may not leave the others waiting in the gather
+  ok = (count = (int *)malloc(2*mpi_size*sizeof(int))) != NULL;
+  MPI_Allreduce(MPI_IN_PLACE,&ok,1,MPI_INT,MPI_MIN,grand_comm);
+  if(!ok){
+    free(count);
+    return(NULL);
+  }
+  offset = &count[mpi_size];
+  MPI_Allgather(&size,1,MPI_INT,count,1,MPI_INT,grand_comm);
+  for(int i=0;i<mpi_size;i++){
+    offset[i] = total;
+    total += count[i];
+  }
+  ok = total == 0 || (all = (SkippedRange *)malloc(total)) != NULL;
+  MPI_Allreduce(MPI_IN_PLACE,&ok,1,MPI_INT,MPI_MIN,grand_comm);
+  if(ok){
+    MPI_Allgatherv(r->skipped,size,MPI_BYTE,all,count,offset,MPI_BYTE,grand_comm);
+    qsort(all,total/sizeof(SkippedRange),sizeof(SkippedRange),grand_mpi_sort_skipped);
+    for(int i=0;i<total/(int)sizeof(SkippedRange);i++){
+      if(m == 0 || grand_mpi_sort_skipped(&all[m-1],&all[i]) != 0) all[m++] = all[i];
+    }
+    *n = m;
+  }
+  free(count);
+  return(all);
+}
+
+/**
+ * \brief Convert the AD and TD files of a file sequence with all ranks selected by grand_HDF5set_mpi, collectively
+ * @param[in] job: what to convert and where to write it; roll-over limits, catalog, view and backend are not used
+ * @param[out] stats: the events of all ranks, the file size and the wall time
+ * \return 1: all ok
+ * \return -2: the output cannot be created or written
+ */
+int grand_mpi_convert(GrandJob *job,GrandJobStats *stats)
+{
+  char filename[VIEW_NAME_LENGTH+30];
+  char hdfname[VIEW_NAME_LENGTH];
+  unsigned short *event;
+  BinReader reader;
+  MpiBuffer b;
+  GrandEvent ev;
+  EventHeader header;
+  EventBody *eb;
+  hid_t file_id,run_id,live_id,table[MPI_N_TABLES];
+  hsize_t chunk[MPI_N_TABLES] = {64,256,256,256,65536};
+  hsize_t bytes = 0;
+  hid_t type[4];
+  long k = 0,round = 0;
+  int readlength,ic,opened,done,all_done,error = 0;
+  SkippedRange *skipped;
+  int n_skipped;
+  int return_code = 1;
+  struct timespec t0,t1,t2;
+
+  clock_gettime(CLOCK_MONOTONIC,&t0);
+  memset((void *)stats,0,sizeof(GrandJobStats));
+  memset((void *)&ev,0,sizeof(GrandEvent));
+  memset((void *)&b,0,sizeof(MpiBuffer));
+  mpi_write_seconds = 0;
+  grand_job_outname(job,hdfname,sizeof(hdfname));
+  if(grand_HDF5create_file(hdfname,job->runnr,&file_id,&run_id)<0){
+    if(mpi_rank == 0) printf("Cannot create %s\n",hdfname);
+    return(-2);
+  }
+  grand_HDF5create_run_structure(run_id);
+  type[0] = t_event_header;
+  type[1] = t_antenna_header;
+  type[2] = t_trigger_time;
+  type[3] = t_live_trace;
+  if((live_id = H5Gcreate(run_id,"Live",H5P_DEFAULT,H5P_DEFAULT,H5P_DEFAULT))<0){
+    grand_HDF5close_file(run_id,file_id);
+    return(-2);
+  }
+  for(int i=0;i<4;i++) if((table[i] = grand_HDF5open_table(live_id,live_name[i],type[i],chunk[i]))<0) return_code = -2;
+  if((table[4] = grand_HDF5open_trace_table(live_id,live_name[4],chunk[4]))<0) return_code = -2;
+  H5Gclose(live_id);
+  if(return_code<0){
+    for(int i=0;i<MPI_N_TABLES;i++) if(table[i]>=0) H5Dclose(table[i]);
+    grand_HDF5close_file(run_id,file_id);
+    return(return_code);
+  }
+
+  snprintf(filename,sizeof(filename),"%s/AD/ad%06d.f%04d",job->basedir,job->runnr,job->fileseq);
+  opened = grand_reader_open(&reader,filename)>0;
+  if(opened) grand_reader_file_header(&reader,&readlength);
+  done = !opened;
+  //every rank takes part in every round, also when its file ended or failed
+  do{
+    while(!done && k<(round+1)*mpi_size*MPI_BLOCK_EVENTS){
+      if(grand_reader_event_header(&reader,&header) <= 0){
+        done = 1;
+        break;
+      }
+      if(header.LSCNT<1) continue;
+      if((k++/MPI_BLOCK_EVENTS)%mpi_size != mpi_rank) continue;
+      if(grand_HDF5decode_begin(&header,&ev)<0) error = done = 1;
+      while(!error && (eb = grand_reader_next_ls(&reader)) != NULL){
+        if((ic = grand_HDF5decode_antenna(eb,&ev)) == -2) grand_reader_skip_ls(&reader,eb);
+        else if(ic>=0 && grand_mpi_antenna(&b,&ev,ic)<0) error = done = 1;
+      }
+      if(error) break;
+      grand_HDF5decode_end(&ev);
+      if(grand_mpi_event(&b,&ev)<0){
+        error = done = 1;
+        break;
+      }
+      grand_HDF5quality_count(&ev);
+      stats->n_events++;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    if(grand_HDF5mpi_flush(table,&b)<0) return_code = -2;
+    clock_gettime(CLOCK_MONOTONIC,&t2);
+    mpi_write_seconds += (t2.tv_sec-t1.tv_sec)+1e-9*(t2.tv_nsec-t1.tv_nsec);
+    round++;
+    MPI_Allreduce(&done,&all_done,1,MPI_INT,MPI_MIN,grand_comm);
+  }while(!all_done);
+  if(error){
+    printf("Rank %d: not enough memory for the events of round %ld\n",mpi_rank,round);
+    return_code = -2;
+  }
+  //every rank writes the ranges of all ranks, the extensions of the table are collective
+  if((skipped = grand_mpi_skipped(&reader,&n_skipped)) == NULL && n_skipped<0) return_code = -2;
+  for(int i=0;i<n_skipped;i++){
+    skipped[i].source = 0;
+    if(grand_HDF5write_skipped(run_id,&skipped[i])<0) return_code = -2;
+  }
+  if(n_skipped>0) stats->n_skipped = n_skipped;
+  free(skipped);
+  if(opened) grand_reader_close(&reader);
+  for(int i=0;i<MPI_N_TABLES;i++) H5Dclose(table[i]);
+
+  //the periodic triggers are few: all ranks convert them, with the same collective calls
+  snprintf(filename,sizeof(filename),"%s/TD/td%06d.f%04d",job->basedir,job->runnr,job->fileseq);
+  if(grand_reader_open(&reader,filename)>0) {
+    grand_reader_file_header(&reader,&readlength);
+    while((event = grand_reader_event(&reader,&readlength))!= NULL){
+      if(((EventHeader *)event)->LSCNT<1)continue;
+      grand_HDF5fill_periodic_event(run_id,event);
+      stats->n_periodic++;
+    }
+    for(int i=0;i<reader.n_skipped;i++){
+      reader.skipped[i].source = 1;
+      grand_HDF5write_skipped(run_id,&reader.skipped[i]);
+    }
+    stats->n_skipped += reader.n_skipped;
+    grand_reader_close(&reader);
+  }
+  MPI_Allreduce(MPI_IN_PLACE,&quality_counts,1+GRAND_N_QUALITY,MPI_UNSIGNED_LONG_LONG,MPI_SUM,grand_comm);
+  MPI_Allreduce(MPI_IN_PLACE,&stats->n_events,1,MPI_LONG,MPI_SUM,grand_comm);
+  MPI_Allreduce(MPI_IN_PLACE,&return_code,1,MPI_INT,MPI_MIN,grand_comm);
+  grand_HDF5fill_runheader(run_id);
+  H5Fget_filesize(file_id,&bytes);
+  grand_HDF5close_file(run_id,file_id);
+  grand_free_event(&ev);
+  free(b.header);
+  free(b.ah);
+  free(b.tt);
+  free(b.index);
+  free(b.samples);
+  stats->n_shards = 1;
+  stats->bytes = bytes;
+  clock_gettime(CLOCK_MONOTONIC,&t1);
+  stats->seconds = (t1.tv_sec-t0.tv_sec)+1e-9*(t1.tv_nsec-t0.tv_nsec);
+  return(return_code);
+}
+#endif
@@ -0,0 +1,45 @@
+/** \file grand_mpi.h
+ *  \brief conversion of a file sequence by several MPI ranks into one shared file (make MPI=1)
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_MPI_H
+#define GRAND_MPI_H
+
+#ifdef GRAND_USE_MPI
+#include <mpi.h>
+
+#define MPI_BLOCK_EVENTS 64 /**< consecutive events of the binary file converted by a rank in a round */
+#define MPI_N_TABLES      5 /**< the EventHeader, AntennaInfo, TriggerTime, TraceIndex and Traces tables */
+
+/*! the rows of the shared tables decoded by a rank in a round */
+typedef struct{
+  EventHeader *header;
+  AntHdr *ah;
+  TriggerTime *tt;
+  LiveTrace *index;
+  short *samples;
+  int n_events;
+  int events_alloc;
+  int n_rows;
+  int rows_alloc;
+  long n_samples;
+  long samples_alloc;
+  hsize_t size[MPI_N_TABLES]; /**< rows of the tables in the file, the same on all ranks */
+}MpiBuffer;
+
+int grand_HDF5set_mpi(MPI_Comm comm);
+hid_t grand_HDF5mpi_access(hid_t fapl);
+int grand_mpi_antenna(MpiBuffer *b,GrandEvent *ev,int ic);
+int grand_mpi_event(MpiBuffer *b,GrandEvent *ev);
+int grand_HDF5mpi_append(hid_t data_set,hid_t type,hsize_t *size,long offset,long n,long total,const void *buf);
+int grand_HDF5mpi_flush(hid_t *table,MpiBuffer *b);
+int grand_mpi_sort_skipped(const void *a,const void *b);
+SkippedRange *grand_mpi_skipped(BinReader *r,int *n);
+int grand_mpi_convert(GrandJob *job,GrandJobStats *stats);
+#endif
+
+#endif
@@ -0,0 +1,302 @@
+/** \file grand_preview.c
+ *  \brief min/max envelopes of the traces at a few resolutions, for event displays
+ *
+ *  Level k of a trace has a point per 4^k samples (4, 16 and 64) with the
+ *  minimum and maximum of those samples, so that a display draws the same
+ *  outline as from the full trace. The first level is reduced from the
+ *  samples, 32 at a time with SSE2, and each next level from the previous
+ *  one, which is 4 times smaller: the samples are read once. The envelopes
+ *  of an event are stored in raw/Preview_4, raw/Preview_16 and
+ *  raw/Preview_64 as shorts [antenna row][channel X, Y, Z][point][min, max],
+ *  a single shuffled and deflated chunk per level;
+ *  points beyond the length of a channel, and missing channels, are
+ *  (SHRT_MAX, SHRT_MIN), an empty envelope. A display reads the coarsest
+ *  level that still has a point per pixel with grand_HDF5read_preview.
+ *  Previews are not written in single-writer/multiple-reader mode.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <limits.h>
+#include "grand_hdf5.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+extern int swmr_mode;
+
+/*! write the previews to the files created afterwards */
+int preview_on = 0;
+/*! the channels of the event being written */
+PreviewEntry *preview_entry = NULL;
+int preview_n_entries = 0;
+int preview_entry_alloc = 0;
+/*! minima and maxima of the points of all channels of the event, per level */
+short *preview_lo[PREVIEW_N_LEVELS] = {NULL,NULL,NULL};
+short *preview_hi[PREVIEW_N_LEVELS] = {NULL,NULL,NULL};
+size_t preview_points[PREVIEW_N_LEVELS] = {0,0,0};
+size_t preview_alloc[PREVIEW_N_LEVELS] = {0,0,0};
+
+#ifdef __SSE2__
+/**
+ * \brief The minimum of every group of 4 of 32 values, in order
+ */
+static __m128i grand_preview_min32(const short *p)
+{
+  __m128i v[4];
+
+  for(int k=0;k<4;k++){
+    v[k] = _mm_loadu_si128((const __m128i *)&p[8*k]);
+    //every lane of a 64-bit half gets the minimum of its group
+    v[k] = _mm_min_epi16(v[k],_mm_shufflehi_epi16(_mm_shufflelo_epi16(v[k],0xb1),0xb1));
+    v[k] = _mm_min_epi16(v[k],_mm_shuffle_epi32(v[k],0xb1));
+    v[k] = _mm_srai_epi32(v[k],16);
+  }
+  v[0] = _mm_packs_epi32(v[0],v[1]);
+  v[2] = _mm_packs_epi32(v[2],v[3]);
+  return(_mm_packs_epi32(_mm_srai_epi32(v[0],16),_mm_srai_epi32(v[2],16)));
+}
+
+/**
+ * \brief The maximum of every group of 4 of 32 values, in order
+ */
+static __m128i grand_preview_max32(const short *p)
+{
+  __m128i v[4];
+
+  for(int k=0;k<4;k++){
+    v[k] = _mm_loadu_si128((const __m128i *)&p[8*k]);
+    v[k] = _mm_max_epi16(v[k],_mm_shufflehi_epi16(_mm_shufflelo_epi16(v[k],0xb1),0xb1));
+    v[k] = _mm_max_epi16(v[k],_mm_shuffle_epi32(v[k],0xb1));
+    v[k] = _mm_srai_epi32(v[k],16);
+  }
+  v[0] = _mm_packs_epi32(v[0],v[1]);
+  v[2] = _mm_packs_epi32(v[2],v[3]);
+  return(_mm_packs_epi32(_mm_srai_epi32(v[0],16),_mm_srai_epi32(v[2],16)));
+}
+#endif
+
+/**
+ * \brief Reduce an envelope by PREVIEW_FACTOR
+ * @param[in] lo: the minima, the samples for the first level
+ * @param[in] hi: the maxima, the samples for the first level
+ * @param[in] n: the number of points
+ * @param[out] out_lo: the minima of every PREVIEW_FACTOR points, the last group may be shorter
+ * @param[out] out_hi: the maxima of every PREVIEW_FACTOR points
+ */
+void grand_preview_reduce(const short *lo,const short *hi,int n,short *out_lo,short *out_hi)
+{
+  int i = 0,j = 0;
+
+#ifdef __SSE2__
+  for(;i+32<=n;i+=32,j+=8){
+    _mm_storeu_si128((__m128i *)&out_lo[j],grand_preview_min32(&lo[i]));
+    _mm_storeu_si128((__m128i *)&out_hi[j],grand_preview_max32(&hi[i]));
+  }
+#endif
+  for(;i<n;i+=PREVIEW_FACTOR,j++){
+    out_lo[j] = lo[i];
+    out_hi[j] = hi[i];
+    for(int k=i+1;k<i+PREVIEW_FACTOR && k<n;k++){
+      if(lo[k]<out_lo[j]) out_lo[j] = lo[k];
+      if(hi[k]>out_hi[j]) out_hi[j] = hi[k];
+    }
+  }
+}
+
+/**
+ * \brief The number of points of a level
+ * @param[in] length: the number of samples
+ * @param[in] level: 0 for 4 samples per point, 1 for 16, 2 for 64
+ */
+int grand_preview_points(int length,int level)
+{
+  for(int l=0;l<=level;l++) length = (length+PREVIEW_FACTOR-1)/PREVIEW_FACTOR;
+  return(length);
+}
+
+/**
+ * \brief Select whether the previews are written
+ * @param[in] on: 1 to write them
+ * \return 1: all ok
+ */
+int grand_HDF5set_preview(int on)
+{
+  preview_on = on != 0;
+  return(1);
+}
+
+/**
+ * \brief Compute the envelopes of the traces of an antenna row
+ * @param[in] ev: the decoded event
+ * @param[in] ic: the antenna row, its traces are only needed during this call
+ * \return 1: all ok
+ * \return 0: no previews
+ * \return -1: not enough memory
+ */
+int grand_HDF5preview_antenna(GrandEvent *ev,int ic)
+{
+  TraceSlice *slice = &ev->slice[ic];
+  PreviewEntry *pe;
+  short *lo,*hi;
+  size_t size;
+  int n;
+
+  if(!preview_on || swmr_mode) return(0);
+  for(int itrace=0;itrace<3;itrace++){
+    if(slice->trace[itrace] == NULL || slice->length[itrace] <= 0) continue;
+    if(preview_n_entries == preview_entry_alloc){
+      if((pe = (PreviewEntry *)realloc(preview_entry,(preview_entry_alloc+64)*sizeof(PreviewEntry))) == NULL) return(-1);
+      preview_entry = pe;
+      preview_entry_alloc += 64;
+    }
+    pe = &preview_entry[preview_n_entries++];
+    pe->row = ic;
+    pe->channel = itrace;
+    pe->length = slice->length[itrace];
+    for(int level=0;level<PREVIEW_N_LEVELS;level++){
+      n = grand_preview_points(pe->length,level);
+      if(preview_points[level]+n>preview_alloc[level]){
+        size = 2*(preview_points[level]+n);
+        lo = (short *)realloc(preview_lo[level],size*SHORTSIZE);
+        if(lo != NULL) preview_lo[level] = lo;
+        hi = (short *)realloc(preview_hi[level],size*SHORTSIZE);
+        if(hi != NULL) preview_hi[level] = hi;
+        if(lo == NULL || hi == NULL){
+          preview_n_entries--;
+          return(-1);
+        }
+        preview_alloc[level] = size;
+      }
+      pe->offset[level] = preview_points[level];
+      if(level == 0) grand_preview_reduce(slice->trace[itrace],slice->trace[itrace],pe->length,
+                                          &preview_lo[0][pe->offset[0]],&preview_hi[0][pe->offset[0]]);
+      else grand_preview_reduce(&preview_lo[level-1][pe->offset[level-1]],&preview_hi[level-1][pe->offset[level-1]],
+                                grand_preview_points(pe->length,level-1),
+                                &preview_lo[level][pe->offset[level]],&preview_hi[level][pe->offset[level]]);
+      preview_points[level] += n;
+    }
+  }
+  return(1);
+}
+
+/**
+ * \brief Write the envelopes of an event
+ * @param[in] raw_id: the raw group of the event
+ * @param[in] ev: the decoded event
+ * \return 1: all ok
+ * \return 0: no previews
+ * \return -1: No event is being written or not enough memory
+ * \return -2: the previews cannot be written
+ */
+int grand_HDF5preview_end(hid_t raw_id,GrandEvent *ev)
+{
+  char name[20];
+  hsize_t dim[4];
+  hid_t space,data_set,dcpl;
+  PreviewEntry *pe;
+  short *envelope;
+  int length = 0,width;
+  int return_code = (preview_on && !swmr_mode)?1:0;
+
+  for(int i=0;i<preview_n_entries;i++) if(preview_entry[i].length>length) length = preview_entry[i].length;
+  for(int level=0;level<PREVIEW_N_LEVELS && return_code == 1;level++){
+    if(raw_id<0){
+      return_code = -1;
+      break;
+    }
+    width = grand_preview_points(length,level);
+    dim[0] = ev->n;
+    dim[1] = 3;
+    dim[2] = width;
+    dim[3] = 2;
+    if((envelope = (short *)malloc(dim[0]*dim[1]*dim[2]*dim[3]*SHORTSIZE+1)) == NULL){
+      return_code = -1;
+      break;
+    }
+    for(size_t i=0;i<dim[0]*dim[1]*dim[2];i++){
+      envelope[2*i] = SHRT_MAX;
+      envelope[2*i+1] = SHRT_MIN;
+    }
+    for(int i=0;i<preview_n_entries;i++){
+      pe = &preview_entry[i];
+      for(int k=0;k<grand_preview_points(pe->length,level);k++){
+        envelope[2*(((size_t)pe->row*3+pe->channel)*width+k)] = preview_lo[level][pe->offset[level]+k];
+        envelope[2*(((size_t)pe->row*3+pe->channel)*width+k)+1] = preview_hi[level][pe->offset[level]+k];
+      }
+    }
+    sprintf(name,"Preview_%d",PREVIEW_FACTOR<<(2*level));
+    space = H5Screate_simple(4,dim,NULL);
+    //one chunk per level: the envelopes are read whole, and shuffled they compress to a fraction
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    if(dim[0]*dim[2]>0){
+      H5Pset_chunk(dcpl,4,dim);
+      H5Pset_shuffle(dcpl);
+      H5Pset_deflate(dcpl,PREVIEW_DEFLATE);
+    }
+    data_set = H5Dcreate(raw_id,name,H5T_NATIVE_SHORT,space,H5P_DEFAULT,dcpl,H5P_DEFAULT);
+    H5Pclose(dcpl);
+    if(data_set<0 || H5Dwrite(data_set,H5T_NATIVE_SHORT,H5S_ALL,H5S_ALL,H5P_DEFAULT,envelope)<0) return_code = -2;
+    if(data_set>=0) H5Dclose(data_set);
+    H5Sclose(space);
+    free(envelope);
+  }
+  //the channels of this event are dropped on every path, also when nothing was written
+  preview_n_entries = 0;
+  for(int level=0;level<PREVIEW_N_LEVELS;level++) preview_points[level] = 0;
+  return(return_code);
+}
+
+/**
+ * \brief Read the coarsest preview of an event that still has a point per pixel
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] eventnr: the event number
+ * @param[in] pixels: the width of a trace on the display
+ * @param[out] envelope: [antenna row][channel][point][min, max], to be freed by the caller
+ * @param[out] n_rows: the number of antenna rows, as in AntennaInfo
+ * @param[out] width: the number of points per channel
+ * \return >1: the number of samples per point of the level that was read
+ * \return 0: no level has enough points, the full traces are needed
+ * \return -1: the event has no previews
+ * \return -2: not enough memory or the preview cannot be read
+ */
+int grand_HDF5read_preview(hid_t run_id,unsigned int eventnr,int pixels,short **envelope,int *n_rows,int *width)
+{
+  char name[60];
+  hsize_t dim[4];
+  hid_t data_set,space;
+  int return_code = 0;
+
+  *envelope = NULL;
+  *n_rows = 0;
+  *width = 0;
+  //every link of the path has to exist
+  sprintf(name,"Event_%u",eventnr);
+  if(H5Lexists(run_id,name,H5P_DEFAULT) <= 0) return(-1);
+  sprintf(name,"Event_%u/raw",eventnr);
+  if(H5Lexists(run_id,name,H5P_DEFAULT) <= 0) return(-1);
+  sprintf(name,"Event_%u/raw/Preview_%d",eventnr,PREVIEW_FACTOR);
+  if(H5Lexists(run_id,name,H5P_DEFAULT) <= 0) return(-1);
+  for(int level=PREVIEW_N_LEVELS-1;level>=0 && return_code == 0;level--){
+    sprintf(name,"Event_%u/raw/Preview_%d",eventnr,PREVIEW_FACTOR<<(2*level));
+    if((data_set = H5Dopen(run_id,name,H5P_DEFAULT))<0) continue;
+    space = H5Dget_space(data_set);
+    if(H5Sget_simple_extent_ndims(space) == 4 && H5Sget_simple_extent_dims(space,dim,NULL) == 4 && dim[2]>=(hsize_t)pixels){
+      if((*envelope = (short *)malloc(dim[0]*dim[1]*dim[2]*dim[3]*SHORTSIZE+1)) == NULL) return_code = -2;
+      else if(H5Dread(data_set,H5T_NATIVE_SHORT,H5S_ALL,H5S_ALL,H5P_DEFAULT,*envelope)<0) return_code = -2;
+      else{
+        *n_rows = dim[0];
+        *width = dim[2];
+        return_code = PREVIEW_FACTOR<<(2*level);
+      }
+    }
+    H5Sclose(space);
+    H5Dclose(data_set);
+  }
+  if(return_code<0){
+    free(*envelope);
+    *envelope = NULL;
+  }
+  return(return_code);
+}
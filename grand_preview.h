@@ -0,0 +1,31 @@
+/** \file grand_preview.h
+ *  \brief min/max envelopes of the traces at a few resolutions, for event displays
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_PREVIEW_H
+#define GRAND_PREVIEW_H
+
+#define PREVIEW_FACTOR   4 /**< samples per envelope point of the first level, and between consecutive levels */
+#define PREVIEW_N_LEVELS 3 /**< levels of 4, 16 and 64 samples per point */
+#define PREVIEW_DEFLATE  1 /**< deflate level of the envelopes, higher levels gain little */
+
+/*! a channel of the event being written, its envelopes are in the pools of the levels */
+typedef struct{
+  int row;
+  int channel;
+  int length;                       /**< the number of samples */
+  size_t offset[PREVIEW_N_LEVELS];  /**< the first point in the pool of every level */
+}PreviewEntry;
+
+void grand_preview_reduce(const short *lo,const short *hi,int n,short *out_lo,short *out_hi);
+int grand_preview_points(int length,int level);
+int grand_HDF5set_preview(int on);
+int grand_HDF5preview_antenna(GrandEvent *ev,int ic);
+int grand_HDF5preview_end(hid_t raw_id,GrandEvent *ev);
+int grand_HDF5read_preview(hid_t run_id,unsigned int eventnr,int pixels,short **envelope,int *n_rows,int *width);
+
+#endif
@@ -0,0 +1,144 @@
+/** \file grand_quality.c
+ *  \brief quality flags of the ADC traces, set while an event is decoded
+ *
+ *  Every channel (X, Y, Z) of a decoded antenna row gets a byte of
+ *  GRAND_QUALITY_* flags in the quality column of AntennaInfo, so that a
+ *  reader can skip bad traces without reading them. A trace is checked in a
+ *  single pass for its minimum and maximum, 16 samples at a time with SSE2:
+ *  saturated when it reaches the limits of the ADC resolution of the local
+ *  station, flat when it spans at most QUALITY_FLAT_RANGE counts. A channel
+ *  without samples is missing; its mapping is bad when field[].channel
+ *  connects it to no ADC input or to more than one. The channels checked
+ *  and flagged are counted per file in Monitor/Quality.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <limits.h>
+#include "grand_hdf5.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+extern AntInfo *field;
+
+/*! type of the Monitor/Quality table, not committed */
+hid_t t_quality_counts = -1;
+/*! names of the flags in Monitor/Quality */
+char *quality_name[GRAND_N_QUALITY] = {"saturated","flat","missing","mapping"};
+/*! the channels checked and flagged in the file being written */
+QualityCounts quality_counts;
+
+/**
+ * \brief The flags of the samples of a trace
+ * @param[in] trace: the ADC samples
+ * @param[in] length: the number of samples, at least 1
+ * @param[in] resolution: the ADC resolution in bits
+ * \return the GRAND_QUALITY_SATURATED and GRAND_QUALITY_FLAT flags of the trace
+ */
+unsigned int grand_quality_trace(const short *trace,int length,int resolution)
+{
+  int vmin = SHRT_MAX,vmax = SHRT_MIN;
+  int i = 0;
+  unsigned int flags = 0;
+#ifdef __SSE2__
+  __m128i min0 = _mm_set1_epi16(SHRT_MAX),min1 = min0;
+  __m128i max0 = _mm_set1_epi16(SHRT_MIN),max1 = max0;
+  __m128i v0,v1;
+  short lane[8];
+
+  for(;i+16<=length;i+=16){
+    v0 = _mm_loadu_si128((const __m128i *)&trace[i]);
+    v1 = _mm_loadu_si128((const __m128i *)&trace[i+8]);
+    min0 = _mm_min_epi16(min0,v0);
+    max0 = _mm_max_epi16(max0,v0);
+    min1 = _mm_min_epi16(min1,v1);
+    max1 = _mm_max_epi16(max1,v1);
+  }
+  _mm_storeu_si128((__m128i *)lane,_mm_min_epi16(min0,min1));
+  for(int k=0;k<8;k++) if(lane[k]<vmin) vmin = lane[k];
+  _mm_storeu_si128((__m128i *)lane,_mm_max_epi16(max0,max1));
+  for(int k=0;k<8;k++) if(lane[k]>vmax) vmax = lane[k];
+#endif
+  for(;i<length;i++){
+    if(trace[i]<vmin) vmin = trace[i];
+    if(trace[i]>vmax) vmax = trace[i];
+  }
+  if(resolution<2 || resolution>16) resolution = QUALITY_RESOLUTION;
+  if(vmin <= -(1<<(resolution-1)) || vmax >= (1<<(resolution-1))-1) flags |= GRAND_QUALITY_SATURATED;
+  if(vmax-vmin <= QUALITY_FLAT_RANGE) flags |= GRAND_QUALITY_FLAT;
+  return(flags);
+}
+
+/**
+ * \brief The flags of the channels of a decoded antenna row
+ * @param[in] iant: the antenna in the field
+ * @param[in] resolution: the ADC resolution of the local station in bits
+ * @param[in] slice: the traces of the row
+ * @param[out] quality: the flags of the X, Y and Z channels
+ */
+void grand_quality_antenna(int iant,int resolution,TraceSlice *slice,unsigned char quality[3])
+{
+  int connected[3] = {0,0,0};
+
+  for(int itr=0;itr<4;itr++){
+    switch(field[iant].channel[itr]){
+    case 'X': case 'x': connected[0]++; break;
+    case 'Y': case 'y': connected[1]++; break;
+    case 'Z': case 'z': connected[2]++; break;
+    }
+  }
+  for(int itrace=0;itrace<3;itrace++){
+    quality[itrace] = connected[itrace] == 1?0:GRAND_QUALITY_MAPPING;
+    if(slice->trace[itrace] == NULL || slice->length[itrace] <= 0) quality[itrace] |= GRAND_QUALITY_MISSING;
+    else quality[itrace] |= grand_quality_trace(slice->trace[itrace],slice->length[itrace],resolution);
+  }
+}
+
+/**
+ * \brief Create the compound of the Monitor/Quality table
+ */
+void grand_HDF5create_quality_counts()
+{
+  if(t_quality_counts>0) return;
+  t_quality_counts = H5Tcreate(H5T_COMPOUND,sizeof(QualityCounts));
+  H5Tinsert(t_quality_counts,"channels",HOFFSET(QualityCounts,n_channels),H5T_NATIVE_ULLONG);
+  for(int i=0;i<GRAND_N_QUALITY;i++)
+    H5Tinsert(t_quality_counts,quality_name[i],HOFFSET(QualityCounts,n_flag)+i*sizeof(unsigned long long),
+              H5T_NATIVE_ULLONG);
+}
+
+/**
+ * \brief Count the flagged channels of an event that is written
+ * @param[in] ev: the decoded event
+ */
+void grand_HDF5quality_count(GrandEvent *ev)
+{
+  for(int ic=0;ic<ev->n;ic++){
+    for(int itrace=0;itrace<3;itrace++){
+      quality_counts.n_channels++;
+      for(int i=0;i<GRAND_N_QUALITY;i++) if(ev->ah[ic].quality[itrace]&(1<<i)) quality_counts.n_flag[i]++;
+    }
+  }
+}
+
+/**
+ * \brief Append the counts of the file to the Monitor/Quality table and start new counts
+ * @param[in] run_id: the run group in the HDF5 file
+ * \return 1: all ok
+ * \return 0: no channels were checked
+ * \return -1: the table cannot be opened
+ * \return -2: the record cannot be written
+ */
+int grand_HDF5write_quality(hid_t run_id)
+{
+  int return_code = 0;
+
+  if(quality_counts.n_channels>0){
+    grand_HDF5create_quality_counts();
+    return_code = grand_HDF5append_records(run_id,"Monitor/Quality",t_quality_counts,64,1,&quality_counts);
+  }
+  memset((void *)&quality_counts,0,sizeof(QualityCounts));
+  return(return_code);
+}
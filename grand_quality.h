@@ -0,0 +1,33 @@
+/** \file grand_quality.h
+ *  \brief quality flags of the ADC traces, set while an event is decoded
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_QUALITY_H
+#define GRAND_QUALITY_H
+
+#define GRAND_QUALITY_SATURATED 0x1 /**< a sample is at the limit of the ADC resolution */
+#define GRAND_QUALITY_FLAT      0x2 /**< the samples span at most QUALITY_FLAT_RANGE counts: a stuck channel */
+#define GRAND_QUALITY_MISSING   0x4 /**< no samples for the channel */
+#define GRAND_QUALITY_MAPPING   0x8 /**< the field connects the channel to no ADC input or to more than one */
+#define GRAND_N_QUALITY         4
+
+#define QUALITY_FLAT_RANGE  1
+#define QUALITY_RESOLUTION 14 /**< ADC bits when the local station does not give a valid resolution */
+
+/*! channels checked and flagged in a file, one row of Monitor/Quality */
+typedef struct{
+  unsigned long long n_channels;
+  unsigned long long n_flag[GRAND_N_QUALITY];
+}QualityCounts;
+
+unsigned int grand_quality_trace(const short *trace,int length,int resolution);
+void grand_quality_antenna(int iant,int resolution,TraceSlice *slice,unsigned char quality[3]);
+void grand_HDF5create_quality_counts();
+void grand_HDF5quality_count(GrandEvent *ev);
+int grand_HDF5write_quality(hid_t run_id);
+
+#endif
@@ -0,0 +1,46 @@
+/** \file grand_query.c
+ *  \brief list the events of a GPS time range from the event catalog
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+
+/**
+ * \brief parse a time given as second[:nanosecond]
+ * \return 1: all ok
+ * \return -1: not a valid time
+ */
+int grand_query_time(char *arg,CatalogKey *key)
+{
+  key->nanosecond = 0;
+  if(sscanf(arg,"%u:%u",&key->second,&key->nanosecond) < 1) return(-1);
+  return(1);
+}
+
+int main(int argc, char **argv) {
+  CatalogKey from,to;
+  CatalogEntry *entries;
+  char (*files)[CATALOG_NAME_LENGTH];
+  int n,n_files;
+
+  if(argc != 4 || grand_query_time(argv[2],&from)<0 || grand_query_time(argv[3],&to)<0){
+    printf("Use: grand_query [catalog] [from second[:nanosec]] [to second[:nanosec]]\n");
+    return(-1);
+  }
+  if(grand_HDF5catalog_files(argv[1],&files,&n_files)<0
+     || grand_HDF5catalog_query(argv[1],from,to,&entries,&n)<0){
+    printf("Cannot read the catalog %s\n",argv[1]);
+    return(-1);
+  }
+  for(int i=0;i<n;i++){
+    printf("%u %09u Run %u Event %u %s\n",entries[i].second,entries[i].nanosecond,
+           entries[i].runnr,entries[i].eventnr,entries[i].file<n_files?files[entries[i].file]:"?");
+  }
+  printf("Found %d events\n",n);
+  free(entries);
+  free(files);
+  return(0);
+}
@@ -0,0 +1,912 @@
+/** \file grand_reader.c
+ *  \brief reader engines of the GRAND binary file: stdio, mmap and asynchronous block reads
+ *
+ *  The asynchronous engine reads the file as a stream of aligned blocks and
+ *  keeps depth reads outstanding: a block is submitted again for the block
+ *  depth further on as soon as all its bytes have been consumed. Events are
+ *  sliced out of the completed blocks into a reusable buffer. The reads go
+ *  through io_uring (raw system calls, no liburing); where io_uring is not
+ *  available the same blocks are read with pread. With O_DIRECT the blocks
+ *  bypass the page cache. The stdio engine is the path of grand_read_event.
+ *  An event can also be read one local station at a time, so that only the
+ *  largest local station has to fit in memory, not the largest event.
+ *  Every event header is checked against the file (length, run number,
+ *  local station count, increasing event number). After a corruption the
+ *  stream is resynchronized on the next plausible event header, found with
+ *  a vectorized search for the run number; the bytes in between are
+ *  recorded as skipped ranges.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stddef.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+#include "grand_binlib.h"
+#include "grand_reader.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define SLOT_IDLE     0
+#define SLOT_INFLIGHT 1
+#define SLOT_DONE     2
+
+int reader_engine = GRAND_READER_STDIO;
+int reader_depth = READER_DEPTH;
+size_t reader_block = READER_BLOCK;
+char *reader_name[GRAND_N_READER] = {"stdio","mmap","async","direct"};
+char *reader_skip_reason[GRAND_N_SKIP] = {"","bad event length","run number mismatch","event number does not increase",
+                                          "local station count does not match the event length",
+                                          "bad local station length","event extends beyond the end of the file"};
+
+/**
+ * \brief Select the reader engine of the files opened afterwards
+ * @param[in] engine: one of the GRAND_READER_* values
+ * @param[in] depth: number of outstanding reads of the asynchronous engines, 0 for the default
+ * @param[in] block: block size of the asynchronous engines, rounded up to READER_ALIGN, 0 for the default
+ * \return 1: all ok
+ * \return -1: unknown engine or depth out of range
+ */
+int grand_reader_set_engine(int engine,int depth,size_t block)
+{
+  if(engine<0 || engine>=GRAND_N_READER || depth<0 || depth>READER_MAX_DEPTH) return(-1);
+  reader_engine = engine;
+  reader_depth = depth>0?depth:READER_DEPTH;
+  reader_block = block>0?(block+READER_ALIGN-1)&~(size_t)(READER_ALIGN-1):READER_BLOCK;
+  return(1);
+}
+
+/**
+ * \brief Find a reader engine by name
+ * @param[in] name: the name of the engine (stdio, mmap, async, direct)
+ * \return -1: unknown engine
+ * \return otherwise: the engine
+ */
+int grand_reader_engine_id(char *name)
+{
+  for(int i=0;i<GRAND_N_READER;i++){
+    if(strcmp(name,reader_name[i]) == 0) return(i);
+  }
+  return(-1);
+}
+
+#ifdef __linux__
+/*! the submission and completion rings shared with the kernel */
+struct ReaderRing{
+  int fd;
+  unsigned *sq_head,*sq_tail,*sq_mask,*sq_array;
+  unsigned *cq_head,*cq_tail,*cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_map,*cq_map;
+  size_t sq_size,cq_size,sqes_size;
+  unsigned pending;
+};
+
+/**
+ * \brief Unmap the rings and close the io_uring
+ */
+void grand_reader_ring_close(BinReader *r)
+{
+  struct ReaderRing *ring = r->ring;
+
+  if(ring == NULL) return;
+  if(ring->sqes != NULL && ring->sqes != MAP_FAILED) munmap(ring->sqes,ring->sqes_size);
+  if(ring->cq_map != NULL && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map) munmap(ring->cq_map,ring->cq_size);
+  if(ring->sq_map != NULL && ring->sq_map != MAP_FAILED) munmap(ring->sq_map,ring->sq_size);
+  close(ring->fd);
+  free(ring);
+  r->ring = NULL;
+}
+
+/**
+ * \brief Set up an io_uring with room for depth requests
+ * \return 1: all ok
+ * \return -1: io_uring is not available
+ */
+int grand_reader_ring_setup(BinReader *r,int depth)
+{
+  struct ReaderRing *ring;
+  struct io_uring_params p;
+  char *sq,*cq;
+
+  if((ring = calloc(1,sizeof(struct ReaderRing))) == NULL) return(-1);
+  memset((void *)&p,0,sizeof(p));
+  if((ring->fd = syscall(__NR_io_uring_setup,depth,&p))<0){
+    free(ring);
+    return(-1);
+  }
+  r->ring = ring;
+  ring->sq_size = p.sq_off.array+p.sq_entries*sizeof(unsigned);
+  ring->cq_size = p.cq_off.cqes+p.cq_entries*sizeof(struct io_uring_cqe);
+  if(p.features&IORING_FEAT_SINGLE_MMAP){
+    if(ring->cq_size>ring->sq_size) ring->sq_size = ring->cq_size;
+    ring->cq_size = ring->sq_size;
+  }
+  ring->sqes_size = p.sq_entries*sizeof(struct io_uring_sqe);
+  ring->sq_map = mmap(NULL,ring->sq_size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_SQ_RING);
+  if(p.features&IORING_FEAT_SINGLE_MMAP) ring->cq_map = ring->sq_map;
+  else ring->cq_map = mmap(NULL,ring->cq_size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_CQ_RING);
+  ring->sqes = mmap(NULL,ring->sqes_size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_SQES);
+  if(ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED || ring->sqes == MAP_FAILED){
+    //unmap the rings that were mapped before giving up on io_uring
+    grand_reader_ring_close(r);
+    return(-1);
+  }
+  sq = (char *)ring->sq_map;
+  cq = (char *)ring->cq_map;
+  ring->sq_head = (unsigned *)(sq+p.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq+p.sq_off.tail);
+  ring->sq_mask = (unsigned *)(sq+p.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(sq+p.sq_off.array);
+  ring->cq_head = (unsigned *)(cq+p.cq_off.head);
+  ring->cq_tail = (unsigned *)(cq+p.cq_off.tail);
+  ring->cq_mask = (unsigned *)(cq+p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq+p.cq_off.cqes);
+  return(1);
+}
+
+/**
+ * \brief Submit the queued requests and reap the completed ones
+ * @param[in] wait: wait for at least one completion
+ * \return 1: all ok
+ * \return -1: io_uring_enter failed
+ */
+int grand_reader_ring_reap(BinReader *r,int wait)
+{
+  struct ReaderRing *ring = r->ring;
+  struct io_uring_cqe *cqe;
+  unsigned head,tail;
+  ReaderSlot *slot;
+  int n;
+
+  if(ring->pending>0 || wait){
+    do{
+      n = syscall(__NR_io_uring_enter,ring->fd,ring->pending,wait?1:0,wait?IORING_ENTER_GETEVENTS:0,NULL,0);
+    }while(n<0 && errno == EINTR);
+    if(n<0) return(-1);
+    ring->pending -= n<(int)ring->pending?n:ring->pending;
+  }
+  head = *ring->cq_head;
+  tail = __atomic_load_n(ring->cq_tail,__ATOMIC_ACQUIRE);
+  while(head != tail){
+    cqe = &ring->cqes[head&*ring->cq_mask];
+    slot = &r->slot[cqe->user_data];
+    slot->length = cqe->res;
+    slot->state = SLOT_DONE;
+    head++;
+  }
+  __atomic_store_n(ring->cq_head,head,__ATOMIC_RELEASE);
+  return(1);
+}
+
+/**
+ * \brief Queue the read of a block into its slot, it is submitted by the next grand_reader_ring_reap
+ */
+void grand_reader_ring_queue(BinReader *r,ReaderSlot *slot,long long block)
+{
+  struct ReaderRing *ring = r->ring;
+  struct io_uring_sqe *sqe;
+  unsigned tail,index;
+
+  slot->iov.iov_base = slot->buf;
+  slot->iov.iov_len = r->block;
+  tail = *ring->sq_tail;
+  index = tail&*ring->sq_mask;
+  sqe = &ring->sqes[index];
+  memset((void *)sqe,0,sizeof(struct io_uring_sqe));
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = r->fd;
+  sqe->off = block*r->block;
+  sqe->addr = (unsigned long)&slot->iov;
+  sqe->len = 1;
+  sqe->user_data = block%r->depth;
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail,tail+1,__ATOMIC_RELEASE);
+  ring->pending++;
+}
+#else
+//without io_uring the asynchronous engines read their blocks with pread
+void grand_reader_ring_close(BinReader *r){}
+int grand_reader_ring_setup(BinReader *r,int depth){return(-1);}
+int grand_reader_ring_reap(BinReader *r,int wait){return(-1);}
+void grand_reader_ring_queue(BinReader *r,ReaderSlot *slot,long long block){}
+#endif
+
+/**
+ * \brief Complete a short read of a block with pread, up to the block size or the end of the file
+ * \return the number of bytes in the block
+ * \return negative: minus the errno of a failed read
+ */
+long grand_reader_fill(BinReader *r,ReaderSlot *slot)
+{
+  long long offset = slot->block*(long long)r->block;
+  long length = slot->length;
+  ssize_t n;
+
+  while(length>=0 && length<(long)r->block && offset+length<r->file_size){
+    if((n = pread(r->fd,slot->buf+length,r->block-length,offset+length))<0){
+      if(errno == EINTR) continue;
+      return(-errno);
+    }
+    if(n == 0) break;
+    length += n;
+  }
+  return(length);
+}
+
+/**
+ * \brief Start the read of a block into its slot; without io_uring the block is read at once
+ * @param[in] block: the block number, blocks beyond the end of the file are not read
+ */
+void grand_reader_submit(BinReader *r,long long block)
+{
+  ReaderSlot *slot = &r->slot[block%r->depth];
+
+  slot->block = block;
+  slot->state = SLOT_IDLE;
+  if(block*(long long)r->block >= r->file_size) return;
+  slot->state = SLOT_INFLIGHT;
+  if(!r->use_ring){
+    slot->length = 0;
+    slot->length = grand_reader_fill(r,slot);
+    slot->state = SLOT_DONE;
+    return;
+  }
+  grand_reader_ring_queue(r,slot,block);
+}
+
+/**
+ * \brief Wait for a block to be read
+ * \return NULL: the block cannot be read
+ * \return otherwise: the slot holding the block
+ */
+ReaderSlot *grand_reader_block(BinReader *r,long long block)
+{
+  ReaderSlot *slot = &r->slot[block%r->depth];
+
+  if(slot->block != block || slot->state == SLOT_IDLE) return(NULL);
+  while(slot->state == SLOT_INFLIGHT){
+    if(grand_reader_ring_reap(r,1)<0) return(NULL);
+  }
+  //a read may return fewer bytes than asked before the end of the file
+  slot->length = grand_reader_fill(r,slot);
+  if(slot->length<0){
+    printf("Cannot read block %lld: %s\n",block,strerror(-slot->length));
+    return(NULL);
+  }
+  return(slot);
+}
+
+/**
+ * \brief Copy the next bytes of the file, without the pushed back bytes
+ * @param[out] dst: the destination, NULL to skip the bytes
+ * @param[in] n: the number of bytes
+ * \return the number of bytes copied, less than n at the end of the file or on a read error
+ */
+size_t grand_reader_copy_file(BinReader *r,void *dst,size_t n)
+{
+  ReaderSlot *slot;
+  long long block;
+  size_t copied = 0;
+  long offset,m;
+
+  if(r->engine == GRAND_READER_STDIO){
+    if(r->pos+(long long)n > r->file_size) n = r->file_size>r->pos?r->file_size-r->pos:0;
+    if(dst != NULL) copied = fread(dst,1,n,r->fp);
+    else copied = fseek(r->fp,n,SEEK_CUR) == 0?n:0;
+    r->pos += copied;
+    return(copied);
+  }
+  if(r->engine == GRAND_READER_MMAP){
+    if(r->pos+(long long)n > r->file_size) n = r->file_size>r->pos?r->file_size-r->pos:0;
+    if(dst != NULL) memcpy(dst,&r->map[r->pos],n);
+    r->pos += n;
+    return(n);
+  }
+  while(copied<n){
+    block = r->pos/r->block;
+    if((slot = grand_reader_block(r,block)) == NULL) break;
+    offset = r->pos-block*r->block;
+    if((m = slot->length-offset)<=0) break;
+    if(m>(long)(n-copied)) m = n-copied;
+    if(dst != NULL) memcpy((char *)dst+copied,&slot->buf[offset],m);
+    copied += m;
+    r->pos += m;
+    //the block is consumed: reuse its slot for the block depth further on
+    if(r->pos == (block+1)*(long long)r->block){
+      grand_reader_submit(r,block+r->depth);
+      if(r->use_ring) grand_reader_ring_reap(r,0);
+    }
+  }
+  return(copied);
+}
+
+/**
+ * \brief Release the mapped pages that have been consumed, so that they do not stay resident
+ */
+void grand_reader_release(BinReader *r)
+{
+  long long pos = r->pos&~(long long)(READER_ALIGN-1);
+
+  if(r->engine != GRAND_READER_MMAP || pos-r->released < READER_BLOCK) return;
+  madvise(&r->map[r->released],pos-r->released,MADV_DONTNEED);
+  r->released = pos;
+}
+
+/**
+ * \brief Copy the next bytes of the stream: first the pushed back bytes, then the file
+ * @param[out] dst: the destination, NULL to skip the bytes
+ * @param[in] n: the number of bytes
+ * \return the number of bytes copied, less than n at the end of the file or on a read error
+ */
+size_t grand_reader_copy(BinReader *r,void *dst,size_t n)
+{
+  size_t m = 0;
+
+  if(r->back_pos < r->back_len){
+    m = r->back_len-r->back_pos;
+    if(m>n) m = n;
+    if(dst != NULL){
+      memcpy(dst,&r->back[r->back_pos],m);
+      dst = (char *)dst+m;
+    }
+    r->back_pos += m;
+    if(m == n) return(n);
+  }
+  return(m+grand_reader_copy_file(r,dst,n-m));
+}
+
+/**
+ * \brief Push back the last bytes that were read, so that they are read again
+ * @param[in] buf: a copy of the last n bytes read
+ * @param[in] n: the number of bytes
+ * \return 1: all ok
+ * \return -1: not enough memory
+ */
+int grand_reader_unread(BinReader *r,char *buf,size_t n)
+{
+  size_t left = r->back_len-r->back_pos;
+  char *back;
+
+  if(n == 0) return(1);
+  //the mapped file is simply read again
+  if(r->engine == GRAND_READER_MMAP && left == 0){
+    r->pos -= n;
+    return(1);
+  }
+  if((back = malloc(n+left)) == NULL) return(-1);
+  memcpy(back,buf,n);
+  if(left>0) memcpy(&back[n],&r->back[r->back_pos],left);
+  free(r->back);
+  r->back = back;
+  r->back_len = n+left;
+  r->back_pos = 0;
+  return(1);
+}
+
+/**
+ * \brief The position in the file of the next byte of the stream
+ */
+long long grand_reader_tell(BinReader *r)
+{
+  return(r->pos-(long long)(r->back_len-r->back_pos));
+}
+
+/**
+ * \brief Record a byte range that is not converted
+ * @param[in] start: the first byte of the range
+ * @param[in] end: the byte after the range
+ * @param[in] reason: one of the GRAND_SKIP_* values
+ */
+void grand_reader_skip(BinReader *r,long long start,long long end,int reason)
+{
+  SkippedRange *skipped;
+
+  if(end<=start) return;
+  printf("Skipped bytes %lld-%lld after event %u: %s\n",start,end,r->last_eventnr,reader_skip_reason[reason]);
+  if(r->n_skipped == r->n_skipped_alloc){
+    if((skipped = realloc(r->skipped,(r->n_skipped_alloc+16)*sizeof(SkippedRange))) == NULL) return;
+    r->skipped = skipped;
+    r->n_skipped_alloc += 16;
+  }
+  skipped = &r->skipped[r->n_skipped++];
+  skipped->start = start;
+  skipped->end = end;
+  skipped->last_eventnr = r->last_eventnr;
+  skipped->reason = reason;
+  skipped->source = 0;
+}
+
+/**
+ * \brief Check an event header against the file and the previous events
+ * @param[in] eh: the event header
+ * @param[in] start: the position of the header in the file
+ * \return 0: the header is valid
+ * \return otherwise: the GRAND_SKIP_* reason why it is not
+ */
+int grand_reader_check(BinReader *r,EventHeader *eh,long long start)
+{
+  long long body = (long long)eh->length+INTSIZE-(long long)sizeof(EventHeader);
+
+  if(body<0) return(GRAND_SKIP_LENGTH);
+  if(start+(long long)eh->length+INTSIZE > r->file_size) return(GRAND_SKIP_TRUNCATED);
+  if(r->runnr != 0 && eh->runnr != r->runnr) return(GRAND_SKIP_RUNNR);
+  if((long long)eh->LSCNT*offsetof(EventBody,info_ADCbuffer) > body) return(GRAND_SKIP_LSCNT);
+  if(r->n_events>0 && (eh->eventnr <= r->last_eventnr || eh->eventnr-r->last_eventnr > READER_RESYNC_WINDOW))
+    return(GRAND_SKIP_EVENTNR);
+  return(0);
+}
+
+/**
+ * \brief Check whether the bytes at offset k of a buffer start a plausible event
+ * @param[in] buf: the buffer, its first byte is at pos in the file
+ * @param[in] n: the number of bytes in the buffer
+ * \return 1: plausible event
+ * \return 0: not an event
+ */
+int grand_reader_candidate(BinReader *r,char *buf,size_t n,long long pos,size_t k)
+{
+  EventHeader eh;
+  UINT16 length;
+
+  if(k+sizeof(EventHeader)+SHORTSIZE > n) return(0);
+  memcpy(&eh,&buf[k],sizeof(EventHeader));
+  memcpy(&length,&buf[k+sizeof(EventHeader)],SHORTSIZE);
+  if(eh.LSCNT<1 || grand_reader_check(r,&eh,pos+k) != 0) return(0);
+  //the first local station has to fit in the event
+  return((size_t)length*SHORTSIZE >= offsetof(EventBody,info_ADCbuffer)
+         && (long long)length*SHORTSIZE <= (long long)eh.length+INTSIZE-(long long)sizeof(EventHeader));
+}
+
+/**
+ * \brief Find the first plausible event header in a buffer, at an offset below limit.
+ * The run number is searched at every byte, 16 offsets at a time with SSE2, so that
+ * inserted or lost bytes of any count are resynchronized.
+ * @param[in] buf: the buffer, its first byte is at pos in the file
+ * @param[in] n: the number of bytes in the buffer
+ * @param[in] limit: the offsets searched are below limit
+ * \return the offset of the event header, limit if there is none
+ */
+size_t grand_reader_find_header(BinReader *r,char *buf,size_t n,long long pos,size_t limit)
+{
+  unsigned char *runnr = (unsigned char *)&r->runnr;
+  size_t k = 0;
+#ifdef __SSE2__
+  __m128i match;
+  unsigned int mask;
+  int j;
+
+  //byte j of the loads at k+4 up to k+7 holds the run number of a header at k+j
+  for(;k+16 <= limit && k+23 <= n;k+=16){
+    match = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)&buf[k+4]),_mm_set1_epi8(runnr[0]));
+    for(j=1;j<INTSIZE;j++)
+      match = _mm_and_si128(match,_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)&buf[k+4+j]),_mm_set1_epi8(runnr[j])));
+    mask = _mm_movemask_epi8(match);
+    while(mask != 0){
+      j = __builtin_ctz(mask);
+      if(grand_reader_candidate(r,buf,n,pos,k+j)) return(k+j);
+      mask &= mask-1;
+    }
+  }
+#endif
+  for(;k<limit && k+8 <= n;k++){
+    if(memcmp(&buf[k+4],runnr,INTSIZE) == 0 && grand_reader_candidate(r,buf,n,pos,k)) return(k);
+  }
+  return(limit);
+}
+
+/**
+ * \brief Resynchronize the stream on the next plausible event header after a corruption;
+ * the bytes from start to the header are recorded as skipped
+ * @param[in] start: where the corrupted data starts
+ * @param[in] reason: why the data at start is not a valid event
+ * \return 1: an event header is found, it is the next data read
+ * \return 0: no event header before the end of the file
+ * \return -1: not enough memory
+ */
+int grand_reader_resync(BinReader *r,long long start,int reason)
+{
+  const size_t keep = sizeof(EventHeader)+SHORTSIZE;
+  long long pos = grand_reader_tell(r);
+  size_t have = 0,n,k,limit;
+
+  if(r->scan == NULL && (r->scan = malloc(READER_SCAN)) == NULL) return(-1);
+  while(1){
+    grand_reader_release(r);
+    n = grand_reader_copy(r,&r->scan[have],READER_SCAN-have);
+    have += n;
+    //the last bytes are searched with the next chunk, unless the file ends
+    limit = n == 0 || have<keep?have:have-keep;
+    //without a run number there is nothing to search for
+    if(r->runnr == 0) k = limit;
+    else k = grand_reader_find_header(r,r->scan,have,pos,limit);
+    if(k<limit){
+      if(grand_reader_unread(r,&r->scan[k],have-k)<0) return(-1);
+      grand_reader_skip(r,start,pos+k,reason);
+      return(1);
+    }
+    if(n == 0){
+      grand_reader_skip(r,start,pos+have,reason);
+      return(0);
+    }
+    //the last bytes may hold the start of a header
+    if(have>keep){
+      memmove(r->scan,&r->scan[have-keep],keep);
+      pos += have-keep;
+      have = keep;
+    }
+  }
+}
+
+/**
+ * \brief Open a binary file with the selected reader engine
+ * @param[out] r: the reader
+ * @param[in] filename: the binary file
+ * \return 1: all ok
+ * \return -1: the file cannot be opened
+ * \return -2: memory problem
+ */
+int grand_reader_open(BinReader *r,char *filename)
+{
+  struct stat st;
+  int flags = O_RDONLY;
+
+  memset((void *)r,0,sizeof(BinReader));
+  r->engine = reader_engine;
+  r->fd = -1;
+  if(r->engine == GRAND_READER_STDIO){
+    if((r->fp = fopen(filename,"r")) == NULL) return(-1);
+    if(fstat(fileno(r->fp),&st) == 0) r->file_size = st.st_size;
+    return(1);
+  }
+  if(r->engine == GRAND_READER_DIRECT) flags |= O_DIRECT;
+  if((r->fd = open(filename,flags))<0 && r->engine == GRAND_READER_DIRECT){
+    //not all file systems support O_DIRECT
+    r->engine = GRAND_READER_ASYNC;
+    r->fd = open(filename,O_RDONLY);
+  }
+  if(r->fd<0) return(-1);
+  if(fstat(r->fd,&st)<0){
+    grand_reader_close(r);
+    return(-1);
+  }
+  r->file_size = st.st_size;
+  if(r->engine == GRAND_READER_MMAP){
+    if(r->file_size>0 && (r->map = mmap(NULL,r->file_size,PROT_READ,MAP_PRIVATE,r->fd,0)) == MAP_FAILED){
+      r->map = NULL;
+      grand_reader_close(r);
+      return(-1);
+    }
+    if(r->map != NULL) madvise(r->map,r->file_size,MADV_SEQUENTIAL);
+    return(1);
+  }
+  r->depth = reader_depth;
+  r->block = reader_block;
+  for(int i=0;i<r->depth;i++){
+    if(posix_memalign((void **)&r->slot[i].buf,READER_ALIGN,r->block) != 0){
+      grand_reader_close(r);
+      return(-2);
+    }
+    r->slot[i].block = -1;
+  }
+  r->use_ring = grand_reader_ring_setup(r,r->depth)>0;
+  if(r->engine == GRAND_READER_ASYNC) posix_fadvise(r->fd,0,0,POSIX_FADV_SEQUENTIAL);
+  for(long long block=0;block<r->depth;block++) grand_reader_submit(r,block);
+  if(r->use_ring) grand_reader_ring_reap(r,0);
+  return(1);
+}
+
+/**
+ * \brief Read the file header, as grand_read_file_header
+ * @param[out] size: the size of the file header, -1 on error
+ * \return NULL:  could not read the file header
+ * \return otherwise: the file header, valid until the reader is closed
+ */
+int *grand_reader_file_header(BinReader *r,int *size)
+{
+  int isize;
+  int *file_header;
+
+  *size = -1;
+  if(grand_reader_copy(r,&isize,INTSIZE) != INTSIZE){
+    printf("Cannot read the header length\n");
+    return(NULL);
+  }
+  if(isize < FILE_HDR_ADDITIONAL || r->pos+isize > r->file_size){
+    printf("The file header is too short or too long, %d bytes\n",isize);
+    return(NULL);
+  }
+  if(r->engine == GRAND_READER_MMAP){
+    file_header = (int *)r->map;
+    r->pos += isize;
+  }
+  else{
+    if((file_header = malloc(isize+INTSIZE)) == NULL) return(NULL);
+    file_header[0] = isize;
+    grand_reader_copy(r,&file_header[1],isize);
+    free(r->header);
+    r->header = file_header;
+  }
+  //the events are checked against the run number of the file
+  if(isize >= FILE_HDR_RUNNR*INTSIZE) r->runnr = file_header[FILE_HDR_RUNNR];
+  *size = isize+INTSIZE;
+  return(file_header);
+}
+
+/**
+ * \brief Check whether an event rejected on its event number starts a new numbering: it is ahead
+ * of the last event and the next READER_RENUMBER-1 events are well framed and continue its numbering.
+ * A numbering that goes back is never accepted, the event numbers of the output keep increasing.
+ * @param[in] eh: the header of the rejected event, its body are the next bytes of the stream
+ * @param[in] start: the position of the header
+ * \return 1: the event starts a new numbering
+ * \return 0: the event is out of order
+ * \return -1: memory problem
+ * The bytes read ahead are pushed back, the stream is at the body of the event again.
+ */
+int grand_reader_renumbered(BinReader *r,EventHeader *eh,long long start)
+{
+  unsigned int last_eventnr = r->last_eventnr;
+  long long body = (long long)eh->length+INTSIZE-(long long)sizeof(EventHeader);
+  long long next_start;
+  EventHeader next;
+  char *buf = NULL,*p;
+  size_t n = 0,alloc = 0,m;
+  int return_code = 1;
+
+  if(eh->eventnr <= last_eventnr) return(0);
+  r->last_eventnr = eh->eventnr;
+  for(int k=1;k<READER_RENUMBER;k++){
+    if(n+body+sizeof(EventHeader) > alloc){
+      alloc = n+body+sizeof(EventHeader);
+      if((p = realloc(buf,alloc)) == NULL){
+        return_code = -1;
+        break;
+      }
+      buf = p;
+    }
+    m = grand_reader_copy(r,&buf[n],body);
+    n += m;
+    next_start = grand_reader_tell(r);
+    if(m != (size_t)body || (m = grand_reader_copy(r,&buf[n],sizeof(EventHeader))) == 0){
+      return_code = 0;
+      break;
+    }
+    n += m;
+    if(m != sizeof(EventHeader)){
+      return_code = 0;
+      break;
+    }
+    memcpy(&next,&buf[n-sizeof(EventHeader)],sizeof(EventHeader));
+    if(grand_reader_check(r,&next,next_start) != 0){
+      return_code = 0;
+      break;
+    }
+    r->last_eventnr = next.eventnr;
+    body = (long long)next.length+INTSIZE-(long long)sizeof(EventHeader);
+  }
+  r->last_eventnr = last_eventnr;
+  if(grand_reader_unread(r,buf,n)<0) return_code = -1;
+  free(buf);
+  return(return_code);
+}
+
+/**
+ * \brief Read the header of the next valid event; its local stations follow with grand_reader_next_ls.
+ * What is left of the previous event is skipped. An event with a valid length but an event number
+ * that does not increase is skipped, unless the next events follow its numbering; after any other
+ * corruption the stream is resynchronized.
+ * @param[out] eh: the event header
+ * \return 1: all ok
+ * \return 0: end of the file
+ * \return -1: not enough memory to resynchronize
+ */
+int grand_reader_event_header(BinReader *r,EventHeader *eh)
+{
+  long long start;
+  size_t n;
+  int reason,return_code;
+
+  //bytes after the last local station do not belong to the event
+  if(r->event_left>0 && r->ls_read>0 && r->ls_left == 0)
+    grand_reader_skip(r,grand_reader_tell(r),grand_reader_tell(r)+r->event_left,GRAND_SKIP_LSCNT);
+  if(r->event_left>0) grand_reader_copy(r,NULL,r->event_left);
+  r->event_left = 0;
+  r->ls_left = 0;
+  r->ls_read = 0;
+  grand_reader_release(r);
+  while(1){
+    start = grand_reader_tell(r);
+    if((n = grand_reader_copy(r,eh,sizeof(EventHeader))) == 0) return(0);
+    if(n != sizeof(EventHeader)){
+      grand_reader_skip(r,start,start+n,GRAND_SKIP_TRUNCATED);
+      return(0);
+    }
+    if((reason = grand_reader_check(r,eh,start)) == 0) break;
+    if(reason == GRAND_SKIP_EVENTNR){
+      //a well framed event followed by events with the same numbering is accepted as a new baseline
+      if((return_code = grand_reader_renumbered(r,eh,start))<0) return(return_code);
+      if(return_code == 1){
+        printf("Event numbering restarts at %u after event %u\n",eh->eventnr,r->last_eventnr);
+        break;
+      }
+      grand_reader_copy(r,NULL,(long long)eh->length+INTSIZE-sizeof(EventHeader));
+      grand_reader_skip(r,start,grand_reader_tell(r),reason);
+      continue;
+    }
+    //the header is misframed: search from the next byte on
+    if(grand_reader_unread(r,(char *)eh+1,sizeof(EventHeader)-1)<0) return(-1);
+    if((return_code = grand_reader_resync(r,start,reason))<=0) return(return_code);
+  }
+  r->event_start = start;
+  r->last_eventnr = eh->eventnr;
+  r->n_events++;
+  r->event_left = (long long)eh->length+INTSIZE-sizeof(EventHeader);
+  r->ls_left = eh->LSCNT;
+  return(1);
+}
+
+/**
+ * \brief Read the next valid event, as grand_read_event
+ * @param[out] size: the size of the event, -1 at the end of the file or on error
+ * \return NULL:  could not read the event
+ * \return otherwise: the event, valid until the next call
+ */
+unsigned short *grand_reader_event(BinReader *r,int *size)
+{
+  EventHeader eh;
+  long long body;
+  char *data;
+
+  *size = -1;
+  if(grand_reader_event_header(r,&eh)<=0) return(NULL);
+  body = r->event_left;
+  r->event_left = 0;
+  //the mapped event is used in place when it is aligned
+  if(r->engine == GRAND_READER_MMAP && r->back_pos == r->back_len && r->event_start%INTSIZE == 0){
+    r->pos += body;
+    *size = body+sizeof(EventHeader);
+    return((unsigned short *)&r->map[r->event_start]);
+  }
+  if(r->data_alloc < (size_t)body+sizeof(EventHeader)){
+    if((data = realloc(r->data,body+sizeof(EventHeader))) == NULL){
+      printf("Cannot allocate enough memory to save the event!\n");
+      return(NULL);
+    }
+    r->data = data;
+    r->data_alloc = body+sizeof(EventHeader);
+  }
+  memcpy(r->data,&eh,sizeof(EventHeader));
+  if(grand_reader_copy(r,&r->data[sizeof(EventHeader)],body) != (size_t)body){
+    printf("Cannot read the full event (requested %lld bytes)\n",body);
+    return(NULL);
+  }
+  *size = body+sizeof(EventHeader);
+  return((unsigned short *)r->data);
+}
+
+/**
+ * \brief Read the next local station of the current event into a reusable buffer.
+ * A local station that does not fit in the event is skipped with the rest of the event.
+ * \return NULL: no more local stations in the event, or the station does not fit in the event
+ * \return otherwise: the local station, valid until the next call
+ */
+EventBody *grand_reader_next_ls(BinReader *r)
+{
+  UINT16 length;
+  long long start;
+  size_t bytes;
+  char *ls;
+
+  if(r->ls_left<=0) return(NULL);
+  if(r->event_left < SHORTSIZE){
+    printf("Event %u ends after %d of its %d local stations\n",r->last_eventnr,r->ls_read,r->ls_read+r->ls_left);
+    r->ls_left = 0;
+    return(NULL);
+  }
+  grand_reader_release(r);
+  start = grand_reader_tell(r);
+  if(grand_reader_copy(r,&length,SHORTSIZE) != SHORTSIZE){
+    r->event_left = 0;
+    return(NULL);
+  }
+  r->event_left -= SHORTSIZE;
+  bytes = (size_t)length*SHORTSIZE;
+  if(bytes < offsetof(EventBody,info_ADCbuffer) || bytes-SHORTSIZE > (size_t)r->event_left){
+    grand_reader_skip(r,start,start+SHORTSIZE+r->event_left,GRAND_SKIP_STATION);
+    grand_reader_copy(r,NULL,r->event_left);
+    r->event_left = 0;
+    r->ls_left = 0;
+    return(NULL);
+  }
+  r->ls_left--;
+  r->ls_read++;
+  //the mapped station is used in place when it is aligned
+  if(r->engine == GRAND_READER_MMAP && r->back_pos == r->back_len && start%INTSIZE == 0){
+    ls = &r->map[start];
+    r->pos += bytes-SHORTSIZE;
+    r->event_left -= bytes-SHORTSIZE;
+    return((EventBody *)ls);
+  }
+  if(r->ls_alloc < bytes){
+    if((ls = realloc(r->ls,bytes)) == NULL){
+      printf("Cannot allocate enough memory to save the local station!\n");
+      return(NULL);
+    }
+    r->ls = ls;
+    r->ls_alloc = bytes;
+  }
+  memcpy(r->ls,&length,SHORTSIZE);
+  if(grand_reader_copy(r,&r->ls[SHORTSIZE],bytes-SHORTSIZE) != bytes-SHORTSIZE){
+    printf("Cannot read the full local station (%zu bytes)\n",bytes);
+    r->event_left = 0;
+    return(NULL);
+  }
+  r->event_left -= bytes-SHORTSIZE;
+  return((EventBody *)r->ls);
+}
+
+/**
+ * \brief Record the local station returned last by grand_reader_next_ls as skipped,
+ * for a station whose contents do not fit in its length
+ * @param[in] eb: the local station
+ */
+void grand_reader_skip_ls(BinReader *r,EventBody *eb)
+{
+  long long end = grand_reader_tell(r);
+
+  grand_reader_skip(r,end-(long long)eb->length*SHORTSIZE,end,GRAND_SKIP_STATION);
+}
+
+/**
+ * \brief Close the file, wait for the outstanding reads and free the buffers
+ */
+void grand_reader_close(BinReader *r)
+{
+  if(r->fp != NULL) fclose(r->fp);
+  r->fp = NULL;
+  if(r->map != NULL) munmap(r->map,r->file_size);
+  r->map = NULL;
+  if(r->use_ring){
+    for(int i=0;i<r->depth;i++){
+      while(r->slot[i].state == SLOT_INFLIGHT && grand_reader_ring_reap(r,1)>0);
+    }
+    grand_reader_ring_close(r);
+    r->use_ring = 0;
+  }
+  for(int i=0;i<READER_MAX_DEPTH;i++){
+    free(r->slot[i].buf);
+    r->slot[i].buf = NULL;
+  }
+  if(r->fd>=0) close(r->fd);
+  r->fd = -1;
+  free(r->header);
+  r->header = NULL;
+  free(r->ls);
+  r->ls = NULL;
+  r->ls_alloc = 0;
+  free(r->data);
+  r->data = NULL;
+  r->data_alloc = 0;
+  free(r->back);
+  r->back = NULL;
+  r->back_len = r->back_pos = 0;
+  free(r->scan);
+  r->scan = NULL;
+  free(r->skipped);
+  r->skipped = NULL;
+  r->n_skipped = r->n_skipped_alloc = 0;
+}
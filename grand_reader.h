@@ -0,0 +1,100 @@
+/** \file grand_reader.h
+ *  \brief reader engines of the GRAND binary file: stdio, mmap and asynchronous block reads
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_READER_H
+#define GRAND_READER_H
+
+#include <sys/uio.h>
+
+#define GRAND_READER_STDIO  0 /**< buffered fread, as grand_read_event */
+#define GRAND_READER_MMAP   1 /**< the file is mapped, events are not copied */
+#define GRAND_READER_ASYNC  2 /**< large aligned reads with a queue of outstanding requests (io_uring or pread) */
+#define GRAND_READER_DIRECT 3 /**< asynchronous reads with O_DIRECT, bypassing the page cache */
+#define GRAND_N_READER      4
+
+#define READER_ALIGN  4096     /**< alignment of the blocks, for O_DIRECT */
+#define READER_BLOCK  (1<<20)  /**< default block size in bytes */
+#define READER_DEPTH  8        /**< default number of outstanding reads */
+#define READER_MAX_DEPTH 256
+#define READER_SCAN   (1<<16)  /**< bytes searched at a time for the next event header after a corruption */
+#define READER_RESYNC_WINDOW (1<<20) /**< the event number of a resynchronized header is at most this far ahead */
+#define READER_RENUMBER 3 /**< consecutive well framed events that set a new event numbering */
+
+#define GRAND_SKIP_LENGTH     1 /**< the event length is shorter than its header */
+#define GRAND_SKIP_RUNNR      2 /**< the run number differs from the file header */
+#define GRAND_SKIP_EVENTNR    3 /**< the event number does not increase */
+#define GRAND_SKIP_LSCNT      4 /**< the local station count does not match the event length */
+#define GRAND_SKIP_STATION    5 /**< a local station length does not fit in the event */
+#define GRAND_SKIP_TRUNCATED  6 /**< the event extends beyond the end of the file */
+#define GRAND_N_SKIP          7
+
+/*! a byte range of a binary file that was not converted */
+typedef struct{
+  unsigned long long start;
+  unsigned long long end;
+  unsigned int last_eventnr; /**< the last valid event before the range */
+  unsigned int reason;       /**< one of the GRAND_SKIP_* values */
+  unsigned int source;       /**< 0: AD file, 1: TD file */
+}SkippedRange;
+
+typedef struct{
+  char *buf;
+  long long block;
+  int state;
+  long length;
+  struct iovec iov;
+}ReaderSlot;
+
+struct ReaderRing; /**< the io_uring of the asynchronous engines, defined in grand_reader.c */
+
+typedef struct{
+  int engine;
+  int depth;
+  size_t block;
+  FILE *fp;
+  int fd;
+  long long file_size;
+  long long pos;
+  long long released;
+  char *map;
+  ReaderSlot slot[READER_MAX_DEPTH];
+  struct ReaderRing *ring;
+  int use_ring;
+  int *header;
+  char *data;
+  size_t data_alloc;
+  long long event_left;
+  char *ls;
+  size_t ls_alloc;
+  unsigned int runnr;
+  unsigned int last_eventnr;
+  int n_events;
+  long long event_start;
+  int ls_left;
+  int ls_read;
+  char *back;      /**< bytes pushed back after a failed check, read before the file */
+  size_t back_len;
+  size_t back_pos;
+  char *scan;
+  SkippedRange *skipped;
+  int n_skipped;
+  int n_skipped_alloc;
+}BinReader;
+
+int grand_reader_set_engine(int engine,int depth,size_t block);
+int grand_reader_engine_id(char *name);
+int grand_reader_open(BinReader *r,char *filename);
+int *grand_reader_file_header(BinReader *r,int *size);
+unsigned short *grand_reader_event(BinReader *r,int *size);
+int grand_reader_event_header(BinReader *r,EventHeader *eh);
+long long grand_reader_tell(BinReader *r);
+EventBody *grand_reader_next_ls(BinReader *r);
+void grand_reader_skip_ls(BinReader *r,EventBody *eb);
+void grand_reader_close(BinReader *r);
+
+#endif
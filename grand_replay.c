@@ -0,0 +1,456 @@
+/** \file grand_replay.c
+ *  \brief replay of AD/TD files, or of synthetic events, at a given event rate to load-test the conversion
+ *
+ *  The events are written to <targetdir>/AD/ad<runnr>.f<fileseq> (and the
+ *  periodic triggers to TD/td<runnr>.f<fileseq>) with the framing of
+ *  grand_read_event: the file header, then every event with its length.
+ *  Events are numbered again from 1 in run runnr, so that a replayed file
+ *  can be repeated. Every event is flushed when written; a file sequence is
+ *  closed, TD first, after a number of events or seconds, which is when
+ *  grand_daemon queues it. The source files are loaded first, so reading
+ *  them does not limit the rate.
+ *
+ *  With -o the HDF5 output of every file sequence is checked while
+ *  replaying and at the end, and the latency from writing an event to
+ *  seeing it in the output is reported. The pattern has %d for the run
+ *  number and %d for the file sequence, e.g. out/Run%d_f%d.hdf5 for
+ *  grand_daemon. A file written in single-writer/multiple-reader mode is
+ *  followed through its Live tables; any other file is listed when it can
+ *  be opened, i.e. after its writer closed it.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "grand_hdf5.h"
+
+#define USAGE "Use: grand_replay [-f fieldfile] [-e events_per_second] [-n n_events] [-l tracelength] [-k events_per_file] [-d seconds_per_file] [-q first_fileseq] [-o hdf5 file pattern] [-w wait_seconds] targetdir runnr [basedir srcrun srcseq]\n"
+
+#define REPLAY_POLL  0.05 /**< seconds between two checks of the HDF5 output */
+#define REPLAY_WAIT  60   /**< default seconds to wait for the last events in the HDF5 output */
+#define REPLAY_FILE  1000 /**< default number of events per file sequence */
+#define REPLAY_LIVE  1024 /**< event headers read at a time from the Live tables */
+
+/*! the events of a binary file, in memory */
+typedef struct{
+  unsigned short **event;
+  int *size;
+  int n;
+  int n_alloc;
+}ReplaySource;
+
+/*! a file sequence that is written, and the check of its HDF5 output */
+typedef struct{
+  int fileseq;
+  long first;     /**< the first event of the sequence, counted from 0 */
+  long n;         /**< the events written */
+  long n_seen;    /**< the events found in the HDF5 output */
+  int closed;
+  int live;       /**< the output is followed through its Live tables */
+  GrandReader reader;
+}ReplayFile;
+
+extern AntInfo *field;
+extern int field_size;
+
+/*! time at which every event was written, and the latency until it was seen in the HDF5 output */
+double *written = NULL;
+double *latency = NULL;
+
+double grand_replay_now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return(ts.tv_sec+1e-9*ts.tv_nsec);
+}
+
+/**
+ * \brief Load the events of a binary file
+ * @param[in] filename: the AD or TD file
+ * @param[out] src: the events
+ * \return >=0: the number of events
+ * \return -1: the file cannot be read
+ * \return -2: not enough memory
+ */
+int grand_replay_load(char *filename,ReplaySource *src)
+{
+  FILE *fp;
+  unsigned short *event;
+  void *p;
+  int size;
+
+  memset((void *)src,0,sizeof(ReplaySource));
+  if((fp = fopen(filename,"r")) == NULL) return(-1);
+  if(grand_read_file_header(fp,&size) == NULL){
+    fclose(fp);
+    return(-1);
+  }
+  //grand_read_event reports the end of the file as a failed read
+  while(fread(&size,INTSIZE,1,fp) == 1){
+    fseek(fp,-INTSIZE,SEEK_CUR);
+    if((event = grand_read_event(fp,&size)) == NULL) break;
+    if(src->n == src->n_alloc){
+      if((p = realloc(src->event,(src->n_alloc+1024)*sizeof(unsigned short *))) == NULL) break;
+      src->event = p;
+      if((p = realloc(src->size,(src->n_alloc+1024)*sizeof(int))) == NULL) break;
+      src->size = p;
+      src->n_alloc += 1024;
+    }
+    if((src->event[src->n] = (unsigned short *)malloc(size)) == NULL) break;
+    memcpy(src->event[src->n],event,size);
+    src->size[src->n++] = size;
+  }
+  fclose(fp);
+  return(src->n);
+}
+
+/**
+ * \brief Give an event the run number and event number of the replay
+ * @param[in,out] event: the event, with the framing of grand_read_event
+ * @param[in] runnr: the run number
+ * @param[in] eventnr: the event number
+ */
+void grand_replay_number(unsigned short *event,int runnr,unsigned int eventnr)
+{
+  EventHeader *eh = (EventHeader *)event;
+  int ils = EVENT_LS;
+  int ev_end = ((int)(event[EVENT_HDR_LENGTH+1]<<16)+(int)(event[EVENT_HDR_LENGTH]))/SHORTSIZE;
+  EventBody *eb;
+
+  eh->runnr = runnr;
+  eh->eventnr = eventnr;
+  eh->t3_event = eventnr;
+  for(int ic=0;ils<ev_end && ic<(int)eh->LSCNT;ic++){
+    eb = (EventBody *)(&event[ils]);
+    if(eb->length == 0) break;
+    eb->event_nr = eventnr;
+    ils += eb->length;
+  }
+}
+
+/**
+ * \brief Create a binary file of the replay and write its header
+ * @param[in] targetdir: the directory with the AD and TD subdirectories
+ * @param[in] type: "AD" or "TD"
+ * @param[in] prefix: "ad" or "td"
+ * @param[in] runnr: the run number
+ * @param[in] fileseq: the file sequence
+ * @param[in] header: the file header, with its length in header[FILE_HDR_LENGTH]
+ * \return NULL: the file cannot be created
+ * \return otherwise: the file
+ */
+FILE *grand_replay_create(char *targetdir,char *type,char *prefix,int runnr,int fileseq,int *header)
+{
+  char filename[VIEW_NAME_LENGTH+40];
+  FILE *fp;
+
+  snprintf(filename,sizeof(filename),"%s/%s/%s%06d.f%04d",targetdir,type,prefix,runnr,fileseq);
+  if((fp = fopen(filename,"w")) == NULL){
+    printf("Cannot create %s\n",filename);
+    return(NULL);
+  }
+  header[FILE_HDR_RUNNR] = runnr;
+  fwrite(header,header[FILE_HDR_LENGTH]+INTSIZE,1,fp);
+  fflush(fp);
+  return(fp);
+}
+
+/**
+ * \brief Close a binary file of the replay, with its last event in the file header
+ * @param[in] fp: the file
+ * @param[in] last: the last event number
+ * @param[in] second: the GPS second of the last event
+ */
+void grand_replay_close(FILE *fp,unsigned int last,unsigned int second)
+{
+  unsigned int tail[2] = {last,second};
+
+  fseek(fp,FILE_HDR_LAST_EVENT*INTSIZE,SEEK_SET);
+  fwrite(tail,sizeof(tail),1,fp);
+  fclose(fp);
+}
+
+/**
+ * \brief Note the events of a file sequence that are in its HDF5 output
+ * @param[in] rf: the file sequence
+ * @param[in] eventnr: the event numbers seen
+ * @param[in] n: the number of event numbers
+ * @param[in] now: the time of the check
+ */
+void grand_replay_seen(ReplayFile *rf,unsigned int *eventnr,int n,double now)
+{
+  long k;
+
+  for(int i=0;i<n;i++){
+    k = (long)eventnr[i]-1;
+    if(k<rf->first || k>=rf->first+rf->n || latency[k] >= 0) continue;
+    latency[k] = now-written[k];
+    rf->n_seen++;
+  }
+}
+
+/**
+ * \brief Check the HDF5 output of a file sequence for new events
+ * @param[in] pattern: the name of the output, with the run number and file sequence
+ * @param[in] runnr: the run number
+ * @param[in,out] rf: the file sequence
+ */
+void grand_replay_poll(char *pattern,int runnr,ReplayFile *rf)
+{
+  char hdfname[VIEW_NAME_LENGTH];
+  EventHeader header[REPLAY_LIVE];
+  unsigned int eventnr[REPLAY_LIVE];
+  int n,opened;
+
+  if(rf->n_seen == rf->n && rf->closed) return;
+  snprintf(hdfname,sizeof(hdfname),pattern,runnr,rf->fileseq);
+  if(!rf->live){
+    if(access(hdfname,R_OK) != 0) return;
+    H5E_BEGIN_TRY {
+      opened = grand_HDF5open_live(hdfname,runnr,&rf->reader)>0;
+      if(opened && H5Lexists(rf->reader.run_id,"Live",H5P_DEFAULT) <= 0){
+        grand_HDF5close_run(&rf->reader);
+        opened = 0;
+      }
+    } H5E_END_TRY;
+    rf->live = opened;
+  }
+  if(rf->live){
+    while((n = grand_HDF5poll_live(&rf->reader,header,REPLAY_LIVE))>0){
+      for(int i=0;i<n;i++) eventnr[i] = header[i].eventnr;
+      grand_replay_seen(rf,eventnr,n,grand_replay_now());
+    }
+    if(rf->n_seen == rf->n && rf->closed){
+      grand_HDF5close_run(&rf->reader);
+      rf->live = 0;
+    }
+    return;
+  }
+  //a file without Live tables can be opened once its writer closed it
+  H5E_BEGIN_TRY {
+    opened = grand_HDF5open_run(hdfname,runnr,&rf->reader)>0;
+  } H5E_END_TRY;
+  if(!opened) return;
+  grand_replay_seen(rf,rf->reader.eventnr,rf->reader.n_events,grand_replay_now());
+  grand_HDF5close_run(&rf->reader);
+}
+
+int grand_replay_compare(const void *a,const void *b)
+{
+  double da = *(const double *)a,db = *(const double *)b;
+
+  return(da<db?-1:(da>db?1:0));
+}
+
+int main(int argc, char **argv) {
+  char *fieldname = "field_run22.txt";
+  char *pattern = NULL;
+  char filename[VIEW_NAME_LENGTH+40];
+  char *targetdir;
+  int header_synthetic[FILE_HDR_ADDITIONAL+1] = {FILE_HDR_ADDITIONAL*INTSIZE,0,0,0,1,0,0,0,0};
+  int *header = header_synthetic;
+  int ls_id[GRAND_N_ELEC_ID];
+  ReplaySource ad,td;
+  ReplayFile *rf = NULL;
+  unsigned short *event;
+  EventHeader *eh;
+  FILE *fp_ad = NULL,*fp_td = NULL;
+  double rate = 0,file_seconds = 0,wait = REPLAY_WAIT;
+  double t0,t_file = 0,t_poll = 0,now,target,lag,max_lag = 0;
+  long n_events = -1,file_events = REPLAY_FILE,n_td = 0,n_seen = 0;
+  unsigned long long bytes = 0;
+  unsigned int last_second = 0;
+  int runnr,srcrun,srcseq,fileseq = 1;
+  int tracelength = 1024,n_files = 0,opt,size;
+  double *lat;
+  void *p;
+
+  while((opt = getopt(argc,argv,"f:e:n:l:k:d:q:o:w:")) != -1){
+    switch(opt){
+    case 'f':
+      fieldname = optarg;
+      break;
+    case 'e':
+      rate = atof(optarg);
+      break;
+    case 'n':
+      n_events = atol(optarg);
+      break;
+    case 'l':
+      tracelength = atoi(optarg);
+      break;
+    case 'k':
+      file_events = atol(optarg);
+      break;
+    case 'd':
+      file_seconds = atof(optarg);
+      break;
+    case 'q':
+      fileseq = atoi(optarg);
+      break;
+    case 'o':
+      pattern = optarg;
+      break;
+    case 'w':
+      wait = atof(optarg);
+      break;
+    default:
+      printf(USAGE);
+      return(-1);
+    }
+  }
+  if((argc-optind != 2 && argc-optind != 5) || sscanf(argv[optind+1],"%d",&runnr) != 1 || rate<0 || tracelength<1){
+    printf(USAGE);
+    return(-1);
+  }
+  targetdir = argv[optind];
+  memset((void *)&ad,0,sizeof(ReplaySource));
+  memset((void *)&td,0,sizeof(ReplaySource));
+  if(argc-optind == 5){
+    if(sscanf(argv[optind+3],"%d",&srcrun) != 1 || sscanf(argv[optind+4],"%d",&srcseq) != 1){
+      printf(USAGE);
+      return(-1);
+    }
+    snprintf(filename,sizeof(filename),"%s/AD/ad%06d.f%04d",argv[optind+2],srcrun,srcseq);
+    if(grand_replay_load(filename,&ad) <= 0){
+      printf("No events in %s\n",filename);
+      return(-1);
+    }
+    //the file header of the source is kept, with the run number of the replay
+    if((fp_ad = fopen(filename,"r")) != NULL){
+      if((header = grand_read_file_header(fp_ad,&size)) == NULL) header = header_synthetic;
+      fclose(fp_ad);
+      fp_ad = NULL;
+    }
+    snprintf(filename,sizeof(filename),"%s/TD/td%06d.f%04d",argv[optind+2],srcrun,srcseq);
+    grand_replay_load(filename,&td);
+    if(n_events<0) n_events = ad.n;
+  }
+  else{
+    if(grand_HDF5initiate_field(fieldname)<0){
+      printf("Cannot load the field configuration %s\n",fieldname);
+      return(-1);
+    }
+    for(int i=0;i<field_size;i++) ls_id[i] = field[i].elec_id;
+    if(n_events<0) n_events = 10*REPLAY_FILE;
+  }
+  if(n_events == 0) return(0);
+  snprintf(filename,sizeof(filename),"%s",targetdir);
+  mkdir(filename,0755);
+  snprintf(filename,sizeof(filename),"%s/AD",targetdir);
+  mkdir(filename,0755);
+  snprintf(filename,sizeof(filename),"%s/TD",targetdir);
+  if(td.n>0) mkdir(filename,0755);
+  if((written = (double *)malloc(n_events*sizeof(double))) == NULL
+     || (latency = (double *)malloc(n_events*sizeof(double))) == NULL){
+    printf("Not enough memory for %ld events\n",n_events);
+    return(-1);
+  }
+  for(long k=0;k<n_events;k++) latency[k] = -1;
+
+  t0 = grand_replay_now();
+  for(long k=0;k<n_events;k++){
+    //rotation: the TD file is closed first, the daemon converts a sequence when its AD file is closed
+    if(fp_ad != NULL && (rf[n_files-1].n == file_events || (file_seconds>0 && grand_replay_now()-t_file >= file_seconds))){
+      if(fp_td != NULL) grand_replay_close(fp_td,n_td,last_second);
+      grand_replay_close(fp_ad,k,last_second);
+      fp_td = NULL;
+      fp_ad = NULL;
+      rf[n_files-1].closed = 1;
+      fileseq++;
+    }
+    if(fp_ad == NULL){
+      if((p = realloc(rf,(n_files+1)*sizeof(ReplayFile))) == NULL) break;
+      rf = p;
+      memset((void *)&rf[n_files],0,sizeof(ReplayFile));
+      rf[n_files].fileseq = fileseq;
+      rf[n_files].first = k;
+      if((fp_ad = grand_replay_create(targetdir,"AD","ad",runnr,fileseq,header)) == NULL) break;
+      if(td.n>0) fp_td = grand_replay_create(targetdir,"TD","td",runnr,fileseq,header);
+      n_files++;
+      t_file = grand_replay_now();
+    }
+    //an absolute schedule, so that a late event does not delay the ones after it
+    if(rate>0){
+      target = t0+k/rate;
+      while((now = grand_replay_now())<target){
+        if(pattern != NULL && now-t_poll >= REPLAY_POLL){
+          for(int i=0;i<n_files;i++) grand_replay_poll(pattern,runnr,&rf[i]);
+          t_poll = grand_replay_now();
+          continue;
+        }
+        usleep(1e6*(target-now<REPLAY_POLL?target-now:REPLAY_POLL));
+      }
+      if((lag = now-target)>max_lag) max_lag = lag;
+    }
+    if(ad.n>0){
+      event = ad.event[k%ad.n];
+      size = ad.size[k%ad.n];
+    }
+    else if((event = grand_synthetic_event(runnr,k+1,field_size,ls_id,tracelength,&size)) == NULL) break;
+    grand_replay_number(event,runnr,k+1);
+    eh = (EventHeader *)event;
+    last_second = eh->second;
+    if(fwrite(event,size,1,fp_ad) != 1){
+      printf("Cannot write event %ld\n",k+1);
+      break;
+    }
+    fflush(fp_ad);
+    written[k] = grand_replay_now();
+    bytes += size;
+    rf[n_files-1].n++;
+    //the periodic triggers keep their share of the events of the source
+    while(fp_td != NULL && n_td<(k+1)*td.n/ad.n){
+      event = td.event[n_td%td.n];
+      grand_replay_number(event,runnr,n_td+1);
+      fwrite(event,td.size[n_td%td.n],1,fp_td);
+      fflush(fp_td);
+      bytes += td.size[n_td%td.n];
+      n_td++;
+    }
+  }
+  if(fp_ad != NULL){
+    if(fp_td != NULL) grand_replay_close(fp_td,n_td,last_second);
+    grand_replay_close(fp_ad,rf[n_files-1].first+rf[n_files-1].n,last_second);
+    rf[n_files-1].closed = 1;
+  }
+  now = grand_replay_now();
+  n_events = n_files>0?rf[n_files-1].first+rf[n_files-1].n:0;
+  printf("Replayed %ld events and %ld periodic triggers in %d files in %.3f s: %.1f events/s, %.1f MB/s",
+         n_events,n_td,n_files,now-t0,n_events/(now-t0),bytes/1e6/(now-t0));
+  if(rate>0) printf(", at most %.1f ms behind the schedule of %.1f events/s",1e3*max_lag,rate);
+  printf("\n");
+
+  if(pattern != NULL){
+    target = grand_replay_now()+wait;
+    do{
+      n_seen = 0;
+      for(int i=0;i<n_files;i++){
+        grand_replay_poll(pattern,runnr,&rf[i]);
+        n_seen += rf[i].n_seen;
+      }
+      if(n_seen == n_events) break;
+      usleep(1e6*REPLAY_POLL);
+    }while(grand_replay_now()<target);
+    for(int i=0;i<n_files;i++) if(rf[i].live) grand_HDF5close_run(&rf[i].reader);
+    if((lat = (double *)malloc((n_seen+1)*sizeof(double))) != NULL){
+      n_seen = 0;
+      for(long k=0;k<n_events;k++) if(latency[k] >= 0) lat[n_seen++] = latency[k];
+      qsort(lat,n_seen,sizeof(double),grand_replay_compare);
+      printf("Seen %ld of %ld events in the HDF5 output",n_seen,n_events);
+      if(n_seen>0)
+        printf(", latency min %.1f ms, median %.1f ms, 99%% %.1f ms, max %.1f ms",1e3*lat[0],1e3*lat[n_seen/2],
+               1e3*lat[(99*n_seen)/100<n_seen?(99*n_seen)/100:n_seen-1],1e3*lat[n_seen-1]);
+      printf("\n");
+      free(lat);
+    }
+  }
+  free(written);
+  free(latency);
+  free(rf);
+  return(n_seen == n_events || pattern == NULL?0:1);
+}
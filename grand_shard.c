@@ -0,0 +1,262 @@
+/** \file grand_shard.c
+ *  \brief library routines to split the output of a run into shards
+ *
+ *  The writer rolls over to a new file after a number of bytes, events or GPS
+ *  seconds. Every shard is a complete run file, with its own compound types,
+ *  run header and run structure, named <base>_sNNN.hdf5. When a shard is
+ *  closed, its catalog entries are added, it is added to the run view and a
+ *  row is appended to the Shards table of <base>_index.hdf5, so closed shards
+ *  can be shipped and read while the run is still being written. Without
+ *  limits the output is the single file given. When several writers share a
+ *  catalog or view, these updates are serialized with a lock file.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "grand_hdf5.h"
+
+hid_t t_shard_info = -1;
+
+/**
+ * \brief Create the compound of the Shards table
+ */
+void grand_HDF5create_shard_info()
+{
+  hid_t t_name;
+
+  if(t_shard_info>0) return;
+  t_name = H5Tcopy(H5T_C_S1);
+  H5Tset_size(t_name,VIEW_NAME_LENGTH);
+  t_shard_info = H5Tcreate(H5T_COMPOUND,sizeof(ShardInfo));
+  H5Tinsert(t_shard_info,"Name",HOFFSET(ShardInfo,name),t_name);
+  H5Tinsert(t_shard_info,"Shard",HOFFSET(ShardInfo,shard),H5T_NATIVE_UINT);
+  H5Tinsert(t_shard_info,"FirstEvent",HOFFSET(ShardInfo,first_event),H5T_NATIVE_UINT);
+  H5Tinsert(t_shard_info,"LastEvent",HOFFSET(ShardInfo,last_event),H5T_NATIVE_UINT);
+  H5Tinsert(t_shard_info,"FirstSecond",HOFFSET(ShardInfo,first_second),H5T_NATIVE_UINT);
+  H5Tinsert(t_shard_info,"LastSecond",HOFFSET(ShardInfo,last_second),H5T_NATIVE_UINT);
+  H5Tinsert(t_shard_info,"Events",HOFFSET(ShardInfo,n_events),H5T_NATIVE_ULLONG);
+  H5Tinsert(t_shard_info,"Bytes",HOFFSET(ShardInfo,bytes),H5T_NATIVE_ULLONG);
+  H5Tclose(t_name);
+}
+
+/**
+ * \brief Initialize the output of a run, without limits
+ * @param[out] s: the sharded output
+ * @param[in] hdfname: the output file; with limits the shards are named after it
+ * @param[in] runnr: the run number
+ */
+void grand_HDF5shard_init(GrandShard *s,char *hdfname,int runnr)
+{
+  int len;
+
+  memset((void *)s,0,sizeof(GrandShard));
+  strncpy(s->base,hdfname,sizeof(s->base)-1);
+  s->runnr = runnr;
+  s->file_id = -1;
+  s->run_id = -1;
+  len = strlen(s->base);
+  if(len>5 && strcmp(&s->base[len-5],".hdf5") == 0) s->base[len-5] = 0;
+}
+
+/**
+ * \brief Set a roll-over limit
+ * @param[in,out] s: the sharded output
+ * @param[in] limit: number followed by k, M or G for bytes, e for events or s for GPS seconds
+ * \return 1: all ok
+ * \return -1: not a valid limit
+ */
+int grand_HDF5shard_limit(GrandShard *s,char *limit)
+{
+  double value;
+  char *unit;
+
+  value = strtod(limit,&unit);
+  if(unit == limit || value <= 0 || unit[0] == 0 || unit[1] != 0) return(-1);
+  switch(unit[0]){
+  case 'k':
+    s->max_bytes = value*1024;
+    break;
+  case 'M':
+    s->max_bytes = value*1024*1024;
+    break;
+  case 'G':
+    s->max_bytes = value*1024*1024*1024;
+    break;
+  case 'e':
+    s->max_events = value;
+    break;
+  case 's':
+    s->max_seconds = value;
+    break;
+  default:
+    return(-1);
+  }
+  return(1);
+}
+
+/**
+ * \brief Is the output split into shards
+ */
+int grand_HDF5shard_sharded(GrandShard *s)
+{
+  return(s->max_bytes>0 || s->max_events>0 || s->max_seconds>0);
+}
+
+/**
+ * \brief Open the next output file and create its run structure
+ * @param[in,out] s: the sharded output
+ * \return 1: all ok
+ * \return -2: the HDF5 file cannot be created
+ * \return -3: the file cannot be switched to single-writer/multiple-reader mode
+ */
+int grand_HDF5shard_start(GrandShard *s)
+{
+  memset((void *)&s->info,0,sizeof(ShardInfo));
+  s->info.shard = s->n_shards;
+  if(grand_HDF5shard_sharded(s))
+    snprintf(s->info.name,VIEW_NAME_LENGTH,"%s_s%03d.hdf5",s->base,s->n_shards);
+  else snprintf(s->info.name,VIEW_NAME_LENGTH,"%s.hdf5",s->base);
+  if(grand_HDF5create_file(s->info.name,s->runnr,&s->file_id,&s->run_id)<0){
+    printf("Cannot create %s\n",s->info.name);
+    return(-2);
+  }
+  s->n_shards++;
+  grand_HDF5create_run_structure(s->run_id);
+  if(s->swmr_cadence>0){
+    grand_HDF5fill_runheader(s->run_id);
+    if(grand_HDF5start_swmr(s->file_id,s->run_id,s->swmr_cadence)<0){
+      printf("Cannot switch %s to single-writer/multiple-reader mode\n",s->info.name);
+      grand_HDF5close_file(s->run_id,s->file_id);
+      s->file_id = -1;
+      return(-3);
+    }
+  }
+  return(1);
+}
+
+/**
+ * \brief Append the description of a closed shard to the Shards table of the index
+ * \return 1: all ok
+ * \return -1: the index cannot be written
+ */
+int grand_HDF5shard_index(GrandShard *s)
+{
+  char name[VIEW_NAME_LENGTH+20];
+  hid_t file_id,run_id;
+  int return_code;
+
+  grand_HDF5create_shard_info();
+  snprintf(name,sizeof(name),"%s_index.hdf5",s->base);
+  if(s->info.shard == 0) file_id = H5Fcreate(name,H5F_ACC_TRUNC,H5P_DEFAULT,H5P_DEFAULT);
+  else file_id = H5Fopen(name,H5F_ACC_RDWR,H5P_DEFAULT);
+  if(file_id<0) return(-1);
+  sprintf(name,"/Run_%d",s->runnr);
+  if(s->info.shard == 0) run_id = H5Gcreate(file_id,name,H5P_DEFAULT,H5P_DEFAULT,H5P_DEFAULT);
+  else run_id = H5Gopen(file_id,name,H5P_DEFAULT);
+  if(run_id<0){
+    H5Fclose(file_id);
+    return(-1);
+  }
+  return_code = grand_HDF5append_records(run_id,"Shards",t_shard_info,64,1,&s->info);
+  H5Gclose(run_id);
+  H5Fclose(file_id);
+  return(return_code<0?-1:1);
+}
+
+/**
+ * \brief Close the open output file: run header, catalog, view and index
+ * @param[in,out] s: the sharded output
+ * \return 1: all ok
+ * \return 0: no file was open
+ * \return -1: the catalog, view or index could not be updated
+ */
+int grand_HDF5shard_close(GrandShard *s)
+{
+  hsize_t size = 0;
+  int return_code = 1;
+  int lock = -1;
+
+  if(s->file_id<0) return(0);
+  grand_HDF5fill_runheader(s->run_id);
+  H5Fget_filesize(s->file_id,&size);
+  s->info.bytes = size;
+  s->total_bytes += size;
+  grand_HDF5close_file(s->run_id,s->file_id);
+  s->file_id = -1;
+  s->run_id = -1;
+  if(s->lockname != NULL && (lock = open(s->lockname,O_RDWR|O_CREAT,0644))>=0) flock(lock,LOCK_EX);
+  if(s->catalog != NULL && s->ncat>0 && grand_HDF5catalog_add(s->catalogname,s->info.name,s->catalog,s->ncat)<0){
+    printf("Cannot add the events to the catalog %s\n",s->catalogname);
+    return_code = -1;
+  }
+  s->ncat = 0;
+  if(s->viewname != NULL && grand_HDF5add_to_run_view(s->viewname,s->runnr,s->info.name)<0){
+    printf("Cannot add %s to the view %s\n",s->info.name,s->viewname);
+    return_code = -1;
+  }
+  if(grand_HDF5shard_sharded(s) && grand_HDF5shard_index(s)<0){
+    printf("Cannot add %s to the shard index\n",s->info.name);
+    return_code = -1;
+  }
+  if(lock>=0) close(lock);
+  if(s->catalog != NULL) free(s->catalog);
+  s->catalog = NULL;
+  s->ncat_alloc = 0;
+  return(return_code);
+}
+
+/**
+ * \brief Start writing an event, after rolling over to a new shard when a limit is reached
+ * @param[in,out] s: the sharded output
+ * @param[in] ev: the decoded event, only its header is needed
+ * \return 1: all ok
+ * \return 2: all ok, the event starts a new shard
+ * \return -4: no memory for the catalog
+ * \return <0: the last shard cannot be closed, a new shard cannot be opened or the event cannot be started
+ */
+int grand_HDF5shard_begin(GrandShard *s,GrandEvent *ev)
+{
+  EventHeader *eh = ev->header;
+  hsize_t size;
+  int return_code = 1;
+  CatalogEntry *catalog;
+  int n;
+
+  if(s->info.n_events>0 && grand_HDF5shard_sharded(s)){
+    size = 0;
+    if(s->max_bytes>0) H5Fget_filesize(s->file_id,&size);
+    if((s->max_events>0 && s->info.n_events >= s->max_events)
+       || (s->max_bytes>0 && size >= s->max_bytes)
+       || (s->max_seconds>0 && eh->second-s->info.first_second >= s->max_seconds)){
+      if((return_code = grand_HDF5shard_close(s))<0) return(return_code);
+      if((return_code = grand_HDF5shard_start(s))<0) return(return_code);
+      return_code = 2;
+    }
+  }
+  if(s->catalogname != NULL && s->ncat == s->ncat_alloc){
+    n = s->ncat_alloc == 0?1024:2*s->ncat_alloc;
+    if((catalog = realloc(s->catalog,n*sizeof(CatalogEntry))) == NULL) return(-4);
+    s->catalog = catalog;
+    s->ncat_alloc = n;
+  }
+  if((n = grand_HDF5begin_event(s->run_id,ev))<0) return(n);
+  if(s->info.n_events == 0){
+    s->info.first_event = eh->eventnr;
+    s->info.first_second = eh->second;
+  }
+  s->info.last_event = eh->eventnr;
+  s->info.last_second = eh->second;
+  s->info.n_events++;
+  if(s->catalogname != NULL){
+    s->catalog[s->ncat].second = eh->second;
+    s->catalog[s->ncat].nanosecond = eh->nanosecond;
+    s->catalog[s->ncat].runnr = eh->runnr;
+    s->catalog[s->ncat].eventnr = eh->eventnr;
+    s->ncat++;
+  }
+  return(return_code);
+}
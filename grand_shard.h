@@ -0,0 +1,49 @@
+/** \file grand_shard.h
+ *  \brief structures and routines to split the output of a run into shards
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_SHARD_H
+#define GRAND_SHARD_H
+
+typedef struct{
+  char name[VIEW_NAME_LENGTH];
+  unsigned int shard;
+  unsigned int first_event;
+  unsigned int last_event;
+  unsigned int first_second;
+  unsigned int last_second;
+  unsigned long long n_events;
+  unsigned long long bytes;
+}ShardInfo;
+
+typedef struct{
+  char base[VIEW_NAME_LENGTH-16];
+  int runnr;
+  long long max_bytes;
+  long long max_events;
+  unsigned int max_seconds;
+  int swmr_cadence;
+  char *catalogname;
+  char *viewname;
+  char *lockname;
+  int n_shards;
+  unsigned long long total_bytes;
+  hid_t file_id;
+  hid_t run_id;
+  ShardInfo info;
+  CatalogEntry *catalog;
+  int ncat;
+  int ncat_alloc;
+}GrandShard;
+
+void grand_HDF5shard_init(GrandShard *s,char *hdfname,int runnr);
+int grand_HDF5shard_limit(GrandShard *s,char *limit);
+int grand_HDF5shard_start(GrandShard *s);
+int grand_HDF5shard_begin(GrandShard *s,GrandEvent *ev);
+int grand_HDF5shard_close(GrandShard *s);
+
+#endif
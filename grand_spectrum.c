@@ -0,0 +1,629 @@
+/** \file grand_spectrum.c
+ *  \brief power spectra of the ADC traces, computed on worker threads during the conversion
+ *
+ *  The spectrum of a trace is the average of the one-sided power spectra of
+ *  its consecutive segments of nfft samples (Welch without overlap, Hann
+ *  window), in ADC counts squared per frequency bin; a trace shorter than
+ *  nfft is zero-padded and the samples after the last full segment are not
+ *  used. The real FFT is an in-tree radix-2 FFT of length nfft/2 on the
+ *  even and odd samples. The traces of an event are copied into a queue
+ *  when they are written and the worker threads compute their spectra while
+ *  the next antennas are written; the queue is drained at the end of the
+ *  event. Per trace, the spectra of an event are stored in raw/Spectra
+ *  (antenna row, channel, bin), or in Live/Spectra in single-writer mode.
+ *  Averaged, they are accumulated per antenna over the trigger-rate bins and
+ *  appended to Monitor/Spectrum.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+
+#define SPECTRUM_ROWS 64 /**< averaged spectra buffered before appending to the file */
+
+extern AntInfo *field;
+extern int field_size;
+extern int swmr_mode;
+extern int rate_seconds;
+
+int spectrum_mode = GRAND_SPECTRUM_NONE;
+int spectrum_nfft = SPECTRUM_NFFT;
+int spectrum_threads = 1;
+char *spectrum_name[GRAND_N_SPECTRUM] = {"none","trace","average"};
+/*! the worker threads, started with the first spectrum */
+SpectrumPool spectrum_pool;
+int spectrum_pool_open = 0;
+/*! type of the Monitor/Spectrum table, its size depends on nfft */
+hid_t t_spectrum_bin = -1;
+/*! the Live/Spectra table in single-writer/multiple-reader mode */
+hid_t live_spectra = -1;
+/*! the spectra of the event being written */
+float *spectrum_event = NULL;
+size_t spectrum_event_alloc = 0;
+/*! the open bin of every antenna, the sum of its spectra and the closed bins waiting for the file */
+SpectrumBin *spectrum_bin = NULL;
+double *spectrum_sum = NULL;
+char *spectrum_rows = NULL;
+int spectrum_row_count = 0;
+
+/**
+ * \brief Prepare the tables of a real FFT
+ * @param[out] plan: the tables
+ * @param[in] nfft: the FFT length, a power of 2
+ * \return 1: all ok
+ * \return -1: not a valid length
+ * \return -2: not enough memory
+ */
+int grand_spectrum_plan(SpectrumPlan *plan,int nfft)
+{
+  int m = nfft/2;
+  int bits = 0,rev;
+
+  memset((void *)plan,0,sizeof(SpectrumPlan));
+  if(nfft<SPECTRUM_MIN_NFFT || nfft>SPECTRUM_MAX_NFFT || (nfft&(nfft-1)) != 0) return(-1);
+  plan->nfft = nfft;
+  plan->bitrev = (int *)malloc(m*sizeof(int));
+  plan->tw_re = (float *)malloc(m/2*sizeof(float));
+  plan->tw_im = (float *)malloc(m/2*sizeof(float));
+  plan->post_re = (float *)malloc((m+1)*sizeof(float));
+  plan->post_im = (float *)malloc((m+1)*sizeof(float));
+  plan->window = (float *)malloc(nfft*sizeof(float));
+  if(plan->bitrev == NULL || plan->tw_re == NULL || plan->tw_im == NULL || plan->post_re == NULL
+     || plan->post_im == NULL || plan->window == NULL){
+    grand_spectrum_free_plan(plan);
+    return(-2);
+  }
+  while((1<<bits)<m) bits++;
+  for(int i=0;i<m;i++){
+    rev = 0;
+    for(int b=0;b<bits;b++) if(i&(1<<b)) rev |= 1<<(bits-1-b);
+    plan->bitrev[i] = rev;
+  }
+  for(int k=0;k<m/2;k++){
+    plan->tw_re[k] = cos(2*M_PI*k/m);
+    plan->tw_im[k] = -sin(2*M_PI*k/m);
+  }
+  for(int k=0;k<=m;k++){
+    plan->post_re[k] = cos(2*M_PI*k/nfft);
+    plan->post_im[k] = -sin(2*M_PI*k/nfft);
+  }
+  plan->window_power = 0;
+  for(int i=0;i<nfft;i++){
+    plan->window[i] = 0.5-0.5*cos(2*M_PI*i/nfft);
+    plan->window_power += plan->window[i]*plan->window[i];
+  }
+  return(1);
+}
+
+void grand_spectrum_free_plan(SpectrumPlan *plan)
+{
+  free(plan->bitrev);
+  free(plan->tw_re);
+  free(plan->tw_im);
+  free(plan->post_re);
+  free(plan->post_im);
+  free(plan->window);
+  memset((void *)plan,0,sizeof(SpectrumPlan));
+}
+
+/**
+ * \brief The power spectrum of a trace
+ * @param[in] plan: the FFT tables
+ * @param[in] trace: the ADC samples
+ * @param[in] length: the number of samples
+ * @param[out] power: nfft/2+1 bins
+ * @param[in] scratch: work buffer of nfft floats
+ */
+void grand_spectrum_compute(SpectrumPlan *plan,short *trace,int length,float *power,float *scratch)
+{
+  int nfft = plan->nfft,m = nfft/2;
+  int n_seg = length/nfft;
+  int count,half,step,a,b;
+  float *re = scratch,*im = &scratch[m];
+  float wr,wi,tr,ti,er,ei,dr,di,xr,xi;
+  short *x;
+  double scale;
+
+  for(int k=0;k<=m;k++) power[k] = 0;
+  if(length<=0) return;
+  if(n_seg == 0) n_seg = 1;
+  for(int seg=0;seg<n_seg;seg++){
+    x = &trace[seg*nfft];
+    count = length-seg*nfft<nfft?length-seg*nfft:nfft;
+    //the even and odd samples are the real and imaginary parts of a complex sequence, in bit-reversed order
+    for(int i=0;i<m;i++){
+      a = plan->bitrev[i];
+      re[a] = 2*i<count?x[2*i]*plan->window[2*i]:0;
+      im[a] = 2*i+1<count?x[2*i+1]*plan->window[2*i+1]:0;
+    }
+    for(int len=2;len<=m;len<<=1){
+      half = len>>1;
+      step = m/len;
+      for(int i=0;i<m;i+=len){
+        for(int k=0;k<half;k++){
+          wr = plan->tw_re[k*step];
+          wi = plan->tw_im[k*step];
+          a = i+k;
+          b = a+half;
+          tr = re[b]*wr-im[b]*wi;
+          ti = re[b]*wi+im[b]*wr;
+          re[b] = re[a]-tr;
+          im[b] = im[a]-ti;
+          re[a] += tr;
+          im[a] += ti;
+        }
+      }
+    }
+    //separate the spectra of the even and odd samples and combine them into the real spectrum
+    for(int k=0;k<=m;k++){
+      a = k%m;
+      b = (m-k)%m;
+      er = 0.5f*(re[a]+re[b]);
+      ei = 0.5f*(im[a]-im[b]);
+      dr = 0.5f*(im[a]+im[b]);
+      di = -0.5f*(re[a]-re[b]);
+      xr = er+dr*plan->post_re[k]-di*plan->post_im[k];
+      xi = ei+dr*plan->post_im[k]+di*plan->post_re[k];
+      power[k] += xr*xr+xi*xi;
+    }
+  }
+  scale = 1.0/(plan->window_power*n_seg);
+  for(int k=0;k<=m;k++) power[k] *= (k == 0 || k == m?1:2)*scale;
+}
+
+void *grand_spectrum_worker(void *arg)
+{
+  SpectrumPool *pool = (SpectrumPool *)arg;
+  float *scratch = (float *)malloc(pool->plan.nfft*sizeof(float));
+  SpectrumJob *job;
+
+  pthread_mutex_lock(&pool->lock);
+  while(1){
+    while(!pool->stop && pool->next == pool->n_jobs) pthread_cond_wait(&pool->work,&pool->lock);
+    if(pool->next == pool->n_jobs) break;
+    job = &pool->job[pool->next++];
+    pthread_mutex_unlock(&pool->lock);
+    if(scratch != NULL) grand_spectrum_compute(&pool->plan,job->trace,job->length,job->power,scratch);
+    else memset((void *)job->power,0,(pool->plan.nfft/2+1)*sizeof(float));
+    pthread_mutex_lock(&pool->lock);
+    if(++pool->n_done == pool->n_jobs) pthread_cond_broadcast(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  free(scratch);
+  return(NULL);
+}
+
+/**
+ * \brief Start the worker threads
+ * @param[out] pool: the workers and their queue
+ * @param[in] nfft: the FFT length, a power of 2
+ * @param[in] n_threads: the number of threads, 0 to compute the spectra when they are queued
+ * \return 1: all ok
+ * \return -1: not a valid length or number of threads
+ * \return -2: not enough memory or the threads cannot be started
+ */
+int grand_spectrum_pool_open(SpectrumPool *pool,int nfft,int n_threads)
+{
+  int return_code;
+
+  memset((void *)pool,0,sizeof(SpectrumPool));
+  if(n_threads<0 || n_threads>SPECTRUM_MAX_THREADS) return(-1);
+  if((return_code = grand_spectrum_plan(&pool->plan,nfft))<0) return(return_code);
+  pthread_mutex_init(&pool->lock,NULL);
+  pthread_cond_init(&pool->work,NULL);
+  pthread_cond_init(&pool->done,NULL);
+  if(n_threads == 0 && (pool->scratch = (float *)malloc(nfft*sizeof(float))) == NULL){
+    grand_spectrum_pool_close(pool);
+    return(-2);
+  }
+  for(int i=0;i<n_threads;i++){
+    if(pthread_create(&pool->thread[i],NULL,grand_spectrum_worker,pool) != 0){
+      grand_spectrum_pool_close(pool);
+      return(-2);
+    }
+    pool->n_threads++;
+  }
+  return(1);
+}
+
+/**
+ * \brief Queue a copy of a trace for its spectrum
+ * @param[in] key: identifies the trace in the results
+ * \return 1: all ok
+ * \return -1: not enough memory
+ */
+int grand_spectrum_add(SpectrumPool *pool,short *trace,int length,int key)
+{
+  SpectrumJob *job;
+
+  if(pool->n_jobs == pool->n_alloc){
+    //the workers do not use the queue while it is reallocated
+    grand_spectrum_wait(pool);
+    if((job = (SpectrumJob *)realloc(pool->job,(pool->n_alloc+SPECTRUM_BLOCK)*sizeof(SpectrumJob))) == NULL) return(-1);
+    memset((void *)&job[pool->n_alloc],0,SPECTRUM_BLOCK*sizeof(SpectrumJob));
+    pool->job = job;
+    pool->n_alloc += SPECTRUM_BLOCK;
+  }
+  job = &pool->job[pool->n_jobs];
+  if(job->power == NULL && (job->power = (float *)malloc((pool->plan.nfft/2+1)*sizeof(float))) == NULL) return(-1);
+  if(job->alloc<length){
+    free(job->trace);
+    job->alloc = 0;
+    if((job->trace = (short *)malloc(length*SHORTSIZE)) == NULL) return(-1);
+    job->alloc = length;
+  }
+  memcpy(job->trace,trace,length*SHORTSIZE);
+  job->length = length;
+  job->key = key;
+  if(pool->n_threads == 0){
+    grand_spectrum_compute(&pool->plan,job->trace,length,job->power,pool->scratch);
+    pool->n_jobs++;
+    pool->next++;
+    pool->n_done++;
+    return(1);
+  }
+  pthread_mutex_lock(&pool->lock);
+  pool->n_jobs++;
+  pthread_cond_signal(&pool->work);
+  pthread_mutex_unlock(&pool->lock);
+  return(1);
+}
+
+/**
+ * \brief Wait until the spectra of all queued traces are computed
+ */
+void grand_spectrum_wait(SpectrumPool *pool)
+{
+  if(pool->n_threads == 0) return;
+  pthread_mutex_lock(&pool->lock);
+  while(pool->n_done<pool->n_jobs) pthread_cond_wait(&pool->done,&pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * \brief Empty the queue once its results have been used
+ */
+void grand_spectrum_reset(SpectrumPool *pool)
+{
+  grand_spectrum_wait(pool);
+  pthread_mutex_lock(&pool->lock);
+  pool->n_jobs = pool->next = pool->n_done = 0;
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * \brief Stop the worker threads and free the queue
+ */
+void grand_spectrum_pool_close(SpectrumPool *pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->work);
+  pthread_mutex_unlock(&pool->lock);
+  for(int i=0;i<pool->n_threads;i++) pthread_join(pool->thread[i],NULL);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->work);
+  pthread_cond_destroy(&pool->done);
+  for(int i=0;i<pool->n_alloc;i++){
+    free(pool->job[i].trace);
+    free(pool->job[i].power);
+  }
+  free(pool->job);
+  free(pool->scratch);
+  grand_spectrum_free_plan(&pool->plan);
+  memset((void *)pool,0,sizeof(SpectrumPool));
+}
+
+/**
+ * \brief Select the spectra computed for the files written afterwards
+ * @param[in] mode: one of the GRAND_SPECTRUM_* values
+ * @param[in] nfft: the FFT length, a power of 2, 0 for the default
+ * @param[in] n_threads: the number of worker threads, 0 to compute the spectra in the writing thread
+ * \return 1: all ok
+ * \return -1: unknown mode, or not a valid length or number of threads
+ */
+int grand_HDF5set_spectrum(int mode,int nfft,int n_threads)
+{
+  if(nfft == 0) nfft = SPECTRUM_NFFT;
+  if(mode<0 || mode>=GRAND_N_SPECTRUM || nfft<SPECTRUM_MIN_NFFT || nfft>SPECTRUM_MAX_NFFT || (nfft&(nfft-1)) != 0
+     || n_threads<0 || n_threads>SPECTRUM_MAX_THREADS) return(-1);
+  if(spectrum_pool_open && (nfft != spectrum_nfft || n_threads != spectrum_threads)){
+    grand_spectrum_pool_close(&spectrum_pool);
+    spectrum_pool_open = 0;
+  }
+  if(t_spectrum_bin>=0 && nfft != spectrum_nfft){
+    H5Tclose(t_spectrum_bin);
+    t_spectrum_bin = -1;
+  }
+  spectrum_mode = mode;
+  spectrum_nfft = nfft;
+  spectrum_threads = n_threads;
+  return(1);
+}
+
+/**
+ * \brief Find a spectrum mode by name
+ * @param[in] name: the name of the mode (none, trace, average)
+ * \return -1: unknown mode
+ * \return otherwise: the mode
+ */
+int grand_HDF5spectrum_id(char *name)
+{
+  for(int i=0;i<GRAND_N_SPECTRUM;i++){
+    if(strcmp(name,spectrum_name[i]) == 0) return(i);
+  }
+  return(-1);
+}
+
+/**
+ * \brief Create the compound of the Monitor/Spectrum table for the current FFT length
+ */
+void grand_HDF5create_spectrum_bin()
+{
+  hid_t mem_type;
+  hsize_t dim[2] = {3,spectrum_nfft/2+1};
+
+  if(t_spectrum_bin>=0) return;
+  t_spectrum_bin = H5Tcreate(H5T_COMPOUND,sizeof(SpectrumBin)+3*dim[1]*sizeof(float));
+  H5Tinsert(t_spectrum_bin,"antenna_id",HOFFSET(SpectrumBin,id),H5T_NATIVE_USHORT);
+  H5Tinsert(t_spectrum_bin,"first_second",HOFFSET(SpectrumBin,first_second),H5T_NATIVE_UINT);
+  H5Tinsert(t_spectrum_bin,"bin_seconds",HOFFSET(SpectrumBin,bin_seconds),H5T_NATIVE_UINT);
+  mem_type = H5Tarray_create(H5T_NATIVE_UINT,1,dim);
+  H5Tinsert(t_spectrum_bin,"n_traces",HOFFSET(SpectrumBin,n_traces),mem_type);
+  H5Tclose(mem_type);
+  mem_type = H5Tarray_create(H5T_NATIVE_FLOAT,2,dim);
+  H5Tinsert(t_spectrum_bin,"power",sizeof(SpectrumBin),mem_type);
+  H5Tclose(mem_type);
+}
+
+/**
+ * \brief Create the table of the spectra per trace (antenna row, channel, bin)
+ * @param[in] loc_id: the group
+ * @param[in] n: the number of antenna rows, 0 for an extendible table
+ * \return <0: the table cannot be created
+ * \return otherwise: the table
+ */
+hid_t grand_HDF5spectrum_table(hid_t loc_id,hsize_t n)
+{
+  hsize_t dim[3] = {n,3,spectrum_nfft/2+1};
+  hsize_t max_dim[3] = {n,3,spectrum_nfft/2+1};
+  hsize_t chunk[3] = {n<64 && n>0?n:64,3,spectrum_nfft/2+1};
+  hid_t space,plist,data_set;
+
+  if(n == 0) max_dim[0] = H5S_UNLIMITED;
+  space = H5Screate_simple(3,dim,max_dim);
+  plist = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(plist,3,chunk);
+  data_set = H5Dcreate(loc_id,"Spectra",H5T_NATIVE_FLOAT,space,H5P_DEFAULT,plist,H5P_DEFAULT);
+  H5Pclose(plist);
+  H5Sclose(space);
+  return(data_set);
+}
+
+/**
+ * \brief Create the spectrum tables before the file switches to single-writer/multiple-reader mode
+ * @param[in] run_id: the run group
+ * @param[in] live_id: the Live group
+ * \return 1: all ok
+ * \return 0: no spectra
+ * \return -2: the tables cannot be created
+ */
+int grand_HDF5spectrum_swmr(hid_t run_id,hid_t live_id)
+{
+  hid_t data_set;
+
+  if(spectrum_mode == GRAND_SPECTRUM_TRACE){
+    if((live_spectra = grand_HDF5spectrum_table(live_id,0))<0) return(-2);
+    return(1);
+  }
+  if(spectrum_mode != GRAND_SPECTRUM_AVERAGE) return(0);
+  grand_HDF5create_spectrum_bin();
+  if((data_set = grand_HDF5open_table(run_id,"Monitor/Spectrum",t_spectrum_bin,SPECTRUM_ROWS))<0) return(-2);
+  H5Dclose(data_set);
+  return(1);
+}
+
+/**
+ * \brief Queue the traces of an antenna row for their spectra
+ * @param[in] ev: the decoded event
+ * @param[in] ic: the antenna row, its traces are only needed during this call
+ * \return 1: all ok
+ * \return 0: no spectra
+ * \return -1: the workers cannot be started or not enough memory
+ */
+int grand_HDF5spectrum_antenna(GrandEvent *ev,int ic)
+{
+  TraceSlice *slice = &ev->slice[ic];
+
+  if(spectrum_mode == GRAND_SPECTRUM_NONE) return(0);
+  if(!spectrum_pool_open){
+    if(grand_spectrum_pool_open(&spectrum_pool,spectrum_nfft,spectrum_threads)<0) return(-1);
+    spectrum_pool_open = 1;
+  }
+  for(int itrace=0;itrace<3;itrace++){
+    if(slice->trace[itrace] == NULL || slice->length[itrace]<=0) continue;
+    if(grand_spectrum_add(&spectrum_pool,slice->trace[itrace],slice->length[itrace],3*ic+itrace)<0) return(-1);
+  }
+  return(1);
+}
+
+/**
+ * \brief Close the open bin of an antenna into the buffer of the Monitor/Spectrum table
+ * \return 1: all ok
+ * \return -2: the table cannot be written
+ */
+int grand_HDF5spectrum_close_bin(hid_t run_id,int iant)
+{
+  int nbins = spectrum_nfft/2+1;
+  size_t row_size = sizeof(SpectrumBin)+3*nbins*sizeof(float);
+  SpectrumBin *sb = &spectrum_bin[iant];
+  double *sum = &spectrum_sum[(size_t)iant*3*nbins];
+  char *row;
+  float *power;
+  int return_code = 1;
+
+  if(sb->bin_seconds == 0) return(1);
+  if(spectrum_row_count == SPECTRUM_ROWS && grand_HDF5flush_spectra(run_id,0)<0) return_code = -2;
+  row = &spectrum_rows[spectrum_row_count++*row_size];
+  memcpy(row,sb,sizeof(SpectrumBin));
+  power = (float *)&row[sizeof(SpectrumBin)];
+  for(int itrace=0;itrace<3;itrace++){
+    for(int k=0;k<nbins;k++)
+      power[itrace*nbins+k] = sb->n_traces[itrace]>0?sum[itrace*nbins+k]/sb->n_traces[itrace]:0;
+  }
+  memset((void *)sb,0,sizeof(SpectrumBin));
+  memset((void *)sum,0,3*nbins*sizeof(double));
+  return(return_code);
+}
+
+/**
+ * \brief Add the spectra of an event to the bins of its antennas
+ * \return 1: all ok
+ * \return -1: not enough memory
+ * \return -2: the table cannot be written
+ */
+int grand_HDF5spectrum_average(hid_t run_id,GrandEvent *ev)
+{
+  int nbins = spectrum_nfft/2+1;
+  SpectrumJob *job;
+  SpectrumBin *sb;
+  double *sum;
+  unsigned int bin;
+  int ic,iant,itrace;
+  int return_code = 1;
+
+  if(spectrum_bin == NULL){
+    spectrum_bin = (SpectrumBin *)calloc(field_size,sizeof(SpectrumBin));
+    spectrum_sum = (double *)calloc((size_t)field_size*3*nbins,sizeof(double));
+    spectrum_rows = (char *)malloc(SPECTRUM_ROWS*(sizeof(SpectrumBin)+3*nbins*sizeof(float)));
+    spectrum_row_count = 0;
+    if(spectrum_bin == NULL || spectrum_sum == NULL || spectrum_rows == NULL) return(-1);
+  }
+  for(int i=0;i<spectrum_pool.n_jobs;i++){
+    job = &spectrum_pool.job[i];
+    ic = job->key/3;
+    itrace = job->key%3;
+    iant = ev->iant[ic];
+    sb = &spectrum_bin[iant];
+    bin = ev->ah[ic].seconds-ev->ah[ic].seconds%rate_seconds;
+    if(sb->bin_seconds != 0 && bin>sb->first_second && grand_HDF5spectrum_close_bin(run_id,iant)<0) return_code = -2;
+    if(sb->bin_seconds == 0){
+      sb->id = field[iant].id;
+      sb->first_second = bin;
+      sb->bin_seconds = rate_seconds;
+    }
+    sum = &spectrum_sum[((size_t)iant*3+itrace)*nbins];
+    for(int k=0;k<nbins;k++) sum[k] += job->power[k];
+    sb->n_traces[itrace]++;
+  }
+  return(return_code);
+}
+
+/**
+ * \brief Store the spectra of an event once all have been computed
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] raw_id: the raw group of the event, not used in single-writer/multiple-reader mode
+ * @param[in] ev: the decoded event
+ * \return 1: all ok
+ * \return 0: no spectra
+ * \return -1: No event is being written or not enough memory
+ * \return -2: the spectra cannot be written
+ */
+int grand_HDF5spectrum_end(hid_t run_id,hid_t raw_id,GrandEvent *ev)
+{
+  size_t nbins = spectrum_nfft/2+1;
+  hsize_t dim[3] = {0,3,nbins};
+  hsize_t start[3] = {0,0,0};
+  hsize_t count[3] = {ev->n,3,nbins};
+  hid_t data_set,space,mem_space;
+  SpectrumJob *job;
+  float *buf;
+  int return_code = 1;
+
+  if(spectrum_mode == GRAND_SPECTRUM_NONE || !spectrum_pool_open) return(0);
+  grand_spectrum_wait(&spectrum_pool);
+  if(spectrum_mode == GRAND_SPECTRUM_AVERAGE){
+    return_code = grand_HDF5spectrum_average(run_id,ev);
+    grand_spectrum_reset(&spectrum_pool);
+    return(return_code);
+  }
+  if((!swmr_mode && raw_id<0) || ev->n == 0){
+    grand_spectrum_reset(&spectrum_pool);
+    return(ev->n == 0?1:-1);
+  }
+  if(spectrum_event_alloc<ev->n*3*nbins){
+    if((buf = (float *)realloc(spectrum_event,ev->n*3*nbins*sizeof(float))) == NULL){
+      grand_spectrum_reset(&spectrum_pool);
+      return(-1);
+    }
+    spectrum_event = buf;
+    spectrum_event_alloc = ev->n*3*nbins;
+  }
+  //channels without a trace have an empty spectrum
+  memset((void *)spectrum_event,0,ev->n*3*nbins*sizeof(float));
+  for(int i=0;i<spectrum_pool.n_jobs;i++){
+    job = &spectrum_pool.job[i];
+    memcpy(&spectrum_event[job->key*nbins],job->power,nbins*sizeof(float));
+  }
+  grand_spectrum_reset(&spectrum_pool);
+  if(swmr_mode){
+    space = H5Dget_space(live_spectra);
+    H5Sget_simple_extent_dims(space,dim,NULL);
+    H5Sclose(space);
+    start[0] = dim[0];
+    dim[0] += ev->n;
+    if(H5Dset_extent(live_spectra,dim)<0) return(-2);
+    space = H5Dget_space(live_spectra);
+    H5Sselect_hyperslab(space,H5S_SELECT_SET,start,NULL,count,NULL);
+    mem_space = H5Screate_simple(3,count,NULL);
+    if(H5Dwrite(live_spectra,H5T_NATIVE_FLOAT,mem_space,space,H5P_DEFAULT,spectrum_event)<0) return_code = -2;
+    H5Sclose(mem_space);
+    H5Sclose(space);
+    return(return_code);
+  }
+  if((data_set = grand_HDF5spectrum_table(raw_id,ev->n))<0) return(-2);
+  if(H5Dwrite(data_set,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,spectrum_event)<0) return_code = -2;
+  H5Dclose(data_set);
+  return(return_code);
+}
+
+/**
+ * \brief Append the closed bins of the averaged spectra to the Monitor/Spectrum table
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] close_bins: also close and append the open bins, at the end of a file
+ * \return 1: all ok
+ * \return 0: no averaged spectra
+ * \return -2: Cannot write the spectrum table
+ */
+int grand_HDF5flush_spectra(hid_t run_id,int close_bins)
+{
+  int return_code = 1;
+
+  if(spectrum_bin == NULL) return(0);
+  for(int iant=0;close_bins && iant<field_size;iant++){
+    if(grand_HDF5spectrum_close_bin(run_id,iant)<0) return_code = -2;
+  }
+  grand_HDF5create_spectrum_bin();
+  if(grand_HDF5append_records(run_id,"Monitor/Spectrum",t_spectrum_bin,SPECTRUM_ROWS,
+                              spectrum_row_count,spectrum_rows)<0) return_code = -2;
+  spectrum_row_count = 0;
+  return(return_code);
+}
+
+/**
+ * \brief Flush the averaged spectra at the end of a file and free the buffers of the file
+ * @param[in] run_id: the run group in the HDF5 file
+ */
+void grand_HDF5close_spectra(hid_t run_id)
+{
+  grand_HDF5flush_spectra(run_id,1);
+  free(spectrum_bin);
+  free(spectrum_sum);
+  free(spectrum_rows);
+  spectrum_bin = NULL;
+  spectrum_sum = NULL;
+  spectrum_rows = NULL;
+  if(live_spectra>=0) H5Dclose(live_spectra);
+  live_spectra = -1;
+}
@@ -0,0 +1,85 @@
+/** \file grand_spectrum.h
+ *  \brief power spectra of the ADC traces, computed on worker threads during the conversion
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_SPECTRUM_H
+#define GRAND_SPECTRUM_H
+
+#include <pthread.h>
+
+#define GRAND_SPECTRUM_NONE    0 /**< no spectra */
+#define GRAND_SPECTRUM_TRACE   1 /**< a spectrum per trace, next to the traces of the event */
+#define GRAND_SPECTRUM_AVERAGE 2 /**< spectra averaged per antenna over the trigger-rate bins, in the Monitor group */
+#define GRAND_N_SPECTRUM       3
+
+#define SPECTRUM_NFFT        1024  /**< default FFT length in samples */
+#define SPECTRUM_MIN_NFFT    16
+#define SPECTRUM_MAX_NFFT    65536
+#define SPECTRUM_MAX_THREADS 64
+#define SPECTRUM_BLOCK       256   /**< traces queued before the queue has to be drained */
+
+/*! the tables of a real FFT of length nfft, computed as a complex FFT of length nfft/2 */
+typedef struct{
+  int nfft;
+  int *bitrev;
+  float *tw_re,*tw_im;     /**< exp(-2 pi i k/(nfft/2)), k < nfft/4 */
+  float *post_re,*post_im; /**< exp(-2 pi i k/nfft), k <= nfft/2 */
+  float *window;           /**< Hann window */
+  double window_power;     /**< sum of the squared window */
+}SpectrumPlan;
+
+/*! a trace waiting for its spectrum; the samples are a copy, the traces of an event are not kept */
+typedef struct{
+  short *trace;
+  int length;
+  int alloc;
+  int key;      /**< antenna row and channel, 3*ic+channel */
+  float *power; /**< nfft/2+1 bins */
+}SpectrumJob;
+
+/*! worker threads computing the spectra of the queued traces */
+typedef struct{
+  SpectrumPlan plan;
+  int n_threads;
+  pthread_t thread[SPECTRUM_MAX_THREADS];
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t done;
+  SpectrumJob *job;
+  int n_jobs;
+  int n_alloc;
+  int next;
+  int n_done;
+  int stop;
+  float *scratch; /**< work buffer of the caller when there are no threads */
+}SpectrumPool;
+
+/*! spectra of an antenna accumulated over a bin of GPS seconds */
+typedef struct{
+  unsigned short id;
+  unsigned int first_second;
+  unsigned int bin_seconds;
+  unsigned int n_traces[3];
+}SpectrumBin;
+
+int grand_spectrum_plan(SpectrumPlan *plan,int nfft);
+void grand_spectrum_free_plan(SpectrumPlan *plan);
+void grand_spectrum_compute(SpectrumPlan *plan,short *trace,int length,float *power,float *scratch);
+int grand_spectrum_pool_open(SpectrumPool *pool,int nfft,int n_threads);
+int grand_spectrum_add(SpectrumPool *pool,short *trace,int length,int key);
+void grand_spectrum_wait(SpectrumPool *pool);
+void grand_spectrum_reset(SpectrumPool *pool);
+void grand_spectrum_pool_close(SpectrumPool *pool);
+int grand_HDF5set_spectrum(int mode,int nfft,int n_threads);
+int grand_HDF5spectrum_id(char *name);
+int grand_HDF5spectrum_swmr(hid_t run_id,hid_t live_id);
+int grand_HDF5flush_spectra(hid_t run_id,int close_bins);
+void grand_HDF5close_spectra(hid_t run_id);
+int grand_HDF5spectrum_antenna(GrandEvent *ev,int ic);
+int grand_HDF5spectrum_end(hid_t run_id,hid_t raw_id,GrandEvent *ev);
+
+#endif
@@ -0,0 +1,271 @@
+/** \file grand_station.c
+ *  \brief antenna-major secondary layout of the traces, for analyses that read one antenna over a run
+ *
+ *  Next to the event groups, the traces of every antenna can also be
+ *  written to Antennas/Antenna_<i>, with i the number of the Traces_<i>
+ *  groups: Traces holds the X, Y and Z samples of all its traces in time
+ *  order, and Index has a row per trace with the event number, the offset
+ *  of the trace in Traces and the length of every channel (the LiveTrace
+ *  record). All traces of an antenna in a file are then a single
+ *  contiguous read. The traces are buffered per antenna and appended in
+ *  whole chunks, so that no chunk is written twice. The layout is per file and is not written in
+ *  single-writer/multiple-reader mode, where the Live tables hold the
+ *  traces.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+
+extern int field_size;
+extern int swmr_mode;
+extern hid_t t_live_trace;
+extern int trace_filter;
+
+/*! write the antenna-major layout to the files created afterwards */
+int station_layout = 0;
+/*! the buffers of the antennas of the field, while a file is written */
+StationBuffer *station = NULL;
+
+void grand_HDF5create_compounds();
+
+/**
+ * \brief Select whether the antenna-major layout is written
+ * @param[in] on: 1 to write it, 0 for the event groups only
+ * \return 1: all ok
+ */
+int grand_HDF5set_station_layout(int on)
+{
+  station_layout = on != 0;
+  return(1);
+}
+
+/**
+ * \brief Open the table of the samples of an antenna, it is created with the selected trace storage
+ * @param[in] group_id: the group of the antenna
+ * \return -1: the table cannot be opened or created
+ * \return otherwise: the dataset of the table
+ */
+hid_t grand_HDF5open_station_traces(hid_t group_id)
+{
+  hid_t data_set,plist,file_space;
+  hsize_t dim[1] = {0};
+  hsize_t max_dim[1] = {H5S_UNLIMITED};
+  hsize_t chunk = STATION_CHUNK;
+
+  if(H5Lexists(group_id,"Traces",H5P_DEFAULT)>0) return(H5Dopen(group_id,"Traces",H5P_DEFAULT));
+  //chunked as required for an extendable table, but uncompressed like the event groups unless a filter was selected
+  if(trace_filter != GRAND_TRACE_NONE) plist = grand_HDF5trace_creation(trace_filter,chunk);
+  else if((plist = H5Pcreate(H5P_DATASET_CREATE))<0 || H5Pset_chunk(plist,1,&chunk)<0) return(-1);
+  if((file_space = H5Screate_simple(1,dim,max_dim))<0){
+    H5Pclose(plist);
+    return(-1);
+  }
+  data_set = H5Dcreate(group_id,"Traces",H5T_NATIVE_SHORT,file_space,H5P_DEFAULT,plist,H5P_DEFAULT);
+  H5Sclose(file_space);
+  H5Pclose(plist);
+  return(data_set);
+}
+
+/**
+ * \brief Append the buffered traces of an antenna to its tables
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] iant: the antenna in the field
+ * @param[in] all: 1 to write all samples, at the end of a file; 0 to keep the samples after the last whole chunk
+ * \return 1: all ok
+ * \return 0: nothing buffered, or the antenna was dropped from the layout of this file
+ * \return -1: the tables cannot be created
+ * \return -2: the traces cannot be written
+ * On failure the tables of the antenna are removed and its layout is no longer written to this file,
+ * the traces stay in the event groups.
+ */
+int grand_HDF5flush_station(hid_t run_id,int iant,int all)
+{
+  StationBuffer *sb;
+  char grpname[50];
+  hid_t group_id,data_set;
+  int n;
+  int return_code = 1;
+
+  if(station == NULL || station[iant].failed || (station[iant].n_index == 0 && station[iant].n_samples == 0)) return(0);
+  sb = &station[iant];
+  n = all?sb->n_samples:sb->n_samples-sb->n_samples%STATION_CHUNK;
+  sprintf(grpname,"Antennas/Antenna_%d",iant+1);
+  group_id = -1;
+  if(H5Lexists(run_id,"Antennas",H5P_DEFAULT) <= 0 && (group_id = H5Gcreate(run_id,"Antennas",H5P_DEFAULT,H5P_DEFAULT,H5P_DEFAULT))<0)
+    return_code = -1;
+  else{
+    if(group_id>=0) H5Gclose(group_id);
+    if(H5Lexists(run_id,grpname,H5P_DEFAULT)>0) group_id = H5Gopen(run_id,grpname,H5P_DEFAULT);
+    else group_id = H5Gcreate(run_id,grpname,H5P_DEFAULT,H5P_DEFAULT,H5P_DEFAULT);
+    if(group_id<0) return_code = -1;
+  }
+  if(return_code == 1){
+    if((data_set = grand_HDF5open_station_traces(group_id))<0) return_code = -1;
+    else{
+      if(grand_HDF5append_table(data_set,H5T_NATIVE_SHORT,n,sb->samples)<0) return_code = -2;
+      H5Dclose(data_set);
+    }
+    if(return_code == 1 && grand_HDF5append_records(group_id,"Index",t_live_trace,STATION_INDEX,sb->n_index,sb->index)<0)
+      return_code = -2;
+    H5Gclose(group_id);
+  }
+  //the written part of the tables no longer matches, the antenna is dropped from the layout of this file
+  if(return_code<0){
+    printf("Cannot write %s, the antenna-major layout of this file has no antenna %d\n",grpname,iant+1);
+    H5E_BEGIN_TRY {
+      H5Ldelete(run_id,grpname,H5P_DEFAULT);
+    } H5E_END_TRY;
+    sb->failed = 1;
+    sb->n_samples = 0;
+    sb->n_index = 0;
+    return(return_code);
+  }
+  memmove(sb->samples,&sb->samples[n],(sb->n_samples-n)*SHORTSIZE);
+  sb->n_samples -= n;
+  sb->n_index = 0;
+  return(return_code);
+}
+
+/**
+ * \brief Add the traces of an antenna row to the antenna-major layout
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] ev: the decoded event
+ * @param[in] ic: the antenna row, its traces are only needed during this call
+ * \return 1: all ok
+ * \return 0: the layout is not written, or not for this antenna
+ * \return -1: not enough memory
+ * \return -2: the buffered traces cannot be written
+ */
+int grand_HDF5station_trace(hid_t run_id,GrandEvent *ev,int ic)
+{
+  TraceSlice *slice = &ev->slice[ic];
+  int iant = ev->iant[ic];
+  StationBuffer *sb;
+  LiveTrace *lt;
+  short *samples;
+  int n = 0,size;
+  int return_code = 1;
+
+  if(!station_layout || swmr_mode) return(0);
+  if(station == NULL && (station = (StationBuffer *)calloc(field_size,sizeof(StationBuffer))) == NULL) return(-1);
+  sb = &station[iant];
+  if(sb->failed) return(0);
+  for(int itrace=0;itrace<3;itrace++) if(slice->trace[itrace] != NULL) n += slice->length[itrace];
+  if(sb->n_samples+n>STATION_BUFFER || sb->n_index == STATION_INDEX){
+    if(grand_HDF5flush_station(run_id,iant,0)<0) return(-2);
+  }
+  if(sb->index == NULL && (sb->index = (LiveTrace *)malloc(STATION_INDEX*sizeof(LiveTrace))) == NULL) return(-1);
+  if(sb->n_samples+n>sb->alloc){
+    size = sb->n_samples+n>STATION_BUFFER?sb->n_samples+n:STATION_BUFFER;
+    if((samples = (short *)realloc(sb->samples,size*SHORTSIZE)) == NULL) return(-1);
+    sb->samples = samples;
+    sb->alloc = size;
+  }
+  lt = &sb->index[sb->n_index++];
+  memset((void *)lt,0,sizeof(LiveTrace));
+  lt->event_nr = ev->header->eventnr;
+  lt->antenna_id = iant+1;
+  lt->offset = sb->offset;
+  for(int itrace=0;itrace<3;itrace++){
+    if(slice->trace[itrace] == NULL) continue;
+    lt->length[itrace] = slice->length[itrace];
+    memcpy(&sb->samples[sb->n_samples],slice->trace[itrace],slice->length[itrace]*SHORTSIZE);
+    sb->n_samples += slice->length[itrace];
+  }
+  sb->offset += n;
+  return(return_code);
+}
+
+/**
+ * \brief Write the traces still buffered at the end of a file and free the buffers
+ * @param[in] run_id: the run group in the HDF5 file
+ * \return 1: all ok
+ * \return 0: the layout was not written
+ * \return -2: traces cannot be written
+ */
+int grand_HDF5close_stations(hid_t run_id)
+{
+  int return_code = 1;
+
+  if(station == NULL) return(0);
+  for(int iant=0;iant<field_size;iant++){
+    if(grand_HDF5flush_station(run_id,iant,1)<0) return_code = -2;
+    free(station[iant].samples);
+    free(station[iant].index);
+  }
+  free(station);
+  station = NULL;
+  return(return_code);
+}
+
+/**
+ * \brief Read a complete table of the antenna-major layout into a new buffer
+ * @param[in] group_id: the group of the antenna
+ * @param[in] name: the name of the table
+ * @param[in] type: the memory type
+ * @param[in] size: the size of an element
+ * @param[out] buf: the elements, to be freed by the caller
+ * \return >=0: the number of elements
+ * \return -2: not enough memory or the table cannot be read
+ */
+long grand_HDF5read_station_table(hid_t group_id,char *name,hid_t type,size_t size,void **buf)
+{
+  hid_t data_set,space;
+  hsize_t dim[1] = {0};
+  long return_code;
+
+  *buf = NULL;
+  if((data_set = H5Dopen(group_id,name,H5P_DEFAULT))<0) return(-2);
+  space = H5Dget_space(data_set);
+  H5Sget_simple_extent_dims(space,dim,NULL);
+  H5Sclose(space);
+  return_code = dim[0];
+  if((*buf = malloc(dim[0]*size+1)) == NULL) return_code = -2;
+  else if(dim[0]>0 && H5Dread(data_set,type,H5S_ALL,H5S_ALL,H5P_DEFAULT,*buf)<0) return_code = -2;
+  H5Dclose(data_set);
+  if(return_code<0){
+    free(*buf);
+    *buf = NULL;
+  }
+  return(return_code);
+}
+
+/**
+ * \brief Read all traces of an antenna in a file from the antenna-major layout
+ * @param[in] run_id: the run group in the HDF5 file
+ * @param[in] antenna: the number of the Traces_<antenna> groups of the antenna
+ * @param[out] samples: the X, Y and Z samples of the traces in time order, to be freed by the caller
+ * @param[out] index: the event number, offset in samples and channel lengths of every trace, to be freed by the caller
+ * @param[out] n_index: the number of traces
+ * \return >=0: the number of samples
+ * \return -1: the file has no antenna-major layout for this antenna
+ * \return -2: not enough memory or the tables cannot be read
+ */
+long grand_HDF5read_station(hid_t run_id,int antenna,short **samples,LiveTrace **index,int *n_index)
+{
+  char grpname[50];
+  hid_t group_id;
+  long n_samples,n;
+
+  *samples = NULL;
+  *index = NULL;
+  *n_index = 0;
+  grand_HDF5create_compounds();
+  sprintf(grpname,"Antennas/Antenna_%d",antenna);
+  if(H5Lexists(run_id,"Antennas",H5P_DEFAULT) <= 0 || H5Lexists(run_id,grpname,H5P_DEFAULT) <= 0) return(-1);
+  if((group_id = H5Gopen(run_id,grpname,H5P_DEFAULT))<0) return(-1);
+  n_samples = grand_HDF5read_station_table(group_id,"Traces",H5T_NATIVE_SHORT,SHORTSIZE,(void **)samples);
+  n = grand_HDF5read_station_table(group_id,"Index",t_live_trace,sizeof(LiveTrace),(void **)index);
+  H5Gclose(group_id);
+  if(n_samples<0 || n<0){
+    free(*samples);
+    free(*index);
+    *samples = NULL;
+    *index = NULL;
+    return(-2);
+  }
+  *n_index = n;
+  return(n_samples);
+}
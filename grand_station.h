@@ -0,0 +1,33 @@
+/** \file grand_station.h
+ *  \brief antenna-major secondary layout of the traces, for analyses that read one antenna over a run
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_STATION_H
+#define GRAND_STATION_H
+
+#define STATION_CHUNK  16384             /**< samples per chunk of an antenna table */
+#define STATION_BUFFER (8*STATION_CHUNK) /**< samples buffered per antenna, written a whole number of chunks at a time */
+#define STATION_INDEX  256               /**< index rows buffered per antenna */
+
+/*! the traces of an antenna waiting to be appended to its tables */
+typedef struct{
+  short *samples;
+  int n_samples;
+  int alloc;
+  LiveTrace *index;
+  int n_index;
+  unsigned long long offset; /**< samples of the antenna in the file, written and buffered */
+  int failed;                /**< an append failed, the antenna has no layout in this file */
+}StationBuffer;
+
+int grand_HDF5set_station_layout(int on);
+int grand_HDF5station_trace(hid_t run_id,GrandEvent *ev,int ic);
+int grand_HDF5flush_station(hid_t run_id,int iant,int all);
+int grand_HDF5close_stations(hid_t run_id);
+long grand_HDF5read_station(hid_t run_id,int antenna,short **samples,LiveTrace **index,int *n_index);
+
+#endif
@@ -0,0 +1,49 @@
+/** \file grand_timing.c
+ *  \brief reconstruction of the trigger times of the local stations
+ *
+ *  The local clock counter is interpolated between the two PPS edges that
+ *  bracket the trigger. ctd is the number of clock ticks between the PPS and the
+ *  trigger, ctp the number of ticks between this PPS and the next one. The GPS
+ *  quantization errors (ns) give the offset of each PPS edge with respect to the
+ *  true GPS second, so the corrected time within the second is
+ *
+ *    nanosec = quant0 + ctd*(1e9+quant1-quant0)/ctp
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include <math.h>
+#include "grand_timing.h"
+
+#define NSEC 1000000000. /**< nanoseconds in a second */
+
+/**
+ * Reconstruct the trigger times of n local stations. The arrays are
+ * separate columns so that the loop vectorizes across antennas.
+ * Stations without a valid PPS count (ctp == 0) keep the nanoseconds of the
+ * electronics.
+ * @param[in] n: number of stations
+ * @param[in] seconds: GPS second of the trigger
+ * @param[in] nano_seconds: nanoseconds reported by the electronics
+ * @param[in] ctd: clock ticks between PPS and trigger
+ * @param[in] ctp: clock ticks between two PPS
+ * @param[in] quant0: quantization error of the PPS before the trigger (ns)
+ * @param[in] quant1: quantization error of the PPS after the trigger (ns)
+ * @param[out] nanosec: corrected time within the GPS second (ns)
+ * @param[out] time_ns: corrected GPS time in ns
+ */
+void grand_trigger_times(int n,const unsigned int * restrict seconds,const unsigned int * restrict nano_seconds,
+                         const unsigned int * restrict ctd,const unsigned int * restrict ctp,
+                         const float * restrict quant0,const float * restrict quant1,
+                         double * restrict nanosec,long long * restrict time_ns)
+{
+  double period,ns;
+  
+  for(int i=0;i<n;i++){
+    period = (NSEC+(double)quant1[i]-(double)quant0[i])/(ctp[i]>0?(double)ctp[i]:1.);
+    ns = ctp[i]>0?(double)quant0[i]+(double)ctd[i]*period:(double)nano_seconds[i];
+    nanosec[i] = ns;
+    time_ns[i] = (long long)seconds[i]*1000000000LL+(long long)floor(ns+0.5);
+  }
+}
@@ -0,0 +1,22 @@
+/** \file grand_timing.h
+ *  \brief reconstruction of the trigger times of the local stations
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_TIMING_H
+#define GRAND_TIMING_H
+
+typedef struct{
+  long long time_ns;
+  double nanosec;
+}TriggerTime;
+
+void grand_trigger_times(int n,const unsigned int *seconds,const unsigned int *nano_seconds,
+                         const unsigned int *ctd,const unsigned int *ctp,
+                         const float *quant0,const float *quant1,
+                         double *nanosec,long long *time_ns);
+
+#endif
@@ -0,0 +1,23 @@
+/** \file grand_view.c
+ *  \brief build the run-wide view of the HDF5 files of the file sequences of a run
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+
+int main(int argc, char **argv) {
+  int runnr,return_code;
+
+  if(argc < 4 || sscanf(argv[2],"%d",&runnr) != 1){
+    printf("Use: grand_view [view] [runnr] [hdf5 file] ...\n");
+    return(-1);
+  }
+  if((return_code = grand_HDF5create_run_view(argv[1],runnr,argc-3,&argv[3]))<0){
+    printf("Cannot build the view %s of run %d (%d)\n",argv[1],runnr,return_code);
+    return(-1);
+  }
+  return(0);
+}
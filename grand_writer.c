@@ -0,0 +1,186 @@
+/** \file grand_writer.c
+ *  \brief output backends of a conversion: HDF5, raw columns or nothing
+ *
+ *  A backend receives the decoded events, the raw periodic events and the
+ *  monitor records. The HDF5 backend is the sharded output of grand_shard.c;
+ *  the null backend only decodes, which gives the cost of the decoding alone.
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#include "grand_hdf5.h"
+
+const GrandWriterOps *grand_writer[] = {&grand_hdf5_writer,&grand_columnar_writer,&grand_null_writer};
+#define GRAND_N_WRITERS (sizeof(grand_writer)/sizeof(grand_writer[0]))
+
+/**
+ * \brief Open the HDF5 output of a job, with its roll-over limits, catalog and view
+ * \return 1: all ok
+ * \return -1: not a valid roll-over limit
+ * \return -2: the output cannot be created
+ */
+int grand_hdf5_open(GrandWriter *w,GrandJob *job)
+{
+  char hdfname[VIEW_NAME_LENGTH];
+  GrandShard *s;
+
+  if((s = calloc(1,sizeof(GrandShard))) == NULL) return(-2);
+  w->state = s;
+  grand_job_outname(job,hdfname,sizeof(hdfname));
+  grand_HDF5shard_init(s,hdfname,job->runnr);
+  for(int i=0;i<job->nlimit;i++){
+    if(grand_HDF5shard_limit(s,job->limit[i])<0) return(-1);
+  }
+  s->swmr_cadence = job->swmr_cadence;
+  s->catalogname = job->catalogname;
+  s->viewname = job->viewname;
+  s->lockname = job->lockname;
+  if(grand_HDF5shard_start(s)<0) return(-2);
+  return(1);
+}
+
+int grand_hdf5_begin(GrandWriter *w,GrandEvent *ev)
+{
+  return(grand_HDF5shard_begin((GrandShard *)w->state,ev));
+}
+
+int grand_hdf5_antenna(GrandWriter *w,GrandEvent *ev,int ic)
+{
+  return(grand_HDF5write_antenna(((GrandShard *)w->state)->run_id,ev,ic));
+}
+
+int grand_hdf5_end(GrandWriter *w,GrandEvent *ev)
+{
+  return(grand_HDF5end_event(((GrandShard *)w->state)->run_id,ev));
+}
+
+/**
+ * \brief periodic data goes into the last shard
+ */
+int grand_hdf5_periodic(GrandWriter *w,unsigned short *event)
+{
+  GrandShard *s = (GrandShard *)w->state;
+
+  if(s->file_id<0) return(0);
+  return(grand_HDF5fill_periodic_event(s->run_id,event));
+}
+
+int grand_hdf5_monitor(GrandWriter *w,int iant,MonInfo *monitor)
+{
+  GrandShard *s = (GrandShard *)w->state;
+
+  if(s->file_id<0) return(0);
+  return(grand_HDF5write_monitor(s->run_id,iant,monitor));
+}
+
+int grand_hdf5_skipped(GrandWriter *w,SkippedRange *range)
+{
+  GrandShard *s = (GrandShard *)w->state;
+
+  if(s->file_id<0) return(0);
+  return(grand_HDF5write_skipped(s->run_id,range));
+}
+
+int grand_hdf5_close(GrandWriter *w)
+{
+  GrandShard *s = (GrandShard *)w->state;
+  int return_code;
+
+  return_code = grand_HDF5shard_close(s);
+  w->n_files = s->n_shards;
+  w->bytes = s->total_bytes;
+  return(return_code);
+}
+
+const GrandWriterOps grand_hdf5_writer = {"hdf5",grand_hdf5_open,grand_hdf5_begin,grand_hdf5_antenna,grand_hdf5_end,grand_hdf5_periodic,
+  grand_hdf5_monitor,grand_hdf5_skipped,grand_hdf5_close};
+
+int grand_null_open(GrandWriter *w,GrandJob *job)
+{
+  return(1);
+}
+
+int grand_null_event(GrandWriter *w,GrandEvent *ev)
+{
+  return(1);
+}
+
+int grand_null_antenna(GrandWriter *w,GrandEvent *ev,int ic)
+{
+  return(1);
+}
+
+int grand_null_close(GrandWriter *w)
+{
+  return(1);
+}
+
+const GrandWriterOps grand_null_writer = {"null",grand_null_open,grand_null_event,grand_null_antenna,grand_null_event,
+  NULL,NULL,NULL,grand_null_close};
+
+/**
+ * \brief Find an output backend by name
+ * @param[in] name: hdf5, columnar or null; NULL selects hdf5
+ * \return the backend, NULL if the name is unknown
+ */
+const GrandWriterOps *grand_writer_backend(char *name)
+{
+  if(name == NULL) return(&grand_hdf5_writer);
+  for(int i=0;i<GRAND_N_WRITERS;i++){
+    if(strcmp(name,grand_writer[i]->name) == 0) return(grand_writer[i]);
+  }
+  return(NULL);
+}
+
+/**
+ * \brief Open the output of a job with a backend
+ * @param[out] w: the writer
+ * @param[in] ops: the backend
+ * @param[in] job: the job, for the output name and options
+ * \return 1: all ok
+ * \return <0: the error of the backend, the writer is not open
+ */
+int grand_writer_open(GrandWriter *w,const GrandWriterOps *ops,GrandJob *job)
+{
+  int return_code;
+
+  memset((void *)w,0,sizeof(GrandWriter));
+  w->ops = ops;
+  if((return_code = ops->open(w,job))<0){
+    free(w->state);
+    w->state = NULL;
+  }
+  return(return_code);
+}
+
+/**
+ * \brief Write a decoded event whose traces are all available
+ * \return 1: all ok
+ * \return <0: the error of the backend
+ */
+int grand_writer_event(GrandWriter *w,GrandEvent *ev)
+{
+  int return_code;
+
+  if((return_code = w->ops->begin(w,ev))<0) return(return_code);
+  for(int ic=0;ic<ev->n;ic++){
+    if(w->ops->antenna(w,ev,ic)<0) return_code = -2;
+  }
+  if(w->ops->end(w,ev)<0) return_code = -2;
+  return(return_code);
+}
+
+/**
+ * \brief Close the output of a writer; n_files and bytes are then final
+ * \return the return code of the backend
+ */
+int grand_writer_close(GrandWriter *w)
+{
+  int return_code;
+
+  return_code = w->ops->close(w);
+  free(w->state);
+  w->state = NULL;
+  return(return_code);
+}
@@ -0,0 +1,74 @@
+/** \file grand_writer.h
+ *  \brief decoded event model and the interface of the output backends
+ *
+ *
+ *  Date: 18/10/2026
+ *
+ *  Author: C. Timmermans
+ */
+#ifndef GRAND_WRITER_H
+#define GRAND_WRITER_H
+
+typedef struct{
+  short *trace[3];
+  int length[3];
+}TraceSlice;
+
+/*! an event decoded from the binary format; the traces point into the raw event */
+typedef struct{
+  EventHeader *header;
+  int n;
+  int n_alloc;
+  int *iant;
+  AntHdr *ah;
+  TriggerTime *tt;
+  TraceSlice *slice;
+  long n_samples;
+}GrandEvent;
+
+typedef struct GrandWriter GrandWriter;
+
+/*! an output backend. An event is written with begin, antenna for every decoded antenna row and end;
+ *  the traces of a row are only valid during its antenna call. periodic, monitor and skipped may be NULL
+ *  when the backend does not store them */
+typedef struct{
+  char *name;
+  int (*open)(GrandWriter *w,GrandJob *job);
+  int (*begin)(GrandWriter *w,GrandEvent *ev);
+  int (*antenna)(GrandWriter *w,GrandEvent *ev,int ic);
+  int (*end)(GrandWriter *w,GrandEvent *ev);
+  int (*periodic)(GrandWriter *w,unsigned short *event);
+  int (*monitor)(GrandWriter *w,int iant,MonInfo *monitor);
+  int (*skipped)(GrandWriter *w,SkippedRange *range);
+  int (*close)(GrandWriter *w);
+}GrandWriterOps;
+
+struct GrandWriter{
+  const GrandWriterOps *ops;
+  void *state;
+  int n_files;
+  unsigned long long bytes;
+};
+
+extern const GrandWriterOps grand_hdf5_writer;
+extern const GrandWriterOps grand_null_writer;
+
+int grand_HDF5decode_begin(EventHeader *eh,GrandEvent *ev);
+int grand_HDF5decode_antenna(EventBody *eb,GrandEvent *ev);
+void grand_HDF5decode_end(GrandEvent *ev);
+int grand_HDF5decode_event(unsigned short *event,GrandEvent *ev);
+void grand_free_event(GrandEvent *ev);
+void grand_HDF5close_event();
+int grand_HDF5begin_event(hid_t run_id,GrandEvent *ev);
+int grand_HDF5write_antenna(hid_t run_id,GrandEvent *ev,int ic);
+int grand_HDF5end_event(hid_t run_id,GrandEvent *ev);
+int grand_HDF5update_rates(hid_t run_id,GrandEvent *ev);
+int grand_HDF5write_event(hid_t run_id,GrandEvent *ev);
+int grand_HDF5write_monitor(hid_t run_id,int iant,MonInfo *monitor);
+int grand_HDF5write_skipped(hid_t run_id,SkippedRange *range);
+const GrandWriterOps *grand_writer_backend(char *name);
+int grand_writer_open(GrandWriter *w,const GrandWriterOps *ops,GrandJob *job);
+int grand_writer_event(GrandWriter *w,GrandEvent *ev);
+int grand_writer_close(GrandWriter *w);
+
+#endif
@@ -1,63 +1,208 @@
+#include <unistd.h>
 #include "grand_hdf5.h"
 
+#ifdef GRAND_USE_MPI
+extern int mpi_rank;
+extern int mpi_size;
+#endif
+
+#define USAGE "Use: to_hdf5 [-f fieldfile] [-c catalog] [-p default|latest|paged|core] [-z none|deflate|shuffle|adc] [-s flush_cadence] [-g rate_bin_seconds] [-F none|trace|average] [-n nfft] [-t spectrum_threads] [-a] [-P] [-m] [-o hdf5 file] [-v view] [-r limit[k|M|G|e|s]] [-b hdf5|columnar|null] [-i stdio|mmap|async|direct] [-q read_depth] [basedir] [runnr] [fileseq]\n"
 
 int main(int argc, char **argv) {
-  //First: The binary data
-  char filename[200];
   int runnr,fileseq;
-  int readlength;
-  unsigned short *event;
-  //HDF5 stuff
-  char hdfname[100];
-  FILE *fp;
-  hid_t       file_id,run_id;
-  int nevt;
+  GrandJob job;
+  GrandJobStats stats;
+  int opt,bin_seconds;
+  //the antenna field
+  char *fieldname = "field_run22.txt";
+  //Event catalog
+  char *catalogname = NULL;
+  //single-writer/multiple-reader mode
+  int swmr_cadence = 0;
+  //output file and run-wide view
+  char *outname = NULL;
+  char *viewname = NULL;
+  //roll-over limits
+  char *limit[GRAND_MAX_LIMITS];
+  int nlimit = 0;
+  //output backend
+  char *backend = NULL;
+  //reader engine
+  int engine = GRAND_READER_STDIO;
+  int depth = 0;
+  //spectra of the traces
+  int spectra = GRAND_SPECTRUM_NONE;
+  int nfft = 0,n_threads = 1;
+  //traces of every antenna in time order, next to the event groups
+  int antenna_major = 0;
+  //min/max envelopes of the traces for event displays
+  int preview = 0;
+  //all MPI ranks write one file
+  int mpi = 0;
 
-  if(argc != 4){
-    printf("Use: to_hdf5 [basedir] [runnr] [fileseq]\n");
+  while((opt = getopt(argc,argv,"f:c:p:s:g:F:n:t:aPmo:v:r:z:b:i:q:")) != -1){
+    switch(opt){
+    case 'f':
+      fieldname = optarg;
+      break;
+    case 'c':
+      catalogname = optarg;
+      break;
+    case 'p':
+      if(grand_HDF5set_profile(grand_HDF5profile_id(optarg))<0){
+        printf("Unknown HDF5 profile %s\n",optarg);
+        return(-1);
+      }
+      break;
+    case 'z':
+      if(grand_HDF5set_trace_filter(grand_HDF5trace_filter_id(optarg))<0){
+        printf("Unknown or unavailable trace storage %s\n",optarg);
+        return(-1);
+      }
+      break;
+    case 's':
+      if(sscanf(optarg,"%d",&swmr_cadence) != 1 || swmr_cadence<1){
+        printf(USAGE);
+        return(-1);
+      }
+      break;
+    case 'g':
+      if(sscanf(optarg,"%d",&bin_seconds) != 1 || grand_HDF5set_rate_bin(bin_seconds)<0){
+        printf(USAGE);
+        return(-1);
+      }
+      break;
+    case 'F':
+      if((spectra = grand_HDF5spectrum_id(optarg))<0){
+        printf("Unknown spectrum mode %s\n",optarg);
+        return(-1);
+      }
+      break;
+    case 'n':
+      if(sscanf(optarg,"%d",&nfft) != 1){
+        printf(USAGE);
+        return(-1);
+      }
+      break;
+    case 't':
+      if(sscanf(optarg,"%d",&n_threads) != 1){
+        printf(USAGE);
+        return(-1);
+      }
+      break;
+    case 'a':
+      antenna_major = 1;
+      break;
+    case 'P':
+      preview = 1;
+      break;
+    case 'm':
+#ifdef GRAND_USE_MPI
+      mpi = 1;
+#else
+      printf("to_hdf5 was built without MPI, use make MPI=1\n");
+      return(-1);
+#endif
+      break;
+    case 'o':
+      outname = optarg;
+      break;
+    case 'v':
+      viewname = optarg;
+      break;
+    case 'r':
+      if(nlimit<GRAND_MAX_LIMITS) limit[nlimit++] = optarg;
+      break;
+    case 'b':
+      if(grand_writer_backend(optarg) == NULL){
+        printf("Unknown output backend %s\n",optarg);
+        return(-1);
+      }
+      backend = optarg;
+      break;
+    case 'i':
+      if((engine = grand_reader_engine_id(optarg))<0){
+        printf("Unknown reader engine %s\n",optarg);
+        return(-1);
+      }
+      break;
+    case 'q':
+      if(sscanf(optarg,"%d",&depth) != 1 || depth<1 || depth>READER_MAX_DEPTH){
+        printf(USAGE);
+        return(-1);
+      }
+      break;
+    default:
+      printf(USAGE);
+      return(-1);
+    }
+  }
+  if(argc-optind != 3){
+    printf(USAGE);
     return(-1);
   }
-  if(sscanf(argv[2],"%d",&runnr)!= 1){
-    printf("Use: to_hdf5 [basedir] [runnr] [fileseq]\n");
+  if(swmr_cadence>0) grand_HDF5swmr_profile();
+  if(antenna_major && swmr_cadence>0) printf("The antenna-major layout is not written in single-writer mode\n");
+  if(mpi && (swmr_cadence>0 || nlimit>0 || catalogname != NULL || viewname != NULL || backend != NULL || antenna_major
+             || spectra != GRAND_SPECTRUM_NONE || preview)){
+    printf("Only the HDF5 tables of the run are written with -m, it cannot be combined with -s, -r, -c, -v, -b, -a, -F or -P\n");
     return(-1);
   }
-  if(sscanf(argv[3],"%d",&fileseq) != 1){
-    printf("Use: to_hdf5 [basedir] [runnr] [fileseq]\n");
+  grand_HDF5set_station_layout(antenna_major);
+  grand_HDF5set_preview(preview);
+  if(grand_HDF5set_spectrum(spectra,nfft,n_threads)<0){
+    printf("The FFT length must be a power of 2 from %d to %d, with at most %d threads\n",
+           SPECTRUM_MIN_NFFT,SPECTRUM_MAX_NFFT,SPECTRUM_MAX_THREADS);
     return(-1);
   }
-  sprintf(hdfname,"Run%d.hdf5",runnr);
-  grand_HDF5create_file(hdfname,runnr, &file_id,&run_id);
-  grand_HDF5initiate_field("field_run22.txt");
-
-  sprintf(filename,"%s/AD/ad%06d.f%04d",argv[1],runnr,fileseq);
-  fp = fopen(filename,"r");
-  if(fp != NULL) {
-    nevt = 0;
-    grand_read_file_header(fp,&readlength);
-    while((event = grand_read_event(fp,&readlength))!= NULL){
-      if(((EventHeader *)event)->LSCNT<1)continue;
-      grand_HDF5fill_event(run_id,event);
-      nevt++;
-    }
-    fclose(fp);
-  }
-  grand_HDF5create_run_structure(run_id);
-  /*sprintf(filename,"%s/TD/td%06d.f%04d",argv[1],runnr,fileseq);
-  fp = fopen(filename,"r");
-  if(fp != NULL) {
-    grand_read_file_header(fp,&readlength);
-    while((event = grand_read_event(fp,&readlength))!= NULL){
-      if(((EventHeader *)event)->LSCNT<1)continue;
-      grand_HDF5fill_periodic_event(run_id,event);
-      nevt++;
-    }
-    fclose(fp);
-  }
-  printf("Wrote %d events\n",nevt);
-  // Next: monitoring data
-  sprintf(filename,"%s/MON/MO%06d.f%04d",argv[1],runnr,fileseq);
-  grand_HDF5fill_monitor(filename,run_id);*/
-  //place 4 antennas in the run
-  grand_HDF5fill_runheader(run_id);
-  grand_HDF5close_file(run_id,file_id);
+  if(sscanf(argv[optind+1],"%d",&runnr)!= 1){
+    printf(USAGE);
+    return(-1);
+  }
+  if(sscanf(argv[optind+2],"%d",&fileseq) != 1){
+    printf(USAGE);
+    return(-1);
+  }
+  grand_job_init(&job,argv[optind],runnr,fileseq);
+  if(outname != NULL) snprintf(job.outname,sizeof(job.outname),"%s",outname);
+  job.catalogname = catalogname;
+  job.viewname = viewname;
+  job.swmr_cadence = swmr_cadence;
+  for(int i=0;i<nlimit;i++) job.limit[i] = limit[i];
+  job.nlimit = nlimit;
+  job.backend = backend;
+  grand_reader_set_engine(engine,depth,0);
+  if(grand_HDF5initiate_field(fieldname)<0){
+    printf("Cannot load the field configuration %s\n",fieldname);
+    return(-1);
+  }
+#ifdef GRAND_USE_MPI
+  if(mpi){
+    MPI_Init(&argc,&argv);
+    grand_HDF5set_mpi(MPI_COMM_WORLD);
+    int return_code = grand_mpi_convert(&job,&stats);
+    if(mpi_rank == 0 && return_code>0)
+      printf("Wrote %ld events with %d ranks in %.2f s\n",stats.n_events+stats.n_periodic,mpi_size,stats.seconds);
+    grand_HDF5set_mpi(MPI_COMM_NULL);
+    MPI_Finalize();
+    return(return_code>0?0:-1);
+  }
+#endif
+  switch(grand_convert(&job,&stats)){
+  case -1:
+    printf(USAGE);
+    return(-1);
+  case -2:
+  case -3:
+    return(-1);
+  case -4:
+    printf("The output cannot be written, the conversion stopped after %ld events\n",stats.n_events);
+    return(-1);
+  case -5:
+    printf("The output cannot be closed after %ld events\n",stats.n_events);
+    return(-1);
+  }
+  printf("Wrote %ld events\n",stats.n_events+stats.n_periodic);
+  if(stats.n_skipped>0) printf("Skipped %d corrupted ranges, %llu bytes\n",stats.n_skipped,stats.skipped_bytes);
+  return(0);
 }